@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TraceCompressor.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <android-base/file.h>
+
+namespace android {
+namespace atrace {
+
+// Blocks are primed with this much of the preceding input, the largest
+// window deflate can refer back to.
+static constexpr size_t kDictionarySize = 32 * 1024;
+
+static constexpr size_t kMaxThreads = 8;
+
+namespace {
+
+struct Block {
+    std::vector<uint8_t> input;
+    std::vector<uint8_t> dictionary;
+    // The final block is always empty and only carries the end-of-stream marker.
+    bool last = false;
+
+    std::vector<uint8_t> output;
+    uLong adler = 0;
+    bool done = false;
+    bool ok = false;
+};
+
+class Compressor {
+public:
+    Compressor(int outFd, size_t threadCount) : mOutFd(outFd), mMaxPending(threadCount * 2) {
+        // Keep signals on the reading thread, where they interrupt read()
+        // and let a streaming trace end when the user hits ^C.
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_SETMASK, &all, &old);
+        for (size_t i = 0; i < threadCount; i++) {
+            mWorkers.emplace_back(&Compressor::workerMain, this);
+        }
+        mWriter = std::thread(&Compressor::writerMain, this);
+        pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    }
+
+    ~Compressor() {
+        {
+            std::lock_guard<std::mutex> lock(mLock);
+            mStopping = true;
+        }
+        mWorkAvailable.notify_all();
+        mProgress.notify_all();
+        for (auto& worker : mWorkers) {
+            worker.join();
+        }
+        mWriter.join();
+    }
+
+    // Queues a block, waiting while too many are in flight. Returns false
+    // once the output has failed and further input would be wasted.
+    bool submit(std::shared_ptr<Block> block) {
+        std::unique_lock<std::mutex> lock(mLock);
+        mProgress.wait(lock, [&]() { return mFailed || mPending.size() < mMaxPending; });
+        if (mFailed) {
+            return false;
+        }
+        mPending.push_back(block);
+        mWork.push_back(std::move(block));
+        mWorkAvailable.notify_one();
+        return true;
+    }
+
+    // Waits for the final block to be written.
+    bool finish() {
+        std::unique_lock<std::mutex> lock(mLock);
+        mProgress.wait(lock, [&]() { return mFailed || mFinished; });
+        return !mFailed;
+    }
+
+private:
+    void workerMain() {
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mWorkAvailable.wait(lock, [&]() { return mStopping || !mWork.empty(); });
+            if (mStopping) {
+                return;
+            }
+            std::shared_ptr<Block> block = std::move(mWork.front());
+            mWork.pop_front();
+            lock.unlock();
+            block->ok = deflateBlock(block.get());
+            lock.lock();
+            block->done = true;
+            mProgress.notify_all();
+        }
+    }
+
+    void writerMain() {
+        uLong adler = adler32(0, nullptr, 0);
+        // Default compression level, no preset dictionary.
+        static const uint8_t header[] = {0x78, 0x9c};
+        bool ok = android::base::WriteFully(mOutFd, header, sizeof(header));
+
+        std::unique_lock<std::mutex> lock(mLock);
+        while (ok) {
+            mProgress.wait(lock, [&]() {
+                return mStopping || (!mPending.empty() && mPending.front()->done);
+            });
+            if (mStopping) {
+                return;
+            }
+            std::shared_ptr<Block> block = std::move(mPending.front());
+            mPending.pop_front();
+            mProgress.notify_all();
+            lock.unlock();
+
+            if (!block->ok) {
+                lock.lock();
+                ok = false;
+                break;
+            }
+            if (!android::base::WriteFully(mOutFd, block->output.data(), block->output.size())) {
+                fprintf(stderr, "error writing deflated trace: %s (%d)\n", strerror(errno), errno);
+                lock.lock();
+                ok = false;
+                break;
+            }
+            adler = adler32_combine(adler, block->adler, block->input.size());
+
+            if (block->last) {
+                const uint8_t trailer[] = {
+                    static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16),
+                    static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler),
+                };
+                ok = android::base::WriteFully(mOutFd, trailer, sizeof(trailer));
+                lock.lock();
+                mFinished = ok;
+                break;
+            }
+            lock.lock();
+        }
+        mFailed = !ok;
+        mProgress.notify_all();
+    }
+
+    static bool deflateBlock(Block* block) {
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        // Raw deflate; the zlib header and trailer are written around the
+        // concatenated blocks.
+        int result = deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8,
+                                  Z_DEFAULT_STRATEGY);
+        if (result != Z_OK) {
+            fprintf(stderr, "error initializing zlib: %d\n", result);
+            return false;
+        }
+        if (!block->dictionary.empty()) {
+            deflateSetDictionary(&zs, block->dictionary.data(), block->dictionary.size());
+        }
+
+        // A sync flush leaves the output on a byte boundary without marking
+        // the end of the stream, so the next block can follow it directly.
+        int flush = block->last ? Z_FINISH : Z_SYNC_FLUSH;
+        zs.next_in = block->input.data();
+        zs.avail_in = block->input.size();
+        block->output.resize(deflateBound(&zs, block->input.size()) + 16);
+        while (true) {
+            zs.next_out = block->output.data() + zs.total_out;
+            zs.avail_out = block->output.size() - zs.total_out;
+            result = deflate(&zs, flush);
+            if (result == Z_STREAM_ERROR || result == Z_STREAM_END || zs.avail_out != 0) {
+                break;
+            }
+            block->output.resize(block->output.size() * 2);
+        }
+        block->output.resize(zs.total_out);
+        deflateEnd(&zs);
+
+        bool ok = block->last ? result == Z_STREAM_END : result == Z_OK || result == Z_BUF_ERROR;
+        if (!ok) {
+            fprintf(stderr, "error deflating trace: %d\n", result);
+            return false;
+        }
+        block->adler = adler32(adler32(0, nullptr, 0), block->input.data(), block->input.size());
+        return true;
+    }
+
+    const int mOutFd;
+    const size_t mMaxPending;
+
+    std::mutex mLock;
+    std::condition_variable mWorkAvailable;
+    // Signalled when a block is compressed or written, or the writer stops.
+    std::condition_variable mProgress;
+    // Blocks in output order, until written.
+    std::deque<std::shared_ptr<Block>> mPending;
+    // Blocks not yet picked up by a worker.
+    std::deque<std::shared_ptr<Block>> mWork;
+    bool mStopping = false;
+    bool mFailed = false;
+    bool mFinished = false;
+
+    std::vector<std::thread> mWorkers;
+    std::thread mWriter;
+};
+
+}  // namespace
+
+// Reads up to size bytes, or only what the first read() returns when
+// streaming. Returns the number of bytes read, or -1 on error.
+static ssize_t readBlock(int fd, uint8_t* buf, size_t size, const CompressOptions& options,
+                         bool* eof)
+{
+    size_t total = 0;
+    while (total < size) {
+        ssize_t n = read(fd, buf + total, size - total);
+        if (n < 0 && errno == EINTR) {
+            if (options.stopRequested && options.stopRequested()) {
+                *eof = true;
+                break;
+            }
+            continue;
+        }
+        if (n < 0) {
+            fprintf(stderr, "error reading trace: %s (%d)\n", strerror(errno), errno);
+            return -1;
+        }
+        if (n == 0) {
+            *eof = true;
+            break;
+        }
+        total += n;
+        if (options.streaming) {
+            break;
+        }
+    }
+    return total;
+}
+
+bool compressTrace(int inFd, int outFd, const CompressOptions& options)
+{
+    size_t threadCount = options.threadCount;
+    if (threadCount == 0) {
+        threadCount = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxThreads);
+    }
+    size_t blockSize = std::max<size_t>(options.blockSize, 1);
+
+    Compressor compressor(outFd, threadCount);
+    std::vector<uint8_t> dictionary;
+    bool ok = true;
+    bool eof = false;
+    while (!eof) {
+        auto block = std::make_shared<Block>();
+        block->input.resize(blockSize);
+        ssize_t n = readBlock(inFd, block->input.data(), blockSize, options, &eof);
+        if (n < 0) {
+            // Still finish the stream so that what was read can be decoded.
+            ok = false;
+            break;
+        }
+        if (n == 0) {
+            continue;
+        }
+        block->input.resize(n);
+        block->dictionary = dictionary;
+
+        // The window spans block boundaries, so carry over the tail of this
+        // block together with whatever is still in reach before it.
+        if (static_cast<size_t>(n) >= kDictionarySize) {
+            dictionary.assign(block->input.end() - kDictionarySize, block->input.end());
+        } else {
+            dictionary.insert(dictionary.end(), block->input.begin(), block->input.end());
+            if (dictionary.size() > kDictionarySize) {
+                dictionary.erase(dictionary.begin(), dictionary.end() - kDictionarySize);
+            }
+        }
+
+        if (!compressor.submit(std::move(block))) {
+            return false;
+        }
+    }
+
+    auto last = std::make_shared<Block>();
+    last->last = true;
+    if (!compressor.submit(std::move(last))) {
+        return false;
+    }
+    return compressor.finish() && ok;
+}
+
+}  // namespace atrace
+}  // namespace android
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_ATRACE_TRACE_COMPRESSOR_H
+#define ANDROID_ATRACE_TRACE_COMPRESSOR_H
+
+#include <stddef.h>
+
+#include <functional>
+
+namespace android {
+namespace atrace {
+
+struct CompressOptions {
+    static constexpr size_t kDefaultBlockSize = 256 * 1024;
+
+    // Amount of input deflated by each worker at a time.
+    size_t blockSize = kDefaultBlockSize;
+
+    // Number of compression threads; 0 picks one per core, up to a small limit.
+    size_t threadCount = 0;
+
+    // Hand each read() to the compressor as soon as it returns instead of
+    // waiting for a full block, so that a consumer of a live stream such as
+    // trace_pipe sees data with bounded latency.
+    bool streaming = false;
+
+    // Polled when a read is interrupted by a signal; returning true ends the
+    // input and finishes the stream cleanly.
+    std::function<bool()> stopRequested;
+};
+
+/*
+ * Deflates everything read from inFd into a single zlib stream on outFd.
+ *
+ * The input is cut into blocks which are deflated independently across a
+ * pool of threads, each ending on a byte boundary with a sync flush and
+ * primed with the last 32KB of the block before it, the same layout pigz
+ * uses. The blocks are written in order behind one zlib header and a
+ * combined adler32 trailer, so the result decodes with a plain inflate()
+ * just like the single-threaded output did. Reading, compressing and
+ * writing run concurrently.
+ *
+ * Returns false if reading, compressing or writing failed; errors are
+ * reported on stderr.
+ */
+bool compressTrace(int inFd, int outFd, const CompressOptions& options = CompressOptions());
+
+}  // namespace atrace
+}  // namespace android
+
+#endif  // ANDROID_ATRACE_TRACE_COMPRESSOR_H
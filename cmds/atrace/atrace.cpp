@@ -28,7 +28,6 @@
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
-#include <zlib.h>
 
 #include <fstream>
 #include <memory>
@@ -51,7 +50,11 @@
 #include <android-base/properties.h>
 #include <android-base/stringprintf.h>
 
+#include "TraceCompressor.h"
+
 using namespace android;
+using atrace::CompressOptions;
+using atrace::compressTrace;
 using pdx::default_transport::ServiceUtility;
 using hardware::hidl_vec;
 using hardware::hidl_string;
@@ -901,6 +904,16 @@ static void streamTrace()
                 strerror(errno), errno);
         return;
     }
+    if (g_compress) {
+        CompressOptions options;
+        options.streaming = true;
+        options.stopRequested = []() { return g_traceAborted; };
+        if (!compressTrace(traceFD, STDOUT_FILENO, options)) {
+            fprintf(stderr, "error compressing trace stream\n");
+        }
+        close(traceFD);
+        return;
+    }
     while (!g_traceAborted) {
         ssize_t bytes_read = read(traceFD, trace_data, 4096);
         if (bytes_read > 0) {
@@ -928,80 +941,8 @@ static void dumpTrace(int outFd)
     }
 
     if (g_compress) {
-        z_stream zs;
-        memset(&zs, 0, sizeof(zs));
-
-        int result = deflateInit(&zs, Z_DEFAULT_COMPRESSION);
-        if (result != Z_OK) {
-            fprintf(stderr, "error initializing zlib: %d\n", result);
-            close(traceFD);
-            return;
-        }
-
-        constexpr size_t bufSize = 64*1024;
-        std::unique_ptr<uint8_t> in(new uint8_t[bufSize]);
-        std::unique_ptr<uint8_t> out(new uint8_t[bufSize]);
-        if (!in || !out) {
-            fprintf(stderr, "couldn't allocate buffers\n");
-            close(traceFD);
-            return;
-        }
-
-        int flush = Z_NO_FLUSH;
-
-        zs.next_out = reinterpret_cast<Bytef*>(out.get());
-        zs.avail_out = bufSize;
-
-        do {
-
-            if (zs.avail_in == 0) {
-                // More input is needed.
-                result = read(traceFD, in.get(), bufSize);
-                if (result < 0) {
-                    fprintf(stderr, "error reading trace: %s (%d)\n",
-                            strerror(errno), errno);
-                    result = Z_STREAM_END;
-                    break;
-                } else if (result == 0) {
-                    flush = Z_FINISH;
-                } else {
-                    zs.next_in = reinterpret_cast<Bytef*>(in.get());
-                    zs.avail_in = result;
-                }
-            }
-
-            if (zs.avail_out == 0) {
-                // Need to write the output.
-                result = write(outFd, out.get(), bufSize);
-                if ((size_t)result < bufSize) {
-                    fprintf(stderr, "error writing deflated trace: %s (%d)\n",
-                            strerror(errno), errno);
-                    result = Z_STREAM_END; // skip deflate error message
-                    zs.avail_out = bufSize; // skip the final write
-                    break;
-                }
-                zs.next_out = reinterpret_cast<Bytef*>(out.get());
-                zs.avail_out = bufSize;
-            }
-
-        } while ((result = deflate(&zs, flush)) == Z_OK);
-
-        if (result != Z_STREAM_END) {
-            fprintf(stderr, "error deflating trace: %s\n", zs.msg);
-        }
-
-        if (zs.avail_out < bufSize) {
-            size_t bytes = bufSize - zs.avail_out;
-            result = write(outFd, out.get(), bytes);
-            if ((size_t)result < bytes) {
-                fprintf(stderr, "error writing deflated trace: %s (%d)\n",
-                        strerror(errno), errno);
-            }
-        }
-
-        result = deflateEnd(&zs);
-        if (result != Z_OK) {
-            fprintf(stderr, "error cleaning up zlib: %d\n", result);
+        if (!compressTrace(traceFD, outFd)) {
+            fprintf(stderr, "error compressing trace\n");
         }
     } else {
         char buf[4096];
@@ -1067,7 +1008,7 @@ static void showHelp(const char *cmd)
                     "  -n              ignore signals\n"
                     "  -s N            sleep for N seconds before tracing [default 0]\n"
                     "  -t N            trace for N seconds [default 5]\n"
-                    "  -z              compress the trace dump\n"
+                    "  -z              compress the trace dump (or stream, with --stream)\n"
                     "  --async_start   start circular trace and return immediately\n"
                     "  --async_dump    dump the current contents of circular trace buffer\n"
                     "  --async_stop    stop tracing and dump the current contents of circular\n"
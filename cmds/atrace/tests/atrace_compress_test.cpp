@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <string>
+#include <thread>
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/unique_fd.h>
+#include <gtest/gtest.h>
+
+#include "../TraceCompressor.h"
+
+using android::atrace::CompressOptions;
+using android::atrace::compressTrace;
+using android::base::StringPrintf;
+using android::base::unique_fd;
+
+namespace {
+
+// Roughly the shape of an ftrace text dump, with enough variation that
+// blocks don't compress down to nothing.
+std::string fakeTrace(size_t size) {
+    std::string trace = "# tracer: nop\n#\n";
+    for (int i = 0; trace.size() < size; i++) {
+        trace += StringPrintf("   surfaceflinger-%d   (  %d) [%03d] d..2 %d.%06d: "
+                              "sched_switch: prev_comm=binder:%d_%d prev_pid=%d ==> next_pid=%d\n",
+                              600 + i % 37, 600 + i % 37, i % 8, 1000 + i / 997, (i * 7919) % 1000000,
+                              i % 41, i % 13, 700 + i % 53, 800 + (i * 31) % 101);
+    }
+    trace.resize(size);
+    return trace;
+}
+
+// Decodes a single zlib stream with a plain inflate(), failing if there is
+// anything after the end of the stream.
+bool inflateAll(const std::string& compressed, std::string* out) {
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit(&zs) != Z_OK) {
+        return false;
+    }
+    out->clear();
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+    zs.avail_in = compressed.size();
+    char buf[64 * 1024];
+    int result;
+    do {
+        zs.next_out = reinterpret_cast<Bytef*>(buf);
+        zs.avail_out = sizeof(buf);
+        result = inflate(&zs, Z_NO_FLUSH);
+        out->append(buf, sizeof(buf) - zs.avail_out);
+    } while (result == Z_OK);
+    inflateEnd(&zs);
+    return result == Z_STREAM_END && zs.avail_in == 0;
+}
+
+}  // namespace
+
+class TraceCompressorTest : public ::testing::Test {
+  protected:
+    // Compresses the contents of a file standing in for the kernel's trace file.
+    std::string compressFile(const std::string& contents, const CompressOptions& options) {
+        std::string tracePath = std::string(dir_.path) + "/trace";
+        EXPECT_TRUE(android::base::WriteStringToFile(contents, tracePath));
+        unique_fd in(open(tracePath.c_str(), O_RDONLY | O_CLOEXEC));
+        EXPECT_NE(-1, in.get());
+
+        TemporaryFile out;
+        EXPECT_TRUE(compressTrace(in.get(), out.fd, options));
+        std::string compressed;
+        EXPECT_TRUE(android::base::ReadFileToString(out.path, &compressed));
+        return compressed;
+    }
+
+    TemporaryDir dir_;
+};
+
+TEST_F(TraceCompressorTest, RoundTripsAcrossThreadCounts) {
+    std::string trace = fakeTrace(3 * 1024 * 1024 + 123);
+    for (size_t threads : {1, 2, 4}) {
+        CompressOptions options;
+        options.threadCount = threads;
+        options.blockSize = 128 * 1024;
+        std::string compressed = compressFile(trace, options);
+        EXPECT_LT(compressed.size(), trace.size() / 4) << threads << " threads";
+
+        std::string decompressed;
+        ASSERT_TRUE(inflateAll(compressed, &decompressed)) << threads << " threads";
+        EXPECT_TRUE(decompressed == trace) << threads << " threads";
+    }
+}
+
+TEST_F(TraceCompressorTest, OutputDoesNotDependOnThreadCount) {
+    std::string trace = fakeTrace(1024 * 1024);
+    CompressOptions options;
+    options.blockSize = 64 * 1024;
+    options.threadCount = 1;
+    std::string serial = compressFile(trace, options);
+    options.threadCount = 4;
+    std::string parallel = compressFile(trace, options);
+    EXPECT_TRUE(serial == parallel);
+}
+
+TEST_F(TraceCompressorTest, EmptyTrace) {
+    std::string compressed = compressFile("", CompressOptions());
+    std::string decompressed = "not empty";
+    ASSERT_TRUE(inflateAll(compressed, &decompressed));
+    EXPECT_EQ("", decompressed);
+}
+
+TEST_F(TraceCompressorTest, SmallBlocks) {
+    std::string trace = fakeTrace(100 * 1000);
+    CompressOptions options;
+    options.blockSize = 1000;
+    std::string decompressed;
+    ASSERT_TRUE(inflateAll(compressFile(trace, options), &decompressed));
+    EXPECT_TRUE(decompressed == trace);
+}
+
+TEST_F(TraceCompressorTest, StreamingFromPipe) {
+    int fds[2];
+    ASSERT_EQ(0, pipe2(fds, O_CLOEXEC));
+    unique_fd readEnd(fds[0]);
+    unique_fd writeEnd(fds[1]);
+
+    // Feed the trace in uneven chunks, like trace_pipe delivers it.
+    std::string trace = fakeTrace(512 * 1024);
+    std::thread writer([&]() {
+        for (size_t pos = 0; pos < trace.size();) {
+            size_t len = std::min<size_t>(trace.size() - pos, 1 + (pos * 13) % 9000);
+            ASSERT_TRUE(android::base::WriteFully(writeEnd.get(), trace.data() + pos, len));
+            pos += len;
+        }
+        writeEnd.reset();
+    });
+
+    TemporaryFile out;
+    CompressOptions options;
+    options.streaming = true;
+    EXPECT_TRUE(compressTrace(readEnd.get(), out.fd, options));
+    writer.join();
+
+    std::string compressed;
+    ASSERT_TRUE(android::base::ReadFileToString(out.path, &compressed));
+    std::string decompressed;
+    ASSERT_TRUE(inflateAll(compressed, &decompressed));
+    EXPECT_TRUE(decompressed == trace);
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "dumpstate"
+
+#include "DumpPool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <android-base/file.h>
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+
+#include "DumpstateInternal.h"
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+DumpPool::DumpPool(const std::string& tmp_root) : tmp_root_(tmp_root) {
+}
+
+DumpPool::~DumpPool() {
+    shutdown();
+}
+
+void DumpPool::start(int thread_counts) {
+    std::lock_guard<std::mutex> lock(lock_);
+    if (!threads_.empty()) {
+        return;
+    }
+    shutdown_ = false;
+    for (int i = 0; i < thread_counts; i++) {
+        threads_.emplace_back(&DumpPool::loop, this);
+    }
+}
+
+void DumpPool::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        shutdown_ = true;
+        // When dumpstate bails out early, the sections nobody waits for needn't run. Dropping
+        // them makes their futures ready, with a broken promise.
+        queue_ = std::queue<std::packaged_task<void()>>();
+    }
+    condition_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+    threads_.clear();
+
+    for (auto& task : tasks_) {
+        task.second.done.wait();
+        android::base::RemoveFileIfExists(task.second.path);
+    }
+    tasks_.clear();
+}
+
+bool DumpPool::enqueueTaskWithFd(const std::string& task_name, std::function<void(int)> task) {
+    if (tasks_.count(task_name) != 0) {
+        MYLOGE("Task %s is already queued\n", task_name.c_str());
+        return false;
+    }
+
+    std::string path = tmp_root_ + "/dumpstate_pool_XXXXXX";
+    android::base::unique_fd fd(mkostemp(path.data(), O_CLOEXEC));
+    if (fd.get() == -1) {
+        MYLOGE("Could not create output for task %s: %s\n", task_name.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::packaged_task<void()> packaged_task(
+        [task = std::move(task), fd = std::make_shared<android::base::unique_fd>(std::move(fd))] {
+            task(fd->get());
+            fsync(fd->get());
+            fd->reset();
+        });
+    std::future<void> done = packaged_task.get_future();
+    {
+        std::lock_guard<std::mutex> lock(lock_);
+        if (shutdown_ || threads_.empty()) {
+            android::base::RemoveFileIfExists(path);
+            return false;
+        }
+        queue_.push(std::move(packaged_task));
+    }
+    condition_.notify_one();
+    tasks_[task_name] = {std::move(done), path};
+    return true;
+}
+
+bool DumpPool::waitForTask(const std::string& task_name, int out_fd) {
+    auto it = tasks_.find(task_name);
+    if (it == tasks_.end()) {
+        MYLOGE("Task %s was not queued\n", task_name.c_str());
+        return false;
+    }
+    it->second.done.wait();
+
+    std::string path = std::move(it->second.path);
+    tasks_.erase(it);
+
+    android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_CLOEXEC)));
+    if (fd.get() == -1) {
+        MYLOGE("Could not read output of task %s: %s\n", task_name.c_str(), strerror(errno));
+    } else {
+        char buffer[65536];
+        ssize_t bytes_read;
+        while ((bytes_read = TEMP_FAILURE_RETRY(read(fd.get(), buffer, sizeof(buffer)))) > 0) {
+            if (!android::base::WriteFully(out_fd, buffer, bytes_read)) {
+                MYLOGE("Could not copy output of task %s: %s\n", task_name.c_str(),
+                       strerror(errno));
+                break;
+            }
+        }
+    }
+    android::base::RemoveFileIfExists(path);
+    return true;
+}
+
+bool DumpPool::hasTask(const std::string& task_name) {
+    return tasks_.count(task_name) != 0;
+}
+
+void DumpPool::loop() {
+    std::unique_lock<std::mutex> lock(lock_);
+    while (true) {
+        condition_.wait(lock, [this] { return shutdown_ || !queue_.empty(); });
+        if (shutdown_) {
+            return;
+        }
+        std::packaged_task<void()> task = std::move(queue_.front());
+        queue_.pop();
+        lock.unlock();
+        task();
+        lock.lock();
+    }
+}
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
+#define FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
+
+#include <unistd.h>
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace os {
+namespace dumpstate {
+
+/*
+ * A bounded pool of worker threads used to run independent dumpstate sections concurrently.
+ *
+ * Each task writes into its own temporary file under |tmp_root| instead of the report. The
+ * buffered output is copied into the report by waitForTask(), so the report keeps the same order
+ * regardless of which task finishes first. Sections that depend on each other (or on the zip
+ * writer) should keep running inline on the main thread.
+ *
+ * Typical usage:
+ *
+ *    DumpPool pool(tmp_root);
+ *    pool.start();
+ *    pool.enqueueTaskWithFd("PROCESSES", [](int out_fd) { ... });
+ *    ...
+ *    pool.waitForTask("PROCESSES");
+ *    pool.shutdown();
+ */
+class DumpPool {
+  public:
+    static const int MAX_THREAD_COUNT = 4;
+
+    explicit DumpPool(const std::string& tmp_root);
+    ~DumpPool();
+
+    /*
+     * Starts |thread_counts| worker threads; does nothing if the pool is already running.
+     */
+    void start(int thread_counts = MAX_THREAD_COUNT);
+
+    /*
+     * Drops the queued tasks which have not started, waits for the running ones to finish, stops
+     * the workers and removes any output that was never collected by waitForTask().
+     */
+    void shutdown();
+
+    /*
+     * Queues |task| to run on a worker thread. |task| receives the file descriptor it should
+     * write its output to. |task_name| must be unique among the tasks not yet waited for.
+     *
+     * Returns false if the task could not be queued, in which case the caller should run the
+     * section inline.
+     */
+    bool enqueueTaskWithFd(const std::string& task_name, std::function<void(int)> task);
+
+    /*
+     * Waits for the task named |task_name| and copies its output to |out_fd|.
+     *
+     * Returns false if no such task was queued.
+     */
+    bool waitForTask(const std::string& task_name, int out_fd = STDOUT_FILENO);
+
+    /* Returns true if a task named |task_name| was queued and has not been waited for yet. */
+    bool hasTask(const std::string& task_name);
+
+  private:
+    struct TaskOutput {
+        std::future<void> done;
+        std::string path;
+    };
+
+    void loop();
+
+    std::string tmp_root_;
+
+    std::mutex lock_;
+    std::condition_variable condition_;
+    std::queue<std::packaged_task<void()>> queue_;
+    std::vector<std::thread> threads_;
+    bool shutdown_ = false;
+
+    // Accessed only from the thread that enqueues and waits for tasks.
+    std::map<std::string, TaskOutput> tasks_;
+
+    DISALLOW_COPY_AND_ASSIGN(DumpPool);
+};
+
+}  // namespace dumpstate
+}  // namespace os
+}  // namespace android
+
+#endif  // FRAMEWORK_NATIVE_CMD_DUMPPOOL_H_
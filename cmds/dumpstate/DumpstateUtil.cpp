@@ -20,10 +20,13 @@
 
 #include <dirent.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
 #include <sys/prctl.h>
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <vector>
 
 #include <android-base/file.h>
@@ -43,44 +46,62 @@ namespace {
 
 static constexpr const char* kSuPath = "/system/xbin/su";
 
+// Polling interval used while waiting for a child. SIGCHLD is process-wide, so when sections run
+// on several threads a signal may be consumed by a thread waiting for a different child; the
+// bounded wait makes sure the owner still notices its child exiting.
+static constexpr int kWaitPollIntervalMs = 50;
+
 static bool waitpid_with_timeout(pid_t pid, int timeout_ms, int* status) {
     sigset_t child_mask, old_mask;
     sigemptyset(&child_mask);
     sigaddset(&child_mask, SIGCHLD);
 
-    if (sigprocmask(SIG_BLOCK, &child_mask, &old_mask) == -1) {
-        printf("*** sigprocmask failed: %s\n", strerror(errno));
+    // sigprocmask() is unspecified in a multithreaded process, and the dump pool runs commands
+    // from several threads. Returns an error number rather than setting errno.
+    int mask_error = pthread_sigmask(SIG_BLOCK, &child_mask, &old_mask);
+    if (mask_error != 0) {
+        printf("*** pthread_sigmask failed: %s\n", strerror(mask_error));
         return false;
     }
 
-    timespec ts;
-    ts.tv_sec = MSEC_TO_SEC(timeout_ms);
-    ts.tv_nsec = (timeout_ms % 1000) * 1000000;
-    int ret = TEMP_FAILURE_RETRY(sigtimedwait(&child_mask, nullptr, &ts));
+    uint64_t deadline = Nanotime() + static_cast<uint64_t>(timeout_ms) * NANOS_PER_MILLI;
+    pid_t child_pid;
+    while ((child_pid = waitpid(pid, status, WNOHANG)) == 0) {
+        uint64_t now = Nanotime();
+        if (now >= deadline) {
+            break;
+        }
+        uint64_t wait_ns = std::min(deadline - now, kWaitPollIntervalMs * NANOS_PER_MILLI);
+        timespec ts;
+        ts.tv_sec = wait_ns / NANOS_PER_SEC;
+        ts.tv_nsec = wait_ns % NANOS_PER_SEC;
+        if (TEMP_FAILURE_RETRY(sigtimedwait(&child_mask, nullptr, &ts)) == -1 &&
+            errno != EAGAIN) {
+            printf("*** sigtimedwait failed: %s\n", strerror(errno));
+            child_pid = -1;
+            break;
+        }
+    }
     int saved_errno = errno;
 
     // Set the signals back the way they were.
-    if (sigprocmask(SIG_SETMASK, &old_mask, nullptr) == -1) {
-        printf("*** sigprocmask failed: %s\n", strerror(errno));
-        if (ret == 0) {
+    mask_error = pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+    if (mask_error != 0) {
+        printf("*** pthread_sigmask failed: %s\n", strerror(mask_error));
+        if (child_pid != pid) {
             return false;
         }
     }
-    if (ret == -1) {
-        errno = saved_errno;
-        if (errno == EAGAIN) {
-            errno = ETIMEDOUT;
-        } else {
-            printf("*** sigtimedwait failed: %s\n", strerror(errno));
-        }
+
+    if (child_pid == 0) {
+        errno = ETIMEDOUT;
         return false;
     }
-
-    pid_t child_pid = waitpid(pid, status, WNOHANG);
     if (child_pid != pid) {
         if (child_pid != -1) {
             printf("*** Waiting for pid %d, got pid %d instead\n", pid, child_pid);
         } else {
+            errno = saved_errno;
             printf("*** waitpid failed: %s\n", strerror(errno));
         }
         return false;
@@ -180,6 +201,7 @@ CommandOptions::CommandOptionsBuilder CommandOptions::WithTimeoutInMs(int64_t ti
 std::string PropertiesHelper::build_type_ = "";
 int PropertiesHelper::dry_run_ = -1;
 int PropertiesHelper::unroot_ = -1;
+int PropertiesHelper::parallel_run_ = -1;
 
 bool PropertiesHelper::IsUserBuild() {
     if (build_type_.empty()) {
@@ -202,6 +224,13 @@ bool PropertiesHelper::IsUnroot() {
     return unroot_ == 1;
 }
 
+bool PropertiesHelper::IsParallelRun() {
+    if (parallel_run_ == -1) {
+        parallel_run_ = android::base::GetBoolProperty("dumpstate.parallel_run", true) ? 1 : 0;
+    }
+    return parallel_run_ == 1;
+}
+
 int DumpFileToFd(int out_fd, const std::string& title, const std::string& path) {
     android::base::unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC)));
     if (fd.get() < 0) {
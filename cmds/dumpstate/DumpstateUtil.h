@@ -176,10 +176,19 @@ class PropertiesHelper {
      */
     static bool IsUnroot();
 
+    /*
+     * Whether independent sections may run concurrently on a worker pool.
+     *
+     * Enabled by default; set the system property `dumpstate.parallel_run` to false to run every
+     * section sequentially.
+     */
+    static bool IsParallelRun();
+
   private:
     static std::string build_type_;
     static int dry_run_;
     static int unroot_;
+    static int parallel_run_;
 };
 
 /*
@@ -43,6 +43,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <fstream>
@@ -312,6 +313,85 @@ static int DumpFile(const std::string& title, const std::string& path) {
     return ds.DumpFile(title, path);
 }
 
+// A section that only writes its own output, so it can run on the dump pool ahead of its place in
+// the report. Everything else keeps running inline on the main thread, in order.
+struct CommandSection {
+    std::string title;
+    std::vector<std::string> full_command;
+    CommandOptions options;
+};
+
+static std::vector<std::string> DumpsysCommand(const std::vector<std::string>& dumpsys_args) {
+    std::vector<std::string> dumpsys = {"/system/bin/dumpsys", "-T",
+                                        std::to_string(Dumpstate::DEFAULT_DUMPSYS.TimeoutInMs())};
+    dumpsys.insert(dumpsys.end(), dumpsys_args.begin(), dumpsys_args.end());
+    return dumpsys;
+}
+
+static const std::vector<CommandSection>& ParallelCommandSections() {
+    static const std::vector<CommandSection> sections = {
+        {"CPU INFO",
+         {"top", "-b", "-n", "1", "-H", "-s", "6", "-o",
+          "pid,tid,user,pr,ni,%cpu,s,virt,res,pcy,cmd,name"},
+         CommandOptions::DEFAULT},
+        {"PROCESSES AND THREADS",
+         {"ps", "-A", "-T", "-Z", "-O", "pri,nice,rtprio,sched,pcy,time"},
+         CommandOptions::DEFAULT},
+        {"NETSTAT", {"netstat", "-nW"}, CommandOptions::DEFAULT},
+        {"LIST OF OPEN FILES", {"lsof"}, CommandOptions::AS_ROOT},
+        {"SYSTEM PROPERTIES", {"getprop"}, CommandOptions::DEFAULT},
+        {"STORAGED IO INFO", {"storaged", "-u", "-p"}, CommandOptions::DEFAULT},
+        {"FILESYSTEMS & FREE SPACE", {"df"}, CommandOptions::DEFAULT},
+        {"CHECKIN BATTERYSTATS", DumpsysCommand({"batterystats", "-c"}),
+         Dumpstate::DEFAULT_DUMPSYS},
+        {"CHECKIN NETSTATS", DumpsysCommand({"netstats", "--checkin"}),
+         Dumpstate::DEFAULT_DUMPSYS},
+        {"CHECKIN PROCSTATS", DumpsysCommand({"procstats", "-c"}), Dumpstate::DEFAULT_DUMPSYS},
+        {"CHECKIN USAGESTATS", DumpsysCommand({"usagestats", "-c"}),
+         Dumpstate::DEFAULT_DUMPSYS},
+        {"CHECKIN PACKAGE", DumpsysCommand({"package", "--checkin"}),
+         Dumpstate::DEFAULT_DUMPSYS},
+    };
+    return sections;
+}
+
+/*
+ * Starts every section of ParallelCommandSections() on ds.dump_pool_, which buffers their output
+ * until RunCommandSection() is reached for the same title.
+ */
+static void EnqueueCommandSections() {
+    if (ds.dump_pool_ == nullptr) {
+        return;
+    }
+    for (const CommandSection& section : ParallelCommandSections()) {
+        ds.dump_pool_->enqueueTaskWithFd(section.title, [&section](int out_fd) {
+            DurationReporter duration_reporter(section.title, false /* logcat_only */,
+                                               false /* verbose */, out_fd);
+            RunCommandToFd(out_fd, section.title, section.full_command, section.options);
+        });
+    }
+}
+
+/*
+ * Writes the output of the section named |title| into the report: either collects it from the
+ * dump pool or, when it was not queued there, runs the command inline.
+ */
+static void RunCommandSection(const std::string& title) {
+    const auto& sections = ParallelCommandSections();
+    auto section = std::find_if(sections.begin(), sections.end(),
+                                [&title](const CommandSection& s) { return s.title == title; });
+    if (section == sections.end()) {
+        MYLOGE("Unknown command section %s\n", title.c_str());
+        return;
+    }
+    if (ds.dump_pool_ != nullptr && ds.dump_pool_->hasTask(title)) {
+        ds.dump_pool_->waitForTask(title);
+        ds.UpdateProgress(section->options.Timeout());
+        return;
+    }
+    ds.RunCommand(section->title, section->full_command, section->options);
+}
+
 // Relative directory (inside the zip) for all files copied as-is into the bugreport.
 static const std::string ZIP_ROOT_DIR = "FS";
 
@@ -1439,6 +1519,16 @@ static void DumpstateLimitedOnly() {
 static Dumpstate::RunStatus dumpstate() {
     DurationReporter duration_reporter("DUMPSTATE");
 
+    // Independent sections start right away on the dump pool; their output is spliced into the
+    // report at the usual place, so the report reads the same as a sequential run.
+    if (PropertiesHelper::IsParallelRun()) {
+        ds.dump_pool_ = std::make_unique<android::os::dumpstate::DumpPool>(
+            ds.bugreport_internal_dir_);
+        ds.dump_pool_->start();
+        EnqueueCommandSections();
+    }
+    auto dump_pool_guard = android::base::make_scope_guard([] { ds.dump_pool_ = nullptr; });
+
     // Dump various things. Note that anything that takes "long" (i.e. several seconds) should
     // check intermittently (if it's intrerruptable like a foreach on pids) and/or should be wrapped
     // in a consent check (via RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK).
@@ -1446,8 +1536,7 @@ static Dumpstate::RunStatus dumpstate() {
     RunCommand("UPTIME", {"uptime"});
     DumpBlockStatFiles();
     DumpFile("MEMORY INFO", "/proc/meminfo");
-    RunCommand("CPU INFO", {"top", "-b", "-n", "1", "-H", "-s", "6", "-o",
-                            "pid,tid,user,pr,ni,%cpu,s,virt,res,pcy,cmd,name"});
+    RunCommandSection("CPU INFO");
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunCommand, "PROCRANK", {"procrank"}, AS_ROOT_20);
 
@@ -1464,8 +1553,7 @@ static Dumpstate::RunStatus dumpstate() {
     DumpFile("KERNEL WAKE SOURCES", "/d/wakeup_sources");
     DumpFile("KERNEL CPUFREQ", "/sys/devices/system/cpu/cpu0/cpufreq/stats/time_in_state");
 
-    RunCommand("PROCESSES AND THREADS",
-               {"ps", "-A", "-T", "-Z", "-O", "pri,nice,rtprio,sched,pcy,time"});
+    RunCommandSection("PROCESSES AND THREADS");
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunCommand, "LIBRANK", {"librank"},
                                          CommandOptions::AS_ROOT);
@@ -1473,7 +1561,7 @@ static Dumpstate::RunStatus dumpstate() {
     DumpHals();
 
     RunCommand("PRINTENV", {"printenv"});
-    RunCommand("NETSTAT", {"netstat", "-nW"});
+    RunCommandSection("NETSTAT");
     struct stat s;
     if (stat("/proc/modules", &s) != 0) {
         MYLOGD("Skipping 'lsmod' because /proc/modules does not exist\n");
@@ -1488,7 +1576,7 @@ static Dumpstate::RunStatus dumpstate() {
         do_dmesg();
     }
 
-    RunCommand("LIST OF OPEN FILES", {"lsof"}, CommandOptions::AS_ROOT);
+    RunCommandSection("LIST OF OPEN FILES");
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(for_each_pid, do_showmap, "SMAPS OF ALL PROCESSES");
 
@@ -1529,11 +1617,11 @@ static Dumpstate::RunStatus dumpstate() {
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunDumpsysHigh);
 
-    RunCommand("SYSTEM PROPERTIES", {"getprop"});
+    RunCommandSection("SYSTEM PROPERTIES");
 
-    RunCommand("STORAGED IO INFO", {"storaged", "-u", "-p"});
+    RunCommandSection("STORAGED IO INFO");
 
-    RunCommand("FILESYSTEMS & FREE SPACE", {"df"});
+    RunCommandSection("FILESYSTEMS & FREE SPACE");
 
     /* Binder state is expensive to look at as it uses a lot of memory. */
     std::string binder_logs_dir = access("/dev/binderfs/binder_logs", R_OK) ?
@@ -1578,14 +1666,14 @@ static Dumpstate::RunStatus dumpstate() {
     printf("== Checkins\n");
     printf("========================================================\n");
 
-    RunDumpsys("CHECKIN BATTERYSTATS", {"batterystats", "-c"});
+    RunCommandSection("CHECKIN BATTERYSTATS");
 
     RUN_SLOW_FUNCTION_WITH_CONSENT_CHECK(RunDumpsys, "CHECKIN MEMINFO", {"meminfo", "--checkin"});
 
-    RunDumpsys("CHECKIN NETSTATS", {"netstats", "--checkin"});
-    RunDumpsys("CHECKIN PROCSTATS", {"procstats", "-c"});
-    RunDumpsys("CHECKIN USAGESTATS", {"usagestats", "-c"});
-    RunDumpsys("CHECKIN PACKAGE", {"package", "--checkin"});
+    RunCommandSection("CHECKIN NETSTATS");
+    RunCommandSection("CHECKIN PROCSTATS");
+    RunCommandSection("CHECKIN USAGESTATS");
+    RunCommandSection("CHECKIN PACKAGE");
 
     printf("========================================================\n");
     printf("== Running Application Activities\n");
@@ -2989,8 +3077,9 @@ Dumpstate& Dumpstate::GetInstance() {
     return singleton_;
 }
 
-DurationReporter::DurationReporter(const std::string& title, bool logcat_only, bool verbose)
-    : title_(title), logcat_only_(logcat_only), verbose_(verbose) {
+DurationReporter::DurationReporter(const std::string& title, bool logcat_only, bool verbose,
+                                   int duration_fd)
+    : title_(title), logcat_only_(logcat_only), verbose_(verbose), duration_fd_(duration_fd) {
     if (!title_.empty()) {
         started_ = Nanotime();
     }
@@ -3004,7 +3093,12 @@ DurationReporter::~DurationReporter() {
         }
         if (!logcat_only_) {
             // Use "Yoda grammar" to make it easier to grep|sort sections.
-            printf("------ %.3fs was the duration of '%s' ------\n", elapsed, title_.c_str());
+            if (duration_fd_ == STDOUT_FILENO) {
+                printf("------ %.3fs was the duration of '%s' ------\n", elapsed, title_.c_str());
+            } else {
+                dprintf(duration_fd_, "------ %.3fs was the duration of '%s' ------\n", elapsed,
+                        title_.c_str());
+            }
         }
     }
 }
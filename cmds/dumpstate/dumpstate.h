@@ -34,6 +34,7 @@
 #include <utils/StrongPointer.h>
 #include <ziparchive/zip_writer.h>
 
+#include "DumpPool.h"
 #include "DumpstateUtil.h"
 
 // Workaround for const char *args[MAX_ARGS_ARRAY_SIZE] variables until they're converted to
@@ -75,7 +76,7 @@ extern "C" {
 class DurationReporter {
   public:
     explicit DurationReporter(const std::string& title, bool logcat_only = false,
-                              bool verbose = false);
+                              bool verbose = false, int duration_fd = STDOUT_FILENO);
 
     ~DurationReporter();
 
@@ -83,6 +84,7 @@ class DurationReporter {
     std::string title_;
     bool logcat_only_;
     bool verbose_;
+    int duration_fd_;
     uint64_t started_;
 
     DISALLOW_COPY_AND_ASSIGN(DurationReporter);
@@ -490,6 +492,9 @@ class Dumpstate {
     // List of open ANR dump files.
     std::vector<DumpData> anr_data_;
 
+    // Runs independent sections concurrently; null when sections run sequentially.
+    std::unique_ptr<android::os::dumpstate::DumpPool> dump_pool_;
+
     // A callback to IncidentCompanion service, which checks user consent for sharing the
     // bugreport with the calling app. If the user has not responded yet to the dialog it will
     // be neither confirmed nor denied.
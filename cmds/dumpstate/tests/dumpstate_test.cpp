@@ -17,6 +17,7 @@
 #define LOG_TAG "dumpstate"
 #include <cutils/log.h>
 
+#include "DumpPool.h"
 #include "DumpstateInternal.h"
 #include "DumpstateService.h"
 #include "android/os/BnDumpstate.h"
@@ -30,6 +31,9 @@
 #include <signal.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <thread>
 
 #include <android-base/file.h>
@@ -1618,6 +1622,129 @@ TEST_F(DumpstateUtilTest, DumpFileOnDryRun) {
     EXPECT_THAT(out, EndsWith("skipped on dry run\n"));
 }
 
+class DumpPoolTest : public DumpstateBaseTest {
+  public:
+    void SetUp() {
+        DumpstateBaseTest::SetUp();
+        pool_ = std::make_unique<DumpPool>(kTestDataPath);
+        out_path_ = kTestDataPath + "DumpPoolTest.txt";
+        out_fd_.reset(TEMP_FAILURE_RETRY(open(out_path_.c_str(),
+                                              O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW,
+                                              S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)));
+        ASSERT_GE(out_fd_.get(), 0) << "could not create FD for path " << out_path_;
+    }
+
+    void TearDown() {
+        pool_ = nullptr;
+        android::base::RemoveFileIfExists(out_path_);
+    }
+
+    // Runs |count| fake slow sections either on the pool or inline, appending their output to
+    // |out_fd_| in order, and returns the wall time it took.
+    std::chrono::milliseconds RunSlowSections(int count, bool parallel) {
+        auto section = [this](int i, int fd) {
+            RunCommandToFd(fd, "SECTION " + std::to_string(i), {kSimpleCommand, "--sleep", "1"});
+        };
+        auto start = std::chrono::steady_clock::now();
+        if (parallel) {
+            pool_->start(count);
+            for (int i = 0; i < count; i++) {
+                EXPECT_TRUE(pool_->enqueueTaskWithFd("SECTION " + std::to_string(i),
+                                                     [=](int fd) { section(i, fd); }));
+            }
+            for (int i = 0; i < count; i++) {
+                EXPECT_TRUE(pool_->waitForTask("SECTION " + std::to_string(i), out_fd_.get()));
+            }
+        } else {
+            for (int i = 0; i < count; i++) {
+                section(i, out_fd_.get());
+            }
+        }
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - start);
+    }
+
+    std::string ReadOutput() {
+        std::string out;
+        ReadFileToString(out_path_, &out);
+        return out;
+    }
+
+    std::unique_ptr<DumpPool> pool_;
+    android::base::unique_fd out_fd_;
+
+  private:
+    std::string out_path_;
+};
+
+TEST_F(DumpPoolTest, WaitForTaskCopiesOutputInOrder) {
+    pool_->start(2);
+    ASSERT_TRUE(pool_->enqueueTaskWithFd("slow", [](int fd) {
+        sleep(1);
+        dprintf(fd, "slow\n");
+    }));
+    ASSERT_TRUE(pool_->enqueueTaskWithFd("fast", [](int fd) { dprintf(fd, "fast\n"); }));
+    EXPECT_TRUE(pool_->hasTask("slow"));
+
+    EXPECT_TRUE(pool_->waitForTask("slow", out_fd_.get()));
+    EXPECT_TRUE(pool_->waitForTask("fast", out_fd_.get()));
+    EXPECT_FALSE(pool_->hasTask("slow"));
+    EXPECT_FALSE(pool_->waitForTask("slow", out_fd_.get()));
+
+    EXPECT_THAT(ReadOutput(), StrEq("slow\nfast\n"));
+}
+
+TEST_F(DumpPoolTest, EnqueueDuplicateTaskFails) {
+    pool_->start(1);
+    EXPECT_TRUE(pool_->enqueueTaskWithFd("task", [](int) {}));
+    EXPECT_FALSE(pool_->enqueueTaskWithFd("task", [](int) {}));
+}
+
+TEST_F(DumpPoolTest, EnqueueBeforeStartFails) {
+    EXPECT_FALSE(pool_->enqueueTaskWithFd("task", [](int) {}));
+    EXPECT_FALSE(pool_->hasTask("task"));
+}
+
+TEST_F(DumpPoolTest, ShutdownDropsTasksNotStarted) {
+    std::atomic<int> runs{0};
+    std::promise<void> started;
+    pool_->start(1);
+    ASSERT_TRUE(pool_->enqueueTaskWithFd("running", [&runs, &started](int) {
+        started.set_value();
+        // Gives shutdown() time to drop the other tasks while this one runs.
+        usleep(100 * 1000);
+        runs++;
+    }));
+    for (int i = 0; i < 4; i++) {
+        ASSERT_TRUE(pool_->enqueueTaskWithFd("task " + std::to_string(i), [&runs](int) {
+            runs++;
+        }));
+    }
+    started.get_future().wait();
+    pool_->shutdown();
+    EXPECT_EQ(1, runs);
+    EXPECT_FALSE(pool_->hasTask("task 0"));
+}
+
+TEST_F(DumpPoolTest, ParallelSectionsMatchSequentialAndRunFaster) {
+    const int kSections = 4;
+    auto sequential_time = RunSlowSections(kSections, false /* parallel */);
+    std::string sequential_out = ReadOutput();
+    ASSERT_EQ(0, ftruncate(out_fd_.get(), 0));
+    ASSERT_EQ(0, lseek(out_fd_.get(), 0, SEEK_SET));
+
+    auto parallel_time = RunSlowSections(kSections, true /* parallel */);
+    std::string parallel_out = ReadOutput();
+
+    MYLOGD("%d slow sections: sequential %lldms, parallel %lldms\n", kSections,
+           static_cast<long long>(sequential_time.count()),
+           static_cast<long long>(parallel_time.count()));
+
+    EXPECT_THAT(parallel_out, StrEq(sequential_out));
+    EXPECT_GE(sequential_time, std::chrono::milliseconds(kSections * 1000));
+    EXPECT_LT(parallel_time, std::chrono::milliseconds(2 * 1000));
+}
+
 }  // namespace dumpstate
 }  // namespace os
 }  // namespace android
@@ -71,6 +71,7 @@
 #include "CrateManager.h"
 #include "MatchExtensionGen.h"
 #include "QuotaUtils.h"
+#include "TreeSizeCalculator.h"
 
 #ifndef LOG_TAG
 #define LOG_TAG "installd"
@@ -307,6 +308,14 @@ status_t InstalldNativeService::dump(int fd, const Vector<String16> & /* args */
         }
     }
 
+    {
+        auto stats = TreeSizeCalculator::getInstance().getCacheStats();
+        out << endl << "Tree size listing cache:" << endl;
+        out << "    hits = " << stats.hits << ", misses = " << stats.misses << endl;
+        out << "    directories = " << stats.directories << ", entries = " << stats.entries
+                << endl;
+    }
+
     out << endl;
     out.flush();
 
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TreeSizeCalculator.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+#include <cutils/multiuser.h>
+#include <private/android_filesystem_config.h>
+
+using android::base::unique_fd;
+
+namespace android {
+namespace installd {
+
+// Listings of directories modified more recently than this are not cached,
+// since a later change within the same timestamp granule would go unnoticed.
+static constexpr time_t kRacyListingSeconds = 1;
+
+static constexpr size_t kMaxThreads = 4;
+
+struct TreeSizeCalculator::Walk {
+    int32_t includeGid;
+    int32_t excludeGid;
+    bool excludeApps;
+    dev_t rootDev;
+
+    std::atomic<int64_t> matchedSize{0};
+    // Directories queued or currently being read for this walk.
+    std::atomic<size_t> outstanding{0};
+};
+
+static bool isAppOwned(const struct stat& s) {
+    int32_t user_uid = multiuser_get_app_id(s.st_uid);
+    int32_t user_gid = multiuser_get_app_id(s.st_gid);
+    return (user_uid >= AID_APP_START && user_uid <= AID_APP_END)
+            || (user_gid >= AID_CACHE_GID_START && user_gid <= AID_CACHE_GID_END)
+            || (user_gid >= AID_SHARED_GID_START && user_gid <= AID_SHARED_GID_END);
+}
+
+static bool isMatched(const struct stat& s, int32_t includeGid, int32_t excludeGid) {
+    int32_t gid = s.st_gid;
+    if (includeGid != -1 && gid != includeGid) {
+        return false;
+    }
+    if (excludeGid != -1 && gid == excludeGid) {
+        return false;
+    }
+    return true;
+}
+
+static bool isSameTime(const struct timespec& a, const struct timespec& b) {
+    return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+static bool readListing(int fd, const std::string& path, std::string* names, size_t* count) {
+    char buf[32 * 1024] __attribute__((aligned(8)));
+    names->clear();
+    *count = 0;
+    while (true) {
+        long n = syscall(__NR_getdents64, fd, buf, sizeof(buf));
+        if (n == 0) {
+            return true;
+        } else if (n < 0) {
+            PLOG(WARNING) << "Failed to read " << path;
+            return false;
+        }
+        for (long pos = 0; pos < n;) {
+            auto* de = reinterpret_cast<struct dirent64*>(buf + pos);
+            pos += de->d_reclen;
+            const char* name = de->d_name;
+            if (!strcmp(name, ".") || !strcmp(name, "..")) {
+                continue;
+            }
+            names->append(name, strlen(name) + 1);
+            (*count)++;
+        }
+    }
+}
+
+static time_t realtimeSeconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return now.tv_sec;
+}
+
+TreeSizeCalculator::TreeSizeCalculator(size_t threadCount, size_t maxCachedEntries, Clock clock)
+      : mMaxCachedEntries(maxCachedEntries),
+        mClock(clock ? std::move(clock) : realtimeSeconds) {
+    for (size_t i = 1; i < threadCount; i++) {
+        mThreads.emplace_back(&TreeSizeCalculator::threadMain, this);
+    }
+}
+
+TreeSizeCalculator::~TreeSizeCalculator() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+TreeSizeCalculator& TreeSizeCalculator::getInstance() {
+    // Intentionally leaked to avoid joining workers from a static destructor.
+    static TreeSizeCalculator* instance = new TreeSizeCalculator(
+            std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxThreads));
+    return *instance;
+}
+
+int TreeSizeCalculator::calculate(const std::string& path, int64_t* size, int32_t include_gid,
+        int32_t exclude_gid, bool exclude_apps) {
+    struct stat s;
+    if (lstat(path.c_str(), &s) != 0) {
+        if (errno != ENOENT) {
+            PLOG(ERROR) << "Failed to stat " << path;
+        }
+        return -1;
+    }
+    if (exclude_apps && isAppOwned(s)) {
+        return 0;
+    }
+
+    auto walk = std::make_shared<Walk>();
+    walk->includeGid = include_gid;
+    walk->excludeGid = exclude_gid;
+    walk->excludeApps = exclude_apps;
+    walk->rootDev = s.st_dev;
+    if (isMatched(s, include_gid, exclude_gid)) {
+        walk->matchedSize += s.st_blocks * 512;
+    }
+
+    if (S_ISDIR(s.st_mode)) {
+        enqueue(walk, path);
+
+        // Help out until every directory of this walk has been read, which
+        // also guarantees progress when no helper threads exist.
+        std::unique_lock<std::mutex> lock(mLock);
+        while (true) {
+            mCondition.wait(lock, [&]() { return walk->outstanding == 0 || !mTasks.empty(); });
+            if (walk->outstanding == 0) {
+                break;
+            }
+            Task task = std::move(mTasks.back());
+            mTasks.pop_back();
+            lock.unlock();
+            processTask(task);
+            lock.lock();
+        }
+    }
+
+    *size += walk->matchedSize;
+    return 0;
+}
+
+void TreeSizeCalculator::threadMain() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait(lock, [&]() { return mStopping || !mTasks.empty(); });
+        if (mStopping) {
+            return;
+        }
+        // Depth-first keeps the queue short on wide trees.
+        Task task = std::move(mTasks.back());
+        mTasks.pop_back();
+        lock.unlock();
+        processTask(task);
+        lock.lock();
+    }
+}
+
+void TreeSizeCalculator::enqueue(const std::shared_ptr<Walk>& walk, std::string path) {
+    walk->outstanding++;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mTasks.push_back({walk, std::move(path)});
+    }
+    mCondition.notify_one();
+}
+
+void TreeSizeCalculator::finishTask(const std::shared_ptr<Walk>& walk) {
+    if (--walk->outstanding == 0) {
+        // Take the lock so the owning thread can't miss the wakeup between
+        // checking its predicate and going to sleep.
+        std::lock_guard<std::mutex> lock(mLock);
+        mCondition.notify_all();
+    }
+}
+
+void TreeSizeCalculator::processTask(const Task& task) {
+    const auto& walk = task.walk;
+    const std::string& path = task.path;
+
+    unique_fd fd(open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC));
+    struct stat dirStat;
+    if (fd == -1 || fstat(fd, &dirStat) != 0) {
+        if (errno != ENOENT) {
+            PLOG(WARNING) << "Failed to open " << path;
+        }
+        finishTask(walk);
+        return;
+    }
+
+    std::string names;
+    if (!lookupListing(dirStat, &names)) {
+        size_t count;
+        if (!readListing(fd, path, &names, &count)) {
+            finishTask(walk);
+            return;
+        }
+        storeListing(dirStat, names, count);
+    }
+
+    int64_t matchedSize = 0;
+    const char* end = names.data() + names.size();
+    for (const char* name = names.data(); name < end; name += strlen(name) + 1) {
+        struct stat s;
+        if (fstatat(fd, name, &s, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+        if (walk->excludeApps && isAppOwned(s)) {
+            continue;
+        }
+        if (isMatched(s, walk->includeGid, walk->excludeGid)) {
+            matchedSize += s.st_blocks * 512;
+        }
+        if (S_ISDIR(s.st_mode) && s.st_dev == walk->rootDev) {
+            enqueue(walk, path + "/" + name);
+        }
+    }
+    walk->matchedSize += matchedSize;
+    finishTask(walk);
+}
+
+bool TreeSizeCalculator::lookupListing(const struct stat& dirStat, std::string* names) {
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    auto it = mListings.find({dirStat.st_dev, dirStat.st_ino});
+    if (it != mListings.end()) {
+        if (isSameTime(it->second.mtime, dirStat.st_mtim)
+                && isSameTime(it->second.ctime, dirStat.st_ctim)) {
+            mCacheHits++;
+            *names = it->second.names;
+            return true;
+        }
+        mCachedEntries -= it->second.count;
+        mListings.erase(it);
+    }
+    mCacheMisses++;
+    return false;
+}
+
+void TreeSizeCalculator::storeListing(const struct stat& dirStat, const std::string& names,
+        size_t count) {
+    const time_t now = mClock();
+    if (now - dirStat.st_mtim.tv_sec <= kRacyListingSeconds
+            || now - dirStat.st_ctim.tv_sec <= kRacyListingSeconds) {
+        return;
+    }
+    if (count > mMaxCachedEntries) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    if (mCachedEntries + count > mMaxCachedEntries) {
+        // Measurements tend to sweep whole volumes, so there is little
+        // locality for an LRU to exploit; start over instead.
+        mListings.clear();
+        mCachedEntries = 0;
+    }
+    DirListing listing = {dirStat.st_mtim, dirStat.st_ctim, names, count};
+    auto result = mListings.insert({{dirStat.st_dev, dirStat.st_ino}, std::move(listing)});
+    if (result.second) {
+        mCachedEntries += count;
+    }
+}
+
+void TreeSizeCalculator::clearCache() {
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    mListings.clear();
+    mCachedEntries = 0;
+}
+
+TreeSizeCalculator::CacheStats TreeSizeCalculator::getCacheStats() {
+    std::lock_guard<std::mutex> lock(mCacheLock);
+    return {mCacheHits, mCacheMisses, mListings.size(), mCachedEntries};
+}
+
+}  // namespace installd
+}  // namespace android
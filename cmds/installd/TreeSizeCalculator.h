@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_INSTALLD_TREE_SIZE_CALCULATOR_H
+#define ANDROID_INSTALLD_TREE_SIZE_CALCULATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <android-base/macros.h>
+
+namespace android {
+namespace installd {
+
+/**
+ * Measures the disk usage of directory trees on volumes without quota
+ * support. Subdirectories are handed out to a small pool of worker threads
+ * and read with getdents64(2)/fstatat(2) relative to the directory fd.
+ *
+ * Directory listings are cached by inode and validated against the
+ * directory mtime/ctime, so that repeated measurements of an unchanged
+ * directory skip reading it again. Entries are always re-stat'ed, since a
+ * file growing in place does not touch the mtime of its parent.
+ */
+class TreeSizeCalculator {
+public:
+    static constexpr size_t kDefaultMaxCachedEntries = 256 * 1024;
+
+    struct CacheStats {
+        uint64_t hits;
+        uint64_t misses;
+        size_t directories;
+        size_t entries;
+    };
+
+    /** Returns the current CLOCK_REALTIME time in seconds. */
+    using Clock = std::function<time_t()>;
+
+    /**
+     * threadCount includes the calling thread, so a value of 1 measures
+     * serially without spawning any helpers. clock is compared against
+     * directory timestamps to leave recently modified listings uncached;
+     * it reads CLOCK_REALTIME unless replaced, as tests do.
+     */
+    explicit TreeSizeCalculator(size_t threadCount,
+            size_t maxCachedEntries = kDefaultMaxCachedEntries, Clock clock = nullptr);
+    ~TreeSizeCalculator();
+
+    /**
+     * Adds the size of path and everything beneath it to *size. Symlinks
+     * are never followed and mount points are not crossed. When
+     * include_gid or exclude_gid are not -1 only matching entries are
+     * counted; when exclude_apps is set, entries owned by an app UID or
+     * app cache/shared GID are neither counted nor traversed.
+     */
+    int calculate(const std::string& path, int64_t* size, int32_t include_gid = -1,
+            int32_t exclude_gid = -1, bool exclude_apps = false);
+
+    void clearCache();
+    CacheStats getCacheStats();
+
+    /** Process-wide instance used by calculate_tree_size(). */
+    static TreeSizeCalculator& getInstance();
+
+private:
+    struct Walk;
+
+    struct Task {
+        std::shared_ptr<Walk> walk;
+        std::string path;
+    };
+
+    struct DirKey {
+        dev_t dev;
+        ino_t ino;
+
+        bool operator==(const DirKey& other) const {
+            return dev == other.dev && ino == other.ino;
+        }
+    };
+
+    struct DirKeyHash {
+        size_t operator()(const DirKey& key) const {
+            return std::hash<uint64_t>()(static_cast<uint64_t>(key.ino) * 31 + key.dev);
+        }
+    };
+
+    struct DirListing {
+        struct timespec mtime;
+        struct timespec ctime;
+        // Entry names, each terminated by '\0'. Excludes "." and "..".
+        std::string names;
+        size_t count;
+    };
+
+    void threadMain();
+    void enqueue(const std::shared_ptr<Walk>& walk, std::string path);
+    void processTask(const Task& task);
+    void finishTask(const std::shared_ptr<Walk>& walk);
+
+    bool lookupListing(const struct stat& dirStat, std::string* names);
+    void storeListing(const struct stat& dirStat, const std::string& names, size_t count);
+
+    const size_t mMaxCachedEntries;
+    const Clock mClock;
+
+    std::mutex mLock;
+    std::condition_variable mCondition;
+    std::deque<Task> mTasks;
+    bool mStopping = false;
+    std::vector<std::thread> mThreads;
+
+    std::mutex mCacheLock;
+    std::unordered_map<DirKey, DirListing, DirKeyHash> mListings;
+    size_t mCachedEntries = 0;
+    uint64_t mCacheHits = 0;
+    uint64_t mCacheMisses = 0;
+
+    DISALLOW_COPY_AND_ASSIGN(TreeSizeCalculator);
+};
+
+}  // namespace installd
+}  // namespace android
+
+#endif  // ANDROID_INSTALLD_TREE_SIZE_CALCULATOR_H
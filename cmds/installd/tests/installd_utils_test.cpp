@@ -14,15 +14,25 @@
  * limitations under the License.
  */
 
+#include <fcntl.h>
+#include <fts.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
 
 #include <android-base/logging.h>
 #include <android-base/scopeguard.h>
+#include <android-base/stringprintf.h>
 #include <gtest/gtest.h>
 
 #include "InstalldNativeService.h"
 #include "MatchExtensionGen.h"
+#include "TreeSizeCalculator.h"
 #include "globals.h"
 #include "utils.h"
 
@@ -42,6 +52,8 @@
 
 #define TEST_PROFILE_DIR "/data/misc/profiles"
 
+#define TEST_TREE_SIZE_DIR "/data/local/tmp/installd_tree_size_test"
+
 namespace android {
 namespace installd {
 
@@ -638,5 +650,171 @@ TEST_F(UtilsTest, TestCreateDirIfNeeded) {
     ASSERT_NE(0, create_dir_if_needed("/data/local/tmp/user/0/bar/baz", 0700));
 }
 
+// Reference implementation of the serial fts(3) walk that TreeSizeCalculator replaced.
+static int64_t fts_tree_size(const std::string& path) {
+    int64_t size = 0;
+    char *argv[] = { (char*) path.c_str(), nullptr };
+    FTS* fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, nullptr);
+    if (fts == nullptr) {
+        return -1;
+    }
+    FTSENT* p;
+    while ((p = fts_read(fts)) != nullptr) {
+        switch (p->fts_info) {
+        case FTS_D:
+        case FTS_DEFAULT:
+        case FTS_F:
+        case FTS_SL:
+        case FTS_SLNONE:
+            size += p->fts_statp->st_blocks * 512;
+            break;
+        }
+    }
+    fts_close(fts);
+    return size;
+}
+
+static void create_synthetic_tree(const std::string& root, int dirs, int filesPerDir) {
+    ASSERT_EQ(0, mkdir(root.c_str(), 0700));
+    for (int i = 0; i < dirs; i++) {
+        auto dir = android::base::StringPrintf("%s/d%d", root.c_str(), i);
+        ASSERT_EQ(0, mkdir(dir.c_str(), 0700));
+        auto nested = dir + "/nested";
+        ASSERT_EQ(0, mkdir(nested.c_str(), 0700));
+        for (int j = 0; j < filesPerDir; j++) {
+            auto file = android::base::StringPrintf("%s/f%d", (j % 2) ? dir.c_str()
+                    : nested.c_str(), j);
+            int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+            ASSERT_NE(-1, fd);
+            ASSERT_EQ(1, write(fd, "x", 1));
+            close(fd);
+        }
+        auto link = dir + "/link";
+        ASSERT_EQ(0, symlink("/system", link.c_str()));
+    }
+}
+
+TEST_F(UtilsTest, CalculateTreeSize_MatchesFts) {
+    delete_dir_contents_and_dir(TEST_TREE_SIZE_DIR, true /* ignore_if_missing */);
+    auto deleter = [&]() {
+        delete_dir_contents_and_dir(TEST_TREE_SIZE_DIR, true /* ignore_if_missing */);
+    };
+    auto scope_guard = android::base::make_scope_guard(deleter);
+
+    // 100 directories of 1000 files each.
+    create_synthetic_tree(TEST_TREE_SIZE_DIR, 100, 1000);
+    ASSERT_FALSE(HasFatalFailure());
+
+    auto ftsStart = std::chrono::steady_clock::now();
+    int64_t expected = fts_tree_size(TEST_TREE_SIZE_DIR);
+    auto ftsEnd = std::chrono::steady_clock::now();
+    ASSERT_GT(expected, 0);
+
+    TreeSizeCalculator calculator(4);
+    int64_t size = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &size));
+    auto parallelEnd = std::chrono::steady_clock::now();
+    EXPECT_EQ(expected, size);
+
+    size = 0;
+    ASSERT_EQ(0, calculate_tree_size(TEST_TREE_SIZE_DIR, &size));
+    EXPECT_EQ(expected, size);
+
+    // Serial mode walks on the calling thread only.
+    TreeSizeCalculator serial(1);
+    size = 0;
+    ASSERT_EQ(0, serial.calculate(TEST_TREE_SIZE_DIR, &size));
+    EXPECT_EQ(expected, size);
+
+    using std::chrono::microseconds;
+    LOG(INFO) << "fts: " << std::chrono::duration_cast<microseconds>(ftsEnd - ftsStart).count()
+            << "us, parallel: "
+            << std::chrono::duration_cast<microseconds>(parallelEnd - ftsEnd).count() << "us";
+}
+
+TEST_F(UtilsTest, CalculateTreeSize_Filters) {
+    delete_dir_contents_and_dir(TEST_TREE_SIZE_DIR, true /* ignore_if_missing */);
+    auto deleter = [&]() {
+        delete_dir_contents_and_dir(TEST_TREE_SIZE_DIR, true /* ignore_if_missing */);
+    };
+    auto scope_guard = android::base::make_scope_guard(deleter);
+
+    create_synthetic_tree(TEST_TREE_SIZE_DIR, 4, 10);
+    ASSERT_FALSE(HasFatalFailure());
+
+    TreeSizeCalculator calculator(2);
+    int64_t all = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &all));
+
+    int64_t excluded = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &excluded, -1, getgid()));
+    EXPECT_EQ(0, excluded);
+
+    int64_t included = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &included, getgid()));
+    EXPECT_EQ(all, included);
+
+    int64_t missing = 0;
+    EXPECT_EQ(-1, calculator.calculate(TEST_TREE_SIZE_DIR "/missing", &missing));
+    EXPECT_EQ(0, missing);
+}
+
+TEST_F(UtilsTest, CalculateTreeSize_ListingCache) {
+    delete_dir_contents_and_dir(TEST_TREE_SIZE_DIR, true /* ignore_if_missing */);
+    auto deleter = [&]() {
+        delete_dir_contents_and_dir(TEST_TREE_SIZE_DIR, true /* ignore_if_missing */);
+    };
+    auto scope_guard = android::base::make_scope_guard(deleter);
+
+    // The clock starts no later than any directory timestamp.
+    std::atomic<time_t> now(time(nullptr));
+    create_synthetic_tree(TEST_TREE_SIZE_DIR, 10, 100);
+    ASSERT_FALSE(HasFatalFailure());
+
+    TreeSizeCalculator calculator(4, TreeSizeCalculator::kDefaultMaxCachedEntries,
+            [&now]() -> time_t { return now; });
+
+    // Listings of recently modified directories are never cached.
+    int64_t first = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &first));
+    auto stats = calculator.getCacheStats();
+    EXPECT_EQ(0u, stats.hits);
+    // Root, plus each directory and its nested child.
+    EXPECT_EQ(21u, stats.misses);
+    EXPECT_EQ(0u, stats.directories);
+
+    now = time(nullptr) + 2;
+    int64_t second = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &second));
+    EXPECT_EQ(first, second);
+    stats = calculator.getCacheStats();
+    EXPECT_EQ(0u, stats.hits);
+    EXPECT_EQ(42u, stats.misses);
+    EXPECT_EQ(21u, stats.directories);
+
+    int64_t cached = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &cached));
+    EXPECT_EQ(first, cached);
+    EXPECT_EQ(21u, calculator.getCacheStats().hits);
+
+    // A new file invalidates only its parent.
+    int fd = open(TEST_TREE_SIZE_DIR "/d3/extra", O_WRONLY | O_CREAT | O_CLOEXEC, 0600);
+    ASSERT_NE(-1, fd);
+    ASSERT_EQ(1, write(fd, "x", 1));
+    close(fd);
+
+    now = time(nullptr) + 2;
+    int64_t third = 0;
+    ASSERT_EQ(0, calculator.calculate(TEST_TREE_SIZE_DIR, &third));
+    EXPECT_EQ(fts_tree_size(TEST_TREE_SIZE_DIR), third);
+    EXPECT_GT(third, first);
+    stats = calculator.getCacheStats();
+    EXPECT_EQ(41u, stats.hits);
+    EXPECT_EQ(43u, stats.misses);
+
+    calculator.clearCache();
+    EXPECT_EQ(0u, calculator.getCacheStats().directories);
+}
+
 }  // namespace installd
 }  // namespace android
@@ -40,6 +40,7 @@
 #include "dexopt_return_codes.h"
 #include "globals.h"  // extern variables.
 #include "QuotaUtils.h"
+#include "TreeSizeCalculator.h"
 
 #ifndef LOG_TAG
 #define LOG_TAG "installd"
@@ -378,45 +379,12 @@ std::vector<userid_t> get_known_users(const char* volume_uuid) {
 
 int calculate_tree_size(const std::string& path, int64_t* size,
         int32_t include_gid, int32_t exclude_gid, bool exclude_apps) {
-    FTS *fts;
-    FTSENT *p;
     int64_t matchedSize = 0;
-    char *argv[] = { (char*) path.c_str(), nullptr };
-    if (!(fts = fts_open(argv, FTS_PHYSICAL | FTS_NOCHDIR | FTS_XDEV, nullptr))) {
-        if (errno != ENOENT) {
-            PLOG(ERROR) << "Failed to fts_open " << path;
-        }
-        return -1;
-    }
-    while ((p = fts_read(fts)) != nullptr) {
-        switch (p->fts_info) {
-        case FTS_D:
-        case FTS_DEFAULT:
-        case FTS_F:
-        case FTS_SL:
-        case FTS_SLNONE:
-            int32_t uid = p->fts_statp->st_uid;
-            int32_t gid = p->fts_statp->st_gid;
-            int32_t user_uid = multiuser_get_app_id(uid);
-            int32_t user_gid = multiuser_get_app_id(gid);
-            if (exclude_apps && ((user_uid >= AID_APP_START && user_uid <= AID_APP_END)
-                    || (user_gid >= AID_CACHE_GID_START && user_gid <= AID_CACHE_GID_END)
-                    || (user_gid >= AID_SHARED_GID_START && user_gid <= AID_SHARED_GID_END))) {
-                // Don't traverse inside or measure
-                fts_set(fts, p, FTS_SKIP);
-                break;
-            }
-            if (include_gid != -1 && gid != include_gid) {
-                break;
-            }
-            if (exclude_gid != -1 && gid == exclude_gid) {
-                break;
-            }
-            matchedSize += (p->fts_statp->st_blocks * 512);
-            break;
-        }
+    int res = TreeSizeCalculator::getInstance().calculate(path, &matchedSize, include_gid,
+            exclude_gid, exclude_apps);
+    if (res != 0) {
+        return res;
     }
-    fts_close(fts);
 #if MEASURE_DEBUG
     if ((include_gid == -1) && (exclude_gid == -1)) {
         LOG(DEBUG) << "Measured " << path << " size " << matchedSize;
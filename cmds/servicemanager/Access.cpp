@@ -122,6 +122,31 @@ bool Access::canList(const CallingContext& ctx) {
     return actionAllowed(ctx, mThisProcessContext, "list", "service_manager");
 }
 
+bool Access::isEnforced(const CallingContext& ctx) {
+    if (selinux_status_getenforce() <= 0) return false;
+
+    // Permissive domains are permissive for every class and permission, so
+    // asking about any of them tells whether the caller's domain is.
+    security_id_t ssid;
+    security_id_t tsid;
+    if (avc_context_to_sid(ctx.sid.c_str(), &ssid) != 0 ||
+        avc_context_to_sid(mThisProcessContext, &tsid) != 0) {
+        return false;
+    }
+    const security_class_t tclass = string_to_security_class("service_manager");
+    const access_vector_t perm = string_to_av_perm(tclass, "list");
+    struct av_decision avd;
+    // Fills in |avd| whether or not the permission is granted.
+    (void)avc_has_perm_noaudit(ssid, tsid, tclass, perm, nullptr, &avd);
+    return (avd.flags & SELINUX_AVD_FLAGS_PERMISSIVE) == 0;
+}
+
+uint64_t Access::getPolicyGeneration() {
+    // Both policy loads and boolean changes bump the policyload count.
+    uint64_t policyLoad = static_cast<uint32_t>(selinux_status_policyload());
+    return (policyLoad << 1) | (selinux_status_getenforce() > 0 ? 1 : 0);
+}
+
 bool Access::actionAllowed(const CallingContext& sctx, const char* tctx, const char* perm,
         const std::string& tname) {
     const char* tclass = "service_manager";
@@ -44,6 +44,14 @@ public:
     virtual bool canAdd(const CallingContext& ctx, const std::string& name);
     virtual bool canList(const CallingContext& ctx);
 
+    // Whether access decisions for the caller are enforced, rather than allowed
+    // and only audited because the device or the caller's domain is permissive.
+    virtual bool isEnforced(const CallingContext& ctx);
+
+    // Changes whenever access decisions may have changed, i.e. when the policy or a
+    // boolean is reloaded or the enforcing mode is switched.
+    virtual uint64_t getPolicyGeneration();
+
 private:
     bool actionAllowed(const CallingContext& sctx, const char* tctx, const char* perm,
             const std::string& tname);
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "AccessCache.h"
+
+#include <functional>
+
+namespace android {
+
+size_t AccessCache::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<std::string>()(key.sid);
+    hash = hash * 31 + std::hash<std::string>()(key.name);
+    return hash * 31 + static_cast<size_t>(key.perm);
+}
+
+void AccessCache::updatePolicyGeneration(uint64_t policyGeneration) {
+    if (policyGeneration == mPolicyGeneration) return;
+
+    mPolicyGeneration = policyGeneration;
+    if (!mEntries.empty()) {
+        mEntries.clear();
+        mLru.clear();
+        mInvalidations++;
+    }
+}
+
+bool AccessCache::isGranted(uint64_t policyGeneration, const std::string& sid,
+                            const std::string& name, Perm perm) {
+    updatePolicyGeneration(policyGeneration);
+
+    auto it = mEntries.find(Key{sid, name, perm});
+    if (it == mEntries.end()) {
+        mMisses++;
+        return false;
+    }
+
+    mLru.splice(mLru.begin(), mLru, it->second);
+    mHits++;
+    return true;
+}
+
+void AccessCache::setGranted(uint64_t policyGeneration, const std::string& sid,
+                             const std::string& name, Perm perm) {
+    updatePolicyGeneration(policyGeneration);
+
+    Key key{sid, name, perm};
+    if (mEntries.count(key) != 0) return;
+
+    if (mEntries.size() >= kMaxEntries) {
+        mEntries.erase(mLru.back());
+        mLru.pop_back();
+    }
+    mLru.push_front(key);
+    mEntries.emplace(std::move(key), mLru.begin());
+}
+
+}  // namespace android
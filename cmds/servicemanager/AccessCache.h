@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <list>
+#include <string>
+#include <unordered_map>
+
+namespace android {
+
+// Remembers SELinux decisions which granted a permission on a service, keyed by
+// (calling SID, service name, permission). Checking a permission takes a
+// service_contexts lookup and an AVC query, and app startup does hundreds of
+// these in a row.
+//
+// Only grants of an enforced policy are remembered, so that every denial is
+// still checked and audited, including those which a permissive device or
+// domain lets through. All entries are dropped when the policy generation changes, and the
+// least recently used entry is evicted once the cache is full.
+class AccessCache {
+public:
+    enum class Perm { FIND, ADD };
+
+    static constexpr size_t kMaxEntries = 1024;
+
+    // Returns true if the permission is known to be granted under the given policy
+    // generation.
+    bool isGranted(uint64_t policyGeneration, const std::string& sid, const std::string& name,
+                   Perm perm);
+    // Records that the permission was granted under the given policy generation.
+    void setGranted(uint64_t policyGeneration, const std::string& sid, const std::string& name,
+                    Perm perm);
+
+    size_t size() const { return mEntries.size(); }
+    size_t hits() const { return mHits; }
+    size_t misses() const { return mMisses; }
+    size_t invalidations() const { return mInvalidations; }
+
+private:
+    struct Key {
+        std::string sid;
+        std::string name;
+        Perm perm;
+
+        bool operator==(const Key& other) const {
+            return perm == other.perm && sid == other.sid && name == other.name;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    // Drops all entries if the policy changed since they were recorded.
+    void updatePolicyGeneration(uint64_t policyGeneration);
+
+    // Most recently used first.
+    std::list<Key> mLru;
+    std::unordered_map<Key, std::list<Key>::iterator, KeyHash> mEntries;
+    uint64_t mPolicyGeneration = 0;
+
+    size_t mHits = 0;
+    size_t mMisses = 0;
+    size_t mInvalidations = 0;
+};
+
+}  // namespace android
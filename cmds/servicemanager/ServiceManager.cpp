@@ -16,14 +16,18 @@
 
 #include "ServiceManager.h"
 
+#include <algorithm>
+#include <android-base/file.h>
 #include <android-base/logging.h>
 #include <android-base/properties.h>
+#include <android-base/stringprintf.h>
 #include <binder/BpBinder.h>
 #include <binder/IPCThreadState.h>
 #include <binder/ProcessState.h>
 #include <binder/Stability.h>
 #include <cutils/android_filesystem_config.h>
 #include <cutils/multiuser.h>
+#include <inttypes.h>
 #include <thread>
 
 #ifndef VENDORSERVICEMANAGER
@@ -31,6 +35,7 @@
 #include <vintf/constants.h>
 #endif  // !VENDORSERVICEMANAGER
 
+using ::android::base::StringAppendF;
 using ::android::binder::Status;
 using ::android::internal::Stability;
 
@@ -117,17 +122,56 @@ ServiceManager::~ServiceManager() {
 }
 
 Status ServiceManager::getService(const std::string& name, sp<IBinder>* outBinder) {
+    auto start = std::chrono::steady_clock::now();
     *outBinder = tryGetService(name, true);
+    recordLookupLatency(std::chrono::steady_clock::now() - start);
     // returns ok regardless of result for legacy reasons
     return Status::ok();
 }
 
 Status ServiceManager::checkService(const std::string& name, sp<IBinder>* outBinder) {
+    auto start = std::chrono::steady_clock::now();
     *outBinder = tryGetService(name, false);
+    recordLookupLatency(std::chrono::steady_clock::now() - start);
     // returns ok regardless of result for legacy reasons
     return Status::ok();
 }
 
+void ServiceManager::recordLookupLatency(std::chrono::steady_clock::duration latency) {
+    int64_t latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+    auto bucket = std::upper_bound(kLookupLatencyBucketsUs.begin(),
+                                   kLookupLatencyBucketsUs.end(), latencyUs);
+    mLookupLatencyHistogram[bucket - kLookupLatencyBucketsUs.begin()]++;
+}
+
+bool ServiceManager::canFind(const Access::CallingContext& ctx, const std::string& name) {
+    uint64_t generation = mAccess->getPolicyGeneration();
+    if (mAccessCache.isGranted(generation, ctx.sid, name, AccessCache::Perm::FIND)) {
+        return true;
+    }
+    if (!mAccess->canFind(ctx, name)) {
+        return false;
+    }
+    if (mAccess->isEnforced(ctx)) {
+        mAccessCache.setGranted(generation, ctx.sid, name, AccessCache::Perm::FIND);
+    }
+    return true;
+}
+
+bool ServiceManager::canAdd(const Access::CallingContext& ctx, const std::string& name) {
+    uint64_t generation = mAccess->getPolicyGeneration();
+    if (mAccessCache.isGranted(generation, ctx.sid, name, AccessCache::Perm::ADD)) {
+        return true;
+    }
+    if (!mAccess->canAdd(ctx, name)) {
+        return false;
+    }
+    if (mAccess->isEnforced(ctx)) {
+        mAccessCache.setGranted(generation, ctx.sid, name, AccessCache::Perm::ADD);
+    }
+    return true;
+}
+
 sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfNotFound) {
     auto ctx = mAccess->getCallingContext();
 
@@ -147,7 +191,7 @@ sp<IBinder> ServiceManager::tryGetService(const std::string& name, bool startIfN
         out = service->binder;
     }
 
-    if (!mAccess->canFind(ctx, name)) {
+    if (!canFind(ctx, name)) {
         return nullptr;
     }
 
@@ -187,7 +231,7 @@ Status ServiceManager::addService(const std::string& name, const sp<IBinder>& bi
         return Status::fromExceptionCode(Status::EX_SECURITY);
     }
 
-    if (!mAccess->canAdd(ctx, name)) {
+    if (!canAdd(ctx, name)) {
         return Status::fromExceptionCode(Status::EX_SECURITY);
     }
 
@@ -263,7 +307,7 @@ Status ServiceManager::registerForNotifications(
         const std::string& name, const sp<IServiceCallback>& callback) {
     auto ctx = mAccess->getCallingContext();
 
-    if (!mAccess->canFind(ctx, name)) {
+    if (!canFind(ctx, name)) {
         return Status::fromExceptionCode(Status::EX_SECURITY);
     }
 
@@ -297,7 +341,7 @@ Status ServiceManager::unregisterForNotifications(
         const std::string& name, const sp<IServiceCallback>& callback) {
     auto ctx = mAccess->getCallingContext();
 
-    if (!mAccess->canFind(ctx, name)) {
+    if (!canFind(ctx, name)) {
         return Status::fromExceptionCode(Status::EX_SECURITY);
     }
 
@@ -319,7 +363,7 @@ Status ServiceManager::unregisterForNotifications(
 Status ServiceManager::isDeclared(const std::string& name, bool* outReturn) {
     auto ctx = mAccess->getCallingContext();
 
-    if (!mAccess->canFind(ctx, name)) {
+    if (!canFind(ctx, name)) {
         return Status::fromExceptionCode(Status::EX_SECURITY);
     }
 
@@ -386,7 +430,7 @@ Status ServiceManager::registerClientCallback(const std::string& name, const sp<
     }
 
     auto ctx = mAccess->getCallingContext();
-    if (!mAccess->canAdd(ctx, name)) {
+    if (!canAdd(ctx, name)) {
         return Status::fromExceptionCode(Status::EX_SECURITY);
     }
 
@@ -436,6 +480,26 @@ void ServiceManager::removeClientCallback(const wp<IBinder>& who,
     }
 }
 
+status_t ServiceManager::dump(int fd, const Vector<String16>& /*args*/) {
+    std::string out;
+
+    size_t lookups = 0;
+    for (size_t count : mLookupLatencyHistogram) lookups += count;
+    StringAppendF(&out, "Service lookups (getService/checkService): %zu\n", lookups);
+    for (size_t i = 0; i < kLookupLatencyBucketsUs.size(); i++) {
+        StringAppendF(&out, "  < %" PRId64 "us: %zu\n", kLookupLatencyBucketsUs[i],
+                      mLookupLatencyHistogram[i]);
+    }
+    StringAppendF(&out, "  >= %" PRId64 "us: %zu\n", kLookupLatencyBucketsUs.back(),
+                  mLookupLatencyHistogram.back());
+
+    StringAppendF(&out, "Access cache: %zu/%zu entries, %zu hits, %zu misses, %zu invalidations\n",
+                  mAccessCache.size(), AccessCache::kMaxEntries, mAccessCache.hits(),
+                  mAccessCache.misses(), mAccessCache.invalidations());
+
+    return base::WriteStringToFd(out, fd) ? OK : UNKNOWN_ERROR;
+}
+
 ssize_t ServiceManager::Service::getNodeStrongRefCount() {
     sp<BpBinder> bpBinder = binder->remoteBinder();
     if (bpBinder == nullptr) return -1;
@@ -520,7 +584,7 @@ Status ServiceManager::tryUnregisterService(const std::string& name, const sp<IB
     }
 
     auto ctx = mAccess->getCallingContext();
-    if (!mAccess->canAdd(ctx, name)) {
+    if (!canAdd(ctx, name)) {
         return Status::fromExceptionCode(Status::EX_SECURITY);
     }
 
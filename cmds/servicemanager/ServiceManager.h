@@ -20,7 +20,11 @@
 #include <android/os/IClientCallback.h>
 #include <android/os/IServiceCallback.h>
 
+#include <array>
+#include <chrono>
+
 #include "Access.h"
+#include "AccessCache.h"
 
 namespace android {
 
@@ -50,6 +54,8 @@ public:
     void binderDied(const wp<IBinder>& who) override;
     void handleClientCallbacks();
 
+    status_t dump(int fd, const Vector<String16>& args) override;
+
 protected:
     virtual void tryStartService(const std::string& name);
 
@@ -84,11 +90,25 @@ private:
 
     sp<IBinder> tryGetService(const std::string& name, bool startIfNotFound);
 
+    // mAccess->canFind/canAdd, remembering grants in mAccessCache
+    bool canFind(const Access::CallingContext& ctx, const std::string& name);
+    bool canAdd(const Access::CallingContext& ctx, const std::string& name);
+
+    // upper bounds of the lookup latency histogram buckets, in microseconds
+    static constexpr std::array<int64_t, 8> kLookupLatencyBucketsUs = {
+        10, 20, 50, 100, 200, 500, 1000, 5000,
+    };
+    void recordLookupLatency(std::chrono::steady_clock::duration latency);
+
     ServiceMap mNameToService;
     ServiceCallbackMap mNameToRegistrationCallback;
     ClientCallbackMap mNameToClientCallback;
 
     std::unique_ptr<Access> mAccess;
+    AccessCache mAccessCache;
+
+    // getService/checkService latencies, the last bucket counts everything slower
+    std::array<size_t, kLookupLatencyBucketsUs.size() + 1> mLookupLatencyHistogram = {};
 };
 
 }  // namespace android
@@ -15,6 +15,7 @@
  */
 
 #include <android/os/BnServiceCallback.h>
+#include <android-base/file.h>
 #include <binder/Binder.h>
 #include <binder/ProcessState.h>
 #include <binder/IServiceManager.h>
@@ -35,6 +36,7 @@ using android::os::BnServiceCallback;
 using android::os::IServiceManager;
 using testing::_;
 using testing::ElementsAre;
+using testing::HasSubstr;
 using testing::NiceMock;
 using testing::Return;
 
@@ -51,10 +53,14 @@ static sp<IBinder> getBinder() {
 
 class MockAccess : public Access {
 public:
+    MockAccess() { ON_CALL(*this, isEnforced(_)).WillByDefault(Return(true)); }
+
     MOCK_METHOD0(getCallingContext, CallingContext());
     MOCK_METHOD2(canAdd, bool(const CallingContext&, const std::string& name));
     MOCK_METHOD2(canFind, bool(const CallingContext&, const std::string& name));
     MOCK_METHOD1(canList, bool(const CallingContext&));
+    MOCK_METHOD1(isEnforced, bool(const CallingContext&));
+    MOCK_METHOD0(getPolicyGeneration, uint64_t());
 };
 
 class MockServiceManager : public ServiceManager {
@@ -447,3 +453,142 @@ TEST(ServiceNotifications, GetMultipleNotification) {
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
     EXPECT_THAT(cb->registrations, ElementsAre("asdfasdf", "asdfasdf"));
 }
+
+TEST(AccessCache, FindCheckedOnce) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{
+        .sid = "u:r:untrusted_app:s0",
+    }));
+    EXPECT_CALL(*access, canFind(_, "foo")).Times(1).WillOnce(Return(true));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    for (int i = 0; i < 10; i++) {
+        sp<IBinder> out;
+        EXPECT_TRUE(sm->checkService("foo", &out).isOk());
+    }
+}
+
+TEST(AccessCache, AddCheckedOnce) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, canAdd(_, "foo")).Times(1).WillOnce(Return(true));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    for (int i = 0; i < 10; i++) {
+        EXPECT_TRUE(sm->addService("foo", getBinder(), false /*allowIsolated*/,
+            IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());
+    }
+}
+
+TEST(AccessCache, DenialsCheckedEveryTime) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, canFind(_, "foo")).Times(3).WillRepeatedly(Return(false));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    for (int i = 0; i < 3; i++) {
+        sp<IBinder> out;
+        EXPECT_TRUE(sm->checkService("foo", &out).isOk());
+    }
+}
+
+TEST(AccessCache, PermissiveGrantsCheckedEveryTime) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, isEnforced(_)).WillRepeatedly(Return(false));
+    EXPECT_CALL(*access, canFind(_, "foo")).Times(3).WillRepeatedly(Return(true));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    for (int i = 0; i < 3; i++) {
+        sp<IBinder> out;
+        EXPECT_TRUE(sm->checkService("foo", &out).isOk());
+    }
+}
+
+TEST(AccessCache, KeyedBySidNameAndPermission) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    const Access::CallingContext app = { .sid = "u:r:untrusted_app:s0" };
+    const Access::CallingContext system = { .sid = "u:r:system_server:s0" };
+    EXPECT_CALL(*access, getCallingContext())
+        .WillOnce(Return(app))
+        .WillOnce(Return(system))
+        .WillOnce(Return(app))
+        .WillOnce(Return(system))
+        .WillOnce(Return(app))
+        .WillOnce(Return(system));
+    EXPECT_CALL(*access, canFind(_, "foo")).Times(2).WillRepeatedly(Return(true));
+    EXPECT_CALL(*access, canFind(_, "bar")).Times(1).WillOnce(Return(true));
+    EXPECT_CALL(*access, canAdd(_, "foo")).Times(1).WillOnce(Return(true));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    sp<IBinder> out;
+    EXPECT_TRUE(sm->checkService("foo", &out).isOk());  // app
+    EXPECT_TRUE(sm->checkService("foo", &out).isOk());  // system
+    EXPECT_TRUE(sm->checkService("bar", &out).isOk());  // app
+    EXPECT_TRUE(sm->addService("foo", getBinder(), false /*allowIsolated*/,
+        IServiceManager::DUMP_FLAG_PRIORITY_DEFAULT).isOk());  // system
+    EXPECT_TRUE(sm->checkService("foo", &out).isOk());  // app, cached
+    EXPECT_TRUE(sm->checkService("foo", &out).isOk());  // system, cached
+}
+
+TEST(AccessCache, InvalidatedOnPolicyReload) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{}));
+    EXPECT_CALL(*access, getPolicyGeneration())
+        .WillOnce(Return(1))
+        .WillOnce(Return(1))
+        .WillRepeatedly(Return(2));
+    EXPECT_CALL(*access, canFind(_, "foo")).Times(2).WillRepeatedly(Return(true));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    for (int i = 0; i < 4; i++) {
+        sp<IBinder> out;
+        EXPECT_TRUE(sm->checkService("foo", &out).isOk());
+    }
+}
+
+TEST(AccessCache, Bounded) {
+    std::unique_ptr<MockAccess> access = std::make_unique<NiceMock<MockAccess>>();
+
+    EXPECT_CALL(*access, getCallingContext()).WillRepeatedly(Return(Access::CallingContext{}));
+    // "service0" is evicted by the last new entry, and checked again.
+    EXPECT_CALL(*access, canFind(_, _)).Times(android::AccessCache::kMaxEntries)
+        .WillRepeatedly(Return(true));
+    EXPECT_CALL(*access, canFind(_, "service0")).Times(2).WillRepeatedly(Return(true));
+
+    sp<ServiceManager> sm = new NiceMock<MockServiceManager>(std::move(access));
+
+    sp<IBinder> out;
+    for (size_t i = 0; i <= android::AccessCache::kMaxEntries; i++) {
+        EXPECT_TRUE(sm->checkService("service" + std::to_string(i), &out).isOk());
+    }
+    EXPECT_TRUE(sm->checkService("service0", &out).isOk());
+}
+
+TEST(Dump, LookupLatencyAndAccessCache) {
+    auto sm = getPermissiveServiceManager();
+
+    sp<IBinder> out;
+    EXPECT_TRUE(sm->checkService("foo", &out).isOk());
+    EXPECT_TRUE(sm->checkService("foo", &out).isOk());
+
+    android::base::TemporaryFile tmp;
+    ASSERT_EQ(android::OK, sm->dump(tmp.fd, {}));
+
+    std::string dump;
+    ASSERT_TRUE(android::base::ReadFileToString(tmp.path, &dump));
+    EXPECT_THAT(dump, HasSubstr("Service lookups (getService/checkService): 2\n"));
+    EXPECT_THAT(dump, HasSubstr("Access cache: 1/1024 entries, 1 hits, 1 misses"));
+}
@@ -41,13 +41,15 @@ void printHelpMenu() {
     std::cout << "  -m  Stops the replayer at the start of the trace and switches ";
                  "to manual replay\n";
 
-    std::cout << "\n  -t [Number of Threads]  Specifies the number of threads to be used while "
-                 "replaying (default is " << android::DEFAULT_THREADS << ")\n";
+    std::cout << "\n  -t [Number of Threads]  Specifies the number of worker threads, which is also "
+                 "the number of increments prepared ahead (default is "
+              << android::DEFAULT_THREADS << ")\n";
 
     std::cout << "\n  -s [Timestamp]  Specify at what timestamp should the replayer switch "
                  "to manual replay\n";
 
-    std::cout << "  -n  Ignore timestamps and run through trace as fast as possible\n";
+    std::cout << "  -n  Ignore timestamps and run through trace as fast as possible, reporting "
+                 "transaction throughput\n";
 
     std::cout << "  -l  Indefinitely loop the replayer\n";
 
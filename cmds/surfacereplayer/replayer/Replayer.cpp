@@ -22,6 +22,8 @@
 
 #include <android-base/file.h>
 
+#include <google/protobuf/io/coded_stream.h>
+
 #include <gui/BufferQueue.h>
 #include <gui/ISurfaceComposer.h>
 #include <gui/LayerState.h>
@@ -31,8 +33,12 @@
 #include <ui/DisplayInfo.h>
 #include <utils/Log.h>
 #include <utils/String8.h>
+#include <utils/Timers.h>
 #include <utils/Trace.h>
 
+#include <time.h>
+
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <condition_variable>
@@ -48,8 +54,38 @@
 
 using namespace android;
 
+// Ordering keys for increments that don't belong to a surface. Surfaces use their id.
+static constexpr TaskPool::Key DISPLAY_KEY_BASE = 1LL << 32;
+static constexpr TaskPool::Key VSYNC_KEY = 2LL << 32;
+static constexpr TaskPool::Key EMPTY_TRANSACTION_KEY = 3LL << 32;
+
 std::atomic_bool Replayer::sReplayingManually(false);
 
+// Streamed traces are written one increment at a time, so a recording that was cut short ends in
+// a partial increment. Keep every complete increment before it.
+static bool parseStreamedTrace(const std::string& input, Trace* trace) {
+    google::protobuf::io::CodedInputStream stream(
+            reinterpret_cast<const uint8_t*>(input.data()), input.size());
+    // Field 1 of Trace, length-delimited.
+    constexpr uint32_t incrementTag = (1 << 3) | 2;
+
+    trace->Clear();
+    while (stream.ReadTag() == incrementTag) {
+        uint32_t size;
+        if (!stream.ReadVarint32(&size)) {
+            break;
+        }
+        auto limit = stream.PushLimit(size);
+        Increment increment;
+        if (!increment.ParseFromCodedStream(&stream) || !stream.ConsumedEntireMessage()) {
+            break;
+        }
+        stream.PopLimit(limit);
+        trace->add_increment()->Swap(&increment);
+    }
+    return trace->increment_size() > 0;
+}
+
 Replayer::Replayer(const std::string& filename, bool replayManually, int numThreads, bool wait,
         nsecs_t stopHere)
       : mTrace(),
@@ -68,6 +104,13 @@ Replayer::Replayer(const std::string& filename, bool replayManually, int numThre
     }
 
     mLoaded = mTrace.ParseFromString(input);
+    if (!mLoaded) {
+        mLoaded = parseStreamedTrace(input, &mTrace);
+        if (mLoaded) {
+            std::cerr << "Trace is truncated, replaying the first " << mTrace.increment_size()
+                      << " increments" << std::endl;
+        }
+    }
     if (!mLoaded) {
         std::cerr << "Trace did not load." << std::endl;
         abort();
@@ -114,8 +157,13 @@ status_t Replayer::replay() {
 
     SurfaceComposerClient::enableVSyncInjections(true);
 
+    mTaskPool = std::make_unique<TaskPool>(mNumThreads);
+
     initReplay();
 
+    mTraceStartTime = mCurrentTime;
+    mReplayStartTime = systemTime(SYSTEM_TIME_MONOTONIC);
+
     ALOGV("Starting actual Replay!");
     while (!mPendingIncrements.empty()) {
         mCurrentIncrement = mTrace.increment(mIncrementIndex);
@@ -125,7 +173,12 @@ status_t Replayer::replay() {
             sReplayingManually.store(true);
         }
 
-        waitForConsoleCommmand();
+        if (sReplayingManually) {
+            waitForConsoleCommmand();
+            // Pace from the previous increment rather than trying to catch up on the pause.
+            mReplayStartTime =
+                    systemTime(SYSTEM_TIME_MONOTONIC) - (mCurrentTime - mTraceStartTime);
+        }
 
         if (mWaitForTimeStamps) {
             waitUntilTimestamp(mCurrentIncrement.time_stamp());
@@ -136,14 +189,22 @@ status_t Replayer::replay() {
 
         event->complete();
 
+        if (mWaitForTimeStamps) {
+            recordLateness(mCurrentIncrement.time_stamp());
+        }
+        mStats.increments++;
+
         if (event->getIncrementType() == Increment::kVsyncEvent) {
             mWaitingForNextVSync = false;
+        } else if (event->getIncrementType() == Increment::kTransaction) {
+            mStats.transactions++;
         }
 
         if (mIncrementIndex + mNumThreads < mTrace.increment_size()) {
             status = dispatchEvent(mIncrementIndex + mNumThreads);
 
             if (status != NO_ERROR) {
+                completePendingIncrements();
                 SurfaceComposerClient::enableVSyncInjections(false);
                 return status;
             }
@@ -153,11 +214,44 @@ status_t Replayer::replay() {
         mCurrentTime = mCurrentIncrement.time_stamp();
     }
 
+    mTaskPool->waitForIdle();
+    mStats.elapsed = systemTime(SYSTEM_TIME_MONOTONIC) - mReplayStartTime;
+    printStats();
+
     SurfaceComposerClient::enableVSyncInjections(false);
 
     return status;
 }
 
+// Lets the increments that were already handed to workers run, so that none of them is left
+// waiting for a signal that would never come.
+void Replayer::completePendingIncrements() {
+    while (!mPendingIncrements.empty()) {
+        auto event = mPendingIncrements.front();
+        mPendingIncrements.pop();
+        // Buffer updates belong to the per-surface schedulers, not to the pool.
+        if (event->getIncrementType() != Increment::kBufferUpdate) {
+            event->complete();
+        }
+    }
+    mTaskPool->waitForIdle();
+}
+
+void Replayer::printStats() const {
+    double seconds = mStats.elapsed / 1e9;
+    std::cout << "Replayed " << mStats.increments << " increments (" << mStats.transactions
+              << " transactions) in " << seconds << "s";
+    if (mWaitForTimeStamps) {
+        nsecs_t mean = mStats.increments > 0 ? mStats.totalLateness / mStats.increments : 0;
+        std::cout << ", scheduling error: mean " << ns2us(mean) << "us, max "
+                  << ns2us(mStats.maxLateness) << "us";
+    } else if (seconds > 0) {
+        std::cout << ", " << static_cast<int64_t>(mStats.transactions / seconds)
+                  << " transactions/s";
+    }
+    std::cout << std::endl;
+}
+
 status_t Replayer::initReplay() {
     for (int i = 0; i < mNumThreads && i < mTrace.increment_size(); i++) {
         status_t status = dispatchEvent(i);
@@ -272,19 +366,49 @@ void Replayer::waitForConsoleCommmand() {
     }
 }
 
+// Increments that share a key are applied in trace order. A transaction is ordered with the first
+// surface (or display) it changes.
+static TaskPool::Key orderingKey(const Increment& increment) {
+    switch (increment.increment_case()) {
+        case Increment::kTransaction: {
+            const Transaction& t = increment.transaction();
+            if (t.surface_change_size() > 0) {
+                return static_cast<uint32_t>(t.surface_change(0).id());
+            }
+            if (t.display_change_size() > 0) {
+                return DISPLAY_KEY_BASE + static_cast<uint32_t>(t.display_change(0).id());
+            }
+            return EMPTY_TRANSACTION_KEY;
+        }
+        case Increment::kSurfaceCreation:
+            return static_cast<uint32_t>(increment.surface_creation().id());
+        case Increment::kDisplayCreation:
+            return DISPLAY_KEY_BASE + static_cast<uint32_t>(increment.display_creation().id());
+        case Increment::kDisplayDeletion:
+            return DISPLAY_KEY_BASE + static_cast<uint32_t>(increment.display_deletion().id());
+        case Increment::kPowerModeUpdate:
+            return DISPLAY_KEY_BASE + static_cast<uint32_t>(increment.power_mode_update().id());
+        default:
+            return VSYNC_KEY;
+    }
+}
+
 status_t Replayer::dispatchEvent(int index) {
     auto increment = mTrace.increment(index);
     std::shared_ptr<Event> event = std::make_shared<Event>(increment.increment_case());
-    mPendingIncrements.push(event);
+    TaskPool::Key key = orderingKey(increment);
 
     status_t status = NO_ERROR;
     switch (increment.increment_case()) {
         case increment.kTransaction: {
-            std::thread(&Replayer::doTransaction, this, increment.transaction(), event).detach();
+            mTaskPool->enqueue(key, [this, t = increment.transaction(), event] {
+                doTransaction(t, event);
+            });
         } break;
         case increment.kSurfaceCreation: {
-            std::thread(&Replayer::createSurfaceControl, this, increment.surface_creation(), event)
-                    .detach();
+            mTaskPool->enqueue(key, [this, create = increment.surface_creation(), event] {
+                createSurfaceControl(create, event);
+            });
         } break;
         case increment.kBufferUpdate: {
             std::lock_guard<std::mutex> lock1(mLayerLock);
@@ -308,19 +432,24 @@ status_t Replayer::dispatchEvent(int index) {
             }
         } break;
         case increment.kVsyncEvent: {
-            std::thread(&Replayer::injectVSyncEvent, this, increment.vsync_event(), event).detach();
+            mTaskPool->enqueue(key, [this, vsync = increment.vsync_event(), event] {
+                injectVSyncEvent(vsync, event);
+            });
         } break;
         case increment.kDisplayCreation: {
-            std::thread(&Replayer::createDisplay, this, increment.display_creation(), event)
-                    .detach();
+            mTaskPool->enqueue(key, [this, create = increment.display_creation(), event] {
+                createDisplay(create, event);
+            });
         } break;
         case increment.kDisplayDeletion: {
-            std::thread(&Replayer::deleteDisplay, this, increment.display_deletion(), event)
-                    .detach();
+            mTaskPool->enqueue(key, [this, delete_ = increment.display_deletion(), event] {
+                deleteDisplay(delete_, event);
+            });
         } break;
         case increment.kPowerModeUpdate: {
-            std::thread(&Replayer::updatePowerMode, this, increment.power_mode_update(), event)
-                    .detach();
+            mTaskPool->enqueue(key, [this, update = increment.power_mode_update(), event] {
+                updatePowerMode(update, event);
+            });
         } break;
         default:
             ALOGE("Unknown Increment Type: %d", increment.increment_case());
@@ -328,6 +457,9 @@ status_t Replayer::dispatchEvent(int index) {
             break;
     }
 
+    if (status == NO_ERROR) {
+        mPendingIncrements.push(event);
+    }
     return status;
 }
 
@@ -688,8 +820,23 @@ void Replayer::updatePowerMode(const PowerModeUpdate& pmu, const std::shared_ptr
 }
 
 void Replayer::waitUntilTimestamp(int64_t timestamp) {
-    ALOGV("Waiting for %lld nanoseconds...", static_cast<int64_t>(timestamp - mCurrentTime));
-    std::this_thread::sleep_for(std::chrono::nanoseconds(timestamp - mCurrentTime));
+    // Sleep until an absolute deadline so that wakeup latency doesn't accumulate over the trace.
+    nsecs_t deadline = mReplayStartTime + (timestamp - mTraceStartTime);
+    ALOGV("Waiting for %lld nanoseconds...",
+            static_cast<int64_t>(deadline - systemTime(SYSTEM_TIME_MONOTONIC)));
+
+    struct timespec ts;
+    ts.tv_sec = deadline / 1000000000;
+    ts.tv_nsec = deadline % 1000000000;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+void Replayer::recordLateness(int64_t timestamp) {
+    nsecs_t deadline = mReplayStartTime + (timestamp - mTraceStartTime);
+    nsecs_t lateness = std::max<nsecs_t>(systemTime(SYSTEM_TIME_MONOTONIC) - deadline, 0);
+    mStats.totalLateness += lateness;
+    mStats.maxLateness = std::max(mStats.maxLateness, lateness);
 }
 
 void Replayer::waitUntilDeferredTransactionLayerExists(
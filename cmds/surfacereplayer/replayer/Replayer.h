@@ -20,6 +20,7 @@
 #include "BufferQueueScheduler.h"
 #include "Color.h"
 #include "Event.h"
+#include "TaskPool.h"
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
@@ -52,6 +53,16 @@ typedef int32_t display_id;
 typedef google::protobuf::RepeatedPtrField<SurfaceChange> SurfaceChanges;
 typedef google::protobuf::RepeatedPtrField<DisplayChange> DisplayChanges;
 
+// How closely the replay followed the trace. Lateness is measured from the time an increment was
+// due, as scheduled from the start of the replay, to the time it was released to its worker.
+struct ReplayStats {
+    int64_t increments = 0;
+    int64_t transactions = 0;
+    nsecs_t totalLateness = 0;
+    nsecs_t maxLateness = 0;
+    nsecs_t elapsed = 0;
+};
+
 class Replayer {
   public:
     Replayer(const std::string& filename, bool replayManually = false,
@@ -61,6 +72,8 @@ class Replayer {
 
     status_t replay();
 
+    const ReplayStats& getStats() const { return mStats; }
+
   private:
     status_t initReplay();
 
@@ -68,6 +81,8 @@ class Replayer {
     static void stopAutoReplayHandler(int signal);
 
     status_t dispatchEvent(int index);
+    void completePendingIncrements();
+    void printStats() const;
 
     status_t doTransaction(const Transaction& transaction, const std::shared_ptr<Event>& event);
     status_t createSurfaceControl(const SurfaceCreation& create,
@@ -133,6 +148,7 @@ class Replayer {
             display_id id, const ProjectionChange& pc);
 
     void waitUntilTimestamp(int64_t timestamp);
+    void recordLateness(int64_t timestamp);
     void waitUntilDeferredTransactionLayerExists(
             const DeferredTransactionChange& dtc, std::unique_lock<std::mutex>& lock);
     status_t loadSurfaceComposerClient();
@@ -141,6 +157,9 @@ class Replayer {
     bool mLoaded = false;
     int32_t mIncrementIndex = 0;
     int64_t mCurrentTime = 0;
+    int64_t mTraceStartTime = 0;
+    // Monotonic time at which the first increment was due.
+    nsecs_t mReplayStartTime = 0;
     int32_t mNumThreads = DEFAULT_THREADS;
 
     Increment mCurrentIncrement;
@@ -170,6 +189,11 @@ class Replayer {
 
     sp<SurfaceComposerClient> mComposerClient;
     std::queue<std::shared_ptr<Event>> mPendingIncrements;
+
+    ReplayStats mStats;
+
+    // Declared last so that its workers are done before the state they use goes away.
+    std::unique_ptr<TaskPool> mTaskPool;
 };
 
 }  // namespace android
@@ -0,0 +1,88 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "TaskPool.h"
+
+#include <algorithm>
+
+using namespace android;
+
+TaskPool::TaskPool(int numThreads) {
+    numThreads = std::max(numThreads, 1);
+    for (int i = 0; i < numThreads; i++) {
+        mThreads.emplace_back(&TaskPool::threadMain, this);
+    }
+}
+
+TaskPool::~TaskPool() {
+    waitForIdle();
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mTaskReady.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void TaskPool::enqueue(Key key, Task task) {
+    std::lock_guard<std::mutex> lock(mLock);
+    KeyQueue& queue = mQueues[key];
+    queue.tasks.push_back(std::move(task));
+    if (!queue.running && queue.tasks.size() == 1) {
+        mReadyKeys.push_back(key);
+        mTaskReady.notify_one();
+    }
+}
+
+void TaskPool::waitForIdle() {
+    std::unique_lock<std::mutex> lock(mLock);
+    mIdle.wait(lock, [this] { return mQueues.empty(); });
+}
+
+void TaskPool::threadMain() {
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mTaskReady.wait(lock, [this] { return mStopping || !mReadyKeys.empty(); });
+        if (mReadyKeys.empty()) {
+            return;
+        }
+
+        Key key = mReadyKeys.front();
+        mReadyKeys.pop_front();
+        KeyQueue& queue = mQueues[key];
+        Task task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        queue.running = true;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        // Entries of a running key are never erased, so the reference is still valid.
+        queue.running = false;
+        if (!queue.tasks.empty()) {
+            mReadyKeys.push_back(key);
+            mTaskReady.notify_one();
+        } else {
+            mQueues.erase(key);
+            if (mQueues.empty()) {
+                mIdle.notify_all();
+            }
+        }
+    }
+}
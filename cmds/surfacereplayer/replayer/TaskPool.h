@@ -0,0 +1,72 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ANDROID_SURFACEREPLAYER_TASKPOOL_H
+#define ANDROID_SURFACEREPLAYER_TASKPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace android {
+
+// A fixed set of worker threads shared by all increments of a replay.
+//
+// Every task carries an ordering key, e.g. the surface it changes. Tasks with the same key run
+// one at a time in the order they were enqueued, so changes to one surface reach SurfaceFlinger
+// in trace order, while tasks with different keys run concurrently. A task that is waiting for
+// its turn does not occupy a worker.
+class TaskPool {
+  public:
+    using Key = int64_t;
+    using Task = std::function<void()>;
+
+    explicit TaskPool(int numThreads);
+
+    // Waits for all enqueued tasks to finish.
+    ~TaskPool();
+
+    void enqueue(Key key, Task task);
+
+    void waitForIdle();
+
+  private:
+    struct KeyQueue {
+        std::deque<Task> tasks;
+        bool running = false;
+    };
+
+    void threadMain();
+
+    std::mutex mLock;
+    std::condition_variable mTaskReady;
+    std::condition_variable mIdle;
+
+    // Keys whose next task may start, in the order they became runnable.
+    std::deque<Key> mReadyKeys;
+    // Keys with a task queued or running.
+    std::unordered_map<Key, KeyQueue> mQueues;
+    bool mStopping = false;
+
+    std::vector<std::thread> mThreads;
+};
+
+}  // namespace android
+#endif
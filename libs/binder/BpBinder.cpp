@@ -21,10 +21,12 @@
 
 #include <binder/IPCThreadState.h>
 #include <binder/IResultReceiver.h>
+#include <binder/RpcSession.h>
 #include <binder/Stability.h>
 #include <cutils/compiler.h>
 #include <utils/Log.h>
 
+#include <inttypes.h>
 #include <stdio.h>
 
 //#undef ALOGV
@@ -46,6 +48,26 @@ uint32_t BpBinder::sBinderProxyCountHighWatermark = 2500;
 // Another arbitrary value a binder count needs to drop below before another callback will be called
 uint32_t BpBinder::sBinderProxyCountLowWatermark = 2000;
 
+// The handle of proxies of RpcSessions, which the driver never hands out.
+static constexpr int32_t kRpcHandle = -1;
+
+// A proxy of an object served over an RpcSession. Its session and address live
+// here rather than in BpBinder, which is part of the VNDK and can't change its
+// layout.
+class RpcBpBinder : public BpBinder {
+public:
+    RpcBpBinder(const sp<RpcSession>& session, uint64_t address)
+          : BpBinder(RpcProxyTag{}), mSession(session), mAddress(address) {
+        ALOGV("Creating BpBinder %p address %" PRIu64 "\n", this, mAddress);
+    }
+
+    const sp<RpcSession> mSession;
+    const uint64_t mAddress;
+
+protected:
+    ~RpcBpBinder() override { mSession->onProxyDestroyed(mAddress, this); }
+};
+
 enum {
     LIMIT_REACHED_MASK = 0x80000000,        // A flag denoting that the limit has been reached
     COUNTING_VALUE_MASK = 0x7FFFFFFF,       // A mask of the remaining bits for the count value
@@ -136,6 +158,11 @@ BpBinder* BpBinder::create(int32_t handle) {
     return new BpBinder(handle, trackedUid);
 }
 
+BpBinder* BpBinder::create(const sp<RpcSession>& session, uint64_t address) {
+    LOG_ALWAYS_FATAL_IF(session == nullptr, "BpBinder::create null session");
+    return new RpcBpBinder(session, address);
+}
+
 BpBinder::BpBinder(int32_t handle, int32_t trackedUid)
     : mHandle(handle)
     , mStability(0)
@@ -150,10 +177,35 @@ BpBinder::BpBinder(int32_t handle, int32_t trackedUid)
     IPCThreadState::self()->incWeakHandle(handle, this);
 }
 
+BpBinder::BpBinder(RpcProxyTag)
+    : mHandle(kRpcHandle)
+    , mStability(0)
+    , mAlive(1)
+    , mObitsSent(0)
+    , mObituaries(nullptr)
+    , mTrackedUid(-1)
+{
+    // The session is told as soon as the last strong reference goes away, so
+    // unlike proxies of handles these keep the default strong lifetime.
+}
+
 int32_t BpBinder::handle() const {
     return mHandle;
 }
 
+bool BpBinder::isRpcBinder() const {
+    return mHandle == kRpcHandle;
+}
+
+const sp<RpcSession>& BpBinder::rpcSession() const {
+    static const sp<RpcSession> kNoSession;
+    return isRpcBinder() ? static_cast<const RpcBpBinder*>(this)->mSession : kNoSession;
+}
+
+uint64_t BpBinder::rpcAddress() const {
+    return isRpcBinder() ? static_cast<const RpcBpBinder*>(this)->mAddress : 0;
+}
+
 bool BpBinder::isDescriptorCached() const {
     Mutex::Autolock _l(mLock);
     return mDescriptorCache.size() ? true : false;
@@ -234,8 +286,9 @@ status_t BpBinder::transact(
             }
         }
 
-        status_t status = IPCThreadState::self()->transact(
-            mHandle, code, data, reply, flags);
+        status_t status = isRpcBinder()
+            ? rpcSession()->transact(rpcAddress(), code, data, reply, flags)
+            : IPCThreadState::self()->transact(mHandle, code, data, reply, flags);
         if (status == DEAD_OBJECT) mAlive = 0;
 
         return status;
@@ -248,6 +301,9 @@ status_t BpBinder::transact(
 status_t BpBinder::linkToDeath(
     const sp<DeathRecipient>& recipient, void* cookie, uint32_t flags)
 {
+    // RpcSession doesn't deliver death notifications.
+    if (isRpcBinder()) return INVALID_OPERATION;
+
     Obituary ob;
     ob.recipient = recipient;
     ob.cookie = cookie;
@@ -388,6 +444,9 @@ BpBinder::~BpBinder()
 {
     ALOGV("Destroying BpBinder %p handle %d\n", this, mHandle);
 
+    // ~RpcBpBinder already told its session.
+    if (isRpcBinder()) return;
+
     IPCThreadState* ipc = IPCThreadState::self();
 
     if (mTrackedUid >= 0) {
@@ -419,6 +478,7 @@ BpBinder::~BpBinder()
 void BpBinder::onFirstRef()
 {
     ALOGV("onFirstRef BpBinder %p handle %d\n", this, mHandle);
+    if (isRpcBinder()) return;
     IPCThreadState* ipc = IPCThreadState::self();
     if (ipc) ipc->incStrongHandle(mHandle, this);
 }
@@ -429,6 +489,7 @@ void BpBinder::onLastStrongRef(const void* /*id*/)
     IF_ALOGV() {
         printRefs();
     }
+    if (isRpcBinder()) return;
     IPCThreadState* ipc = IPCThreadState::self();
     if (ipc) ipc->decStrongHandle(mHandle);
 
@@ -456,6 +517,7 @@ void BpBinder::onLastStrongRef(const void* /*id*/)
 bool BpBinder::onIncStrongAttempted(uint32_t /*flags*/, const void* /*id*/)
 {
     ALOGV("onIncStrongAttempted BpBinder %p handle %d\n", this, mHandle);
+    if (isRpcBinder()) return false;
     IPCThreadState* ipc = IPCThreadState::self();
     return ipc ? ipc->attemptIncStrongHandle(mHandle) == NO_ERROR : false;
 }
@@ -209,6 +209,12 @@ status_t Parcel::flattenBinder(const sp<IBinder>& binder)
             if (proxy == nullptr) {
                 ALOGE("null proxy");
             }
+            if (proxy && proxy->isRpcBinder()) {
+                // A parcel doesn't know whether it goes to the driver or to an
+                // RpcSession, and the driver can't carry these.
+                ALOGE("Cannot write a proxy of an RPC session to a parcel");
+                return BAD_TYPE;
+            }
             const int32_t handle = proxy ? proxy->handle() : 0;
             obj.hdr.type = BINDER_TYPE_HANDLE;
             obj.binder = 0; /* Don't pass uninitialized stack data to a remote process */
@@ -27,6 +27,7 @@
 #include <utils/String8.h>
 #include <utils/threads.h>
 
+#include <private/binder/ProxyHandleTable.h>
 #include <private/binder/binder_module.h>
 #include "Static.h"
 
@@ -223,90 +224,56 @@ void ProcessState::setCallRestriction(CallRestriction restriction) {
     mCallRestriction = restriction;
 }
 
-ProcessState::handle_entry* ProcessState::lookupHandleLocked(int32_t handle)
+// Proxies of the handles of this process. This lives outside of ProcessState
+// to keep the layout of that class unchanged. It is never destroyed, as
+// proxies may still be released while the process exits.
+static ProxyHandleTable& proxyHandleTable()
 {
-    const size_t N=mHandleToObject.size();
-    if (N <= (size_t)handle) {
-        handle_entry e;
-        e.binder = nullptr;
-        e.refs = nullptr;
-        status_t err = mHandleToObject.insertAt(e, N, handle+1-N);
-        if (err < NO_ERROR) return nullptr;
-    }
-    return &mHandleToObject.editItemAt(handle);
+    static ProxyHandleTable* table = new ProxyHandleTable();
+    return *table;
 }
 
 sp<IBinder> ProcessState::getStrongProxyForHandle(int32_t handle)
 {
-    sp<IBinder> result;
-
-    AutoMutex _l(mLock);
-
-    handle_entry* e = lookupHandleLocked(handle);
-
-    if (e != nullptr) {
-        // We need to create a new BpBinder if there isn't currently one, OR we
-        // are unable to acquire a weak reference on this current one.  The
-        // attemptIncWeak() is safe because we know the BpBinder destructor will always
-        // call expungeHandle(), which acquires the same lock we are holding now.
-        // We need to do this because there is a race condition between someone
-        // releasing a reference on this BpBinder, and a new reference on its handle
-        // arriving from the driver.
-        IBinder* b = e->binder;
-        if (b == nullptr || !e->refs->attemptIncWeak(this)) {
-            if (handle == 0) {
-                // Special case for context manager...
-                // The context manager is the only object for which we create
-                // a BpBinder proxy without already holding a reference.
-                // Perform a dummy transaction to ensure the context manager
-                // is registered before we create the first local reference
-                // to it (which will occur when creating the BpBinder).
-                // If a local reference is created for the BpBinder when the
-                // context manager is not present, the driver will fail to
-                // provide a reference to the context manager, but the
-                // driver API does not return status.
-                //
-                // Note that this is not race-free if the context manager
-                // dies while this code runs.
-                //
-                // TODO: add a driver API to wait for context manager, or
-                // stop special casing handle 0 for context manager and add
-                // a driver API to get a handle to the context manager with
-                // proper reference counting.
-
-                Parcel data;
-                status_t status = IPCThreadState::self()->transact(
-                        0, IBinder::PING_TRANSACTION, data, nullptr, 0);
-                if (status == DEAD_OBJECT)
-                   return nullptr;
-            }
-
-            b = BpBinder::create(handle);
-            e->binder = b;
-            if (b) e->refs = b->getWeakRefs();
-            result = b;
-        } else {
-            // This little bit of nastyness is to allow us to add a primary
-            // reference to the remote proxy when this team doesn't have one
-            // but another team is sending the handle to us.
-            result.force_set(b);
-            e->refs->decWeak(this);
+    // Existing proxies are looked up without taking a lock, see
+    // ProxyHandleTable. A new BpBinder is only created if there isn't
+    // currently one, or if we are unable to acquire a weak reference on the
+    // current one because it is being destroyed.
+    return proxyHandleTable().getOrCreate(handle, [](int32_t handle) -> IBinder* {
+        if (handle == 0) {
+            // Special case for context manager...
+            // The context manager is the only object for which we create
+            // a BpBinder proxy without already holding a reference.
+            // Perform a dummy transaction to ensure the context manager
+            // is registered before we create the first local reference
+            // to it (which will occur when creating the BpBinder).
+            // If a local reference is created for the BpBinder when the
+            // context manager is not present, the driver will fail to
+            // provide a reference to the context manager, but the
+            // driver API does not return status.
+            //
+            // Note that this is not race-free if the context manager
+            // dies while this code runs.
+            //
+            // TODO: add a driver API to wait for context manager, or
+            // stop special casing handle 0 for context manager and add
+            // a driver API to get a handle to the context manager with
+            // proper reference counting.
+
+            Parcel data;
+            status_t status = IPCThreadState::self()->transact(
+                    0, IBinder::PING_TRANSACTION, data, nullptr, 0);
+            if (status == DEAD_OBJECT)
+               return nullptr;
         }
-    }
 
-    return result;
+        return BpBinder::create(handle);
+    });
 }
 
 void ProcessState::expungeHandle(int32_t handle, IBinder* binder)
 {
-    AutoMutex _l(mLock);
-
-    handle_entry* e = lookupHandleLocked(handle);
-
-    // This handle may have already been replaced with a new BpBinder
-    // (if someone failed the AttemptIncWeak() above); we don't want
-    // to overwrite it.
-    if (e && e->binder == binder) e->binder = nullptr;
+    proxyHandleTable().expunge(handle, binder);
 }
 
 String8 ProcessState::makeBinderThreadName() {
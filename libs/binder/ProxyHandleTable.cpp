@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <private/binder/ProxyHandleTable.h>
+
+#include <algorithm>
+#include <new>
+#include <thread>
+
+namespace android {
+
+ProxyHandleTable::Directory::Directory(size_t size)
+      : capacity(size), chunks(new std::atomic<Chunk*>[size]) {
+    for (size_t i = 0; i < capacity; i++) {
+        chunks[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+ProxyHandleTable::ProxyHandleTable() {}
+
+ProxyHandleTable::~ProxyHandleTable() {
+    // Retired directories only hold chunks which were copied to the current one.
+    Directory* directory = mDirectory.load(std::memory_order_relaxed);
+    if (directory == nullptr) return;
+    for (size_t i = 0; i < directory->capacity; i++) {
+        delete directory->chunks[i].load(std::memory_order_relaxed);
+    }
+    delete directory;
+}
+
+ProxyHandleTable::Entry* ProxyHandleTable::findEntry(int32_t handle) const {
+    const Directory* directory = mDirectory.load(std::memory_order_acquire);
+    const size_t chunkIndex = static_cast<size_t>(handle) >> kChunkShift;
+    if (directory == nullptr || chunkIndex >= directory->capacity) return nullptr;
+
+    Chunk* chunk = directory->chunks[chunkIndex].load(std::memory_order_acquire);
+    if (chunk == nullptr) return nullptr;
+    return &chunk->entries[handle & (kChunkSize - 1)];
+}
+
+ProxyHandleTable::Entry* ProxyHandleTable::findOrAllocateEntry(int32_t handle) {
+    Entry* entry = findEntry(handle);
+    if (entry != nullptr) return entry;
+
+    std::lock_guard<std::mutex> _l(mGrowLock);
+
+    const size_t chunkIndex = static_cast<size_t>(handle) >> kChunkShift;
+    Directory* directory = mDirectory.load(std::memory_order_relaxed);
+    if (directory == nullptr || chunkIndex >= directory->capacity) {
+        size_t capacity = directory != nullptr ? directory->capacity * 2 : kInitialChunks;
+        capacity = std::max(capacity, chunkIndex + 1);
+        Directory* grown = new (std::nothrow) Directory(capacity);
+        if (grown == nullptr) return nullptr;
+        if (directory != nullptr) {
+            for (size_t i = 0; i < directory->capacity; i++) {
+                grown->chunks[i].store(directory->chunks[i].load(std::memory_order_relaxed),
+                                       std::memory_order_relaxed);
+            }
+            mRetiredDirectories.emplace_back(directory);
+        }
+        mDirectory.store(grown, std::memory_order_release);
+        directory = grown;
+    }
+
+    Chunk* chunk = directory->chunks[chunkIndex].load(std::memory_order_relaxed);
+    if (chunk == nullptr) {
+        chunk = new (std::nothrow) Chunk;
+        if (chunk == nullptr) return nullptr;
+        directory->chunks[chunkIndex].store(chunk, std::memory_order_release);
+    }
+    return &chunk->entries[handle & (kChunkSize - 1)];
+}
+
+sp<IBinder> ProxyHandleTable::tryAcquire(Entry& entry) {
+    sp<IBinder> result;
+
+    // Pairs with expunge(): either it sees this reader and waits for it, or
+    // the binder it cleared is not seen here.
+    entry.readers.fetch_add(1, std::memory_order_seq_cst);
+    IBinder* binder = entry.binder.load(std::memory_order_seq_cst);
+    if (binder != nullptr) {
+        // The proxy may be destroyed already, except for its call to
+        // expunge(), so it is only used through a weak reference. We need to
+        // do this because there is a race condition between someone releasing
+        // a reference on the proxy, and a new reference on its handle arriving
+        // from the driver.
+        RefBase::weakref_type* refs = binder->getWeakRefs();
+        if (refs->attemptIncWeak(this)) {
+            // This little bit of nastyness is to allow us to add a primary
+            // reference to the remote proxy when this team doesn't have one
+            // but another team is sending the handle to us.
+            result.force_set(binder);
+            refs->decWeak(this);
+        }
+    }
+    entry.readers.fetch_sub(1, std::memory_order_release);
+
+    return result;
+}
+
+sp<IBinder> ProxyHandleTable::getOrCreate(int32_t handle, const CreateFunc& create) {
+    if (handle < 0) return nullptr;
+
+    Entry* entry = findEntry(handle);
+    if (entry != nullptr) {
+        sp<IBinder> result = tryAcquire(*entry);
+        if (result != nullptr) return result;
+    }
+
+    entry = findOrAllocateEntry(handle);
+    if (entry == nullptr) return nullptr;
+
+    std::lock_guard<std::mutex> _l(stripeLock(handle));
+
+    // Another thread may have made a proxy since the lookup above.
+    sp<IBinder> result = tryAcquire(*entry);
+    if (result != nullptr) return result;
+
+    IBinder* binder = create(handle);
+    if (binder == nullptr) return nullptr;
+    entry->binder.store(binder, std::memory_order_seq_cst);
+    result = binder;
+    return result;
+}
+
+void ProxyHandleTable::expunge(int32_t handle, IBinder* binder) {
+    if (handle < 0) return;
+    Entry* entry = findEntry(handle);
+    if (entry == nullptr) return;
+
+    {
+        std::lock_guard<std::mutex> _l(stripeLock(handle));
+        // This handle may have already been replaced with a new proxy (if
+        // someone failed the attemptIncWeak() in tryAcquire()); we don't want
+        // to overwrite it.
+        IBinder* expected = binder;
+        entry->binder.compare_exchange_strong(expected, nullptr, std::memory_order_seq_cst);
+    }
+
+    // Lookups which read |binder| before it was cleared or replaced may still
+    // be using it. They don't block, so this doesn't spin for long.
+    while (entry->readers.load(std::memory_order_seq_cst) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace android
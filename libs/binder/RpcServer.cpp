@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcServer"
+
+#include <binder/RpcServer.h>
+
+#include <utils/Log.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <thread>
+
+#include "RpcWireFormat.h"
+
+namespace android {
+
+using base::unique_fd;
+
+RpcServer::RpcServer() {}
+
+RpcServer::~RpcServer() {}
+
+sp<RpcServer> RpcServer::make() {
+    return new RpcServer;
+}
+
+bool RpcServer::setupUnixDomainServer(const char* path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        ALOGE("Socket path %s is too long", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+
+    unique_fd fd(TEMP_FAILURE_RETRY(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)));
+    if (!fd.ok()) {
+        ALOGE("Could not create socket: %s", strerror(errno));
+        return false;
+    }
+    if (bind(fd.get(), reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        ALOGE("Could not bind socket at %s: %s", path, strerror(errno));
+        return false;
+    }
+    if (listen(fd.get(), SOMAXCONN) != 0) {
+        ALOGE("Could not listen on socket at %s: %s", path, strerror(errno));
+        return false;
+    }
+
+    mServer = std::move(fd);
+    return true;
+}
+
+void RpcServer::setMaxThreads(size_t threads) {
+    LOG_ALWAYS_FATAL_IF(threads == 0, "RpcServer needs at least one thread");
+    std::lock_guard<std::mutex> _l(mLock);
+    mMaxThreads = threads;
+}
+
+size_t RpcServer::getMaxThreads() {
+    std::lock_guard<std::mutex> _l(mLock);
+    return mMaxThreads;
+}
+
+void RpcServer::setRootObject(const sp<IBinder>& binder) {
+    std::lock_guard<std::mutex> _l(mLock);
+    mRootObject = binder;
+}
+
+sp<IBinder> RpcServer::getRootObject() {
+    std::lock_guard<std::mutex> _l(mLock);
+    return mRootObject;
+}
+
+void RpcServer::join() {
+    LOG_ALWAYS_FATAL_IF(!mServer.ok(), "RpcServer must be set up before joining");
+
+    for (;;) {
+        unique_fd fd(TEMP_FAILURE_RETRY(accept4(mServer.get(), nullptr, nullptr, SOCK_CLOEXEC)));
+        if (!fd.ok()) {
+            ALOGE("Could not accept connection: %s", strerror(errno));
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> _l(mLock);
+            if (mThreadCount >= mMaxThreads) {
+                ALOGE("Refusing connection, all %zu threads are serving", mMaxThreads);
+                continue;
+            }
+            mThreadCount++;
+        }
+
+        sp<RpcServer> self = this;
+        std::thread([self, fd = std::move(fd)]() mutable {
+            self->serveConnection(std::move(fd));
+        }).detach();
+    }
+}
+
+void RpcServer::serveConnection(unique_fd fd) {
+    sp<RpcSession> session;
+    RpcConnectionHeader header;
+    ucred peer{};
+    socklen_t peerSize = sizeof(peer);
+    if (getsockopt(fd.get(), SOL_SOCKET, SO_PEERCRED, &peer, &peerSize) != 0) {
+        ALOGE("Could not get the peer of a connection: %s", strerror(errno));
+    } else if (rpcReadFully(fd.get(), &header, sizeof(header)) == OK &&
+               header.version == RPC_WIRE_PROTOCOL_VERSION) {
+        std::lock_guard<std::mutex> _l(mLock);
+        if (header.sessionId == RPC_SESSION_ID_NEW) {
+            const int32_t sessionId = mNextSessionId++;
+            session = RpcSession::make();
+            session->setForServer(this, sessionId);
+            mSessions[sessionId] = Session{session, peer.pid, peer.uid};
+        } else {
+            // Session ids are easy to guess, so they only name the session.
+            // Joining one takes being the process which created it.
+            auto it = mSessions.find(header.sessionId);
+            if (it != mSessions.end() && it->second.pid == peer.pid &&
+                it->second.uid == peer.uid) {
+                session = it->second.session;
+            }
+        }
+    }
+
+    if (session != nullptr) {
+        // If the client went away already, serving fails right away and cleans
+        // up the session.
+        (void)rpcWriteFully(fd.get(), &session->mId, sizeof(session->mId));
+        session->serveConnection(std::move(fd));
+    } else {
+        ALOGE("Refusing connection with an invalid header or from another process");
+    }
+
+    std::lock_guard<std::mutex> _l(mLock);
+    mThreadCount--;
+}
+
+void RpcServer::onSessionTerminated(int32_t sessionId) {
+    // Released outside of the lock.
+    sp<RpcSession> session;
+    std::lock_guard<std::mutex> _l(mLock);
+    auto it = mSessions.find(sessionId);
+    if (it != mSessions.end()) {
+        session = std::move(it->second.session);
+        mSessions.erase(it);
+    }
+}
+
+} // namespace android
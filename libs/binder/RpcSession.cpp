@@ -0,0 +1,800 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "RpcSession"
+
+#include <binder/RpcSession.h>
+
+#include <binder/BpBinder.h>
+#include <binder/IPCThreadState.h>
+#include <binder/RpcServer.h>
+#include <utils/Log.h>
+
+#include <private/binder/binder_module.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "RpcWireFormat.h"
+
+namespace android {
+
+using base::unique_fd;
+
+// Larger commands are treated as a corrupt stream.
+static constexpr size_t kMaxCommandSize = 64 * 1024 * 1024;
+// The kernel limit on the number of descriptors in one SCM_RIGHTS message.
+static constexpr size_t kMaxFdsPerCommand = 253;
+
+status_t rpcReadFully(int fd, void* data, size_t size) {
+    uint8_t* buffer = static_cast<uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(read(fd, buffer, size));
+        if (n < 0) return -errno;
+        if (n == 0) return DEAD_OBJECT;
+        buffer += n;
+        size -= n;
+    }
+    return OK;
+}
+
+status_t rpcWriteFully(int fd, const void* data, size_t size) {
+    const uint8_t* buffer = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t n = TEMP_FAILURE_RETRY(send(fd, buffer, size, MSG_NOSIGNAL));
+        if (n < 0) return errno == EPIPE ? DEAD_OBJECT : -errno;
+        buffer += n;
+        size -= n;
+    }
+    return OK;
+}
+
+namespace {
+
+// Owns the data of a parcel received over a session, and the references on the
+// objects in it.
+struct ReceivedParcel {
+    std::vector<uint8_t> body;
+    std::vector<binder_size_t> objects;
+    std::vector<sp<IBinder>> binders;
+    std::vector<unique_fd> fds;
+};
+
+void releaseReceivedParcel(Parcel* /*parcel*/, const uint8_t* /*data*/, size_t /*dataSize*/,
+                           const binder_size_t* /*objects*/, size_t /*objectsSize*/,
+                           void* cookie) {
+    delete static_cast<ReceivedParcel*>(cookie);
+}
+
+} // namespace
+
+RpcSession::RpcSession() {}
+
+RpcSession::~RpcSession() {
+    ALOGV("Destroying RpcSession %p", this);
+}
+
+sp<RpcSession> RpcSession::make() {
+    return new RpcSession;
+}
+
+bool RpcSession::setupUnixDomainClient(const char* path, size_t numConnections) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        ALOGE("Socket path %s is too long", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+
+    for (size_t i = 0; i < numConnections; i++) {
+        unique_fd fd(TEMP_FAILURE_RETRY(socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)));
+        if (!fd.ok()) {
+            ALOGE("Could not create socket: %s", strerror(errno));
+            return false;
+        }
+        if (TEMP_FAILURE_RETRY(connect(fd.get(), reinterpret_cast<sockaddr*>(&addr),
+                                       sizeof(addr))) != 0) {
+            ALOGE("Could not connect to %s: %s", path, strerror(errno));
+            return false;
+        }
+
+        RpcConnectionHeader header{RPC_WIRE_PROTOCOL_VERSION, i == 0 ? RPC_SESSION_ID_NEW : mId};
+        int32_t sessionId;
+        if (rpcWriteFully(fd.get(), &header, sizeof(header)) != OK ||
+            rpcReadFully(fd.get(), &sessionId, sizeof(sessionId)) != OK) {
+            ALOGE("Server at %s refused connection %zu", path, i);
+            return false;
+        }
+        mId = sessionId;
+        addConnection(std::move(fd), false /*incoming*/);
+    }
+    return true;
+}
+
+sp<IBinder> RpcSession::getRootObject() {
+    Parcel data;
+    Parcel reply;
+    status_t status = transact(RPC_SPECIAL_ADDRESS, RPC_SPECIAL_TRANSACT_GET_ROOT, data, &reply, 0);
+    if (status != OK) {
+        ALOGE("Could not get root object: %s", statusToString(status).c_str());
+        return nullptr;
+    }
+    return reply.readStrongBinder();
+}
+
+status_t RpcSession::transact(uint64_t address, uint32_t code, const Parcel& data, Parcel* reply,
+                              uint32_t flags) {
+    status_t status = data.errorCheck();
+    if (status != OK) return status;
+
+    std::vector<uint8_t> dataCopy;
+    std::vector<RpcWireObject> objects;
+    std::vector<int> fds;
+    status = flattenObjects(data, &dataCopy, &objects, &fds);
+    if (status != OK) return status;
+
+    RpcWireTransaction transaction{address, code, flags, static_cast<uint32_t>(data.ipcDataSize()),
+                                   static_cast<uint32_t>(objects.size())};
+    const void* payload =
+            dataCopy.empty() ? reinterpret_cast<const void*>(data.ipcData()) : dataCopy.data();
+    const iovec body[] = {
+            {&transaction, sizeof(transaction)},
+            {const_cast<void*>(payload), data.ipcDataSize()},
+            {objects.data(), objects.size() * sizeof(RpcWireObject)},
+    };
+
+    std::shared_ptr<RpcConnection> connection;
+    bool nested;
+    status = acquireConnection(&connection, &nested);
+    if (status != OK) return status;
+
+    status = sendCommand(*connection, RPC_COMMAND_TRANSACT, body, 3, fds);
+    if (status == OK && (flags & IBinder::FLAG_ONEWAY) == 0) {
+        Parcel unusedReply;
+        status = waitForReply(*connection, reply != nullptr ? reply : &unusedReply);
+    }
+
+    if (!nested) releaseConnection(connection);
+    return status;
+}
+
+void RpcSession::onProxyDestroyed(uint64_t address, BpBinder* proxy) {
+    uint32_t references = 0;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        auto it = mImported.find(address);
+        // The entry may already belong to a newer proxy, see importBinder.
+        if (it != mImported.end() && it->second.proxy == proxy) {
+            references = it->second.timesReceived;
+            mImported.erase(it);
+        }
+    }
+    if (references > 0) sendDecStrong(address, references);
+}
+
+void RpcSession::setForServer(const wp<RpcServer>& server, int32_t sessionId) {
+    mForServer = server;
+    mId = sessionId;
+}
+
+void RpcSession::serveConnection(unique_fd fd) {
+    std::shared_ptr<RpcConnection> connection = addConnection(std::move(fd), true /*incoming*/);
+
+    for (;;) {
+        RpcWireHeader header;
+        std::vector<uint8_t> body;
+        std::vector<unique_fd> fds;
+        if (readCommand(*connection, &header, &body, &fds) != OK) break;
+
+        if (processCommand(*connection, header, std::move(body), std::move(fds)) != OK) {
+            shutdown();
+            break;
+        }
+    }
+
+    removeConnection(connection);
+}
+
+std::shared_ptr<RpcSession::RpcConnection> RpcSession::addConnection(unique_fd fd, bool incoming) {
+    auto connection = std::make_shared<RpcConnection>();
+    connection->fd = std::move(fd);
+    connection->incoming = incoming;
+    if (incoming) connection->owner = std::this_thread::get_id();
+
+    ucred peer{};
+    socklen_t peerSize = sizeof(peer);
+    if (getsockopt(connection->fd.get(), SOL_SOCKET, SO_PEERCRED, &peer, &peerSize) == 0) {
+        connection->hasPeer = true;
+        connection->peerPid = peer.pid;
+        connection->peerUid = peer.uid;
+    } else {
+        ALOGE("Could not get the peer of a connection: %s", strerror(errno));
+    }
+
+    std::lock_guard<std::mutex> _l(mLock);
+    mConnections.push_back(connection);
+    return connection;
+}
+
+void RpcSession::removeConnection(const std::shared_ptr<RpcConnection>& connection) {
+    bool last;
+    sp<RpcServer> server;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        for (auto it = mConnections.begin(); it != mConnections.end(); it++) {
+            if (*it == connection) {
+                mConnections.erase(it);
+                break;
+            }
+        }
+        last = mConnections.empty();
+        server = mForServer.promote();
+    }
+
+    if (last) {
+        shutdown();
+        if (server != nullptr) server->onSessionTerminated(mId);
+    }
+}
+
+status_t RpcSession::acquireConnection(std::shared_ptr<RpcConnection>* connection, bool* nested) {
+    const std::thread::id self = std::this_thread::get_id();
+
+    std::unique_lock<std::mutex> _l(mLock);
+    for (;;) {
+        if (mShutdown) return DEAD_OBJECT;
+
+        std::shared_ptr<RpcConnection> available;
+        bool hasOutgoing = false;
+        for (const auto& candidate : mConnections) {
+            if (candidate->owner == self) {
+                *connection = candidate;
+                *nested = true;
+                return OK;
+            }
+            if (!candidate->incoming) {
+                hasOutgoing = true;
+                if (available == nullptr && candidate->owner == std::thread::id()) {
+                    available = candidate;
+                }
+            }
+        }
+
+        if (available != nullptr) {
+            available->owner = self;
+            *connection = available;
+            *nested = false;
+            return OK;
+        }
+        if (!hasOutgoing) {
+            ALOGE("Calls into objects of the client are only possible while it calls this "
+                  "thread");
+            return WOULD_BLOCK;
+        }
+        mAvailableConnectionCv.wait(_l);
+    }
+}
+
+void RpcSession::releaseConnection(const std::shared_ptr<RpcConnection>& connection) {
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        connection->owner = std::thread::id();
+    }
+    mAvailableConnectionCv.notify_one();
+}
+
+void RpcSession::shutdown() {
+    std::map<uint64_t, ExportedBinder> exported;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        if (mShutdown) return;
+        mShutdown = true;
+        for (const auto& connection : mConnections) {
+            // Wakes up the threads reading from it.
+            ::shutdown(connection->fd.get(), SHUT_RDWR);
+        }
+        // Released outside of the lock, since their destructors may use the session.
+        exported.swap(mExported);
+        mExportedAddresses.clear();
+    }
+    mAvailableConnectionCv.notify_all();
+}
+
+status_t RpcSession::sendCommand(RpcConnection& connection, uint32_t command, const iovec* body,
+                                 size_t bodyCount, const std::vector<int>& fds) {
+    if (fds.size() > kMaxFdsPerCommand) {
+        ALOGE("Cannot send %zu file descriptors at once", fds.size());
+        return BAD_VALUE;
+    }
+
+    RpcWireHeader header{command, 0};
+    std::vector<iovec> iovs;
+    iovs.reserve(bodyCount + 1);
+    iovs.push_back({&header, sizeof(header)});
+    size_t bodySize = 0;
+    for (size_t i = 0; i < bodyCount; i++) {
+        if (body[i].iov_len == 0) continue;
+        iovs.push_back(body[i]);
+        bodySize += body[i].iov_len;
+    }
+    if (bodySize > kMaxCommandSize) {
+        ALOGE("Cannot send a command of %zu bytes", bodySize);
+        return FAILED_TRANSACTION;
+    }
+    header.bodySize = static_cast<uint32_t>(bodySize);
+
+    msghdr msg{};
+    std::vector<uint8_t> control;
+    if (!fds.empty()) {
+        control.resize(CMSG_SPACE(sizeof(int) * fds.size()));
+        msg.msg_control = control.data();
+        msg.msg_controllen = control.size();
+        cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    status_t status = OK;
+    {
+        std::lock_guard<std::mutex> _l(connection.writeLock);
+        iovec* iov = iovs.data();
+        size_t iovCount = iovs.size();
+        while (iovCount > 0) {
+            msg.msg_iov = iov;
+            msg.msg_iovlen = iovCount;
+            ssize_t n = TEMP_FAILURE_RETRY(sendmsg(connection.fd.get(), &msg, MSG_NOSIGNAL));
+            if (n < 0) {
+                ALOGE("Could not send command %" PRIu32 ": %s", command, strerror(errno));
+                status = DEAD_OBJECT;
+                break;
+            }
+            // The descriptors went with the first part of the command.
+            msg.msg_control = nullptr;
+            msg.msg_controllen = 0;
+
+            size_t sent = static_cast<size_t>(n);
+            while (iovCount > 0 && sent >= iov->iov_len) {
+                sent -= iov->iov_len;
+                iov++;
+                iovCount--;
+            }
+            if (iovCount > 0) {
+                iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + sent;
+                iov->iov_len -= sent;
+            }
+        }
+    }
+
+    if (status != OK) shutdown();
+    return status;
+}
+
+status_t RpcSession::readCommand(RpcConnection& connection, RpcWireHeader* header,
+                                 std::vector<uint8_t>* body, std::vector<unique_fd>* fds) {
+    // Descriptors are attached to the first byte of a command, so the header is
+    // read on its own to never receive those of the next command.
+    alignas(cmsghdr) uint8_t control[CMSG_SPACE(sizeof(int) * kMaxFdsPerCommand)];
+    iovec iov{header, sizeof(*header)};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t n = TEMP_FAILURE_RETRY(recvmsg(connection.fd.get(), &msg, MSG_CMSG_CLOEXEC));
+    if (n <= 0) {
+        if (n < 0) ALOGE("Could not read command: %s", strerror(errno));
+        shutdown();
+        return DEAD_OBJECT;
+    }
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (size_t i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            fds->emplace_back(fd);
+        }
+    }
+
+    status_t status = OK;
+    if (msg.msg_flags & MSG_CTRUNC) {
+        ALOGE("Received too many file descriptors");
+        status = BAD_VALUE;
+    }
+    if (status == OK && static_cast<size_t>(n) < sizeof(*header)) {
+        status = rpcReadFully(connection.fd.get(), reinterpret_cast<uint8_t*>(header) + n,
+                              sizeof(*header) - n);
+    }
+    if (status == OK && header->bodySize > kMaxCommandSize) {
+        ALOGE("Received a command of %" PRIu32 " bytes", header->bodySize);
+        status = BAD_VALUE;
+    }
+    if (status == OK) {
+        body->resize(header->bodySize);
+        status = rpcReadFully(connection.fd.get(), body->data(), body->size());
+    }
+
+    if (status != OK) {
+        shutdown();
+        return DEAD_OBJECT;
+    }
+    return OK;
+}
+
+status_t RpcSession::waitForReply(RpcConnection& connection, Parcel* reply) {
+    for (;;) {
+        RpcWireHeader header;
+        std::vector<uint8_t> body;
+        std::vector<unique_fd> fds;
+        status_t status = readCommand(connection, &header, &body, &fds);
+        if (status != OK) return status;
+
+        if (header.command != RPC_COMMAND_REPLY) {
+            // A nested call from the other side, or a reference release.
+            status = processCommand(connection, header, std::move(body), std::move(fds));
+            if (status != OK) {
+                shutdown();
+                return DEAD_OBJECT;
+            }
+            continue;
+        }
+
+        RpcWireReply rpcReply;
+        if (body.size() < sizeof(rpcReply)) {
+            ALOGE("Received a truncated reply");
+            shutdown();
+            return DEAD_OBJECT;
+        }
+        memcpy(&rpcReply, body.data(), sizeof(rpcReply));
+        if (rpcReply.status != OK) return rpcReply.status;
+
+        status = unflattenParcel(std::move(body), sizeof(rpcReply), rpcReply.dataSize,
+                                 rpcReply.objectCount, std::move(fds), reply);
+        if (status != OK) {
+            shutdown();
+            return DEAD_OBJECT;
+        }
+        return OK;
+    }
+}
+
+status_t RpcSession::processCommand(RpcConnection& connection, const RpcWireHeader& header,
+                                    std::vector<uint8_t>&& body, std::vector<unique_fd>&& fds) {
+    switch (header.command) {
+        case RPC_COMMAND_TRANSACT:
+            return processTransact(connection, std::move(body), std::move(fds));
+        case RPC_COMMAND_DEC_STRONG:
+            return processDecStrong(body);
+    }
+    ALOGE("Received unknown command %" PRIu32, header.command);
+    return BAD_VALUE;
+}
+
+status_t RpcSession::processTransact(RpcConnection& connection, std::vector<uint8_t>&& body,
+                                     std::vector<unique_fd>&& fds) {
+    RpcWireTransaction transaction;
+    if (body.size() < sizeof(transaction)) {
+        ALOGE("Received a truncated transaction");
+        return BAD_VALUE;
+    }
+    memcpy(&transaction, body.data(), sizeof(transaction));
+
+    Parcel data;
+    status_t status = unflattenParcel(std::move(body), sizeof(transaction), transaction.dataSize,
+                                      transaction.objectCount, std::move(fds), &data);
+    if (status != OK) return status;
+
+    Parcel reply;
+    status_t error;
+    if (!connection.hasPeer) {
+        // The callee could not tell who is calling.
+        ALOGE("Refusing a transaction from an unknown peer");
+        error = PERMISSION_DENIED;
+    } else if (transaction.address == RPC_SPECIAL_ADDRESS) {
+        error = processSpecialTransact(transaction.code, &reply);
+    } else {
+        sp<IBinder> target = lookupExported(transaction.address);
+        if (target != nullptr) {
+            // The callee sees the peer as the caller, as it would the sender
+            // of a transaction from the driver.
+            IPCThreadState* ipc = IPCThreadState::self();
+            const pid_t origPid = ipc->mCallingPid;
+            const char* origSid = ipc->mCallingSid;
+            const uid_t origUid = ipc->mCallingUid;
+            ipc->mCallingPid = connection.peerPid;
+            ipc->mCallingSid = nullptr;
+            ipc->mCallingUid = connection.peerUid;
+
+            error = target->transact(transaction.code, data, &reply, transaction.flags);
+
+            ipc->mCallingPid = origPid;
+            ipc->mCallingSid = origSid;
+            ipc->mCallingUid = origUid;
+        } else {
+            ALOGE("Transaction to unknown object %" PRIu64, transaction.address);
+            error = BAD_VALUE;
+        }
+    }
+
+    if (transaction.flags & IBinder::FLAG_ONEWAY) {
+        if (error != OK) {
+            ALOGW("oneway transaction finished with status %s", statusToString(error).c_str());
+        }
+        return OK;
+    }
+    return sendReply(connection, error, reply);
+}
+
+status_t RpcSession::processDecStrong(const std::vector<uint8_t>& body) {
+    RpcWireDecStrong decStrong;
+    if (body.size() != sizeof(decStrong)) {
+        ALOGE("Received a truncated reference release");
+        return BAD_VALUE;
+    }
+    memcpy(&decStrong, body.data(), sizeof(decStrong));
+
+    // Released outside of the lock, since its destructor may use the session.
+    sp<IBinder> released;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        auto it = mExported.find(decStrong.address);
+        if (it == mExported.end() || it->second.timesSent < decStrong.count) {
+            ALOGE("Received a release of %" PRIu32 " references on object %" PRIu64
+                  " which were never sent",
+                  decStrong.count, decStrong.address);
+            return BAD_VALUE;
+        }
+        it->second.timesSent -= decStrong.count;
+        if (it->second.timesSent == 0) {
+            released = std::move(it->second.binder);
+            mExportedAddresses.erase(released.get());
+            mExported.erase(it);
+        }
+    }
+    return OK;
+}
+
+status_t RpcSession::processSpecialTransact(uint32_t code, Parcel* reply) {
+    switch (code) {
+        case RPC_SPECIAL_TRANSACT_GET_ROOT: {
+            sp<RpcServer> server = mForServer.promote();
+            if (server == nullptr) {
+                ALOGE("Only servers have a root object");
+                return INVALID_OPERATION;
+            }
+            return reply->writeStrongBinder(server->getRootObject());
+        }
+    }
+    return UNKNOWN_TRANSACTION;
+}
+
+status_t RpcSession::sendReply(RpcConnection& connection, status_t status, const Parcel& reply) {
+    if (status == OK) status = reply.errorCheck();
+
+    std::vector<uint8_t> dataCopy;
+    std::vector<RpcWireObject> objects;
+    std::vector<int> fds;
+    if (status == OK) status = flattenObjects(reply, &dataCopy, &objects, &fds);
+
+    RpcWireReply rpcReply{status, 0, 0, 0};
+    if (status != OK) {
+        iovec body{&rpcReply, sizeof(rpcReply)};
+        return sendCommand(connection, RPC_COMMAND_REPLY, &body, 1, {});
+    }
+
+    rpcReply.dataSize = static_cast<uint32_t>(reply.ipcDataSize());
+    rpcReply.objectCount = static_cast<uint32_t>(objects.size());
+    const void* payload =
+            dataCopy.empty() ? reinterpret_cast<const void*>(reply.ipcData()) : dataCopy.data();
+    const iovec body[] = {
+            {&rpcReply, sizeof(rpcReply)},
+            {const_cast<void*>(payload), reply.ipcDataSize()},
+            {objects.data(), objects.size() * sizeof(RpcWireObject)},
+    };
+    return sendCommand(connection, RPC_COMMAND_REPLY, body, 3, fds);
+}
+
+void RpcSession::sendDecStrong(uint64_t address, uint32_t count) {
+    std::shared_ptr<RpcConnection> connection;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        if (mShutdown || mConnections.empty()) return;
+        // Any connection will do, the other side reads the release with the next
+        // command on it.
+        connection = mConnections.front();
+    }
+
+    RpcWireDecStrong decStrong{address, count, 0};
+    iovec body{&decStrong, sizeof(decStrong)};
+    (void)sendCommand(*connection, RPC_COMMAND_DEC_STRONG, &body, 1, {});
+}
+
+status_t RpcSession::flattenObjects(const Parcel& parcel, std::vector<uint8_t>* data,
+                                    std::vector<RpcWireObject>* objects, std::vector<int>* fds) {
+    const size_t objectCount = parcel.ipcObjectsCount();
+    if (objectCount == 0) return OK;
+
+    // The flat objects hold addresses of this process, so they are cleared in a
+    // copy of the data and described by RpcWireObjects instead.
+    const uint8_t* parcelData = reinterpret_cast<const uint8_t*>(parcel.ipcData());
+    const binder_size_t* offsets = reinterpret_cast<const binder_size_t*>(parcel.ipcObjects());
+    data->assign(parcelData, parcelData + parcel.ipcDataSize());
+    objects->reserve(objectCount);
+
+    for (size_t i = 0; i < objectCount; i++) {
+        const flat_binder_object* flat =
+                reinterpret_cast<const flat_binder_object*>(parcelData + offsets[i]);
+        RpcWireObject object{static_cast<uint32_t>(offsets[i]), RPC_OBJECT_NULL_BINDER, 0};
+
+        switch (flat->hdr.type) {
+            case BINDER_TYPE_BINDER: {
+                if (flat->cookie == 0) break;
+                // Always a local object, as Parcel::flattenBinder refuses to
+                // write proxies of RPC sessions. Parcels received from a
+                // session can still hold them though, if they are sent on.
+                IBinder* binder = reinterpret_cast<IBinder*>(flat->cookie);
+                if (binder->localBinder() == nullptr) {
+                    ALOGE("Cannot send a proxy of an RPC session");
+                    return BAD_TYPE;
+                }
+                object.type = RPC_OBJECT_SENDER_BINDER;
+                object.value = exportBinder(binder);
+                break;
+            }
+            case BINDER_TYPE_FD:
+                object.type = RPC_OBJECT_FD;
+                object.value = fds->size();
+                fds->push_back(static_cast<int>(flat->handle));
+                break;
+            default:
+                ALOGE("Cannot send binder object of type 0x%08" PRIx32 " over an RPC session",
+                      flat->hdr.type);
+                return BAD_TYPE;
+        }
+
+        memset(data->data() + offsets[i], 0, sizeof(flat_binder_object));
+        objects->push_back(object);
+    }
+    return OK;
+}
+
+status_t RpcSession::unflattenParcel(std::vector<uint8_t>&& body, size_t dataOffset,
+                                     size_t dataSize, size_t objectCount,
+                                     std::vector<unique_fd>&& fds, Parcel* parcel) {
+    if (body.size() < dataOffset || dataSize > body.size() - dataOffset ||
+        objectCount != (body.size() - dataOffset - dataSize) / sizeof(RpcWireObject)) {
+        ALOGE("Parcel of %zu bytes and %zu objects does not match a command of %zu bytes",
+              dataSize, objectCount, body.size());
+        return BAD_VALUE;
+    }
+
+    auto received = std::make_unique<ReceivedParcel>();
+    received->objects.reserve(objectCount);
+    uint8_t* data = body.data() + dataOffset;
+    const uint8_t* wireObjects = data + dataSize;
+
+    size_t minOffset = 0;
+    for (size_t i = 0; i < objectCount; i++) {
+        RpcWireObject object;
+        memcpy(&object, wireObjects + i * sizeof(object), sizeof(object));
+        if (object.offset < minOffset || dataSize < sizeof(flat_binder_object) ||
+            object.offset > dataSize - sizeof(flat_binder_object)) {
+            ALOGE("Received an object at bad offset %" PRIu32, object.offset);
+            return BAD_VALUE;
+        }
+        minOffset = object.offset + sizeof(flat_binder_object);
+
+        flat_binder_object flat{};
+        flat.hdr.type = BINDER_TYPE_BINDER;
+        sp<IBinder> binder;
+        switch (object.type) {
+            case RPC_OBJECT_NULL_BINDER:
+                break;
+            case RPC_OBJECT_SENDER_BINDER:
+                binder = importBinder(object.value);
+                break;
+            case RPC_OBJECT_FD:
+                if (object.value >= fds.size()) {
+                    ALOGE("Received file descriptor %" PRIu64 " of %zu", object.value,
+                          fds.size());
+                    return BAD_VALUE;
+                }
+                flat.hdr.type = BINDER_TYPE_FD;
+                // Not owned by the parcel, they are closed with ReceivedParcel.
+                flat.handle = fds[object.value].get();
+                break;
+            default:
+                ALOGE("Received object of unknown type %" PRIu32, object.type);
+                return BAD_VALUE;
+        }
+
+        // Same as a local object in a parcel of this process, so that the parcel
+        // can hold and release references on it.
+        if (binder != nullptr) {
+            flat.binder = reinterpret_cast<uintptr_t>(binder->getWeakRefs());
+            flat.cookie = reinterpret_cast<uintptr_t>(binder.get());
+            received->binders.push_back(std::move(binder));
+        }
+        memcpy(data + object.offset, &flat, sizeof(flat));
+        received->objects.push_back(object.offset);
+    }
+
+    received->fds = std::move(fds);
+    // Moving the vector keeps its storage, which |data| points into.
+    received->body = std::move(body);
+
+    ReceivedParcel* cookie = received.release();
+    parcel->ipcSetDataReference(data, dataSize, cookie->objects.data(), cookie->objects.size(),
+                                releaseReceivedParcel, cookie);
+    return OK;
+}
+
+uint64_t RpcSession::exportBinder(const sp<IBinder>& binder) {
+    std::lock_guard<std::mutex> _l(mLock);
+    uint64_t address;
+    auto it = mExportedAddresses.find(binder.get());
+    if (it != mExportedAddresses.end()) {
+        address = it->second;
+    } else {
+        address = mNextAddress++;
+        mExportedAddresses[binder.get()] = address;
+        mExported[address].binder = binder;
+    }
+    mExported[address].timesSent++;
+    return address;
+}
+
+sp<IBinder> RpcSession::lookupExported(uint64_t address) {
+    std::lock_guard<std::mutex> _l(mLock);
+    auto it = mExported.find(address);
+    return it != mExported.end() ? it->second.binder : nullptr;
+}
+
+sp<IBinder> RpcSession::importBinder(uint64_t address) {
+    sp<IBinder> binder;
+    uint32_t staleReferences = 0;
+    {
+        std::lock_guard<std::mutex> _l(mLock);
+        auto it = mImported.find(address);
+        if (it != mImported.end()) {
+            binder = it->second.binder.promote();
+            if (binder != nullptr) {
+                it->second.timesReceived++;
+                return binder;
+            }
+            // The proxy is being destroyed, and its entry is replaced before it
+            // could release the references it received.
+            staleReferences = it->second.timesReceived;
+        }
+
+        BpBinder* proxy = BpBinder::create(this, address);
+        binder = proxy;
+        mImported[address] = ImportedBinder{binder, proxy, 1};
+    }
+
+    if (staleReferences > 0) sendDecStrong(address, staleReferences);
+    return binder;
+}
+
+} // namespace android
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utils/Errors.h>
+
+namespace android {
+
+// Wire format of RpcSession connections. Both ends are expected to run the same
+// libbinder, so there is no attempt at compatibility across versions beyond
+// rejecting a mismatch when connecting.
+
+constexpr uint32_t RPC_WIRE_PROTOCOL_VERSION = 0;
+
+// Sent by the client when it opens a connection. The server answers with the
+// id of the session the connection was added to, as an int32_t.
+struct RpcConnectionHeader {
+    uint32_t version;
+    int32_t sessionId;
+};
+constexpr int32_t RPC_SESSION_ID_NEW = -1;
+
+enum : uint32_t {
+    // RpcWireTransaction, parcel data, RpcWireObject[objectCount]
+    RPC_COMMAND_TRANSACT = 0,
+    // RpcWireReply, parcel data, RpcWireObject[objectCount]
+    RPC_COMMAND_REPLY,
+    // RpcWireDecStrong
+    RPC_COMMAND_DEC_STRONG,
+};
+
+// Precedes every command. File descriptors sent with the command are attached
+// to the header as SCM_RIGHTS.
+struct RpcWireHeader {
+    uint32_t command;
+    uint32_t bodySize;
+};
+
+// Address 0 never names an object; transactions to it are handled by the
+// session itself.
+constexpr uint64_t RPC_SPECIAL_ADDRESS = 0;
+enum : uint32_t {
+    // Replies with the root object of the server, written as a strong binder.
+    RPC_SPECIAL_TRANSACT_GET_ROOT = 0,
+};
+
+struct RpcWireTransaction {
+    uint64_t address;
+    uint32_t code;
+    uint32_t flags;
+    uint32_t dataSize;
+    uint32_t objectCount;
+};
+
+struct RpcWireReply {
+    int32_t status;
+    uint32_t dataSize;
+    uint32_t objectCount;
+    uint32_t reserved;
+};
+
+enum : uint32_t {
+    RPC_OBJECT_NULL_BINDER = 0,
+    // An object exported by the sender of the parcel, named by its address in
+    // the sender's address space.
+    RPC_OBJECT_SENDER_BINDER,
+    // A file descriptor, named by its index in the SCM_RIGHTS of the command.
+    RPC_OBJECT_FD,
+};
+
+// Describes the flat_binder_object at |offset| in the parcel data. The object
+// itself is zeroed on the wire and rebuilt by the receiver.
+struct RpcWireObject {
+    uint32_t offset;
+    uint32_t type;
+    uint64_t value;
+};
+
+// Drops |count| of the references the peer received on the object at |address|
+// in the address space of the receiver of this command.
+struct RpcWireDecStrong {
+    uint64_t address;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+// Blocking reads and writes of the connection headers. Return DEAD_OBJECT if the
+// other end closed the socket.
+status_t rpcReadFully(int fd, void* data, size_t size);
+status_t rpcWriteFully(int fd, const void* data, size_t size);
+
+} // namespace android
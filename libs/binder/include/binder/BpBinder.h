@@ -31,15 +31,24 @@ namespace internal {
 class Stability;
 };
 
+class RpcSession;
+
 using binder_proxy_limit_callback = void(*)(int);
 
 class BpBinder : public IBinder
 {
 public:
     static BpBinder*    create(int32_t handle);
+    static BpBinder*    create(const sp<RpcSession>& session, uint64_t address);
 
     int32_t             handle() const;
 
+    // Whether this is a proxy of an object served over an RpcSession, rather
+    // than a handle of the binder driver.
+            bool        isRpcBinder() const;
+    const sp<RpcSession>& rpcSession() const;
+            uint64_t    rpcAddress() const;
+
     virtual const String16&    getInterfaceDescriptor() const;
     virtual bool        isBinderAlive() const;
     virtual status_t    pingBinder();
@@ -112,6 +121,10 @@ public:
 
 protected:
                         BpBinder(int32_t handle,int32_t trackedUid);
+    // Constructs the base of a proxy of an RpcSession, whose session and address
+    // are kept by a subclass in BpBinder.cpp so that this class keeps its layout.
+    struct RpcProxyTag {};
+    explicit            BpBinder(RpcProxyTag);
     virtual             ~BpBinder();
     virtual void        onFirstRef();
     virtual void        onLastStrongRef(const void* id);
@@ -145,6 +145,8 @@ public:
             static const int32_t kUnsetWorkSource = -1;
 
 private:
+    friend class RpcSession;
+
                                 IPCThreadState();
                                 ~IPCThreadState();
 
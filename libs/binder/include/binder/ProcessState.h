@@ -104,8 +104,6 @@ private:
                 RefBase::weakref_type* refs;
             };
 
-            handle_entry*       lookupHandleLocked(int32_t handle);
-
             String8             mDriverName;
             int                 mDriverFD;
             void*               mVMStart;
@@ -125,6 +123,8 @@ private:
 
     mutable Mutex               mLock;  // protects everything below.
 
+            // Unused, proxies are kept in a ProxyHandleTable in ProcessState.cpp.
+            // Still here so that the layout of this class doesn't change.
             Vector<handle_entry>mHandleToObject;
 
             context_check_func  mBinderContextCheckFunc;
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <binder/IBinder.h>
+#include <binder/RpcSession.h>
+#include <utils/RefBase.h>
+
+#include <sys/types.h>
+
+#include <map>
+#include <mutex>
+
+namespace android {
+
+/**
+ * Serves binder transactions over Unix domain sockets, see RpcSession. Clients
+ * start by asking for the root object of the server, and every connection they
+ * open is served by its own thread. Connections to an existing session are only
+ * accepted from the process which created it.
+ */
+class RpcServer final : public virtual RefBase {
+public:
+    static sp<RpcServer> make();
+
+    /**
+     * Listens on |path|, which must not exist yet.
+     */
+    [[nodiscard]] bool setupUnixDomainServer(const char* path);
+
+    /**
+     * The maximum number of connections served at once, across all sessions.
+     * Further connections are refused. Defaults to 1.
+     */
+    void setMaxThreads(size_t threads);
+    size_t getMaxThreads();
+
+    /**
+     * The object returned by RpcSession::getRootObject.
+     */
+    void setRootObject(const sp<IBinder>& binder);
+    sp<IBinder> getRootObject();
+
+    /**
+     * Accepts connections until the server socket fails. Each connection is
+     * served on a new thread.
+     */
+    void join();
+
+    ~RpcServer();
+
+private:
+    friend RpcSession;
+    RpcServer();
+
+    void serveConnection(base::unique_fd fd);
+    void onSessionTerminated(int32_t sessionId);
+
+    base::unique_fd mServer;
+
+    std::mutex mLock;
+    size_t mMaxThreads = 1;
+    size_t mThreadCount = 0;
+    sp<IBinder> mRootObject;
+    int32_t mNextSessionId = 0;
+
+    struct Session {
+        sp<RpcSession> session;
+        // The peer of the connection which created the session. Only it may
+        // open more connections to the session.
+        pid_t pid;
+        uid_t uid;
+    };
+    std::map<int32_t, Session> mSessions;
+};
+
+} // namespace android
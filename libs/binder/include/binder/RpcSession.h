@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+#include <binder/IBinder.h>
+#include <binder/Parcel.h>
+#include <utils/RefBase.h>
+
+#include <sys/uio.h>
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+class BpBinder;
+class RpcServer;
+struct RpcWireHeader;
+struct RpcWireObject;
+
+/**
+ * A session with another process over Unix domain sockets, which carries binder
+ * transactions without going through the binder driver. Each side of the session
+ * may send its local objects to the other; they are received as BpBinders which
+ * transact over the session.
+ *
+ * The client side opens a fixed number of connections, and each outgoing call
+ * takes one for its duration, so this is also the number of calls the client can
+ * have in flight. The server serves every connection on its own thread. A call
+ * into an object of the client is only possible while the client is waiting for
+ * a call on the same connection, in the same way as a nested binder call.
+ *
+ * Parcels may contain file descriptors and binders exported by either side of
+ * the session. Proxies of the binder driver or of other sessions can't be sent,
+ * and death notifications are not supported.
+ */
+class RpcSession final : public virtual RefBase {
+public:
+    static sp<RpcSession> make();
+
+    /**
+     * Connects to a server listening on |path|, opening |numConnections|
+     * connections to it.
+     */
+    [[nodiscard]] bool setupUnixDomainClient(const char* path, size_t numConnections = 1);
+
+    /**
+     * The root object of the server, or nullptr on error.
+     */
+    sp<IBinder> getRootObject();
+
+    [[nodiscard]] status_t transact(uint64_t address, uint32_t code, const Parcel& data,
+                                    Parcel* reply, uint32_t flags);
+
+    /**
+     * Called by a BpBinder of this session when it is destroyed.
+     */
+    void onProxyDestroyed(uint64_t address, BpBinder* proxy);
+
+    ~RpcSession();
+
+private:
+    friend RpcServer;
+    RpcSession();
+
+    struct RpcConnection {
+        base::unique_fd fd;
+        // Whether the connection was opened by the other side, and is served
+        // by a thread of this process.
+        bool incoming = false;
+        // The thread which currently reads from the connection, guarded by
+        // RpcSession::mLock.
+        std::thread::id owner;
+        // Commands are written whole while holding this lock.
+        std::mutex writeLock;
+        // The process on the other side, from SO_PEERCRED. Transactions which
+        // come in over the connection are refused without it.
+        bool hasPeer = false;
+        pid_t peerPid = -1;
+        uid_t peerUid = static_cast<uid_t>(-1);
+    };
+
+    struct ExportedBinder {
+        sp<IBinder> binder;
+        // Number of times the binder was sent, minus the references released
+        // by the other side.
+        size_t timesSent = 0;
+    };
+
+    struct ImportedBinder {
+        wp<IBinder> binder;
+        BpBinder* proxy = nullptr;
+        // Number of times the binder was received by |proxy|.
+        uint32_t timesReceived = 0;
+    };
+
+    // Used by RpcServer.
+    void setForServer(const wp<RpcServer>& server, int32_t sessionId);
+    // Serves a connection which was accepted by the server, until it is closed.
+    void serveConnection(base::unique_fd fd);
+
+    std::shared_ptr<RpcConnection> addConnection(base::unique_fd fd, bool incoming);
+    void removeConnection(const std::shared_ptr<RpcConnection>& connection);
+    // Takes a connection for an outgoing call. If this thread already reads
+    // from a connection, the call is nested and goes over the same one.
+    status_t acquireConnection(std::shared_ptr<RpcConnection>* connection, bool* nested);
+    void releaseConnection(const std::shared_ptr<RpcConnection>& connection);
+    void shutdown();
+
+    status_t sendCommand(RpcConnection& connection, uint32_t command, const iovec* body,
+                         size_t bodyCount, const std::vector<int>& fds);
+    status_t readCommand(RpcConnection& connection, RpcWireHeader* header,
+                         std::vector<uint8_t>* body, std::vector<base::unique_fd>* fds);
+    // Reads and processes commands until the reply to an outgoing call comes.
+    status_t waitForReply(RpcConnection& connection, Parcel* reply);
+    status_t processCommand(RpcConnection& connection, const RpcWireHeader& header,
+                            std::vector<uint8_t>&& body, std::vector<base::unique_fd>&& fds);
+    status_t processTransact(RpcConnection& connection, std::vector<uint8_t>&& body,
+                             std::vector<base::unique_fd>&& fds);
+    status_t processDecStrong(const std::vector<uint8_t>& body);
+    status_t processSpecialTransact(uint32_t code, Parcel* reply);
+    status_t sendReply(RpcConnection& connection, status_t status, const Parcel& reply);
+    void sendDecStrong(uint64_t address, uint32_t count);
+
+    // Translates the objects of an outgoing parcel.
+    status_t flattenObjects(const Parcel& parcel, std::vector<uint8_t>* data,
+                            std::vector<RpcWireObject>* objects, std::vector<int>* fds);
+    // Makes |parcel| refer to the data at |dataOffset| of |body|, and rebuilds
+    // its objects from the RpcWireObjects which follow it.
+    status_t unflattenParcel(std::vector<uint8_t>&& body, size_t dataOffset, size_t dataSize,
+                             size_t objectCount, std::vector<base::unique_fd>&& fds,
+                             Parcel* parcel);
+
+    uint64_t exportBinder(const sp<IBinder>& binder);
+    sp<IBinder> lookupExported(uint64_t address);
+    sp<IBinder> importBinder(uint64_t address);
+
+    std::mutex mLock;
+    std::condition_variable mAvailableConnectionCv;
+    std::vector<std::shared_ptr<RpcConnection>> mConnections;
+    bool mShutdown = false;
+
+    wp<RpcServer> mForServer;
+    int32_t mId = -1;
+
+    uint64_t mNextAddress = 1;
+    std::map<uint64_t, ExportedBinder> mExported;
+    std::map<IBinder*, uint64_t> mExportedAddresses;
+    std::map<uint64_t, ImportedBinder> mImported;
+};
+
+} // namespace android
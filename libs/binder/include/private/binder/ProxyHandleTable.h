@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <binder/IBinder.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace android {
+
+/**
+ * Maps the handles of a binder driver to their proxies in this process.
+ *
+ * Handles are small integers allocated by the driver, so entries are kept in
+ * chunks of a directory indexed by handle. Chunks are never freed before the
+ * table, and the directory is replaced, not resized, when it grows, so finding
+ * the entry of a handle takes no lock. Taking a reference on the proxy of an
+ * existing entry takes no lock either; only creating a proxy takes the lock of
+ * one of a few stripes of handles.
+ *
+ * Proxies must have OBJECT_LIFETIME_WEAK and call expunge() from their
+ * destructor, as BpBinder does. expunge() waits for the lookups which may still
+ * use the proxy, so that they never touch a destroyed object.
+ */
+class ProxyHandleTable {
+public:
+    // Makes the proxy of a handle, or returns nullptr on failure.
+    using CreateFunc = std::function<IBinder*(int32_t handle)>;
+
+    ProxyHandleTable();
+    ~ProxyHandleTable();
+
+    // Returns the live proxy of |handle|, or one made by |create| if there is
+    // none. |create| is called with the lock of the stripe of |handle| held.
+    sp<IBinder> getOrCreate(int32_t handle, const CreateFunc& create);
+
+    // Forgets |binder| as the proxy of |handle|, unless it was replaced already.
+    void expunge(int32_t handle, IBinder* binder);
+
+private:
+    struct Entry {
+        std::atomic<IBinder*> binder{nullptr};
+        // Number of lookups which may be using |binder|.
+        std::atomic<uint32_t> readers{0};
+    };
+
+    static constexpr size_t kChunkShift = 8;
+    static constexpr size_t kChunkSize = 1 << kChunkShift;
+    static constexpr size_t kInitialChunks = 16;
+    static constexpr size_t kStripes = 32;
+
+    struct Chunk {
+        Entry entries[kChunkSize];
+    };
+
+    struct Directory {
+        explicit Directory(size_t capacity);
+
+        const size_t capacity;
+        std::unique_ptr<std::atomic<Chunk*>[]> chunks;
+    };
+
+    ProxyHandleTable(const ProxyHandleTable&) = delete;
+    ProxyHandleTable& operator=(const ProxyHandleTable&) = delete;
+
+    // Returns nullptr if the chunk of |handle| wasn't allocated yet.
+    Entry* findEntry(int32_t handle) const;
+    Entry* findOrAllocateEntry(int32_t handle);
+    // Returns a strong reference on the proxy of |entry|, if it is still alive.
+    sp<IBinder> tryAcquire(Entry& entry);
+    std::mutex& stripeLock(int32_t handle) { return mStripeLocks[handle % kStripes]; }
+
+    std::atomic<Directory*> mDirectory{nullptr};
+
+    // Protects allocation of chunks and directories.
+    std::mutex mGrowLock;
+    // Directories which were replaced, and may still be read by lookups.
+    std::vector<std::unique_ptr<Directory>> mRetiredDirectories;
+
+    std::mutex mStripeLocks[kStripes];
+};
+
+} // namespace android
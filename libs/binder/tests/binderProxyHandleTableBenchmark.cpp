@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <binder/Binder.h>
+#include <private/binder/ProxyHandleTable.h>
+
+#include <stdlib.h>
+
+#include <mutex>
+#include <vector>
+
+using namespace android;
+
+namespace {
+
+constexpr int32_t kHandles = 256;
+
+// The handle table ProcessState used before ProxyHandleTable: one lock for
+// every lookup, and a vector grown under it.
+class MutexVectorTable {
+public:
+    sp<IBinder> getOrCreate(int32_t handle, const ProxyHandleTable::CreateFunc& create) {
+        sp<IBinder> result;
+
+        std::lock_guard<std::mutex> _l(mLock);
+        if (mEntries.size() <= static_cast<size_t>(handle)) mEntries.resize(handle + 1);
+        Entry* e = &mEntries[handle];
+
+        IBinder* b = e->binder;
+        if (b == nullptr || !e->refs->attemptIncWeak(this)) {
+            b = create(handle);
+            e->binder = b;
+            if (b) e->refs = b->getWeakRefs();
+            result = b;
+        } else {
+            result.force_set(b);
+            e->refs->decWeak(this);
+        }
+        return result;
+    }
+
+    void expunge(int32_t handle, IBinder* binder) {
+        std::lock_guard<std::mutex> _l(mLock);
+        if (static_cast<size_t>(handle) < mEntries.size() && mEntries[handle].binder == binder) {
+            mEntries[handle].binder = nullptr;
+        }
+    }
+
+private:
+    struct Entry {
+        IBinder* binder = nullptr;
+        RefBase::weakref_type* refs = nullptr;
+    };
+
+    std::mutex mLock;
+    std::vector<Entry> mEntries;
+};
+
+// Stands in for BpBinder, which can't be created without the driver.
+template <typename Table>
+class FakeProxy : public BBinder {
+public:
+    FakeProxy(Table* table, int32_t handle) : mTable(table), mHandle(handle) {
+        extendObjectLifetime(OBJECT_LIFETIME_WEAK);
+    }
+    ~FakeProxy() override { mTable->expunge(mHandle, this); }
+
+private:
+    Table* const mTable;
+    const int32_t mHandle;
+};
+
+template <typename Table>
+sp<IBinder> getProxy(Table* table, int32_t handle) {
+    return table->getOrCreate(handle, [table](int32_t h) -> IBinder* {
+        return new FakeProxy<Table>(table, h);
+    });
+}
+
+// The table shared by all threads of a benchmark. Its first half of handles
+// always has a live proxy, like the services a process keeps using.
+template <typename Table>
+Table* sharedTable() {
+    static Table* table = [] {
+        Table* t = new Table;
+        static std::vector<sp<IBinder>> held;
+        for (int32_t handle = 0; handle < kHandles / 2; handle++) {
+            held.push_back(getProxy(t, handle));
+        }
+        return t;
+    }();
+    return table;
+}
+
+// Looks up proxies which are alive, as for every binder received in a parcel.
+template <typename Table>
+void BM_LookupExisting(benchmark::State& state) {
+    Table* table = sharedTable<Table>();
+    unsigned seed = static_cast<unsigned>(state.thread_index);
+    for (auto _ : state) {
+        sp<IBinder> binder = getProxy(table, rand_r(&seed) % (kHandles / 2));
+        benchmark::DoNotOptimize(binder.get());
+    }
+}
+
+// Also creates and destroys proxies of handles nobody holds on to.
+template <typename Table>
+void BM_LookupWithChurn(benchmark::State& state) {
+    Table* table = sharedTable<Table>();
+    unsigned seed = static_cast<unsigned>(state.thread_index);
+    for (auto _ : state) {
+        sp<IBinder> binder = getProxy(table, rand_r(&seed) % kHandles);
+        benchmark::DoNotOptimize(binder.get());
+    }
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_LookupExisting, MutexVectorTable)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LookupExisting, ProxyHandleTable)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LookupWithChurn, MutexVectorTable)->ThreadRange(1, 32)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_LookupWithChurn, ProxyHandleTable)->ThreadRange(1, 32)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <binder/Binder.h>
+#include <gtest/gtest.h>
+#include <private/binder/ProxyHandleTable.h>
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace android;
+
+namespace {
+
+// Stands in for BpBinder, which can't be created without the driver: it has
+// the same lifetime and expunges itself from the table the same way.
+class FakeProxy : public BBinder {
+public:
+    FakeProxy(ProxyHandleTable* table, int32_t handle) : mTable(table), mHandle(handle) {
+        extendObjectLifetime(OBJECT_LIFETIME_WEAK);
+        sCreated++;
+    }
+
+    ~FakeProxy() override {
+        mTable->expunge(mHandle, this);
+        sDestroyed++;
+    }
+
+    int32_t handle() const { return mHandle; }
+
+    static std::atomic<size_t> sCreated;
+    static std::atomic<size_t> sDestroyed;
+
+private:
+    ProxyHandleTable* const mTable;
+    const int32_t mHandle;
+};
+
+std::atomic<size_t> FakeProxy::sCreated{0};
+std::atomic<size_t> FakeProxy::sDestroyed{0};
+
+class ProxyHandleTableTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        FakeProxy::sCreated = 0;
+        FakeProxy::sDestroyed = 0;
+    }
+
+    void TearDown() override { EXPECT_EQ(FakeProxy::sCreated, FakeProxy::sDestroyed); }
+
+    sp<IBinder> get(int32_t handle) {
+        return mTable.getOrCreate(handle, [this](int32_t h) -> IBinder* {
+            return new FakeProxy(&mTable, h);
+        });
+    }
+
+    ProxyHandleTable mTable;
+};
+
+} // namespace
+
+TEST_F(ProxyHandleTableTest, ReturnsSameProxyWhileAlive) {
+    sp<IBinder> first = get(3);
+    ASSERT_NE(nullptr, first);
+    sp<IBinder> second = get(3);
+    EXPECT_EQ(first, second);
+    EXPECT_EQ(1u, FakeProxy::sCreated);
+}
+
+TEST_F(ProxyHandleTableTest, CreatesNewProxyAfterRelease) {
+    get(3).clear();
+    EXPECT_EQ(1u, FakeProxy::sDestroyed);
+
+    sp<IBinder> binder = get(3);
+    ASSERT_NE(nullptr, binder);
+    EXPECT_EQ(2u, FakeProxy::sCreated);
+    EXPECT_EQ(3, static_cast<FakeProxy*>(binder.get())->handle());
+}
+
+TEST_F(ProxyHandleTableTest, KeepsHandlesApart) {
+    sp<IBinder> a = get(1);
+    sp<IBinder> b = get(2);
+    EXPECT_NE(a, b);
+    EXPECT_EQ(1, static_cast<FakeProxy*>(a.get())->handle());
+    EXPECT_EQ(2, static_cast<FakeProxy*>(b.get())->handle());
+}
+
+TEST_F(ProxyHandleTableTest, ExpungeOfReplacedProxyKeepsEntry) {
+    sp<IBinder> binder = get(5);
+    sp<IBinder> other = new BBinder;
+    mTable.expunge(5, other.get());
+    EXPECT_EQ(binder, get(5));
+    EXPECT_EQ(1u, FakeProxy::sCreated);
+}
+
+TEST_F(ProxyHandleTableTest, GrowsForLargeHandles) {
+    sp<IBinder> small = get(0);
+    sp<IBinder> large = get(100000);
+    ASSERT_NE(nullptr, large);
+    EXPECT_EQ(100000, static_cast<FakeProxy*>(large.get())->handle());
+    EXPECT_EQ(small, get(0));
+    EXPECT_EQ(large, get(100000));
+}
+
+TEST_F(ProxyHandleTableTest, RejectsNegativeHandles) {
+    EXPECT_EQ(nullptr, get(-1));
+    EXPECT_EQ(0u, FakeProxy::sCreated);
+}
+
+TEST_F(ProxyHandleTableTest, FailedCreateLeavesNoEntry) {
+    EXPECT_EQ(nullptr, mTable.getOrCreate(7, [](int32_t) -> IBinder* { return nullptr; }));
+    sp<IBinder> binder = get(7);
+    EXPECT_NE(nullptr, binder);
+}
+
+TEST_F(ProxyHandleTableTest, ConcurrentLookupsAndReleases) {
+    constexpr size_t kThreads = 8;
+    constexpr size_t kIterations = 100000;
+    constexpr int32_t kHandles = 512;
+
+    std::atomic<size_t> mismatches{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; t++) {
+        threads.emplace_back([&, seed = static_cast<unsigned>(t)]() mutable {
+            // Holding on to a few proxies makes lookups both hit live proxies
+            // and race with the destruction of released ones.
+            sp<IBinder> held[4];
+            for (size_t i = 0; i < kIterations; i++) {
+                const int32_t handle = rand_r(&seed) % kHandles;
+                sp<IBinder> binder = get(handle);
+                if (binder == nullptr ||
+                    static_cast<FakeProxy*>(binder.get())->handle() != handle) {
+                    mismatches++;
+                }
+                held[i % 4] = binder;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    EXPECT_EQ(0u, mismatches);
+    EXPECT_GT(FakeProxy::sCreated, 0u);
+}
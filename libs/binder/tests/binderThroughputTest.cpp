@@ -2,12 +2,18 @@
 #include <binder/IBinder.h>
 #include <binder/IPCThreadState.h>
 #include <binder/IServiceManager.h>
+#include <binder/ProcessState.h>
+#include <binder/RpcServer.h>
+#include <binder/RpcSession.h>
 #include <string>
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
 
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <thread>
 #include <vector>
 #include <tuple>
 
@@ -134,6 +140,18 @@ struct ProcResults {
         ret.m_total_time = a.m_total_time + b.m_total_time;
         return ret;
     }
+    // Latency under which the given fraction of transactions completed, in ms.
+    double percentile(float fraction) const {
+        uint64_t cur_total = 0;
+        float time_per_bucket_ms = time_per_bucket / 1.0E6;
+        for (int i = 0; i < num_buckets; i++) {
+            cur_total += m_buckets[i];
+            if (cur_total >= fraction * m_transactions) {
+                return time_per_bucket_ms * i + 0.5f * time_per_bucket_ms;
+            }
+        }
+        return max_time_bucket / 1.0E6;
+    }
     void dump() {
         if (m_long_transactions > 0) {
             cout << (double)m_long_transactions / m_transactions << "% of transactions took longer "
@@ -146,28 +164,26 @@ struct ProcResults {
         double average = (double)m_total_time / m_transactions / 1.0E6;
         cout << "average:" << average << "ms worst:" << worst << "ms best:" << best << "ms" << endl;
 
-        uint64_t cur_total = 0;
-        float time_per_bucket_ms = time_per_bucket / 1.0E6;
-        for (int i = 0; i < num_buckets; i++) {
-            float cur_time = time_per_bucket_ms * i + 0.5f * time_per_bucket_ms;
-            if ((cur_total < 0.5f * m_transactions) && (cur_total + m_buckets[i] >= 0.5f * m_transactions)) {
-                cout << "50%: " << cur_time << " ";
-            }
-            if ((cur_total < 0.9f * m_transactions) && (cur_total + m_buckets[i] >= 0.9f * m_transactions)) {
-                cout << "90%: " << cur_time << " ";
-            }
-            if ((cur_total < 0.95f * m_transactions) && (cur_total + m_buckets[i] >= 0.95f * m_transactions)) {
-                cout << "95%: " << cur_time << " ";
-            }
-            if ((cur_total < 0.99f * m_transactions) && (cur_total + m_buckets[i] >= 0.99f * m_transactions)) {
-                cout << "99%: " << cur_time << " ";
-            }
-            cur_total += m_buckets[i];
-        }
+        cout << "50%: " << percentile(0.5f) << " ";
+        cout << "90%: " << percentile(0.9f) << " ";
+        cout << "95%: " << percentile(0.95f) << " ";
+        cout << "99%: " << percentile(0.99f) << " ";
         cout << endl;
     }
 };
 
+struct RunResults {
+    int payload_size;
+    int threads;
+    double iterations_per_sec;
+    ProcResults results;
+};
+
+// When set, workers serve each other over Unix domain sockets at this path
+// prefix instead of registering with servicemanager, so that transactions don't
+// go through the binder driver.
+static string rpc_socket_prefix;
+
 String16 generateServiceName(int num)
 {
     char num_str[32];
@@ -176,20 +192,69 @@ String16 generateServiceName(int num)
     return serviceName;
 }
 
+string generateSocketPath(int num)
+{
+    return rpc_socket_prefix + to_string(num);
+}
+
+ProcResults client_fx(int num,
+                      unsigned int seed,
+                      int iterations,
+                      int payload_size,
+                      bool cs_pair,
+                      int server_count,
+                      const vector<sp<IBinder> >& workers)
+{
+    ProcResults results;
+    chrono::time_point<chrono::high_resolution_clock> start, end;
+    for (int i = 0; i < iterations; i++) {
+        Parcel data, reply;
+        int target = cs_pair ? num % server_count : rand_r(&seed) % workers.size();
+        int sz = payload_size;
+
+        while (sz >= sizeof(uint32_t)) {
+            data.writeInt32(0);
+            sz -= sizeof(uint32_t);
+        }
+        start = chrono::high_resolution_clock::now();
+        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply);
+        end = chrono::high_resolution_clock::now();
+
+        uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+        results.add_time(cur_time);
+
+        if (ret != NO_ERROR) {
+           cout << "thread " << num << " failed " << ret << "i : " << i << endl;
+           exit(EXIT_FAILURE);
+        }
+    }
+    return results;
+}
+
 void worker_fx(int num,
                int worker_count,
                int iterations,
                int payload_size,
+               int threads,
                bool cs_pair,
                Pipe p)
 {
     // Create BinderWorkerService and for go.
-    ProcessState::self()->startThreadPool();
-    sp<IServiceManager> serviceMgr = defaultServiceManager();
+    sp<IServiceManager> serviceMgr;
     sp<BinderWorkerService> service = new BinderWorkerService;
-    serviceMgr->addService(generateServiceName(num), service);
+    if (rpc_socket_prefix.empty()) {
+        ProcessState::self()->startThreadPool();
+        serviceMgr = defaultServiceManager();
+        serviceMgr->addService(generateServiceName(num), service);
+    } else {
+        // Every client thread of the other workers has its own connection.
+        sp<RpcServer> server = RpcServer::make();
+        ASSERT_TRUE(server->setupUnixDomainServer(generateSocketPath(num).c_str()));
+        server->setMaxThreads(worker_count * threads);
+        server->setRootObject(service);
+        std::thread([server] { server->join(); }).detach();
+    }
 
-    srand(num);
     p.signal();
     p.wait();
 
@@ -199,36 +264,34 @@ void worker_fx(int num,
 
     // Get references to other binder services.
     cout << "Created BinderWorker" << num << endl;
-    (void)worker_count;
     vector<sp<IBinder> > workers;
     for (int i = 0; i < server_count; i++) {
         if (num == i)
             continue;
-        workers.push_back(serviceMgr->getService(generateServiceName(i)));
+        if (rpc_socket_prefix.empty()) {
+            workers.push_back(serviceMgr->getService(generateServiceName(i)));
+        } else {
+            sp<RpcSession> session = RpcSession::make();
+            ASSERT_TRUE(session->setupUnixDomainClient(generateSocketPath(i).c_str(), threads));
+            workers.push_back(session->getRootObject());
+        }
+        ASSERT_TRUE(workers.back() != nullptr);
     }
 
     // Run the benchmark if client
     ProcResults results;
-    chrono::time_point<chrono::high_resolution_clock> start, end;
-    for (int i = 0; (!cs_pair || num >= server_count) && i < iterations; i++) {
-        Parcel data, reply;
-        int target = cs_pair ? num % server_count : rand() % workers.size();
-        int sz = payload_size;
-
-        while (sz >= sizeof(uint32_t)) {
-            data.writeInt32(0);
-            sz -= sizeof(uint32_t);
+    if (!cs_pair || num >= server_count) {
+        vector<ProcResults> thread_results(threads);
+        vector<std::thread> clients;
+        for (int t = 0; t < threads; t++) {
+            clients.emplace_back([&, t] {
+                thread_results[t] = client_fx(num, num * threads + t, iterations, payload_size,
+                                              cs_pair, server_count, workers);
+            });
         }
-        start = chrono::high_resolution_clock::now();
-        status_t ret = workers[target]->transact(BINDER_NOP, data, &reply);
-        end = chrono::high_resolution_clock::now();
-
-        uint64_t cur_time = uint64_t(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
-        results.add_time(cur_time);
-
-        if (ret != NO_ERROR) {
-           cout << "thread " << num << " failed " << ret << "i : " << i << endl;
-           exit(EXIT_FAILURE);
+        for (int t = 0; t < threads; t++) {
+            clients[t].join();
+            results = ProcResults::combine(results, thread_results[t]);
         }
     }
 
@@ -240,10 +303,14 @@ void worker_fx(int num,
     p.send(results);
     p.wait();
 
+    if (!rpc_socket_prefix.empty()) {
+        unlink(generateSocketPath(num).c_str());
+    }
     exit(EXIT_SUCCESS);
 }
 
-Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bool cs_pair)
+Pipe make_worker(int num, int iterations, int worker_count, int payload_size, int threads,
+                 bool cs_pair)
 {
     auto pipe_pair = Pipe::createPipePair();
     pid_t pid = fork();
@@ -252,7 +319,8 @@ Pipe make_worker(int num, int iterations, int worker_count, int payload_size, bo
         return move(get<0>(pipe_pair));
     } else {
         /* child */
-        worker_fx(num, worker_count, iterations, payload_size, cs_pair, move(get<1>(pipe_pair)));
+        worker_fx(num, worker_count, iterations, payload_size, threads, cs_pair,
+                  move(get<1>(pipe_pair)));
         /* never get here */
         return move(get<0>(pipe_pair));
     }
@@ -273,16 +341,17 @@ void signal_all(vector<Pipe>& v)
     }
 }
 
-void run_main(int iterations,
-              int workers,
-              int payload_size,
-              int cs_pair,
-              bool training_round=false)
+RunResults run_main(int iterations,
+                    int workers,
+                    int payload_size,
+                    int threads,
+                    int cs_pair,
+                    bool training_round=false)
 {
     vector<Pipe> pipes;
     // Create all the workers and wait for them to spawn.
     for (int i = 0; i < workers; i++) {
-        pipes.push_back(make_worker(i, iterations, workers, payload_size, cs_pair));
+        pipes.push_back(make_worker(i, iterations, workers, payload_size, threads, cs_pair));
     }
     wait_all(pipes);
 
@@ -294,10 +363,6 @@ void run_main(int iterations,
     wait_all(pipes);
     end = chrono::high_resolution_clock::now();
 
-    // Calculate overall throughput.
-    double iterations_per_sec = double(iterations * workers) / (chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1.0E9);
-    cout << "iterations per sec: " << iterations_per_sec << endl;
-
     // Collect all results from the workers.
     cout << "collecting results" << endl;
     signal_all(pipes);
@@ -308,6 +373,10 @@ void run_main(int iterations,
         tot_results = ProcResults::combine(tot_results, tmp_results);
     }
 
+    // Calculate overall throughput, over the transactions of all client threads.
+    double iterations_per_sec = double(tot_results.m_transactions) / (chrono::duration_cast<chrono::nanoseconds>(end - start).count() / 1.0E9);
+    cout << "iterations per sec: " << iterations_per_sec << endl;
+
     // Kill all the workers.
     cout << "killing workers" << endl;
     signal_all(pipes);
@@ -327,6 +396,21 @@ void run_main(int iterations,
     } else {
             tot_results.dump();
     }
+    return RunResults{payload_size, threads, iterations_per_sec, tot_results};
+}
+
+void dump_sweep(const vector<RunResults>& runs)
+{
+    cout << endl << setw(8) << "payload" << setw(8) << "threads" << setw(14) << "iter/s"
+         << setw(10) << "50%" << setw(10) << "90%" << setw(10) << "99%" << endl;
+    for (const RunResults& run : runs) {
+        cout << setw(8) << run.payload_size << setw(8) << run.threads
+             << setw(14) << fixed << setprecision(0) << run.iterations_per_sec
+             << setprecision(4) << setw(10) << run.results.percentile(0.5f)
+             << setw(10) << run.results.percentile(0.9f)
+             << setw(10) << run.results.percentile(0.99f) << endl;
+    }
+    cout << "(latencies in ms)" << endl;
 }
 
 int main(int argc, char *argv[])
@@ -334,8 +418,10 @@ int main(int argc, char *argv[])
     int workers = 2;
     int iterations = 10000;
     int payload_size = 0;
+    int threads = 1;
     bool cs_pair = false;
     bool training_round = false;
+    bool sweep = false;
     (void)argc;
     (void)argv;
 
@@ -343,14 +429,30 @@ int main(int argc, char *argv[])
     for (int i = 1; i < argc; i++) {
         if (string(argv[i]) == "--help") {
             cout << "Usage: binderThroughputTest [OPTIONS]" << endl;
+            cout << "\t-c N    : Specify number of client threads per worker." << endl;
             cout << "\t-i N    : Specify number of iterations." << endl;
             cout << "\t-m N    : Specify expected max latency in microseconds." << endl;
             cout << "\t-p      : Split workers into client/server pairs." << endl;
             cout << "\t-s N    : Specify payload size." << endl;
             cout << "\t-t N    : Run training round." << endl;
             cout << "\t-w N    : Specify total number of workers." << endl;
+            cout << "\t--rpc   : Transact over Unix domain sockets instead of the binder driver." << endl;
+            cout << "\t--sweep : Run over a range of payload sizes and client threads." << endl;
             return 0;
         }
+        if (string(argv[i]) == "-c") {
+            threads = atoi(argv[i+1]);
+            i++;
+            continue;
+        }
+        if (string(argv[i]) == "--rpc") {
+            rpc_socket_prefix = "/data/local/tmp/binderThroughputTest-" + to_string(getpid()) + "-";
+            continue;
+        }
+        if (string(argv[i]) == "--sweep") {
+            sweep = true;
+            continue;
+        }
         if (string(argv[i]) == "-w") {
             workers = atoi(argv[i+1]);
             i++;
@@ -392,10 +494,22 @@ int main(int argc, char *argv[])
 
     if (training_round) {
         cout << "Start training round" << endl;
-        run_main(iterations, workers, payload_size, cs_pair, training_round=true);
+        run_main(iterations, workers, payload_size, threads, cs_pair, training_round=true);
         cout << "Completed training round" << endl << endl;
     }
 
-    run_main(iterations, workers, payload_size, cs_pair);
+    if (sweep) {
+        vector<RunResults> runs;
+        for (int sweep_payload_size : {0, 64, 256, 1024, 4096, 16384, 65536}) {
+            for (int sweep_threads : {1, 2, 4, 8}) {
+                runs.push_back(run_main(iterations, workers, sweep_payload_size, sweep_threads,
+                                        cs_pair));
+            }
+        }
+        dump_sweep(runs);
+        return 0;
+    }
+
+    run_main(iterations, workers, payload_size, threads, cs_pair);
     return 0;
 }
@@ -23,13 +23,14 @@ namespace renderengine {
 
 Mesh::Mesh(Primitive primitive, size_t vertexCount, size_t vertexSize, size_t texCoordSize,
            size_t cropCoordsSize, size_t shadowColorSize, size_t shadowParamsSize,
-           size_t indexCount)
+           size_t colorSize, size_t indexCount)
       : mVertexCount(vertexCount),
         mVertexSize(vertexSize),
         mTexCoordsSize(texCoordSize),
         mCropCoordsSize(cropCoordsSize),
         mShadowColorSize(shadowColorSize),
         mShadowParamsSize(shadowParamsSize),
+        mColorSize(colorSize),
         mPrimitive(primitive),
         mIndexCount(indexCount) {
     if (vertexCount == 0) {
@@ -38,14 +39,15 @@ Mesh::Mesh(Primitive primitive, size_t vertexCount, size_t vertexSize, size_t te
         mStride = 0;
         return;
     }
-    size_t stride = vertexSize + texCoordSize + cropCoordsSize + shadowColorSize + shadowParamsSize;
+    size_t stride = vertexSize + texCoordSize + cropCoordsSize + shadowColorSize +
+            shadowParamsSize + colorSize;
     size_t remainder = (stride * vertexCount) / vertexCount;
     // Since all of the input parameters are unsigned, if stride is less than
     // either vertexSize or texCoordSize, it must have overflowed. remainder
     // will be equal to stride as long as stride * vertexCount doesn't overflow.
     if ((stride < vertexSize) || (remainder != stride)) {
-        ALOGE("Overflow in Mesh(..., %zu, %zu, %zu, %zu, %zu, %zu)", vertexCount, vertexSize,
-              texCoordSize, cropCoordsSize, shadowColorSize, shadowParamsSize);
+        ALOGE("Overflow in Mesh(..., %zu, %zu, %zu, %zu, %zu, %zu, %zu)", vertexCount, vertexSize,
+              texCoordSize, cropCoordsSize, shadowColorSize, shadowParamsSize, colorSize);
         mVertices.resize(1);
         mVertices[0] = 0.0f;
         mVertexCount = 0;
@@ -54,6 +56,7 @@ Mesh::Mesh(Primitive primitive, size_t vertexCount, size_t vertexSize, size_t te
         mCropCoordsSize = 0;
         mShadowColorSize = 0;
         mShadowParamsSize = 0;
+        mColorSize = 0;
         mStride = 0;
         return;
     }
@@ -102,6 +105,15 @@ float* Mesh::getShadowParams() {
     return mVertices.data() + mVertexSize + mTexCoordsSize + mCropCoordsSize + mShadowColorSize;
 }
 
+float const* Mesh::getColors() const {
+    return mVertices.data() + mVertexSize + mTexCoordsSize + mCropCoordsSize + mShadowColorSize +
+            mShadowParamsSize;
+}
+float* Mesh::getColors() {
+    return mVertices.data() + mVertexSize + mTexCoordsSize + mCropCoordsSize + mShadowColorSize +
+            mShadowParamsSize;
+}
+
 uint16_t const* Mesh::getIndices() const {
     return mIndices.data();
 }
@@ -130,6 +142,10 @@ size_t Mesh::getShadowParamsSize() const {
     return mShadowParamsSize;
 }
 
+size_t Mesh::getColorSize() const {
+    return mColorSize;
+}
+
 size_t Mesh::getByteStride() const {
     return mStride * sizeof(float);
 }
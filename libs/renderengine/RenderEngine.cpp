@@ -19,20 +19,34 @@
 #include <cutils/properties.h>
 #include <log/log.h>
 #include <private/gui/SyncFeatures.h>
+#include "cpu/CpuRenderEngine.h"
 #include "gl/GLESRenderEngine.h"
 
 namespace android {
 namespace renderengine {
 
 std::unique_ptr<impl::RenderEngine> RenderEngine::create(const RenderEngineCreationArgs& args) {
+    RenderEngineType renderEngineType = args.renderEngineType;
+
     char prop[PROPERTY_VALUE_MAX];
-    property_get(PROPERTY_DEBUG_RENDERENGINE_BACKEND, prop, "gles");
+    property_get(PROPERTY_DEBUG_RENDERENGINE_BACKEND, prop, "");
     if (strcmp(prop, "gles") == 0) {
-        ALOGD("RenderEngine GLES Backend");
-        return renderengine::gl::GLESRenderEngine::create(args);
+        renderEngineType = RenderEngineType::GLES;
+    } else if (strcmp(prop, "cpu") == 0) {
+        renderEngineType = RenderEngineType::CPU;
+    } else if (prop[0] != '\0') {
+        ALOGE("UNKNOWN BackendType: %s, ignoring.", prop);
+    }
+
+    switch (renderEngineType) {
+        case RenderEngineType::CPU:
+            ALOGD("RenderEngine CPU Backend");
+            return renderengine::cpu::CpuRenderEngine::create(args);
+        case RenderEngineType::GLES:
+        default:
+            ALOGD("RenderEngine GLES Backend");
+            return renderengine::gl::GLESRenderEngine::create(args);
     }
-    ALOGE("UNKNOWN BackendType: %s, create GLES RenderEngine.", prop);
-    return renderengine::gl::GLESRenderEngine::create(args);
 }
 
 RenderEngine::~RenderEngine() = default;
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include "../gl/GLShadowCache.h"
+#include "../gl/GLShadowVertexGenerator.h"
+
+namespace android::renderengine::gl {
+
+// Shadow casting windows on screen, each drawn once per frame.
+static constexpr int kCasterCount = 8;
+
+static GLShadowCache::Key getCasterKey(int index) {
+    const float left = 40.0f * index;
+    return {FloatRect(left, 100.0f, left + 400.0f, 900.0f),
+            24.0f /* casterCornerRadius */,
+            16.0f /* casterZ */,
+            false /* casterIsTranslucent */,
+            vec4(0.0f, 0.0f, 0.0f, 0.039f) /* ambientColor */,
+            vec4(0.0f, 0.0f, 0.0f, 0.19f) /* spotColor */,
+            vec3(540.0f, -200.0f, 600.0f) /* lightPosition */,
+            800.0f /* lightRadius */};
+}
+
+// What GLESRenderEngine::handleShadow() did for every caster before meshes
+// were cached.
+static void benchmarkTessellateShadows(benchmark::State& state) {
+    for (auto _ : state) {
+        for (int i = 0; i < kCasterCount; i++) {
+            const GLShadowCache::Key key = getCasterKey(i);
+            const GLShadowVertexGenerator shadows(key.casterRect, key.casterCornerRadius,
+                                                  key.casterZ, key.casterIsTranslucent,
+                                                  key.ambientColor, key.spotColor,
+                                                  key.lightPosition, key.lightRadius);
+            Mesh mesh = Mesh::Builder()
+                                .setPrimitive(Mesh::TRIANGLES)
+                                .setVertices(shadows.getVertexCount(), 2 /* size */)
+                                .setShadowAttrs()
+                                .setIndices(shadows.getIndexCount())
+                                .build();
+            Mesh::VertexArray<vec2> position = mesh.getPositionArray<vec2>();
+            Mesh::VertexArray<vec4> shadowColor = mesh.getShadowColorArray<vec4>();
+            Mesh::VertexArray<vec3> shadowParams = mesh.getShadowParamsArray<vec3>();
+            shadows.fillVertices(position, shadowColor, shadowParams);
+            shadows.fillIndices(mesh.getIndicesArray());
+            benchmark::DoNotOptimize(mesh.getIndicesArray());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCasterCount);
+}
+
+static void benchmarkCachedShadows(benchmark::State& state) {
+    GLShadowCache cache(kCasterCount * 4);
+    for (auto _ : state) {
+        for (int i = 0; i < kCasterCount; i++) {
+            benchmark::DoNotOptimize(cache.getMesh(getCasterKey(i)).getPositions());
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kCasterCount);
+}
+
+// One caster moves every frame, as during a window drag.
+static void benchmarkCachedShadowsWithMovingCaster(benchmark::State& state) {
+    GLShadowCache cache(kCasterCount * 4);
+    int frame = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < kCasterCount; i++) {
+            GLShadowCache::Key key = getCasterKey(i);
+            if (i == 0) {
+                key.casterRect.left += frame;
+                key.casterRect.right += frame;
+            }
+            benchmark::DoNotOptimize(cache.getMesh(key).getPositions());
+        }
+        frame++;
+    }
+    state.SetItemsProcessed(state.iterations() * kCasterCount);
+}
+
+BENCHMARK(benchmarkTessellateShadows);
+BENCHMARK(benchmarkCachedShadows);
+BENCHMARK(benchmarkCachedShadowsWithMovingCaster);
+
+} // namespace android::renderengine::gl
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <renderengine/RenderEngine.h>
+#include <sync/sync.h>
+#include <ui/GraphicBuffer.h>
+#include <ui/PixelFormat.h>
+#include "../gl/GLESRenderEngine.h"
+
+namespace android::renderengine {
+
+static constexpr uint32_t kDisplayWidth = 1080;
+static constexpr uint32_t kDisplayHeight = 2340;
+
+static std::unique_ptr<gl::GLESRenderEngine> createRenderEngine() {
+    RenderEngineCreationArgs args =
+            RenderEngineCreationArgs::Builder()
+                    .setPixelFormat(static_cast<int>(ui::PixelFormat::RGBA_8888))
+                    .setImageCacheSize(1)
+                    .setUseColorManagerment(false)
+                    .setEnableProtectedContext(false)
+                    .setPrecacheToneMapperShaderOnly(false)
+                    .setSupportsBackgroundBlur(true)
+                    .setContextPriority(RenderEngine::ContextPriority::MEDIUM)
+                    .build();
+    return gl::GLESRenderEngine::create(args);
+}
+
+// Draws a background, a window and a blur layer with the given bounds on top, and
+// reports the time per frame, including the GPU work.
+static void drawBlurredFrames(benchmark::State& state, const FloatRect& blurBounds,
+                              bool animateBackground) {
+    auto re = createRenderEngine();
+    sp<GraphicBuffer> output =
+            new GraphicBuffer(kDisplayWidth, kDisplayHeight, HAL_PIXEL_FORMAT_RGBA_8888, 1,
+                              GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE, "output");
+    DisplaySettings display;
+    display.physicalDisplay = Rect(kDisplayWidth, kDisplayHeight);
+    display.clip = display.physicalDisplay;
+
+    LayerSettings background;
+    background.geometry.boundaries = FloatRect(0, 0, kDisplayWidth, kDisplayHeight);
+    background.source.solidColor = half3(0.2f, 0.4f, 0.6f);
+    background.alpha = 1.0f;
+
+    LayerSettings window;
+    window.geometry.boundaries = FloatRect(0, 0, kDisplayWidth / 2, kDisplayHeight);
+    window.source.solidColor = half3(0.9f, 0.3f, 0.1f);
+    window.alpha = 1.0f;
+
+    LayerSettings blur;
+    blur.geometry.boundaries = blurBounds;
+    blur.backgroundBlurRadius = 50;
+    blur.alpha = 0.0f;
+
+    const std::vector<const LayerSettings*> layers = {&background, &window, &blur};
+    size_t blurredPixels = 0;
+    int frame = 0;
+    for (auto _ : state) {
+        if (animateBackground) {
+            // Something beneath the blur changes every frame, as with a video playing.
+            window.geometry.boundaries.right = kDisplayWidth / 2 + frame++ % 2;
+        }
+        base::unique_fd fence;
+        status_t status = re->drawLayers(display, layers, output->getNativeBuffer(), true,
+                                         base::unique_fd(), &fence);
+        if (status != NO_ERROR) {
+            state.SkipWithError("drawLayers failed");
+            break;
+        }
+        if (fence.get() >= 0) {
+            sync_wait(fence.get(), -1);
+        }
+        blurredPixels += re->getLastFrameBlurredPixelsForTesting();
+    }
+    state.counters["blurredPixels"] =
+            benchmark::Counter(blurredPixels, benchmark::Counter::kAvgIterations);
+}
+
+// A blur behind a full screen surface, as with the notification shade.
+static void benchmarkFullscreenBlur(benchmark::State& state) {
+    drawBlurredFrames(state, FloatRect(0, 0, kDisplayWidth, kDisplayHeight),
+                      true /* animateBackground */);
+}
+
+// A blur behind a dialog.
+static void benchmarkSmallBlur(benchmark::State& state) {
+    drawBlurredFrames(state, FloatRect(140, 970, kDisplayWidth - 140, 1370),
+                      true /* animateBackground */);
+}
+
+// Nothing changes beneath the blur, so the last frame's blur is reused.
+static void benchmarkUnchangedFullscreenBlur(benchmark::State& state) {
+    drawBlurredFrames(state, FloatRect(0, 0, kDisplayWidth, kDisplayHeight),
+                      false /* animateBackground */);
+}
+
+BENCHMARK(benchmarkFullscreenBlur);
+BENCHMARK(benchmarkSmallBlur);
+BENCHMARK(benchmarkUnchangedFullscreenBlur);
+
+} // namespace android::renderengine
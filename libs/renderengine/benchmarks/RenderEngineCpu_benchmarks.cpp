@@ -0,0 +1,183 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <renderengine/RenderEngine.h>
+#include <ui/GraphicBuffer.h>
+#include <ui/PixelFormat.h>
+#include "../cpu/CpuRenderEngine.h"
+
+namespace android::renderengine {
+
+static constexpr uint32_t kDisplayWidth = 1080;
+static constexpr uint32_t kDisplayHeight = 2340;
+
+static std::unique_ptr<cpu::CpuRenderEngine> createRenderEngine(bool useColorManagement) {
+    RenderEngineCreationArgs args =
+            RenderEngineCreationArgs::Builder()
+                    .setPixelFormat(static_cast<int>(ui::PixelFormat::RGBA_8888))
+                    .setImageCacheSize(1)
+                    .setUseColorManagerment(useColorManagement)
+                    .setEnableProtectedContext(false)
+                    .setPrecacheToneMapperShaderOnly(false)
+                    .setSupportsBackgroundBlur(true)
+                    .setContextPriority(RenderEngine::ContextPriority::MEDIUM)
+                    .setRenderEngineType(RenderEngine::RenderEngineType::CPU)
+                    .build();
+    return cpu::CpuRenderEngine::create(args);
+}
+
+static sp<GraphicBuffer> allocateBuffer(uint32_t width, uint32_t height, const char* name) {
+    return new GraphicBuffer(width, height, HAL_PIXEL_FORMAT_RGBA_8888, 1,
+                             GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN |
+                                     GRALLOC_USAGE_HW_RENDER | GRALLOC_USAGE_HW_TEXTURE,
+                             name);
+}
+
+// A gradient, so that sampling is not trivially cached.
+static sp<GraphicBuffer> allocateSourceBuffer() {
+    sp<GraphicBuffer> buffer = allocateBuffer(kDisplayWidth, kDisplayHeight, "source");
+    uint8_t* pixels;
+    buffer->lock(GRALLOC_USAGE_SW_WRITE_OFTEN, reinterpret_cast<void**>(&pixels));
+    for (uint32_t y = 0; y < kDisplayHeight; y++) {
+        uint8_t* row = pixels + y * buffer->getStride() * 4;
+        for (uint32_t x = 0; x < kDisplayWidth; x++) {
+            row[x * 4 + 0] = x * 255 / kDisplayWidth;
+            row[x * 4 + 1] = y * 255 / kDisplayHeight;
+            row[x * 4 + 2] = 128;
+            row[x * 4 + 3] = 255;
+        }
+    }
+    buffer->unlock();
+    return buffer;
+}
+
+static DisplaySettings getDisplaySettings() {
+    DisplaySettings display;
+    display.physicalDisplay = Rect(kDisplayWidth, kDisplayHeight);
+    display.clip = display.physicalDisplay;
+    return display;
+}
+
+static LayerSettings getFullscreenLayer() {
+    LayerSettings layer;
+    layer.geometry.boundaries = FloatRect(0, 0, kDisplayWidth, kDisplayHeight);
+    layer.source.solidColor = half3(0.2f, 0.4f, 0.6f);
+    layer.alpha = 1.0f;
+    return layer;
+}
+
+// Draws a background and one layer of the given kind on top, and reports
+// throughput in output pixels.
+static void drawLayers(benchmark::State& state, const LayerSettings& layer,
+                       bool useColorManagement = false) {
+    auto re = createRenderEngine(useColorManagement);
+    sp<GraphicBuffer> output = allocateBuffer(kDisplayWidth, kDisplayHeight, "output");
+    const DisplaySettings display = getDisplaySettings();
+    const LayerSettings background = getFullscreenLayer();
+    const std::vector<const LayerSettings*> layers = {&background, &layer};
+
+    for (auto _ : state) {
+        base::unique_fd fence;
+        status_t status = re->drawLayers(display, layers, output->getNativeBuffer(), true,
+                                         base::unique_fd(), &fence);
+        if (status != NO_ERROR) {
+            state.SkipWithError("drawLayers failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kDisplayWidth * kDisplayHeight);
+}
+
+static void benchmarkSolidLayer(benchmark::State& state) {
+    drawLayers(state, getFullscreenLayer());
+}
+
+static void benchmarkTexturedLayer(benchmark::State& state) {
+    LayerSettings layer = getFullscreenLayer();
+    layer.source.buffer.buffer = allocateSourceBuffer();
+    layer.source.buffer.isOpaque = true;
+    drawLayers(state, layer);
+}
+
+static void benchmarkFilteredTexturedLayer(benchmark::State& state) {
+    LayerSettings layer = getFullscreenLayer();
+    layer.source.buffer.buffer = allocateSourceBuffer();
+    layer.source.buffer.useTextureFiltering = true;
+    // Scaled down, as with a window animating in.
+    layer.geometry.boundaries = FloatRect(100, 200, kDisplayWidth - 100, kDisplayHeight - 200);
+    drawLayers(state, layer);
+}
+
+static void benchmarkAlphaBlendedLayer(benchmark::State& state) {
+    LayerSettings layer = getFullscreenLayer();
+    layer.source.buffer.buffer = allocateSourceBuffer();
+    layer.alpha = 0.5f;
+    drawLayers(state, layer);
+}
+
+static void benchmarkRoundedCornersLayer(benchmark::State& state) {
+    LayerSettings layer = getFullscreenLayer();
+    layer.source.buffer.buffer = allocateSourceBuffer();
+    layer.source.buffer.isOpaque = true;
+    layer.geometry.roundedCornersRadius = 48.0f;
+    layer.geometry.roundedCornersCrop = layer.geometry.boundaries;
+    drawLayers(state, layer);
+}
+
+static void benchmarkColorTransformLayer(benchmark::State& state) {
+    LayerSettings layer = getFullscreenLayer();
+    layer.source.buffer.buffer = allocateSourceBuffer();
+    layer.source.buffer.isOpaque = true;
+    layer.sourceDataspace = ui::Dataspace::DISPLAY_P3;
+    // Grayscale, as with the accessibility color correction.
+    layer.colorTransform = mat4(vec4(0.3f, 0.3f, 0.3f, 0.0f), vec4(0.6f, 0.6f, 0.6f, 0.0f),
+                                vec4(0.1f, 0.1f, 0.1f, 0.0f), vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    drawLayers(state, layer, true /* useColorManagement */);
+}
+
+static void benchmarkShadowLayer(benchmark::State& state) {
+    LayerSettings layer = getFullscreenLayer();
+    layer.geometry.boundaries = FloatRect(100, 400, kDisplayWidth - 100, kDisplayHeight - 400);
+    layer.geometry.roundedCornersRadius = 48.0f;
+    layer.shadow.ambientColor = vec4(0.0f, 0.0f, 0.0f, 0.039f);
+    layer.shadow.spotColor = vec4(0.0f, 0.0f, 0.0f, 0.19f);
+    layer.shadow.lightPos = vec3(kDisplayWidth / 2.0f, 0.0f, 1500.0f);
+    layer.shadow.lightRadius = 800.0f;
+    layer.shadow.length = 64.0f;
+    drawLayers(state, layer);
+}
+
+static void benchmarkBlurLayer(benchmark::State& state) {
+    LayerSettings layer = getFullscreenLayer();
+    layer.backgroundBlurRadius = 50;
+    layer.alpha = 0.0f;
+    drawLayers(state, layer);
+}
+
+BENCHMARK(benchmarkSolidLayer);
+BENCHMARK(benchmarkTexturedLayer);
+BENCHMARK(benchmarkFilteredTexturedLayer);
+BENCHMARK(benchmarkAlphaBlendedLayer);
+BENCHMARK(benchmarkRoundedCornersLayer);
+BENCHMARK(benchmarkColorTransformLayer);
+BENCHMARK(benchmarkShadowLayer);
+BENCHMARK(benchmarkBlurLayer);
+
+} // namespace android::renderengine
+
+BENCHMARK_MAIN();
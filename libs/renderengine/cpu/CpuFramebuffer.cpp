@@ -0,0 +1,77 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CpuFramebuffer.h"
+
+#include <inttypes.h>
+
+#include <log/log.h>
+#include <ui/PixelFormat.h>
+
+namespace android {
+namespace renderengine {
+namespace cpu {
+
+CpuFramebuffer::~CpuFramebuffer() {
+    unlock();
+}
+
+bool CpuFramebuffer::setNativeWindowBuffer(ANativeWindowBuffer* nativeBuffer, bool isProtected,
+                                           const bool /*useFramebufferCache*/) {
+    unlock();
+    mBuffer = nullptr;
+    if (nativeBuffer == nullptr) {
+        return true;
+    }
+    if (isProtected) {
+        ALOGE("CPU RenderEngine cannot render to protected buffers");
+        return false;
+    }
+    mBuffer = GraphicBuffer::from(nativeBuffer);
+    const PixelFormat format = mBuffer->getPixelFormat();
+    if (format != PIXEL_FORMAT_RGBA_8888 && format != PIXEL_FORMAT_RGBX_8888) {
+        ALOGE("CPU RenderEngine cannot render to buffer format %d", format);
+        mBuffer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+status_t CpuFramebuffer::lock() {
+    if (mBuffer == nullptr) {
+        return BAD_VALUE;
+    }
+    void* pixels = nullptr;
+    status_t status =
+            mBuffer->lock(GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN, &pixels);
+    if (status != NO_ERROR) {
+        ALOGE("Failed to map output buffer %" PRIu64 ": %d", mBuffer->getId(), status);
+        return status;
+    }
+    mPixels = static_cast<uint8_t*>(pixels);
+    return NO_ERROR;
+}
+
+void CpuFramebuffer::unlock() {
+    if (mPixels != nullptr) {
+        mBuffer->unlock();
+        mPixels = nullptr;
+    }
+}
+
+} // namespace cpu
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,56 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <renderengine/Framebuffer.h>
+#include <ui/GraphicBuffer.h>
+
+struct ANativeWindowBuffer;
+
+namespace android {
+namespace renderengine {
+namespace cpu {
+
+// An output buffer mapped for CPU access while it is bound.
+class CpuFramebuffer : public renderengine::Framebuffer {
+public:
+    CpuFramebuffer() = default;
+    ~CpuFramebuffer() override;
+
+    bool setNativeWindowBuffer(ANativeWindowBuffer* nativeBuffer, bool isProtected,
+                               const bool useFramebufferCache) override;
+
+    // Maps the buffer for reading and writing. Returns NO_ERROR on success.
+    status_t lock();
+    void unlock();
+
+    uint8_t* getPixels() const { return mPixels; }
+    int32_t getWidth() const { return mBuffer != nullptr ? mBuffer->getWidth() : 0; }
+    int32_t getHeight() const { return mBuffer != nullptr ? mBuffer->getHeight() : 0; }
+    // In pixels.
+    int32_t getStride() const { return mBuffer != nullptr ? mBuffer->getStride() : 0; }
+
+private:
+    sp<GraphicBuffer> mBuffer;
+    uint8_t* mPixels = nullptr;
+};
+
+} // namespace cpu
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,763 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "CpuRenderEngine.h"
+
+#include <inttypes.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include <android-base/stringprintf.h>
+#include <log/log.h>
+#include <sync/sync.h>
+#include <ui/ColorSpace.h>
+#include <ui/GraphicBuffer.h>
+#include <ui/PixelFormat.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <utils/Trace.h>
+
+namespace android {
+namespace renderengine {
+namespace cpu {
+
+using base::StringAppendF;
+using ui::Dataspace;
+
+// Tiles are square, one span wide, and are the unit of work handed to the
+// worker pool.
+static constexpr int32_t kTileSize = kSpanWidth;
+
+// Compositing is bound by memory bandwidth well before it runs out of cores.
+static constexpr size_t kMaxThreads = 4;
+
+// Limited by gralloc rather than by the backend.
+static constexpr size_t kMaxTextureSize = 16384;
+
+// The same number of blur layers as the GLES backend honours.
+static constexpr size_t kMaxBlurLayers = 2;
+
+struct CpuRenderEngine::Target {
+    uint8_t* pixels;
+    int32_t width;
+    int32_t height;
+    // In pixels.
+    int32_t stride;
+
+    uint8_t* row(int32_t y) const { return pixels + static_cast<size_t>(y) * stride * 4; }
+};
+
+// Everything drawRow() needs, worked out once per layer and frame.
+struct CpuRenderEngine::PreparedLayer {
+    // Target pixels the layer may touch.
+    Rect bounds;
+    // From target pixel centers to layer space.
+    AffineMap toLayer;
+    FloatRect layerBounds;
+
+    // A shadow layer draws only its shadow, as in the GLES backend.
+    bool hasShadow = false;
+    ShadowParams shadow;
+
+    bool hasTexture = false;
+    TextureSampler sampler;
+    // From target pixel centers to texture coordinates.
+    AffineMap toTexture;
+    vec3 solidColor;
+
+    float alpha = 1.0f;
+    bool premultiplied = true;
+    ColorPipeline colorPipeline;
+    float cornerRadius = 0.0f;
+    FloatRect cornerCrop;
+    BlendMode blendMode = BlendMode::REPLACE;
+};
+
+// Source buffers mapped for the duration of a frame, each mapped once even if
+// several layers sample it.
+class CpuRenderEngine::SourceBuffers {
+public:
+    ~SourceBuffers() {
+        for (auto& [bufferId, mapping] : mMappings) {
+            if (mapping.pixels != nullptr) {
+                mapping.buffer->unlock();
+            }
+        }
+    }
+
+    // Returns the buffer contents once the fence has fired, or nullptr if the
+    // buffer cannot be mapped.
+    const uint8_t* map(const sp<GraphicBuffer>& buffer, const sp<Fence>& fence) {
+        auto it = mMappings.find(buffer->getId());
+        if (it != mMappings.end()) {
+            return it->second.pixels;
+        }
+        if (fence != nullptr) {
+            fence->waitForever("CpuRenderEngine");
+        }
+        void* pixels = nullptr;
+        status_t status = buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, &pixels);
+        if (status != NO_ERROR) {
+            ALOGE("Failed to map source buffer %" PRIu64 ": %d", buffer->getId(), status);
+            pixels = nullptr;
+        }
+        mMappings.emplace(buffer->getId(), Mapping{buffer, static_cast<const uint8_t*>(pixels)});
+        return static_cast<const uint8_t*>(pixels);
+    }
+
+private:
+    struct Mapping {
+        sp<GraphicBuffer> buffer;
+        const uint8_t* pixels;
+    };
+    std::unordered_map<uint64_t, Mapping> mMappings;
+};
+
+// Maps layer stack space onto target pixels: the clip rectangle is rotated
+// by the display orientation, then scaled and moved onto the physical
+// display, just like the viewport and projection of the GLES backend.
+static AffineMap getLayerStackToTarget(const DisplaySettings& display, bool applyOrientation) {
+    const Rect& source = display.clip;
+    const Rect& destination = display.physicalDisplay;
+    float sourceWidth = source.getWidth();
+    float sourceHeight = source.getHeight();
+
+    AffineMap translateSource;
+    translateSource.origin = vec2(-source.left, -source.top);
+
+    AffineMap rotation;
+    switch (applyOrientation ? display.orientation : ui::Transform::ROT_0) {
+        case ui::Transform::ROT_90:
+            rotation.dx = vec2(0.0f, 1.0f);
+            rotation.dy = vec2(-1.0f, 0.0f);
+            rotation.origin = vec2(source.getHeight(), 0.0f);
+            std::swap(sourceWidth, sourceHeight);
+            break;
+        case ui::Transform::ROT_180:
+            rotation.dx = vec2(-1.0f, 0.0f);
+            rotation.dy = vec2(0.0f, -1.0f);
+            rotation.origin = vec2(source.getWidth(), source.getHeight());
+            break;
+        case ui::Transform::ROT_270:
+            rotation.dx = vec2(0.0f, -1.0f);
+            rotation.dy = vec2(1.0f, 0.0f);
+            rotation.origin = vec2(0.0f, source.getWidth());
+            std::swap(sourceWidth, sourceHeight);
+            break;
+        default:
+            break;
+    }
+
+    AffineMap scaleToDestination;
+    scaleToDestination.dx = vec2(destination.getWidth() / sourceWidth, 0.0f);
+    scaleToDestination.dy = vec2(0.0f, destination.getHeight() / sourceHeight);
+    scaleToDestination.origin = vec2(destination.left, destination.top);
+
+    return translateSource.then(rotation).then(scaleToDestination);
+}
+
+// The smallest rectangle of whole pixels covering rect once mapped.
+static Rect getMappedBounds(const AffineMap& map, const FloatRect& rect) {
+    const vec2 corners[] = {
+            map.map(rect.left, rect.top),
+            map.map(rect.right, rect.top),
+            map.map(rect.left, rect.bottom),
+            map.map(rect.right, rect.bottom),
+    };
+    float left = corners[0].x;
+    float top = corners[0].y;
+    float right = corners[0].x;
+    float bottom = corners[0].y;
+    for (const vec2& corner : corners) {
+        left = std::min(left, corner.x);
+        top = std::min(top, corner.y);
+        right = std::max(right, corner.x);
+        bottom = std::max(bottom, corner.y);
+    }
+    return Rect(std::floor(left), std::floor(top), std::ceil(right), std::ceil(bottom));
+}
+
+// HDR transfer functions would need tone mapping, which this backend does not
+// do; such content is handled as if it were sRGB.
+static Description::TransferFunction getTransferFunction(Dataspace dataspace) {
+    Description::TransferFunction transfer = Description::dataSpaceToTransferFunction(dataspace);
+    return transfer == Description::TransferFunction::LINEAR ? transfer
+                                                              : Description::TransferFunction::SRGB;
+}
+
+std::unique_ptr<CpuRenderEngine> CpuRenderEngine::create(const RenderEngineCreationArgs& args) {
+    // The thread calling drawLayers() rasterizes too.
+    const size_t threadCount =
+            std::clamp<size_t>(std::thread::hardware_concurrency(), 1, kMaxThreads) - 1;
+    return std::make_unique<CpuRenderEngine>(args, threadCount);
+}
+
+CpuRenderEngine::CpuRenderEngine(const RenderEngineCreationArgs& args, size_t threadCount)
+      : renderengine::impl::RenderEngine(args), mWorkerPool(threadCount, "RenderEngineCpu") {
+    if (args.useColorManagement) {
+        const ColorSpace srgb(ColorSpace::sRGB());
+        const ColorSpace displayP3(ColorSpace::DisplayP3());
+        const ColorSpace bt2020(ColorSpace::BT2020());
+
+        // no chromatic adaptation needed since all color spaces use D65 for their white points.
+        const mat4 srgbToXyz = mat4(srgb.getRGBtoXYZ());
+        const mat4 displayP3ToXyz = mat4(displayP3.getRGBtoXYZ());
+        const mat4 bt2020ToXyz = mat4(bt2020.getRGBtoXYZ());
+        const mat4 xyzToSrgb = mat4(srgb.getXYZtoRGB());
+        const mat4 xyzToDisplayP3 = mat4(displayP3.getXYZtoRGB());
+        const mat4 xyzToBt2020 = mat4(bt2020.getXYZtoRGB());
+
+        mSrgbToDisplayP3 = xyzToDisplayP3 * srgbToXyz;
+        mSrgbToBt2020 = xyzToBt2020 * srgbToXyz;
+        mDisplayP3ToSrgb = xyzToSrgb * displayP3ToXyz;
+        mDisplayP3ToBt2020 = xyzToBt2020 * displayP3ToXyz;
+        mBt2020ToSrgb = xyzToSrgb * bt2020ToXyz;
+        mBt2020ToDisplayP3 = xyzToDisplayP3 * bt2020ToXyz;
+    }
+}
+
+CpuRenderEngine::~CpuRenderEngine() = default;
+
+void CpuRenderEngine::genTextures(size_t count, uint32_t* names) {
+    std::lock_guard<std::mutex> lock(mTextureMutex);
+    for (size_t i = 0; i < count; i++) {
+        names[i] = mNextTextureName++;
+        mTextures[names[i]] = nullptr;
+    }
+}
+
+void CpuRenderEngine::deleteTextures(size_t count, uint32_t const* names) {
+    std::lock_guard<std::mutex> lock(mTextureMutex);
+    for (size_t i = 0; i < count; i++) {
+        mTextures.erase(names[i]);
+    }
+}
+
+void CpuRenderEngine::bindExternalTextureImage(uint32_t /*texName*/, const Image& /*image*/) {
+    // Images wrap EGL resources, which this backend has no use for.
+}
+
+status_t CpuRenderEngine::bindExternalTextureBuffer(uint32_t texName,
+                                                    const sp<GraphicBuffer>& buffer,
+                                                    const sp<Fence>& fence) {
+    ATRACE_CALL();
+    if (buffer == nullptr) {
+        return BAD_VALUE;
+    }
+    if (fence != nullptr) {
+        fence->waitForever("CpuRenderEngine");
+    }
+    std::lock_guard<std::mutex> lock(mTextureMutex);
+    mTextures[texName] = buffer;
+    return NO_ERROR;
+}
+
+void CpuRenderEngine::cacheExternalTextureBuffer(const sp<GraphicBuffer>& /*buffer*/) {
+    // Buffers are mapped as they are drawn, there is nothing to prepare.
+}
+
+void CpuRenderEngine::unbindExternalTextureBuffer(uint64_t bufferId) {
+    std::lock_guard<std::mutex> lock(mTextureMutex);
+    for (auto& [texName, buffer] : mTextures) {
+        if (buffer != nullptr && buffer->getId() == bufferId) {
+            buffer = nullptr;
+        }
+    }
+}
+
+status_t CpuRenderEngine::bindFrameBuffer(Framebuffer* framebuffer) {
+    return static_cast<CpuFramebuffer*>(framebuffer)->lock();
+}
+
+void CpuRenderEngine::unbindFrameBuffer(Framebuffer* framebuffer) {
+    static_cast<CpuFramebuffer*>(framebuffer)->unlock();
+}
+
+bool CpuRenderEngine::cleanupPostRender(CleanupMode mode) {
+    // Drawing is synchronous and holds on to nothing once it returns, so only
+    // texture bindings can be released.
+    if (mode != CleanupMode::CLEAN_ALL) {
+        return false;
+    }
+    bool cleaned = false;
+    std::lock_guard<std::mutex> lock(mTextureMutex);
+    for (auto& [texName, buffer] : mTextures) {
+        if (buffer != nullptr) {
+            buffer = nullptr;
+            cleaned = true;
+        }
+    }
+    return cleaned;
+}
+
+Framebuffer* CpuRenderEngine::getFramebufferForDrawing() {
+    return &mFramebuffer;
+}
+
+void CpuRenderEngine::dump(std::string& result) {
+    StringAppendF(&result, "CPU RenderEngine: %zu worker threads\n",
+                  mWorkerPool.getThreadCount());
+    std::lock_guard<std::mutex> lock(mTextureMutex);
+    StringAppendF(&result, "RenderEngine texture names: %zu\n", mTextures.size());
+}
+
+size_t CpuRenderEngine::getMaxTextureSize() const {
+    return kMaxTextureSize;
+}
+
+size_t CpuRenderEngine::getMaxViewportDims() const {
+    return kMaxTextureSize;
+}
+
+ColorPipeline CpuRenderEngine::getColorPipeline(const DisplaySettings& display,
+                                                const LayerSettings& layer, bool premultiplied,
+                                                bool opaque) const {
+    const mat4 identity;
+    mat4 outputTransformMatrix;
+    auto inputTransfer = Description::TransferFunction::LINEAR;
+    auto outputTransfer = Description::TransferFunction::LINEAR;
+
+    // Same decisions as GLESRenderEngine::drawMesh(), minus the XYZ
+    // conversions that are only needed to tone map HDR content.
+    if (mArgs.useColorManagement) {
+        Dataspace inputStandard =
+                static_cast<Dataspace>(layer.sourceDataspace & Dataspace::STANDARD_MASK);
+        const Dataspace outputStandard =
+                static_cast<Dataspace>(display.outputDataspace & Dataspace::STANDARD_MASK);
+        if (inputStandard != Dataspace::STANDARD_DCI_P3 &&
+            inputStandard != Dataspace::STANDARD_BT2020) {
+            inputStandard = Dataspace::STANDARD_BT709;
+        }
+
+        if (inputStandard != outputStandard) {
+            switch (outputStandard) {
+                case Dataspace::STANDARD_BT2020:
+                    if (inputStandard == Dataspace::STANDARD_BT709) {
+                        outputTransformMatrix = mSrgbToBt2020;
+                    } else if (inputStandard == Dataspace::STANDARD_DCI_P3) {
+                        outputTransformMatrix = mDisplayP3ToBt2020;
+                    }
+                    break;
+                case Dataspace::STANDARD_DCI_P3:
+                    if (inputStandard == Dataspace::STANDARD_BT709) {
+                        outputTransformMatrix = mSrgbToDisplayP3;
+                    } else if (inputStandard == Dataspace::STANDARD_BT2020) {
+                        outputTransformMatrix = mBt2020ToDisplayP3;
+                    }
+                    break;
+                default:
+                    if (inputStandard == Dataspace::STANDARD_DCI_P3) {
+                        outputTransformMatrix = mDisplayP3ToSrgb;
+                    } else if (inputStandard == Dataspace::STANDARD_BT2020) {
+                        outputTransformMatrix = mBt2020ToSrgb;
+                    }
+                    break;
+            }
+        }
+
+        const Dataspace inputTransferSpace =
+                static_cast<Dataspace>(layer.sourceDataspace & Dataspace::TRANSFER_MASK);
+        const Dataspace outputTransferSpace =
+                static_cast<Dataspace>(display.outputDataspace & Dataspace::TRANSFER_MASK);
+        if (layer.colorTransform != identity || outputTransformMatrix != identity ||
+            inputTransferSpace != outputTransferSpace) {
+            inputTransfer = getTransferFunction(layer.sourceDataspace);
+            outputTransfer = getTransferFunction(display.outputDataspace);
+        }
+    }
+
+    ColorPipeline pipeline;
+    pipeline.inputTransfer = inputTransfer;
+    pipeline.outputTransfer = outputTransfer;
+    pipeline.outputMatrix = layer.colorTransform * outputTransformMatrix;
+    pipeline.hasDisplayMatrix = display.colorTransform != identity;
+    pipeline.displayMatrix = display.colorTransform;
+    pipeline.enabled = layer.colorTransform != identity || outputTransformMatrix != identity ||
+            inputTransfer != outputTransfer || pipeline.hasDisplayMatrix;
+    pipeline.unpremultiply = !opaque && premultiplied;
+    return pipeline;
+}
+
+bool CpuRenderEngine::prepareLayer(const DisplaySettings& display, const LayerSettings& layer,
+                                   const AffineMap& layerStackToTarget, const Rect& clip,
+                                   SourceBuffers& sources, PreparedLayer* out) const {
+    const AffineMap layerToTarget =
+            AffineMap::fromMatrix(layer.geometry.positionTransform).then(layerStackToTarget);
+    if (layerToTarget.determinant() == 0.0f) {
+        return false;
+    }
+    out->toLayer = layerToTarget.inverse();
+    out->layerBounds = layer.geometry.boundaries;
+
+    FloatRect drawnBounds = layer.geometry.boundaries;
+    const ShadowSettings& shadow = layer.shadow;
+    if (shadow.length > 0.0f) {
+        drawnBounds = FloatRect(drawnBounds.left - shadow.length, drawnBounds.top - shadow.length,
+                                drawnBounds.right + shadow.length,
+                                drawnBounds.bottom + shadow.length);
+    }
+    if (!getMappedBounds(layerToTarget, drawnBounds).intersect(clip, &out->bounds)) {
+        return false;
+    }
+
+    if (shadow.length > 0.0f) {
+        // An analytic stand-in for the tessellated shadows of the GLES
+        // backend: the ambient shadow fades out over the whole length around
+        // the caster, and the spot shadow is the same shape pushed a quarter
+        // of the length away from the light, so neither reaches further than
+        // the length.
+        const FloatRect& caster = layer.geometry.boundaries;
+        const vec2 center((caster.left + caster.right) / 2.0f,
+                          (caster.top + caster.bottom) / 2.0f);
+        const vec2 awayFromLight = center - vec2(shadow.lightPos.x, shadow.lightPos.y);
+        const float distance = length(awayFromLight);
+
+        out->hasShadow = true;
+        out->shadow.caster = caster;
+        out->shadow.cornerRadius = layer.geometry.roundedCornersRadius;
+        out->shadow.ambientColor = shadow.ambientColor;
+        out->shadow.spotColor = shadow.spotColor;
+        out->shadow.spotOffset = distance > 0.0f
+                ? awayFromLight * (shadow.length / 4.0f / distance)
+                : vec2(0.0f, 0.0f);
+        out->shadow.ambientLength = shadow.length;
+        out->shadow.spotLength = shadow.length * 3.0f / 4.0f;
+        out->shadow.fillCaster = shadow.casterIsTranslucent;
+        out->blendMode = BlendMode::PREMULTIPLIED;
+        return true;
+    }
+
+    bool opaque = false;
+    if (layer.source.buffer.buffer != nullptr) {
+        const Buffer& source = layer.source.buffer;
+        const sp<GraphicBuffer>& buffer = source.buffer;
+        if (source.isY410BT2020) {
+            ALOGE("CPU RenderEngine cannot sample Y410 buffers");
+            return false;
+        }
+        TextureSampler& sampler = out->sampler;
+        switch (buffer->getPixelFormat()) {
+            case PIXEL_FORMAT_RGBA_8888:
+                break;
+            case PIXEL_FORMAT_RGBX_8888:
+                sampler.ignoreAlpha = true;
+                break;
+            case PIXEL_FORMAT_BGRA_8888:
+                sampler.swapRedBlue = true;
+                break;
+            default:
+                ALOGE("CPU RenderEngine cannot sample buffer format %d", buffer->getPixelFormat());
+                return false;
+        }
+        sampler.pixels = sources.map(buffer, source.fence);
+        if (sampler.pixels == nullptr) {
+            return false;
+        }
+        sampler.width = buffer->getWidth();
+        sampler.height = buffer->getHeight();
+        sampler.stride = buffer->getStride();
+        sampler.ignoreAlpha |= source.isOpaque;
+        sampler.filter = source.useTextureFiltering;
+
+        // Texture coordinates run from 0 to 1 across the layer boundaries
+        // before the texture transform is applied.
+        const FloatRect& bounds = layer.geometry.boundaries;
+        AffineMap layerToTexture;
+        layerToTexture.dx = vec2(1.0f / bounds.getWidth(), 0.0f);
+        layerToTexture.dy = vec2(0.0f, 1.0f / bounds.getHeight());
+        layerToTexture.origin =
+                vec2(-bounds.left / bounds.getWidth(), -bounds.top / bounds.getHeight());
+
+        out->hasTexture = true;
+        out->toTexture = out->toLayer.then(layerToTexture)
+                                 .then(AffineMap::fromMatrix(source.textureTransform));
+        out->premultiplied = source.usePremultipliedAlpha;
+        opaque = source.isOpaque;
+    } else {
+        const half3& color = layer.source.solidColor;
+        out->solidColor = vec3(color.r, color.g, color.b);
+    }
+
+    out->alpha = layer.alpha;
+    out->colorPipeline = getColorPipeline(display, layer, out->premultiplied, opaque);
+    out->cornerRadius = layer.geometry.roundedCornersRadius;
+    out->cornerCrop = layer.geometry.roundedCornersCrop;
+    if (!layer.disableBlending && (out->alpha < 1.0f || !opaque || out->cornerRadius > 0.0f)) {
+        out->blendMode = out->premultiplied ? BlendMode::PREMULTIPLIED : BlendMode::STRAIGHT;
+    } else {
+        out->blendMode = BlendMode::REPLACE;
+    }
+    return true;
+}
+
+void CpuRenderEngine::drawRow(const Target& target, const PreparedLayer& layer, int32_t left,
+                              int32_t right, int32_t y) const {
+    const int n = right - left;
+    Span span;
+    alignas(16) float x[kSpanWidth];
+    alignas(16) float yLayer[kSpanWidth];
+    alignas(16) float mask[kSpanWidth];
+    uint8_t* dst = target.row(y) + left * 4;
+
+    layer.toLayer.mapSpan(left, y, n, x, yLayer);
+    if (layer.hasShadow) {
+        shadeShadow(span, n, x, yLayer, layer.shadow);
+        std::fill_n(mask, n, 1.0f);
+        blendSpan(dst, span, mask, n, layer.blendMode);
+        return;
+    }
+
+    computeBoundsMask(mask, n, x, yLayer, layer.layerBounds);
+    if (std::all_of(mask, mask + n, [](float m) { return m == 0.0f; })) {
+        return;
+    }
+
+    if (layer.hasTexture) {
+        alignas(16) float u[kSpanWidth];
+        alignas(16) float v[kSpanWidth];
+        layer.toTexture.mapSpan(left, y, n, u, v);
+        sampleTexture(span, n, u, v, layer.sampler);
+    } else {
+        fillSolid(span, n, layer.solidColor);
+    }
+    if (layer.alpha < 1.0f) {
+        applyAlpha(span, n, layer.alpha, layer.premultiplied);
+    }
+    applyColorPipeline(span, n, layer.colorPipeline);
+    if (layer.cornerRadius > 0.0f) {
+        applyCornerRadius(span, n, x, yLayer, layer.cornerCrop, layer.cornerRadius,
+                          layer.premultiplied);
+    }
+    blendSpan(dst, span, mask, n, layer.blendMode);
+}
+
+void CpuRenderEngine::drawTile(const Target& target, const Rect& tile, const PreparedLayer* begin,
+                               const PreparedLayer* end) const {
+    for (const PreparedLayer* layer = begin; layer != end; layer++) {
+        Rect area;
+        if (!layer->bounds.intersect(tile, &area)) {
+            continue;
+        }
+        for (int32_t y = area.top; y < area.bottom; y++) {
+            for (int32_t x = area.left; x < area.right; x += kSpanWidth) {
+                drawRow(target, *layer, x, std::min(x + kSpanWidth, area.right), y);
+            }
+        }
+    }
+}
+
+void CpuRenderEngine::blur(const Target& target, const Rect& clip, const Rect& bounds,
+                           int radius) {
+    ATRACE_CALL();
+    // Pixels within the blur radius of the layer bleed into it.
+    Rect region;
+    if (bounds.isEmpty() ||
+        !Rect(bounds.left - radius, bounds.top - radius, bounds.right + radius,
+              bounds.bottom + radius)
+                 .intersect(clip, &region)) {
+        return;
+    }
+    const int32_t width = region.getWidth();
+    const int32_t height = region.getHeight();
+    const size_t size = static_cast<size_t>(width) * height;
+    mBlurBuffer.resize(size * 2);
+    uint32_t* pixels = mBlurBuffer.data();
+    uint32_t* scratch = pixels + size;
+    for (int32_t y = 0; y < height; y++) {
+        memcpy(pixels + static_cast<size_t>(y) * width,
+               target.row(region.top + y) + region.left * 4, width * 4);
+    }
+
+    // Three box passes in each direction come close to a gaussian whose
+    // sigma equals the box radius; the blur radius is taken as two sigmas.
+    constexpr int kPasses = 3;
+    const int boxRadius = std::max(1, radius / 2);
+    const size_t rowBands = (height + kTileSize - 1) / kTileSize;
+    const size_t columnBands = (width + kTileSize - 1) / kTileSize;
+    for (int pass = 0; pass < kPasses; pass++) {
+        mWorkerPool.run(rowBands, [&](size_t band) {
+            const int32_t end = std::min<int32_t>((band + 1) * kTileSize, height);
+            for (int32_t y = band * kTileSize; y < end; y++) {
+                boxBlur(pixels + static_cast<size_t>(y) * width, 1,
+                        scratch + static_cast<size_t>(y) * width, 1, width, boxRadius);
+            }
+        });
+        mWorkerPool.run(columnBands, [&](size_t band) {
+            const int32_t end = std::min<int32_t>((band + 1) * kTileSize, width);
+            for (int32_t x = band * kTileSize; x < end; x++) {
+                boxBlur(scratch + x, width, pixels + x, width, height, boxRadius);
+            }
+        });
+    }
+
+    // Only what is behind the layer is blurred.
+    for (int32_t y = bounds.top; y < bounds.bottom; y++) {
+        memcpy(target.row(y) + bounds.left * 4,
+               pixels + static_cast<size_t>(y - region.top) * width + (bounds.left - region.left),
+               bounds.getWidth() * 4);
+    }
+}
+
+status_t CpuRenderEngine::drawLayers(const DisplaySettings& display,
+                                     const std::vector<const LayerSettings*>& layers,
+                                     ANativeWindowBuffer* const buffer,
+                                     const bool useFramebufferCache, base::unique_fd&& bufferFence,
+                                     base::unique_fd* drawFence) {
+    ATRACE_CALL();
+    if (layers.empty()) {
+        ALOGV("Drawing empty layer stack");
+        return NO_ERROR;
+    }
+
+    if (bufferFence.get() >= 0) {
+        ATRACE_NAME("Waiting before draw");
+        sync_wait(bufferFence.get(), -1);
+    }
+
+    if (buffer == nullptr) {
+        ALOGE("No output buffer provided. Aborting CPU composition.");
+        return BAD_VALUE;
+    }
+
+    BindNativeBufferAsFramebuffer fbo(*this, buffer, useFramebufferCache);
+    if (fbo.getStatus() != NO_ERROR) {
+        ALOGE("Failed to bind framebuffer! Aborting CPU composition for buffer (%p).",
+              buffer->handle);
+        return fbo.getStatus();
+    }
+    const Target target{mFramebuffer.getPixels(), mFramebuffer.getWidth(),
+                        mFramebuffer.getHeight(), mFramebuffer.getStride()};
+
+    Rect clip;
+    if (!display.physicalDisplay.intersect(Rect(target.width, target.height), &clip)) {
+        clip = Rect::EMPTY_RECT;
+    }
+    const AffineMap layerStackToTarget = getLayerStackToTarget(display, true);
+
+    // The GLES backend fills the clear region before the display orientation
+    // is folded into its projection, so do the same here.
+    std::vector<Rect> clearRects;
+    if (!display.clearRegion.isEmpty()) {
+        const AffineMap clearToTarget = getLayerStackToTarget(display, false);
+        for (const Rect& rect : display.clearRegion) {
+            Rect clearRect;
+            if (getMappedBounds(clearToTarget, rect.toFloatRect()).intersect(clip, &clearRect)) {
+                clearRects.push_back(clearRect);
+            }
+        }
+    }
+
+    // Only the frontmost blurs are honoured.
+    std::vector<const LayerSettings*> blurLayers;
+    if (mArgs.supportsBackgroundBlur) {
+        for (auto layer : layers) {
+            if (layer->backgroundBlurRadius > 0) {
+                blurLayers.push_back(layer);
+            }
+        }
+        if (blurLayers.size() > kMaxBlurLayers) {
+            blurLayers.erase(blurLayers.begin(), blurLayers.end() - kMaxBlurLayers);
+        }
+    }
+
+    SourceBuffers sources;
+    std::vector<PreparedLayer> prepared;
+    prepared.reserve(layers.size());
+    // Blurs to apply before drawing prepared[first], behind the given bounds.
+    struct Blur {
+        size_t first;
+        Rect bounds;
+        int radius;
+    };
+    std::vector<Blur> blurs;
+    {
+        ATRACE_NAME("Preparing layers");
+        for (auto layer : layers) {
+            if (std::find(blurLayers.begin(), blurLayers.end(), layer) != blurLayers.end()) {
+                const AffineMap layerToTarget =
+                        AffineMap::fromMatrix(layer->geometry.positionTransform)
+                                .then(layerStackToTarget);
+                Rect bounds;
+                if (!getMappedBounds(layerToTarget, layer->geometry.boundaries)
+                             .intersect(clip, &bounds)) {
+                    bounds = Rect::EMPTY_RECT;
+                }
+                blurs.push_back({prepared.size(), bounds, layer->backgroundBlurRadius});
+            }
+            prepared.emplace_back();
+            if (!prepareLayer(display, *layer, layerStackToTarget, clip, sources,
+                              &prepared.back())) {
+                prepared.pop_back();
+            }
+        }
+    }
+
+    const int32_t tilesX = (target.width + kTileSize - 1) / kTileSize;
+    const int32_t tilesY = (target.height + kTileSize - 1) / kTileSize;
+    auto rasterize = [&](size_t begin, size_t end, bool clear) {
+        ATRACE_NAME("Rasterizing tiles");
+        mWorkerPool.run(tilesX * tilesY, [&](size_t index) {
+            const int32_t left = (index % tilesX) * kTileSize;
+            const int32_t top = (index / tilesX) * kTileSize;
+            const Rect tile(left, top, std::min(left + kTileSize, target.width),
+                            std::min(top + kTileSize, target.height));
+            if (clear) {
+                // Clear the entire buffer, reused buffers would otherwise
+                // show ghost images, and overlays need a transparent
+                // framebuffer.
+                for (int32_t y = tile.top; y < tile.bottom; y++) {
+                    memset(target.row(y) + tile.left * 4, 0, tile.getWidth() * 4);
+                }
+                for (const Rect& clearRect : clearRects) {
+                    Rect area;
+                    if (!clearRect.intersect(tile, &area)) {
+                        continue;
+                    }
+                    for (int32_t y = area.top; y < area.bottom; y++) {
+                        uint32_t* row = reinterpret_cast<uint32_t*>(target.row(y));
+                        // Opaque black.
+                        std::fill(row + area.left, row + area.right, 0xff000000);
+                    }
+                }
+            }
+            drawTile(target, tile, prepared.data() + begin, prepared.data() + end);
+        });
+    };
+
+    size_t begin = 0;
+    bool clear = true;
+    for (const Blur& layerBlur : blurs) {
+        rasterize(begin, layerBlur.first, clear);
+        clear = false;
+        blur(target, clip, layerBlur.bounds, layerBlur.radius);
+        begin = layerBlur.first;
+    }
+    rasterize(begin, prepared.size(), clear);
+
+    // Everything has landed in the buffer already.
+    if (drawFence != nullptr) {
+        drawFence->reset();
+    }
+    return NO_ERROR;
+}
+
+} // namespace cpu
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+
+#include <android-base/thread_annotations.h>
+#include <renderengine/RenderEngine.h>
+#include <workerpool/WorkerPool.h>
+#include "CpuFramebuffer.h"
+#include "PixelKernels.h"
+
+namespace android {
+namespace renderengine {
+namespace cpu {
+
+/*
+ * A RenderEngine that composites on the CPU, for devices or tests without a
+ * usable GPU and as a reference for the GLES backend.
+ *
+ * Output and source buffers are mapped with gralloc, so they must be
+ * allocated with CPU read/write usage; only RGBA/RGBX_8888 outputs and
+ * RGBA/RGBX/BGRA_8888 sources are supported. The frame is cut into tiles
+ * which are rasterized in parallel, each tile blending all layers back to
+ * front before the next one, so that its pixels stay in cache.
+ * Rendering is finished by the time drawLayers() returns.
+ */
+class CpuRenderEngine : public impl::RenderEngine {
+public:
+    static std::unique_ptr<CpuRenderEngine> create(const RenderEngineCreationArgs& args);
+
+    CpuRenderEngine(const RenderEngineCreationArgs& args, size_t threadCount);
+    ~CpuRenderEngine() override;
+
+    void primeCache() const override {}
+    void genTextures(size_t count, uint32_t* names) override EXCLUDES(mTextureMutex);
+    void deleteTextures(size_t count, uint32_t const* names) override EXCLUDES(mTextureMutex);
+    void bindExternalTextureImage(uint32_t texName, const Image& image) override;
+    status_t bindExternalTextureBuffer(uint32_t texName, const sp<GraphicBuffer>& buffer,
+                                       const sp<Fence>& fence) override EXCLUDES(mTextureMutex);
+    void cacheExternalTextureBuffer(const sp<GraphicBuffer>& buffer) override;
+    void unbindExternalTextureBuffer(uint64_t bufferId) override EXCLUDES(mTextureMutex);
+    status_t bindFrameBuffer(Framebuffer* framebuffer) override;
+    void unbindFrameBuffer(Framebuffer* framebuffer) override;
+
+    bool isProtected() const override { return false; }
+    bool supportsProtectedContent() const override { return false; }
+    bool useProtectedContext(bool useProtectedContext) override { return !useProtectedContext; }
+    status_t drawLayers(const DisplaySettings& display,
+                        const std::vector<const LayerSettings*>& layers,
+                        ANativeWindowBuffer* buffer, const bool useFramebufferCache,
+                        base::unique_fd&& bufferFence, base::unique_fd* drawFence) override;
+    bool cleanupPostRender(CleanupMode mode) override EXCLUDES(mTextureMutex);
+
+protected:
+    Framebuffer* getFramebufferForDrawing() override;
+    void dump(std::string& result) override EXCLUDES(mTextureMutex);
+    size_t getMaxTextureSize() const override;
+    size_t getMaxViewportDims() const override;
+
+private:
+    struct PreparedLayer;
+    struct Target;
+    class SourceBuffers;
+
+    bool prepareLayer(const DisplaySettings& display, const LayerSettings& layer,
+                      const AffineMap& layerStackToTarget, const Rect& clip,
+                      SourceBuffers& sources, PreparedLayer* out) const;
+    ColorPipeline getColorPipeline(const DisplaySettings& display, const LayerSettings& layer,
+                                   bool premultiplied, bool opaque) const;
+    void drawTile(const Target& target, const Rect& tile, const PreparedLayer* begin,
+                  const PreparedLayer* end) const;
+    void drawRow(const Target& target, const PreparedLayer& layer, int32_t left, int32_t right,
+                 int32_t y) const;
+    // Blurs what is behind bounds, reading from up to radius pixels around it.
+    void blur(const Target& target, const Rect& clip, const Rect& bounds, int radius);
+
+    CpuFramebuffer mFramebuffer;
+    WorkerPool mWorkerPool;
+
+    std::mutex mTextureMutex;
+    uint32_t mNextTextureName GUARDED_BY(mTextureMutex) = 1;
+    // Buffers last bound to each texture name. drawLayers() reads straight
+    // from LayerSettings, so this only keeps bound buffers alive the same way
+    // the GLES backend's images do.
+    std::unordered_map<uint32_t, sp<GraphicBuffer>> mTextures GUARDED_BY(mTextureMutex);
+
+    // Blur scratch space, reused across frames.
+    std::vector<uint32_t> mBlurBuffer;
+
+    // Gamut conversions, only used with color management.
+    mat4 mSrgbToDisplayP3;
+    mat4 mSrgbToBt2020;
+    mat4 mDisplayP3ToSrgb;
+    mat4 mDisplayP3ToBt2020;
+    mat4 mBt2020ToSrgb;
+    mat4 mBt2020ToDisplayP3;
+};
+
+} // namespace cpu
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,358 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "PixelKernels.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace android {
+namespace renderengine {
+namespace cpu {
+
+using TransferFunction = Description::TransferFunction;
+
+AffineMap AffineMap::fromMatrix(const mat4& m) {
+    AffineMap map;
+    map.origin = vec2(m[3][0], m[3][1]);
+    map.dx = vec2(m[0][0], m[0][1]);
+    map.dy = vec2(m[1][0], m[1][1]);
+    return map;
+}
+
+AffineMap AffineMap::then(const AffineMap& next) const {
+    AffineMap map;
+    map.origin = next.map(origin.x, origin.y);
+    map.dx = next.dx * dx.x + next.dy * dx.y;
+    map.dy = next.dx * dy.x + next.dy * dy.y;
+    return map;
+}
+
+AffineMap AffineMap::inverse() const {
+    const float invDet = 1.0f / determinant();
+    AffineMap map;
+    map.dx = vec2(dy.y, -dx.y) * invDet;
+    map.dy = vec2(-dy.x, dx.x) * invDet;
+    map.origin = -(map.dx * origin.x + map.dy * origin.y);
+    return map;
+}
+
+void AffineMap::mapSpan(int32_t x, int32_t y, int n, float* outX, float* outY) const {
+    const vec2 start = map(x + 0.5f, y + 0.5f);
+    for (int i = 0; i < n; i++) {
+        outX[i] = start.x + dx.x * i;
+        outY[i] = start.y + dx.y * i;
+    }
+}
+
+void fillSolid(Span& span, int n, const vec3& color) {
+    std::fill_n(span.r, n, color.r);
+    std::fill_n(span.g, n, color.g);
+    std::fill_n(span.b, n, color.b);
+    std::fill_n(span.a, n, 1.0f);
+}
+
+static inline uint32_t loadTexel(const TextureSampler& sampler, int32_t x, int32_t y) {
+    x = std::clamp(x, 0, sampler.width - 1);
+    y = std::clamp(y, 0, sampler.height - 1);
+    const uint8_t* p = sampler.pixels + (static_cast<size_t>(y) * sampler.stride + x) * 4;
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+void sampleTexture(Span& span, int n, const float* u, const float* v,
+                   const TextureSampler& sampler) {
+    constexpr float kScale = 1.0f / 255.0f;
+    const float width = sampler.width;
+    const float height = sampler.height;
+    if (!sampler.filter) {
+        for (int i = 0; i < n; i++) {
+            const uint32_t texel = loadTexel(sampler, static_cast<int32_t>(std::floor(u[i] * width)),
+                                             static_cast<int32_t>(std::floor(v[i] * height)));
+            span.r[i] = (texel & 0xff) * kScale;
+            span.g[i] = ((texel >> 8) & 0xff) * kScale;
+            span.b[i] = ((texel >> 16) & 0xff) * kScale;
+            span.a[i] = (texel >> 24) * kScale;
+        }
+    } else {
+        for (int i = 0; i < n; i++) {
+            const float x = u[i] * width - 0.5f;
+            const float y = v[i] * height - 0.5f;
+            const float x0 = std::floor(x);
+            const float y0 = std::floor(y);
+            const float fx = x - x0;
+            const float fy = y - y0;
+            const int32_t ix = static_cast<int32_t>(x0);
+            const int32_t iy = static_cast<int32_t>(y0);
+            const uint32_t t00 = loadTexel(sampler, ix, iy);
+            const uint32_t t10 = loadTexel(sampler, ix + 1, iy);
+            const uint32_t t01 = loadTexel(sampler, ix, iy + 1);
+            const uint32_t t11 = loadTexel(sampler, ix + 1, iy + 1);
+            const float w00 = (1.0f - fx) * (1.0f - fy) * kScale;
+            const float w10 = fx * (1.0f - fy) * kScale;
+            const float w01 = (1.0f - fx) * fy * kScale;
+            const float w11 = fx * fy * kScale;
+            auto channel = [&](int shift) {
+                return ((t00 >> shift) & 0xff) * w00 + ((t10 >> shift) & 0xff) * w10 +
+                        ((t01 >> shift) & 0xff) * w01 + ((t11 >> shift) & 0xff) * w11;
+            };
+            span.r[i] = channel(0);
+            span.g[i] = channel(8);
+            span.b[i] = channel(16);
+            span.a[i] = channel(24);
+        }
+    }
+    if (sampler.swapRedBlue) {
+        for (int i = 0; i < n; i++) {
+            std::swap(span.r[i], span.b[i]);
+        }
+    }
+    if (sampler.ignoreAlpha) {
+        std::fill_n(span.a, n, 1.0f);
+    }
+}
+
+void applyAlpha(Span& span, int n, float alpha, bool premultiplied) {
+    if (premultiplied) {
+        for (int i = 0; i < n; i++) {
+            span.r[i] *= alpha;
+            span.g[i] *= alpha;
+            span.b[i] *= alpha;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        span.a[i] *= alpha;
+    }
+}
+
+static inline float eotfSrgb(float x) {
+    const float v = std::abs(x);
+    const float linear = v <= 0.04045f ? v / 12.92f : std::pow((v + 0.055f) / 1.055f, 2.4f);
+    return std::copysign(linear, x);
+}
+
+static inline float oetfSrgb(float x) {
+    const float v = std::abs(x);
+    const float encoded = v <= 0.0031308f ? v * 12.92f : std::pow(v, 1.0f / 2.4f) * 1.055f - 0.055f;
+    return std::copysign(encoded, x);
+}
+
+static void applyTransfer(float* channel, int n, float (*transfer)(float)) {
+    for (int i = 0; i < n; i++) {
+        channel[i] = transfer(channel[i]);
+    }
+}
+
+static void applyMatrix(Span& span, int n, const mat4& m, bool clamp) {
+    for (int i = 0; i < n; i++) {
+        const float r = span.r[i];
+        const float g = span.g[i];
+        const float b = span.b[i];
+        float outR = m[0][0] * r + m[1][0] * g + m[2][0] * b + m[3][0];
+        float outG = m[0][1] * r + m[1][1] * g + m[2][1] * b + m[3][1];
+        float outB = m[0][2] * r + m[1][2] * g + m[2][2] * b + m[3][2];
+        if (clamp) {
+            outR = std::clamp(outR, 0.0f, 1.0f);
+            outG = std::clamp(outG, 0.0f, 1.0f);
+            outB = std::clamp(outB, 0.0f, 1.0f);
+        }
+        span.r[i] = outR;
+        span.g[i] = outG;
+        span.b[i] = outB;
+    }
+}
+
+static void scaleColor(Span& span, int n, bool divide) {
+    // Same bias as the shaders, to stay clear of dividing by 0.
+    constexpr float kAlphaBias = 0.0019f;
+    for (int i = 0; i < n; i++) {
+        const float alpha = span.a[i] + kAlphaBias;
+        const float scale = divide ? 1.0f / alpha : alpha;
+        span.r[i] *= scale;
+        span.g[i] *= scale;
+        span.b[i] *= scale;
+    }
+}
+
+void applyColorPipeline(Span& span, int n, const ColorPipeline& pipeline) {
+    if (!pipeline.enabled) {
+        return;
+    }
+    if (pipeline.unpremultiply) {
+        scaleColor(span, n, true);
+    }
+    if (pipeline.inputTransfer == TransferFunction::SRGB) {
+        applyTransfer(span.r, n, eotfSrgb);
+        applyTransfer(span.g, n, eotfSrgb);
+        applyTransfer(span.b, n, eotfSrgb);
+    }
+    applyMatrix(span, n, pipeline.outputMatrix, true);
+    if (pipeline.outputTransfer == TransferFunction::SRGB) {
+        applyTransfer(span.r, n, oetfSrgb);
+        applyTransfer(span.g, n, oetfSrgb);
+        applyTransfer(span.b, n, oetfSrgb);
+    }
+    if (pipeline.hasDisplayMatrix) {
+        applyMatrix(span, n, pipeline.displayMatrix, true);
+    }
+    if (pipeline.unpremultiply) {
+        scaleColor(span, n, false);
+    }
+}
+
+void computeBoundsMask(float* mask, int n, const float* x, const float* y, const FloatRect& bounds) {
+    for (int i = 0; i < n; i++) {
+        const bool inside = x[i] >= bounds.left && x[i] < bounds.right && y[i] >= bounds.top &&
+                y[i] < bounds.bottom;
+        mask[i] = inside ? 1.0f : 0.0f;
+    }
+}
+
+void applyCornerRadius(Span& span, int n, const float* x, const float* y, const FloatRect& crop,
+                       float radius, bool premultiplied) {
+    const float halfWidth = crop.getWidth() / 2.0f;
+    const float halfHeight = crop.getHeight() / 2.0f;
+    const float centerX = crop.left + halfWidth;
+    const float centerY = crop.top + halfHeight;
+    for (int i = 0; i < n; i++) {
+        // Distance past the inset rectangle whose rounded outline is the crop.
+        const float dx = std::max(std::abs(x[i] - centerX) - halfWidth + radius, 0.0f);
+        const float dy = std::max(std::abs(y[i] - centerY) - halfHeight + radius, 0.0f);
+        const float plane = std::sqrt(dx * dx + dy * dy);
+        const float coverage = 1.0f - std::clamp(plane - radius, 0.0f, 1.0f);
+        if (premultiplied) {
+            span.r[i] *= coverage;
+            span.g[i] *= coverage;
+            span.b[i] *= coverage;
+        }
+        span.a[i] *= coverage;
+    }
+}
+
+// Signed distance from a point to a rounded rectangle, negative inside.
+static inline float roundedRectDistance(float x, float y, float centerX, float centerY,
+                                        float halfWidth, float halfHeight, float radius) {
+    const float qx = std::abs(x - centerX) - halfWidth + radius;
+    const float qy = std::abs(y - centerY) - halfHeight + radius;
+    const float outsideX = std::max(qx, 0.0f);
+    const float outsideY = std::max(qy, 0.0f);
+    return std::sqrt(outsideX * outsideX + outsideY * outsideY) +
+            std::min(std::max(qx, qy), 0.0f) - radius;
+}
+
+// How much of the shadow color reaches a point at distance d from the
+// caster, easing out to nothing at length.
+static inline float shadowFalloff(float d, float length, bool fillCaster) {
+    if (d <= 0.0f) {
+        return fillCaster ? 1.0f : 0.0f;
+    }
+    const float t = std::max(1.0f - d / length, 0.0f);
+    return t * t;
+}
+
+void shadeShadow(Span& span, int n, const float* x, const float* y, const ShadowParams& shadow) {
+    const float halfWidth = shadow.caster.getWidth() / 2.0f;
+    const float halfHeight = shadow.caster.getHeight() / 2.0f;
+    const float centerX = shadow.caster.left + halfWidth;
+    const float centerY = shadow.caster.top + halfHeight;
+    const float radius = std::min(shadow.cornerRadius, std::min(halfWidth, halfHeight));
+    for (int i = 0; i < n; i++) {
+        float ambient = 0.0f;
+        if (shadow.ambientLength > 0.0f) {
+            const float d = roundedRectDistance(x[i], y[i], centerX, centerY, halfWidth,
+                                                halfHeight, radius);
+            ambient = shadowFalloff(d, shadow.ambientLength, shadow.fillCaster);
+        }
+        float spot = 0.0f;
+        if (shadow.spotLength > 0.0f) {
+            const float d = roundedRectDistance(x[i] - shadow.spotOffset.x,
+                                                y[i] - shadow.spotOffset.y, centerX, centerY,
+                                                halfWidth, halfHeight, radius);
+            spot = shadowFalloff(d, shadow.spotLength, shadow.fillCaster);
+        }
+        // Both colors are premultiplied.
+        span.r[i] = std::min(shadow.ambientColor.r * ambient + shadow.spotColor.r * spot, 1.0f);
+        span.g[i] = std::min(shadow.ambientColor.g * ambient + shadow.spotColor.g * spot, 1.0f);
+        span.b[i] = std::min(shadow.ambientColor.b * ambient + shadow.spotColor.b * spot, 1.0f);
+        span.a[i] = std::min(shadow.ambientColor.a * ambient + shadow.spotColor.a * spot, 1.0f);
+    }
+}
+
+static inline uint8_t toUnorm8(float value) {
+    return static_cast<uint8_t>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void blendSpan(uint8_t* dst, const Span& span, const float* mask, int n, BlendMode mode) {
+    constexpr float kScale = 1.0f / 255.0f;
+    if (mode == BlendMode::REPLACE) {
+        for (int i = 0; i < n; i++) {
+            if (mask[i] != 0.0f) {
+                dst[i * 4 + 0] = toUnorm8(span.r[i]);
+                dst[i * 4 + 1] = toUnorm8(span.g[i]);
+                dst[i * 4 + 2] = toUnorm8(span.b[i]);
+                dst[i * 4 + 3] = toUnorm8(span.a[i]);
+            }
+        }
+        return;
+    }
+
+    const bool straight = mode == BlendMode::STRAIGHT;
+    for (int i = 0; i < n; i++) {
+        // A zero mask makes the source fully transparent, which leaves the
+        // destination as it was under either blend function.
+        const float srcAlpha = span.a[i] * mask[i];
+        const float srcScale = straight ? srcAlpha : mask[i];
+        const float dstScale = (1.0f - srcAlpha) * kScale;
+        uint8_t* p = dst + i * 4;
+        p[0] = toUnorm8(span.r[i] * srcScale + p[0] * dstScale);
+        p[1] = toUnorm8(span.g[i] * srcScale + p[1] * dstScale);
+        p[2] = toUnorm8(span.b[i] * srcScale + p[2] * dstScale);
+        p[3] = toUnorm8(span.a[i] * srcScale + p[3] * dstScale);
+    }
+}
+
+void boxBlur(const uint32_t* src, int srcStep, uint32_t* dst, int dstStep, int n, int radius) {
+    if (n <= 0) {
+        return;
+    }
+    auto at = [&](int i) {
+        return src[static_cast<ptrdiff_t>(std::clamp(i, 0, n - 1)) * srcStep];
+    };
+    uint32_t sum[4] = {0, 0, 0, 0};
+    for (int i = -radius; i <= radius; i++) {
+        const uint32_t p = at(i);
+        for (int c = 0; c < 4; c++) {
+            sum[c] += (p >> (c * 8)) & 0xff;
+        }
+    }
+    const uint32_t window = 2 * radius + 1;
+    for (int i = 0; i < n; i++) {
+        uint32_t out = 0;
+        for (int c = 0; c < 4; c++) {
+            out |= ((sum[c] + window / 2) / window) << (c * 8);
+        }
+        dst[static_cast<ptrdiff_t>(i) * dstStep] = out;
+
+        const uint32_t leaving = at(i - radius);
+        const uint32_t entering = at(i + radius + 1);
+        for (int c = 0; c < 4; c++) {
+            sum[c] += ((entering >> (c * 8)) & 0xff) - ((leaving >> (c * 8)) & 0xff);
+        }
+    }
+}
+
+} // namespace cpu
+} // namespace renderengine
+} // namespace android
@@ -0,0 +1,141 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <math/mat4.h>
+#include <math/vec2.h>
+#include <math/vec4.h>
+#include <renderengine/private/Description.h>
+#include <ui/FloatRect.h>
+
+namespace android {
+namespace renderengine {
+namespace cpu {
+
+// The CPU backend shades a row of up to kSpanWidth pixels at a time. Every
+// channel lives in its own float array and each kernel below is a flat loop
+// over those arrays without cross-lane dependencies, so the compiler turns
+// them into NEON/SSE code rather than shading one pixel at a time. The
+// kernels mirror the fragment shaders generated by gl::ProgramCache.
+constexpr int kSpanWidth = 64;
+
+struct Span {
+    alignas(16) float r[kSpanWidth];
+    alignas(16) float g[kSpanWidth];
+    alignas(16) float b[kSpanWidth];
+    alignas(16) float a[kSpanWidth];
+};
+
+// A 2D affine map from output pixel coordinates into some other space, such
+// as layer or texture coordinates.
+struct AffineMap {
+    vec2 origin = vec2(0.0f, 0.0f);
+    vec2 dx = vec2(1.0f, 0.0f);
+    vec2 dy = vec2(0.0f, 1.0f);
+
+    // Builds the map from the x, y and translation terms of a 4x4 transform,
+    // ignoring any perspective.
+    static AffineMap fromMatrix(const mat4& m);
+    AffineMap then(const AffineMap& next) const;
+    float determinant() const { return dx.x * dy.y - dy.x * dx.y; }
+    // Only meaningful when the determinant is non-zero.
+    AffineMap inverse() const;
+    vec2 map(float x, float y) const { return origin + dx * x + dy * y; }
+
+    // Maps the centers of n pixels starting at (x, y).
+    void mapSpan(int32_t x, int32_t y, int n, float* outX, float* outY) const;
+};
+
+// Where to read texels from. stride is in pixels.
+struct TextureSampler {
+    const uint8_t* pixels = nullptr;
+    int32_t width = 0;
+    int32_t height = 0;
+    int32_t stride = 0;
+    bool swapRedBlue = false;
+    bool ignoreAlpha = false;
+    bool filter = false;
+};
+
+// Per-layer parameters of the color conversion applied after sampling,
+// matching the EOTF -> OutputTransform -> OETF -> DisplayColorMatrix chain of
+// the GLES shaders. HDR tone mapping, and with it the InputTransform step, is
+// not supported.
+struct ColorPipeline {
+    bool enabled = false;
+    // Divide out alpha around the transfer functions, for translucent
+    // premultiplied content.
+    bool unpremultiply = false;
+    Description::TransferFunction inputTransfer = Description::TransferFunction::LINEAR;
+    Description::TransferFunction outputTransfer = Description::TransferFunction::LINEAR;
+    // Layer color matrix combined with the gamut conversion; always clamped.
+    mat4 outputMatrix;
+    bool hasDisplayMatrix = false;
+    mat4 displayMatrix;
+};
+
+struct ShadowParams {
+    // Casting rectangle and corner radius, in layer space.
+    FloatRect caster;
+    float cornerRadius = 0.0f;
+    vec4 ambientColor;
+    vec4 spotColor;
+    // The spot shadow is the caster shape moved away from the light.
+    vec2 spotOffset = vec2(0.0f, 0.0f);
+    float ambientLength = 0.0f;
+    float spotLength = 0.0f;
+    // Fill the shadow under the caster too, for translucent casters.
+    bool fillCaster = false;
+};
+
+enum class BlendMode {
+    // Write the source as is, as with GL_BLEND disabled.
+    REPLACE,
+    // ONE, ONE_MINUS_SRC_ALPHA.
+    PREMULTIPLIED,
+    // SRC_ALPHA, ONE_MINUS_SRC_ALPHA.
+    STRAIGHT,
+};
+
+void fillSolid(Span& span, int n, const vec3& color);
+void sampleTexture(Span& span, int n, const float* u, const float* v,
+                   const TextureSampler& sampler);
+void applyAlpha(Span& span, int n, float alpha, bool premultiplied);
+void applyColorPipeline(Span& span, int n, const ColorPipeline& pipeline);
+
+// Sets mask to 1 for pixel centers inside bounds and 0 elsewhere, using the
+// same fill convention as GL rasterization.
+void computeBoundsMask(float* mask, int n, const float* x, const float* y, const FloatRect& bounds);
+// Fades out the corners of crop, with coordinates in the same space as crop.
+void applyCornerRadius(Span& span, int n, const float* x, const float* y, const FloatRect& crop,
+                       float radius, bool premultiplied);
+void shadeShadow(Span& span, int n, const float* x, const float* y, const ShadowParams& shadow);
+
+// Blends n shaded pixels onto an RGBA_8888 row, leaving pixels whose mask
+// is 0 untouched.
+void blendSpan(uint8_t* dst, const Span& span, const float* mask, int n, BlendMode mode);
+
+// Box-filters a line of n RGBA_8888 pixels from src into dst, with edges
+// clamped. Steps are the distances between neighbouring pixels, so the same
+// kernel handles rows and columns.
+void boxBlur(const uint32_t* src, int srcStep, uint32_t* dst, int dstStep, int n, int radius);
+
+} // namespace cpu
+} // namespace renderengine
+} // namespace android
@@ -22,6 +22,7 @@
 #include <sched.h>
 #include <cmath>
 #include <fstream>
+#include <iterator>
 #include <sstream>
 #include <unordered_set>
 
@@ -46,8 +47,8 @@
 #include "GLExtensions.h"
 #include "GLFramebuffer.h"
 #include "GLImage.h"
-#include "GLShadowVertexGenerator.h"
 #include "Program.h"
+#include "ProgramBinaryCache.h"
 #include "ProgramCache.h"
 #include "filters/BlurFilter.h"
 
@@ -66,6 +67,13 @@ bool checkGlError(const char* op, int lineNumber) {
 
 static constexpr bool outputDebugPPMs = false;
 
+// Enough for every shadow cast on a busy screen, including the shade and
+// freeform windows, while bounding the memory spent on meshes.
+static constexpr size_t kShadowCacheSize = 32;
+
+// Linked programs are kept here across boots, see ProgramBinaryCache.
+static const char* const kProgramBinaryCacheFile = "/data/misc/gpu/renderengine_program_cache";
+
 void writePPM(const char* basename, GLuint width, GLuint height) {
     ALOGV("writePPM #%s: %d x %d", basename, width, height);
 
@@ -263,6 +271,37 @@ std::unique_ptr<GLESRenderEngine> GLESRenderEngine::create(const RenderEngineCre
         ALOGE_IF(protectedDummy == EGL_NO_SURFACE, "can't create protected dummy pbuffer");
     }
 
+    ProgramCache& programCache = ProgramCache::getInstance();
+    if (extensions.hasProgramBinary()) {
+        GLint binaryFormats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &binaryFormats);
+        if (binaryFormats > 0) {
+            std::string driverVersion = std::string(extensions.getVendor()) + "/" +
+                    extensions.getRenderer() + "/" + extensions.getVersion();
+            programCache.setProgramBinaryCache(
+                    std::make_unique<ProgramBinaryCache>(kProgramBinaryCacheFile, driverVersion));
+        }
+    }
+
+    // Color managed variants are primed in the background on a context of
+    // their own, so that they do not delay the first frames.
+    EGLContext primeContext =
+            createEglContext(display, config, ctxt, false, Protection::UNPROTECTED);
+    EGLSurface primeDummy = EGL_NO_SURFACE;
+    if (primeContext != EGL_NO_CONTEXT && !extensions.hasSurfacelessContext()) {
+        primeDummy = createDummyEglPbufferSurface(display, config, args.pixelFormat,
+                                                  Protection::UNPROTECTED);
+    }
+    if (primeContext != EGL_NO_CONTEXT &&
+        (primeDummy != EGL_NO_SURFACE || extensions.hasSurfacelessContext())) {
+        programCache.setPrimeContext(display, primeContext, primeDummy);
+    } else {
+        ALOGW("Can't create a context for priming shaders, priming them all up front");
+        if (primeContext != EGL_NO_CONTEXT) {
+            eglDestroyContext(display, primeContext);
+        }
+    }
+
     // now figure out what version of GL did we actually get
     GlesVersion version = parseGlesVersion(extensions.getVersion());
 
@@ -345,6 +384,7 @@ GLESRenderEngine::GLESRenderEngine(const RenderEngineCreationArgs& args, EGLDisp
         mProtectedDummySurface(protectedDummy),
         mVpWidth(0),
         mVpHeight(0),
+        mShadowCache(kShadowCacheSize),
         mFramebufferImageCacheSize(args.imageCacheSize),
         mUseColorManagement(args.useColorManagement) {
     glGetIntegerv(GL_MAX_TEXTURE_SIZE, &mMaxTextureSize);
@@ -431,6 +471,8 @@ GLESRenderEngine::GLESRenderEngine(const RenderEngineCreationArgs& args, EGLDisp
 GLESRenderEngine::~GLESRenderEngine() {
     // Destroy the image manager first.
     mImageManager = nullptr;
+    // Priming uses the display too, and the cache outlives this engine.
+    ProgramCache::getInstance().releaseEngineResources();
     std::lock_guard<std::mutex> lock(mRenderingMutex);
     unbindFrameBuffer(mDrawingBuffer.get());
     mDrawingBuffer = nullptr;
@@ -1051,6 +1093,8 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         return BAD_VALUE;
     }
 
+    mDrawCalls = 0;
+
     std::unique_ptr<BindNativeBufferAsFramebuffer> fbo;
     // Gathering layers that requested blur, we'll need them to decide when to render to an
     // offscreen buffer, and when to render to the native buffer.
@@ -1073,6 +1117,9 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
     const auto blurLayersSize = blurLayers.size();
 
     if (blurLayersSize == 0) {
+        if (mBlurFilter != nullptr) {
+            mBlurFilter->clearCache();
+        }
         fbo = std::make_unique<BindNativeBufferAsFramebuffer>(*this, buffer, useFramebufferCache);
         if (fbo->getStatus() != NO_ERROR) {
             ALOGE("Failed to bind framebuffer! Aborting GPU composition for buffer (%p).",
@@ -1083,8 +1130,7 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         setViewportAndProjection(display.physicalDisplay, display.clip);
     } else {
         setViewportAndProjection(display.physicalDisplay, display.clip);
-        auto status =
-                mBlurFilter->setAsDrawTarget(display, blurLayers.front()->backgroundBlurRadius);
+        auto status = mBlurFilter->setAsDrawTarget(display);
         if (status != NO_ERROR) {
             ALOGE("Failed to prepare blur filter! Aborting GPU composition for buffer (%p).",
                   buffer->handle);
@@ -1118,11 +1164,12 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
                         .setTexCoords(2 /* size */)
                         .setCropCoords(2 /* size */)
                         .build();
-    for (auto const layer : layers) {
+    for (size_t i = 0; i < layers.size(); i++) {
+        const LayerSettings* const layer = layers[i];
         if (blurLayers.size() > 0 && blurLayers.front() == layer) {
             blurLayers.pop_front();
 
-            auto status = mBlurFilter->prepare();
+            auto status = mBlurFilter->prepare(*layer, projectionMatrix);
             if (status != NO_ERROR) {
                 ALOGE("Failed to render blur effect! Aborting GPU composition for buffer (%p).",
                       buffer->handle);
@@ -1136,12 +1183,9 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
                                                                       useFramebufferCache);
                 status = fbo->getStatus();
                 setViewportAndProjection(display.physicalDisplay, display.clip);
-            } else {
-                // There's still something else to blur, so let's keep rendering to our FBO
-                // instead of to the display.
-                status = mBlurFilter->setAsDrawTarget(display,
-                                                      blurLayers.front()->backgroundBlurRadius);
             }
+            // Otherwise there's still something else to blur, so the blur filter keeps
+            // rendering to our FBO instead of to the display.
             if (status != NO_ERROR) {
                 ALOGE("Failed to bind framebuffer! Aborting GPU composition for buffer (%p).",
                       buffer->handle);
@@ -1160,6 +1204,18 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
             blurredLayers += 1;
         }
 
+        const size_t batchSize = getSolidColorBatchSize(layers, i, blurLayers);
+        if (!blurLayers.empty()) {
+            for (size_t j = i; j < i + batchSize; j++) {
+                mBlurFilter->addLayer(*layers[j], projectionMatrix);
+            }
+        }
+        if (batchSize > 1) {
+            drawSolidColorLayers(projectionMatrix, &layers[i], batchSize);
+            i += batchSize - 1;
+            continue;
+        }
+
         mState.maxMasteringLuminance = layer->source.buffer.maxMasteringLuminance;
         mState.maxContentLuminance = layer->source.buffer.maxContentLuminance;
         mState.projectionMatrix = projectionMatrix * layer->geometry.positionTransform;
@@ -1256,11 +1312,97 @@ status_t GLESRenderEngine::drawLayers(const DisplaySettings& display,
         mLastDrawFence = new Fence(dup(drawFence->get()));
     }
     mPriorResourcesCleaned = false;
+    mLastFrameDrawCalls = mDrawCalls;
+    mLastFrameBlurredPixels = blurLayersSize > 0 ? mBlurFilter->getBlurredPixels() : 0;
 
     checkErrors();
     return NO_ERROR;
 }
 
+static bool isBatchableSolidColorLayer(const LayerSettings& layer) {
+    return layer.source.buffer.buffer == nullptr && layer.shadow.length <= 0.0f &&
+            layer.geometry.roundedCornersRadius <= 0.0f;
+}
+
+size_t GLESRenderEngine::getSolidColorBatchSize(
+        const std::vector<const LayerSettings*>& layers, size_t first,
+        const std::deque<const LayerSettings*>& blurLayers) const {
+    const LayerSettings& head = *layers[first];
+    if (!mLayerBatchingEnabled || !isBatchableSolidColorLayer(head)) {
+        return 1;
+    }
+
+    size_t count = 1;
+    for (size_t i = first + 1; i < layers.size(); i++) {
+        const LayerSettings& layer = *layers[i];
+        // A blur layer changes the draw target before it is drawn.
+        if (!blurLayers.empty() && blurLayers.front() == &layer) {
+            break;
+        }
+        if (!isBatchableSolidColorLayer(layer) || layer.disableBlending != head.disableBlending ||
+            layer.sourceDataspace != head.sourceDataspace ||
+            layer.colorTransform != head.colorTransform ||
+            layer.source.buffer.maxMasteringLuminance != head.source.buffer.maxMasteringLuminance ||
+            layer.source.buffer.maxContentLuminance != head.source.buffer.maxContentLuminance) {
+            break;
+        }
+        count++;
+    }
+    return count;
+}
+
+void GLESRenderEngine::drawSolidColorLayers(const mat4& projectionMatrix,
+                                            const LayerSettings* const* layers, size_t count) {
+    ATRACE_CALL();
+    // Each layer has its own position transform, so positions are transformed
+    // here and the projection is shared. Colors go with the vertices.
+    static constexpr size_t kQuadVertices[] = {0, 1, 2, 0, 2, 3};
+    static constexpr size_t kVerticesPerLayer = std::size(kQuadVertices);
+    Mesh mesh = Mesh::Builder()
+                        .setPrimitive(Mesh::TRIANGLES)
+                        .setVertices(count * kVerticesPerLayer, 4 /* size */)
+                        .setColors(4 /* size */)
+                        .build();
+    Mesh::VertexArray<vec4> position(mesh.getPositionArray<vec4>());
+    Mesh::VertexArray<vec4> colors(mesh.getColorArray<vec4>());
+    for (size_t i = 0; i < count; i++) {
+        const LayerSettings& layer = *layers[i];
+        const mat4& transform = layer.geometry.positionTransform;
+        const FloatRect& bounds = layer.geometry.boundaries;
+        const vec4 corners[] = {
+                transform * vec4(bounds.left, bounds.top, 0.0f, 1.0f),
+                transform * vec4(bounds.left, bounds.bottom, 0.0f, 1.0f),
+                transform * vec4(bounds.right, bounds.bottom, 0.0f, 1.0f),
+                transform * vec4(bounds.right, bounds.top, 0.0f, 1.0f),
+        };
+        const half3 solidColor = layer.source.solidColor;
+        // Rounded through half4 like the color uniform, so the output matches.
+        const vec4 color(half4(solidColor.r, solidColor.g, solidColor.b, layer.alpha));
+        for (size_t j = 0; j < kVerticesPerLayer; j++) {
+            position[i * kVerticesPerLayer + j] = corners[kQuadVertices[j]];
+            colors[i * kVerticesPerLayer + j] = color;
+        }
+    }
+
+    const LayerSettings& head = *layers[0];
+    mState.maxMasteringLuminance = head.source.buffer.maxMasteringLuminance;
+    mState.maxContentLuminance = head.source.buffer.maxContentLuminance;
+    mState.projectionMatrix = projectionMatrix;
+    setColorTransform(head.colorTransform);
+    // The alpha is only used to pick blending, which solid color layers always need.
+    setupLayerBlending(true /* premultipliedAlpha */, false /* opaque */,
+                       true /* disableTexture */, half4(head.source.solidColor, head.alpha),
+                       0.0f /* cornerRadius */);
+    if (head.disableBlending) {
+        glDisable(GL_BLEND);
+    }
+    setSourceDataSpace(head.sourceDataspace);
+
+    mState.vertexColor = true;
+    drawMesh(mesh);
+    mState.vertexColor = false;
+}
+
 void GLESRenderEngine::setViewportAndProjection(Rect viewport, Rect clip) {
     ATRACE_CALL();
     mVpWidth = viewport.getWidth();
@@ -1379,6 +1521,12 @@ void GLESRenderEngine::drawMesh(const Mesh& mesh) {
                               mesh.getByteStride(), mesh.getShadowParams());
     }
 
+    if (mState.vertexColor) {
+        glEnableVertexAttribArray(Program::layerColor);
+        glVertexAttribPointer(Program::layerColor, mesh.getColorSize(), GL_FLOAT, GL_FALSE,
+                              mesh.getByteStride(), mesh.getColors());
+    }
+
     Description managedState = mState;
     // By default, DISPLAY_P3 is the only supported wide color output. However,
     // when HDR content is present, hardware composer may be able to handle
@@ -1487,6 +1635,7 @@ void GLESRenderEngine::drawMesh(const Mesh& mesh) {
     } else {
         glDrawArrays(mesh.getPrimitive(), 0, mesh.getVertexCount());
     }
+    mDrawCalls++;
 
     if (mUseColorManagement && outputDebugPPMs) {
         static uint64_t managedColorFrameCount = 0;
@@ -1507,6 +1656,10 @@ void GLESRenderEngine::drawMesh(const Mesh& mesh) {
         glDisableVertexAttribArray(Program::shadowColor);
         glDisableVertexAttribArray(Program::shadowParams);
     }
+
+    if (mState.vertexColor) {
+        glDisableVertexAttribArray(Program::layerColor);
+    }
 }
 
 size_t GLESRenderEngine::getMaxTextureSize() const {
@@ -1533,6 +1686,7 @@ void GLESRenderEngine::dump(std::string& result) {
                   cache.getSize(mEGLContext));
     StringAppendF(&result, "RenderEngine program cache size for protected context: %zu\n",
                   cache.getSize(mProtectedEGLContext));
+    cache.dump(result);
     StringAppendF(&result, "RenderEngine last dataspace conversion: (%s) to (%s)\n",
                   dataspaceDetails(static_cast<android_dataspace>(mDataSpace)).c_str(),
                   dataspaceDetails(static_cast<android_dataspace>(mOutputDataSpace)).c_str());
@@ -1553,6 +1707,11 @@ void GLESRenderEngine::dump(std::string& result) {
             StringAppendF(&result, "0x%" PRIx64 "\n", id);
         }
     }
+    mShadowCache.dump(result);
+    StringAppendF(&result, "RenderEngine draw calls in last frame: %zu\n",
+                  mLastFrameDrawCalls.load());
+    StringAppendF(&result, "RenderEngine blurred pixels in last frame: %zu\n",
+                  mLastFrameBlurredPixels.load());
 }
 
 GLESRenderEngine::GlesVersion GLESRenderEngine::parseGlesVersion(const char* str) {
@@ -1755,24 +1914,10 @@ void GLESRenderEngine::handleShadow(const FloatRect& casterRect, float casterCor
                                     const ShadowSettings& settings) {
     ATRACE_CALL();
     const float casterZ = settings.length / 2.0f;
-    const GLShadowVertexGenerator shadows(casterRect, casterCornerRadius, casterZ,
-                                          settings.casterIsTranslucent, settings.ambientColor,
-                                          settings.spotColor, settings.lightPos,
-                                          settings.lightRadius);
-
-    // setup mesh for both shadows
-    Mesh mesh = Mesh::Builder()
-                        .setPrimitive(Mesh::TRIANGLES)
-                        .setVertices(shadows.getVertexCount(), 2 /* size */)
-                        .setShadowAttrs()
-                        .setIndices(shadows.getIndexCount())
-                        .build();
-
-    Mesh::VertexArray<vec2> position = mesh.getPositionArray<vec2>();
-    Mesh::VertexArray<vec4> shadowColor = mesh.getShadowColorArray<vec4>();
-    Mesh::VertexArray<vec3> shadowParams = mesh.getShadowParamsArray<vec3>();
-    shadows.fillVertices(position, shadowColor, shadowParams);
-    shadows.fillIndices(mesh.getIndicesArray());
+    const Mesh& mesh = mShadowCache.getMesh({casterRect, casterCornerRadius, casterZ,
+                                             settings.casterIsTranslucent, settings.ambientColor,
+                                             settings.spotColor, settings.lightPos,
+                                             settings.lightRadius});
 
     mState.cornerRadius = 0.0f;
     mState.drawShadows = true;
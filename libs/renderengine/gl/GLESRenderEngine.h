@@ -17,6 +17,7 @@
 #ifndef SF_GLESRENDERENGINE_H_
 #define SF_GLESRENDERENGINE_H_
 
+#include <atomic>
 #include <condition_variable>
 #include <deque>
 #include <mutex>
@@ -31,6 +32,7 @@
 #include <renderengine/RenderEngine.h>
 #include <renderengine/private/Description.h>
 #include <sys/types.h>
+#include "GLShadowCache.h"
 #include "GLShadowTexture.h"
 #include "ImageManager.h"
 
@@ -100,6 +102,12 @@ public:
     std::shared_ptr<ImageManager::Barrier> cacheExternalTextureBufferForTesting(
             const sp<GraphicBuffer>& buffer);
     std::shared_ptr<ImageManager::Barrier> unbindExternalTextureBufferForTesting(uint64_t bufferId);
+    // Draws every layer on its own, so that batched output can be compared against it.
+    void setLayerBatchingEnabledForTesting(bool enabled) { mLayerBatchingEnabled = enabled; }
+    // Returns the number of draw calls issued by the last drawLayers()
+    size_t getLastFrameDrawCallsForTesting() const { return mLastFrameDrawCalls; }
+    // Returns the number of downsampled pixels blurred by the last drawLayers()
+    size_t getLastFrameBlurredPixelsForTesting() const { return mLastFrameBlurredPixels; }
 
 protected:
     Framebuffer* getFramebufferForDrawing() override;
@@ -153,6 +161,13 @@ private:
     // blending is an expensive operation, we want to turn off blending when it's not necessary.
     void handleRoundedCorners(const DisplaySettings& display, const LayerSettings& layer,
                               const Mesh& mesh);
+    // Returns how many layers starting at layers[first] can be drawn in one
+    // call by drawSolidColorLayers(). Only layers that are next to each other
+    // are merged, so the blending order is kept.
+    size_t getSolidColorBatchSize(const std::vector<const LayerSettings*>& layers, size_t first,
+                                  const std::deque<const LayerSettings*>& blurLayers) const;
+    void drawSolidColorLayers(const mat4& projectionMatrix, const LayerSettings* const* layers,
+                              size_t count);
     base::unique_fd flush();
     bool finish();
     bool waitFence(base::unique_fd fenceFd);
@@ -191,6 +206,14 @@ private:
     GLuint mVpHeight;
     Description mState;
     GLShadowTexture mShadowTexture;
+    // Shadows usually stay put across frames, so keep their meshes around.
+    GLShadowCache mShadowCache;
+    bool mLayerBatchingEnabled = true;
+    // Draw calls issued so far in the current frame, and in the last one.
+    size_t mDrawCalls = 0;
+    std::atomic<size_t> mLastFrameDrawCalls = 0;
+    // Pixels of the downsampled composition blurred in the last frame.
+    std::atomic<size_t> mLastFrameBlurredPixels = 0;
 
     mat4 mSrgbToXyz;
     mat4 mDisplayP3ToXyz;
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GLShadowCache.h"
+
+#include <functional>
+
+#include <android-base/stringprintf.h>
+
+#include "GLShadowVertexGenerator.h"
+
+namespace android {
+namespace renderengine {
+namespace gl {
+
+using base::StringAppendF;
+
+bool GLShadowCache::Key::operator==(const Key& other) const {
+    return casterRect == other.casterRect && casterCornerRadius == other.casterCornerRadius &&
+            casterZ == other.casterZ && casterIsTranslucent == other.casterIsTranslucent &&
+            ambientColor == other.ambientColor && spotColor == other.spotColor &&
+            lightPosition == other.lightPosition && lightRadius == other.lightRadius;
+}
+
+size_t GLShadowCache::KeyHasher::operator()(const Key& key) const {
+    const float values[] = {
+            key.casterRect.left,    key.casterRect.top,     key.casterRect.right,
+            key.casterRect.bottom,  key.casterCornerRadius, key.casterZ,
+            key.ambientColor.a,     key.spotColor.a,        key.lightPosition.x,
+            key.lightPosition.y,    key.lightPosition.z,    key.lightRadius,
+    };
+    size_t hash = std::hash<bool>()(key.casterIsTranslucent);
+    for (float value : values) {
+        hash = hash * 31 + std::hash<float>()(value);
+    }
+    return hash;
+}
+
+// Mesh can be neither copied nor moved, so it is built in place in its entry.
+GLShadowCache::Entry::Entry(const Key& key, const GLShadowVertexGenerator& shadows)
+      : key(key),
+        // setup mesh for both shadows
+        mesh(Mesh::Builder()
+                     .setPrimitive(Mesh::TRIANGLES)
+                     .setVertices(shadows.getVertexCount(), 2 /* size */)
+                     .setShadowAttrs()
+                     .setIndices(shadows.getIndexCount())
+                     .build()) {
+    Mesh::VertexArray<vec2> position = mesh.getPositionArray<vec2>();
+    Mesh::VertexArray<vec4> shadowColor = mesh.getShadowColorArray<vec4>();
+    Mesh::VertexArray<vec3> shadowParams = mesh.getShadowParamsArray<vec3>();
+    shadows.fillVertices(position, shadowColor, shadowParams);
+    shadows.fillIndices(mesh.getIndicesArray());
+}
+
+GLShadowCache::GLShadowCache(size_t capacity) : mCapacity(capacity) {}
+
+const Mesh& GLShadowCache::getMesh(const Key& key) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mIndex.find(key);
+    if (it != mIndex.end()) {
+        mHits++;
+        mEntries.splice(mEntries.begin(), mEntries, it->second);
+        return it->second->mesh;
+    }
+
+    mMisses++;
+    if (mEntries.size() >= mCapacity && !mEntries.empty()) {
+        mIndex.erase(mEntries.back().key);
+        mEntries.pop_back();
+    }
+    mEntries.emplace_front(key,
+                           GLShadowVertexGenerator(key.casterRect, key.casterCornerRadius,
+                                                   key.casterZ, key.casterIsTranslucent,
+                                                   key.ambientColor, key.spotColor,
+                                                   key.lightPosition, key.lightRadius));
+    mIndex.emplace(key, mEntries.begin());
+    return mEntries.front().mesh;
+}
+
+size_t GLShadowCache::getSize() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+size_t GLShadowCache::getHitCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mHits;
+}
+
+size_t GLShadowCache::getMissCount() const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mMisses;
+}
+
+void GLShadowCache::dump(std::string& result) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    StringAppendF(&result, "RenderEngine shadow cache size: %zu/%zu, hits: %zu, misses: %zu\n",
+                  mEntries.size(), mCapacity, mHits, mMisses);
+}
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
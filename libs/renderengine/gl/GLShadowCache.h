@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <android-base/thread_annotations.h>
+#include <math/vec3.h>
+#include <math/vec4.h>
+#include <renderengine/Mesh.h>
+#include <ui/FloatRect.h>
+
+namespace android {
+namespace renderengine {
+namespace gl {
+
+class GLShadowVertexGenerator;
+
+/**
+ * Keeps the tessellated meshes of recently drawn shadows, so that a caster
+ * whose geometry and light did not change since the last frames is not
+ * tessellated again by GLShadowVertexGenerator.
+ *
+ * Meshes are keyed on every input of the tessellation and evicted least
+ * recently used first. Only the thread drawing with the cache may call
+ * getMesh(); the stats can be read from any thread.
+ */
+class GLShadowCache {
+public:
+    struct Key {
+        FloatRect casterRect;
+        float casterCornerRadius;
+        float casterZ;
+        bool casterIsTranslucent;
+        vec4 ambientColor;
+        vec4 spotColor;
+        vec3 lightPosition;
+        float lightRadius;
+
+        bool operator==(const Key& other) const;
+    };
+
+    explicit GLShadowCache(size_t capacity);
+
+    // Returns the mesh for the given shadow, tessellating it on a miss. The
+    // mesh stays valid until the next call.
+    const Mesh& getMesh(const Key& key) EXCLUDES(mMutex);
+
+    size_t getSize() const EXCLUDES(mMutex);
+    size_t getHitCount() const EXCLUDES(mMutex);
+    size_t getMissCount() const EXCLUDES(mMutex);
+    void dump(std::string& result) const EXCLUDES(mMutex);
+
+private:
+    struct KeyHasher {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        Entry(const Key& key, const GLShadowVertexGenerator& shadows);
+
+        const Key key;
+        Mesh mesh;
+    };
+
+    const size_t mCapacity;
+
+    mutable std::mutex mMutex;
+    // Most recently used first. Entries are never moved once created, as
+    // Mesh cannot be copied.
+    std::list<Entry> mEntries GUARDED_BY(mMutex);
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHasher> mIndex GUARDED_BY(mMutex);
+    size_t mHits GUARDED_BY(mMutex) = 0;
+    size_t mMisses GUARDED_BY(mMutex) = 0;
+};
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
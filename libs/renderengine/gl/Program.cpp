@@ -18,6 +18,7 @@
 
 #include <stdint.h>
 
+#include <GLES2/gl2ext.h>
 #include <log/log.h>
 #include <math/mat4.h>
 #include <utils/String8.h>
@@ -39,6 +40,7 @@ Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const c
     glBindAttribLocation(programId, cropCoords, "cropCoords");
     glBindAttribLocation(programId, shadowColor, "shadowColor");
     glBindAttribLocation(programId, shadowParams, "shadowParams");
+    glBindAttribLocation(programId, layerColor, "layerColor");
     glLinkProgram(programId);
 
     GLint status;
@@ -58,30 +60,62 @@ Program::Program(const ProgramCache::Key& /*needs*/, const char* vertex, const c
         glDeleteShader(fragmentId);
         glDeleteProgram(programId);
     } else {
-        mProgram = programId;
         mVertexShader = vertexId;
         mFragmentShader = fragmentId;
-        mInitialized = true;
-        mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
-        mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
-        mSamplerLoc = glGetUniformLocation(programId, "sampler");
-        mColorLoc = glGetUniformLocation(programId, "color");
-        mDisplayColorMatrixLoc = glGetUniformLocation(programId, "displayColorMatrix");
-        mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
-        mMaxMasteringLuminanceLoc = glGetUniformLocation(programId, "maxMasteringLuminance");
-        mMaxContentLuminanceLoc = glGetUniformLocation(programId, "maxContentLuminance");
-        mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
-        mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
-        mCornerRadiusLoc = glGetUniformLocation(programId, "cornerRadius");
-        mCropCenterLoc = glGetUniformLocation(programId, "cropCenter");
-
-        // set-up the default values for our uniforms
-        glUseProgram(programId);
-        glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
-        glEnableVertexAttribArray(0);
+        initialize(programId);
     }
 }
 
+Program::Program(const ProgramCache::Key& /*needs*/, const ProgramBinaryCache::Binary& binary)
+      : mInitialized(false), mVertexShader(0), mFragmentShader(0) {
+    GLuint programId = glCreateProgram();
+    glProgramBinaryOES(programId, binary.format, binary.data.data(), binary.data.size());
+
+    // Binaries are rejected when the driver changed in a way that the cache
+    // key did not catch. This is not an error, the caller compiles instead.
+    GLint status;
+    glGetProgramiv(programId, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        ALOGD("Program binary rejected by the driver");
+        glDeleteProgram(programId);
+    } else {
+        initialize(programId);
+    }
+}
+
+void Program::initialize(GLuint programId) {
+    mProgram = programId;
+    mInitialized = true;
+    mProjectionMatrixLoc = glGetUniformLocation(programId, "projection");
+    mTextureMatrixLoc = glGetUniformLocation(programId, "texture");
+    mSamplerLoc = glGetUniformLocation(programId, "sampler");
+    mColorLoc = glGetUniformLocation(programId, "color");
+    mDisplayColorMatrixLoc = glGetUniformLocation(programId, "displayColorMatrix");
+    mDisplayMaxLuminanceLoc = glGetUniformLocation(programId, "displayMaxLuminance");
+    mMaxMasteringLuminanceLoc = glGetUniformLocation(programId, "maxMasteringLuminance");
+    mMaxContentLuminanceLoc = glGetUniformLocation(programId, "maxContentLuminance");
+    mInputTransformMatrixLoc = glGetUniformLocation(programId, "inputTransformMatrix");
+    mOutputTransformMatrixLoc = glGetUniformLocation(programId, "outputTransformMatrix");
+    mCornerRadiusLoc = glGetUniformLocation(programId, "cornerRadius");
+    mCropCenterLoc = glGetUniformLocation(programId, "cropCenter");
+
+    // set-up the default values for our uniforms
+    glUseProgram(programId);
+    glUniformMatrix4fv(mProjectionMatrixLoc, 1, GL_FALSE, mat4().asArray());
+    glEnableVertexAttribArray(0);
+}
+
+bool Program::getBinary(ProgramBinaryCache::Binary* binary) const {
+    GLint length = 0;
+    glGetProgramiv(mProgram, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+    if (length <= 0) {
+        return false;
+    }
+    binary->data.resize(length);
+    glGetProgramBinaryOES(mProgram, length, nullptr, &binary->format, binary->data.data());
+    return glGetError() == GL_NO_ERROR;
+}
+
 bool Program::isValid() const {
     return mInitialized;
 }
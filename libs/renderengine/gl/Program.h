@@ -21,6 +21,7 @@
 
 #include <GLES2/gl2.h>
 #include <renderengine/private/Description.h>
+#include "ProgramBinaryCache.h"
 #include "ProgramCache.h"
 
 namespace android {
@@ -51,9 +52,14 @@ public:
 
         /* Shadow params */
         shadowParams = 4,
+
+        /* Layer color, when several solid color layers are drawn at once */
+        layerColor = 5,
     };
 
     Program(const ProgramCache::Key& needs, const char* vertex, const char* fragment);
+    /* Loads a program previously linked from the same sources; check isValid() */
+    Program(const ProgramCache::Key& needs, const ProgramBinaryCache::Binary& binary);
     ~Program() = default;
 
     /* whether this object is usable */
@@ -71,8 +77,12 @@ public:
     /* set-up uniforms from the description */
     void setUniforms(const Description& desc);
 
+    /* reads back the linked program, to load it with the constructor above later */
+    bool getBinary(ProgramBinaryCache::Binary* binary) const;
+
 private:
     GLuint buildShader(const char* source, GLenum type);
+    void initialize(GLuint programId);
 
     // whether the initialization succeeded
     bool mInitialized;
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ProgramBinaryCache.h"
+
+#include <cstring>
+
+#include <FileBlobCache.h>
+
+namespace android {
+namespace renderengine {
+namespace gl {
+
+// The key holds the driver version strings, which can be long.
+static constexpr size_t kMaxKeySize = 2 * 1024;
+static constexpr size_t kMaxValueSize = 256 * 1024;
+static constexpr size_t kMaxTotalSize = 4 * 1024 * 1024;
+
+ProgramBinaryCache::ProgramBinaryCache(const std::string& filename,
+                                       const std::string& driverVersion)
+      : mDriverVersion(driverVersion),
+        mBlobCache(std::make_unique<FileBlobCache>(kMaxKeySize, kMaxValueSize, kMaxTotalSize,
+                                                   filename)) {}
+
+ProgramBinaryCache::~ProgramBinaryCache() = default;
+
+std::vector<uint8_t> ProgramBinaryCache::getBlobKey(uint32_t key, size_t sourceHash) const {
+    std::vector<uint8_t> blobKey(sizeof(key) + sizeof(sourceHash) + mDriverVersion.size());
+    uint8_t* out = blobKey.data();
+    memcpy(out, &key, sizeof(key));
+    out += sizeof(key);
+    memcpy(out, &sourceHash, sizeof(sourceHash));
+    out += sizeof(sourceHash);
+    memcpy(out, mDriverVersion.data(), mDriverVersion.size());
+    return blobKey;
+}
+
+bool ProgramBinaryCache::get(uint32_t key, size_t sourceHash, Binary* binary) {
+    const std::vector<uint8_t> blobKey = getBlobKey(key, sourceHash);
+    std::lock_guard<std::mutex> lock(mMutex);
+    const size_t size = mBlobCache->get(blobKey.data(), blobKey.size(), nullptr, 0);
+    if (size <= sizeof(binary->format)) {
+        return false;
+    }
+
+    std::vector<uint8_t> value(size);
+    if (mBlobCache->get(blobKey.data(), blobKey.size(), value.data(), value.size()) != size) {
+        return false;
+    }
+    memcpy(&binary->format, value.data(), sizeof(binary->format));
+    binary->data.assign(value.begin() + sizeof(binary->format), value.end());
+    return true;
+}
+
+void ProgramBinaryCache::set(uint32_t key, size_t sourceHash, const Binary& binary) {
+    if (binary.data.empty()) {
+        return;
+    }
+    const std::vector<uint8_t> blobKey = getBlobKey(key, sourceHash);
+    std::vector<uint8_t> value(sizeof(binary.format) + binary.data.size());
+    memcpy(value.data(), &binary.format, sizeof(binary.format));
+    memcpy(value.data() + sizeof(binary.format), binary.data.data(), binary.data.size());
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBlobCache->set(blobKey.data(), blobKey.size(), value.data(), value.size());
+    mDirty = true;
+}
+
+void ProgramBinaryCache::save() {
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (mDirty) {
+        mBlobCache->writeToFile();
+        mDirty = false;
+    }
+}
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
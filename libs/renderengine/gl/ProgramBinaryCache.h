@@ -0,0 +1,74 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <GLES2/gl2.h>
+#include <android-base/thread_annotations.h>
+
+namespace android {
+
+class FileBlobCache;
+
+namespace renderengine {
+namespace gl {
+
+/**
+ * Persists linked program binaries across boots, so that priming the
+ * ProgramCache only compiles shaders the first time a driver sees them.
+ *
+ * Binaries are keyed on the ProgramCache key, a hash of the shader sources
+ * and the driver version, so that a binary is never handed to a driver, or
+ * used for shaders, other than the ones it was built with. The cache may be
+ * used from several threads.
+ */
+class ProgramBinaryCache {
+public:
+    struct Binary {
+        GLenum format = 0;
+        std::vector<uint8_t> data;
+    };
+
+    // Loads the binaries previously saved to filename, if any.
+    ProgramBinaryCache(const std::string& filename, const std::string& driverVersion);
+    ~ProgramBinaryCache();
+
+    // Returns false if no binary is stored for the program.
+    bool get(uint32_t key, size_t sourceHash, Binary* binary) EXCLUDES(mMutex);
+    void set(uint32_t key, size_t sourceHash, const Binary& binary) EXCLUDES(mMutex);
+
+    // Writes the cache back to its file if binaries were added since it was
+    // loaded or last saved.
+    void save() EXCLUDES(mMutex);
+
+private:
+    std::vector<uint8_t> getBlobKey(uint32_t key, size_t sourceHash) const;
+
+    const std::string mDriverVersion;
+
+    std::mutex mMutex;
+    std::unique_ptr<FileBlobCache> mBlobCache GUARDED_BY(mMutex);
+    bool mDirty GUARDED_BY(mMutex) = false;
+};
+
+} // namespace gl
+} // namespace renderengine
+} // namespace android
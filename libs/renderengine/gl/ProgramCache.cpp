@@ -18,13 +18,19 @@
 
 #include "ProgramCache.h"
 
+#include <pthread.h>
+
+#include <string_view>
+
 #include <GLES2/gl2.h>
 #include <GLES2/gl2ext.h>
+#include <android-base/stringprintf.h>
 #include <log/log.h>
 #include <renderengine/private/Description.h>
 #include <utils/String8.h>
 #include <utils/Trace.h>
 #include "Program.h"
+#include "ProgramBinaryCache.h"
 
 ANDROID_SINGLETON_STATIC_INSTANCE(android::renderengine::gl::ProgramCache)
 
@@ -32,6 +38,8 @@ namespace android {
 namespace renderengine {
 namespace gl {
 
+using base::StringAppendF;
+
 /*
  * A simple formatter class to automatically add the endl and
  * manage the indentation.
@@ -77,10 +85,53 @@ Formatter& dedent(Formatter& f) {
     return f;
 }
 
+ProgramCache::~ProgramCache() {
+    waitForPrimeCache();
+}
+
+void ProgramCache::setProgramBinaryCache(std::unique_ptr<ProgramBinaryCache> binaryCache) {
+    mBinaryCache = std::move(binaryCache);
+}
+
+void ProgramCache::setPrimeContext(EGLDisplay display, EGLContext context, EGLSurface surface) {
+    waitForPrimeCache();
+    std::lock_guard<std::mutex> lock(mPrimeMutex);
+    mPrimeDisplay = display;
+    mPrimeContext = context;
+    mPrimeSurface = surface;
+}
+
+void ProgramCache::waitForPrimeCache() {
+    std::lock_guard<std::mutex> lock(mPrimeMutex);
+    if (mPrimeThread.joinable()) {
+        mPrimeThread.join();
+    }
+}
+
+void ProgramCache::releaseEngineResources() {
+    std::lock_guard<std::mutex> lock(mPrimeMutex);
+    if (mPrimeThread.joinable()) {
+        mPrimeThread.join();
+    }
+    if (mPrimeContext != EGL_NO_CONTEXT) {
+        if (mPrimeSurface != EGL_NO_SURFACE) {
+            eglDestroySurface(mPrimeDisplay, mPrimeSurface);
+        }
+        eglDestroyContext(mPrimeDisplay, mPrimeContext);
+    }
+    mPrimeDisplay = EGL_NO_DISPLAY;
+    mPrimeContext = EGL_NO_CONTEXT;
+    mPrimeSurface = EGL_NO_SURFACE;
+    // Only used while priming, which is done.
+    mBinaryCache = nullptr;
+}
+
 void ProgramCache::primeCache(
         EGLContext context, bool useColorManagement, bool toneMapperShaderOnly) {
-    auto& cache = mCaches[context];
-    uint32_t shaderCount = 0;
+    std::vector<Key> keys;
+    // Only needed once color managed or HDR content shows up, so these can
+    // be built off the composition thread.
+    std::vector<Key> colorManagedKeys;
 
     if (toneMapperShaderOnly) {
         Key shaderKey;
@@ -101,61 +152,151 @@ void ProgramCache::primeCache(
             // Cache Y410 input on or off
             shaderKey.set(Key::Y410_BT2020_MASK, (i & 2) ?
                     Key::Y410_BT2020_ON : Key::Y410_BT2020_OFF);
-            if (cache.count(shaderKey) == 0) {
-                cache.emplace(shaderKey, generateProgram(shaderKey));
-                shaderCount++;
+            colorManagedKeys.push_back(shaderKey);
+        }
+    } else {
+        uint32_t keyMask = Key::BLEND_MASK | Key::OPACITY_MASK | Key::ALPHA_MASK |
+                Key::TEXTURE_MASK | Key::ROUNDED_CORNERS_MASK;
+        // Prime the cache for all combinations of the above masks,
+        // leaving off the experimental color matrix mask options.
+        for (uint32_t keyVal = 0; keyVal <= keyMask; keyVal++) {
+            Key shaderKey;
+            shaderKey.set(keyMask, keyVal);
+            uint32_t tex = shaderKey.getTextureTarget();
+            if (tex != Key::TEXTURE_OFF && tex != Key::TEXTURE_EXT && tex != Key::TEXTURE_2D) {
+                continue;
             }
+            keys.push_back(shaderKey);
         }
-        return;
-    }
 
-    uint32_t keyMask = Key::BLEND_MASK | Key::OPACITY_MASK | Key::ALPHA_MASK | Key::TEXTURE_MASK
-        | Key::ROUNDED_CORNERS_MASK;
-    // Prime the cache for all combinations of the above masks,
-    // leaving off the experimental color matrix mask options.
+        // Batched solid color layers take their color from the vertices, and
+        // are always drawn translucent and premultiplied without rounded corners.
+        Key vertexColorKey;
+        vertexColorKey.set(keyMask | Key::VERTEX_COLOR_MASK,
+                           Key::BLEND_PREMULT | Key::OPACITY_TRANSLUCENT | Key::ALPHA_LT_ONE |
+                                   Key::TEXTURE_OFF | Key::ROUNDED_CORNERS_OFF |
+                                   Key::VERTEX_COLOR_ON);
+        keys.push_back(vertexColorKey);
+
+        // Prime for sRGB->P3 conversion
+        if (useColorManagement) {
+            Key shaderKey;
+            shaderKey.set(Key::BLEND_MASK | Key::OUTPUT_TRANSFORM_MATRIX_MASK |
+                                  Key::INPUT_TF_MASK | Key::OUTPUT_TF_MASK,
+                          Key::BLEND_PREMULT | Key::OUTPUT_TRANSFORM_MATRIX_ON |
+                                  Key::INPUT_TF_SRGB | Key::OUTPUT_TF_SRGB);
+            for (int i = 0; i < 16; i++) {
+                shaderKey.set(Key::OPACITY_MASK,
+                              (i & 1) ? Key::OPACITY_OPAQUE : Key::OPACITY_TRANSLUCENT);
+                shaderKey.set(Key::ALPHA_MASK, (i & 2) ? Key::ALPHA_LT_ONE : Key::ALPHA_EQ_ONE);
+
+                // Cache rounded corners
+                shaderKey.set(Key::ROUNDED_CORNERS_MASK,
+                              (i & 4) ? Key::ROUNDED_CORNERS_ON : Key::ROUNDED_CORNERS_OFF);
+
+                // Cache texture off option for window transition
+                shaderKey.set(Key::TEXTURE_MASK, (i & 8) ? Key::TEXTURE_EXT : Key::TEXTURE_OFF);
+                colorManagedKeys.push_back(shaderKey);
+            }
 
-    nsecs_t timeBefore = systemTime();
-    for (uint32_t keyVal = 0; keyVal <= keyMask; keyVal++) {
-        Key shaderKey;
-        shaderKey.set(keyMask, keyVal);
-        uint32_t tex = shaderKey.getTextureTarget();
-        if (tex != Key::TEXTURE_OFF && tex != Key::TEXTURE_EXT && tex != Key::TEXTURE_2D) {
-            continue;
+            // Batched solid color layers, as above.
+            shaderKey.set(Key::OPACITY_MASK | Key::ALPHA_MASK | Key::ROUNDED_CORNERS_MASK |
+                                  Key::TEXTURE_MASK | Key::VERTEX_COLOR_MASK,
+                          Key::OPACITY_TRANSLUCENT | Key::ALPHA_LT_ONE |
+                                  Key::ROUNDED_CORNERS_OFF | Key::TEXTURE_OFF |
+                                  Key::VERTEX_COLOR_ON);
+            colorManagedKeys.push_back(shaderKey);
         }
-        if (cache.count(shaderKey) == 0) {
-            cache.emplace(shaderKey, generateProgram(shaderKey));
-            shaderCount++;
+    }
+
+    primePrograms(context, keys);
+
+    std::lock_guard<std::mutex> lock(mPrimeMutex);
+    if (mPrimeContext == EGL_NO_CONTEXT || colorManagedKeys.empty()) {
+        primePrograms(context, colorManagedKeys);
+        if (mBinaryCache != nullptr) {
+            mBinaryCache->save();
         }
+        return;
     }
 
-    // Prime for sRGB->P3 conversion
-    if (useColorManagement) {
-        Key shaderKey;
-        shaderKey.set(Key::BLEND_MASK | Key::OUTPUT_TRANSFORM_MATRIX_MASK | Key::INPUT_TF_MASK |
-                              Key::OUTPUT_TF_MASK,
-                      Key::BLEND_PREMULT | Key::OUTPUT_TRANSFORM_MATRIX_ON | Key::INPUT_TF_SRGB |
-                              Key::OUTPUT_TF_SRGB);
-        for (int i = 0; i < 16; i++) {
-            shaderKey.set(Key::OPACITY_MASK,
-                          (i & 1) ? Key::OPACITY_OPAQUE : Key::OPACITY_TRANSLUCENT);
-            shaderKey.set(Key::ALPHA_MASK, (i & 2) ? Key::ALPHA_LT_ONE : Key::ALPHA_EQ_ONE);
-
-            // Cache rounded corners
-            shaderKey.set(Key::ROUNDED_CORNERS_MASK,
-                          (i & 4) ? Key::ROUNDED_CORNERS_ON : Key::ROUNDED_CORNERS_OFF);
-
-            // Cache texture off option for window transition
-            shaderKey.set(Key::TEXTURE_MASK, (i & 8) ? Key::TEXTURE_EXT : Key::TEXTURE_OFF);
-            if (cache.count(shaderKey) == 0) {
-                cache.emplace(shaderKey, generateProgram(shaderKey));
-                shaderCount++;
+    if (mPrimeThread.joinable()) {
+        mPrimeThread.join();
+    }
+    mPrimeThread = std::thread([this, context, display = mPrimeDisplay,
+                                primeContext = mPrimeContext, surface = mPrimeSurface,
+                                keys = std::move(colorManagedKeys)]() {
+        if (!eglMakeCurrent(display, surface, surface, primeContext)) {
+            ALOGE("Can't make the prime context current: %#x", eglGetError());
+            return;
+        }
+        primePrograms(context, keys);
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (mBinaryCache != nullptr) {
+            mBinaryCache->save();
+        }
+    });
+    pthread_setname_np(mPrimeThread.native_handle(), "ProgramCachePrime");
+}
+
+void ProgramCache::primePrograms(EGLContext context, const std::vector<Key>& keys) {
+    std::vector<std::pair<Key, std::unique_ptr<Program>>> programs;
+    size_t compiledPrograms = 0;
+    nsecs_t compileTime = 0;
+    size_t loadedPrograms = 0;
+    nsecs_t loadTime = 0;
+    for (const Key& key : keys) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mCaches[context].count(key) != 0) {
+                continue;
             }
         }
+        bool fromBinary = false;
+        const nsecs_t timeBefore = systemTime();
+        programs.emplace_back(key, generateProgram(key, &fromBinary));
+        const nsecs_t time = systemTime() - timeBefore;
+        if (fromBinary) {
+            loadedPrograms++;
+            loadTime += time;
+        } else {
+            compiledPrograms++;
+            compileTime += time;
+        }
     }
+    if (programs.empty()) {
+        return;
+    }
+
+    // Programs built with another context are only safe to use from context
+    // once the commands building them are done.
+    glFinish();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto& cache = mCaches[context];
+    for (auto& [key, program] : programs) {
+        // useProgram() may have needed it first.
+        cache.emplace(key, std::move(program));
+    }
+    mCompiledPrograms += compiledPrograms;
+    mCompileTime += compileTime;
+    mLoadedPrograms += loadedPrograms;
+    mLoadTime += loadTime;
+    ALOGD("shader cache generated - %zu shaders compiled in %f ms, %zu loaded in %f ms\n",
+          compiledPrograms, compileTime / 1.0E6, loadedPrograms, loadTime / 1.0E6);
+}
+
+size_t ProgramCache::getSize(const EGLContext context) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCaches[context].size();
+}
 
-    nsecs_t timeAfter = systemTime();
-    float compileTimeMs = static_cast<float>(timeAfter - timeBefore) / 1.0E6;
-    ALOGD("shader cache generated - %u shaders in %f ms\n", shaderCount, compileTimeMs);
+void ProgramCache::dump(std::string& result) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    StringAppendF(&result,
+                  "RenderEngine program cache primed: %zu compiled (cold) in %.2f ms, "
+                  "%zu loaded from binaries (warm) in %.2f ms\n",
+                  mCompiledPrograms, mCompileTime / 1.0E6, mLoadedPrograms, mLoadTime / 1.0E6);
 }
 
 ProgramCache::Key ProgramCache::computeKey(const Description& description) {
@@ -168,7 +309,10 @@ ProgramCache::Key ProgramCache::computeKey(const Description& description) {
                               : description.texture.getTextureTarget() == GL_TEXTURE_2D
                                       ? Key::TEXTURE_2D
                                       : Key::TEXTURE_OFF)
-            .set(Key::ALPHA_MASK, (description.color.a < 1) ? Key::ALPHA_LT_ONE : Key::ALPHA_EQ_ONE)
+            // Per-vertex alphas are not known here, so always modulate by them.
+            .set(Key::ALPHA_MASK,
+                 (description.vertexColor || description.color.a < 1) ? Key::ALPHA_LT_ONE
+                                                                      : Key::ALPHA_EQ_ONE)
             .set(Key::BLEND_MASK,
                  description.isPremultipliedAlpha ? Key::BLEND_PREMULT : Key::BLEND_NORMAL)
             .set(Key::OPACITY_MASK,
@@ -186,7 +330,9 @@ ProgramCache::Key ProgramCache::computeKey(const Description& description) {
                          : Key::DISPLAY_COLOR_TRANSFORM_MATRIX_OFF)
             .set(Key::ROUNDED_CORNERS_MASK,
                  description.cornerRadius > 0 ? Key::ROUNDED_CORNERS_ON : Key::ROUNDED_CORNERS_OFF)
-            .set(Key::SHADOW_MASK, description.drawShadows ? Key::SHADOW_ON : Key::SHADOW_OFF);
+            .set(Key::SHADOW_MASK, description.drawShadows ? Key::SHADOW_ON : Key::SHADOW_OFF)
+            .set(Key::VERTEX_COLOR_MASK,
+                 description.vertexColor ? Key::VERTEX_COLOR_ON : Key::VERTEX_COLOR_OFF);
     needs.set(Key::Y410_BT2020_MASK,
               description.isY410BT2020 ? Key::Y410_BT2020_ON : Key::Y410_BT2020_OFF);
 
@@ -568,6 +714,10 @@ String8 ProgramCache::generateVertexShader(const Key& needs) {
         vs << "attribute lowp vec4 shadowParams;";
         vs << "varying lowp vec3 outShadowParams;";
     }
+    if (needs.hasVertexColor()) {
+        vs << "attribute vec4 layerColor;";
+        vs << "varying vec4 outLayerColor;";
+    }
     vs << "attribute vec4 position;"
        << "uniform mat4 projection;"
        << "uniform mat4 texture;"
@@ -582,6 +732,9 @@ String8 ProgramCache::generateVertexShader(const Key& needs) {
         vs << "outShadowColor = shadowColor;";
         vs << "outShadowParams = shadowParams.xyz;";
     }
+    if (needs.hasVertexColor()) {
+        vs << "outLayerColor = layerColor;";
+    }
     vs << dedent << "}";
     return vs.getString();
 }
@@ -647,7 +800,9 @@ String8 ProgramCache::generateFragmentShader(const Key& needs) {
             )__SHADER__";
     }
 
-    if (needs.getTextureTarget() == Key::TEXTURE_OFF || needs.hasAlpha()) {
+    if (needs.hasVertexColor()) {
+        fs << "varying vec4 outLayerColor;";
+    } else if (needs.getTextureTarget() == Key::TEXTURE_OFF || needs.hasAlpha()) {
         fs << "uniform vec4 color;";
     }
 
@@ -727,6 +882,10 @@ String8 ProgramCache::generateFragmentShader(const Key& needs) {
     }
 
     fs << "void main(void) {" << indent;
+    if (needs.hasVertexColor()) {
+        // stands in for the color uniform, so the rest of the shader is unchanged
+        fs << "vec4 color = outLayerColor;";
+    }
     if (needs.drawShadows()) {
         fs << "gl_FragColor = getShadowColor();";
     } else {
@@ -782,7 +941,7 @@ String8 ProgramCache::generateFragmentShader(const Key& needs) {
     return fs.getString();
 }
 
-std::unique_ptr<Program> ProgramCache::generateProgram(const Key& needs) {
+std::unique_ptr<Program> ProgramCache::generateProgram(const Key& needs, bool* fromBinary) {
     ATRACE_CALL();
 
     // vertex shader
@@ -791,7 +950,30 @@ std::unique_ptr<Program> ProgramCache::generateProgram(const Key& needs) {
     // fragment shader
     String8 fs = generateFragmentShader(needs);
 
-    return std::make_unique<Program>(needs, vs.string(), fs.string());
+    if (mBinaryCache == nullptr) {
+        return std::make_unique<Program>(needs, vs.string(), fs.string());
+    }
+
+    // The sources are part of the key, so a binary is never used for
+    // shaders that changed since it was stored.
+    const size_t sourceHash = std::hash<std::string_view>()(vs.string()) * 31 +
+            std::hash<std::string_view>()(fs.string());
+    ProgramBinaryCache::Binary binary;
+    if (mBinaryCache->get(needs.mKey, sourceHash, &binary)) {
+        auto program = std::make_unique<Program>(needs, binary);
+        if (program->isValid()) {
+            if (fromBinary != nullptr) {
+                *fromBinary = true;
+            }
+            return program;
+        }
+    }
+
+    auto program = std::make_unique<Program>(needs, vs.string(), fs.string());
+    if (program->isValid() && program->getBinary(&binary)) {
+        mBinaryCache->set(needs.mKey, sourceHash, binary);
+    }
+    return program;
 }
 
 void ProgramCache::useProgram(EGLContext context, const Description& description) {
@@ -799,20 +981,29 @@ void ProgramCache::useProgram(EGLContext context, const Description& description
     Key needs(computeKey(description));
 
     // look-up the program in the cache
-    auto& cache = mCaches[context];
-    auto it = cache.find(needs);
-    if (it == cache.end()) {
+    Program* program = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& cache = mCaches[context];
+        auto it = cache.find(needs);
+        if (it != cache.end()) {
+            program = it->second.get();
+        }
+    }
+    if (program == nullptr) {
         // we didn't find our program, so generate one...
         nsecs_t time = systemTime();
-        it = cache.emplace(needs, generateProgram(needs)).first;
+        std::unique_ptr<Program> generated = generateProgram(needs);
         time = systemTime() - time;
 
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto& cache = mCaches[context];
+        program = cache.emplace(needs, std::move(generated)).first->second.get();
         ALOGV(">>> generated new program for context %p: needs=%08X, time=%u ms (%zu programs)",
               context, needs.mKey, uint32_t(ns2ms(time)), cache.size());
     }
 
     // here we have a suitable program for this description
-    std::unique_ptr<Program>& program = it->second;
     if (program->isValid()) {
         program->use();
         program->setUniforms(description);
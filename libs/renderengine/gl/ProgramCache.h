@@ -18,12 +18,18 @@
 #define SF_RENDER_ENGINE_PROGRAMCACHE_H
 
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
+#include <android-base/thread_annotations.h>
 #include <renderengine/private/Description.h>
 #include <utils/Singleton.h>
+#include <utils/Timers.h>
 #include <utils/TypeHelpers.h>
 
 namespace android {
@@ -38,6 +44,7 @@ namespace gl {
 
 class Formatter;
 class Program;
+class ProgramBinaryCache;
 
 /*
  * This class generates GLSL programs suitable to handle a given
@@ -122,6 +129,11 @@ public:
             DISPLAY_COLOR_TRANSFORM_MATRIX_MASK = 1 << DISPLAY_COLOR_TRANSFORM_MATRIX_SHIFT,
             DISPLAY_COLOR_TRANSFORM_MATRIX_OFF = 0 << DISPLAY_COLOR_TRANSFORM_MATRIX_SHIFT,
             DISPLAY_COLOR_TRANSFORM_MATRIX_ON = 1 << DISPLAY_COLOR_TRANSFORM_MATRIX_SHIFT,
+
+            VERTEX_COLOR_SHIFT = 15,
+            VERTEX_COLOR_MASK = 1 << VERTEX_COLOR_SHIFT,
+            VERTEX_COLOR_OFF = 0 << VERTEX_COLOR_SHIFT,
+            VERTEX_COLOR_ON = 1 << VERTEX_COLOR_SHIFT,
         };
 
         inline Key() : mKey(0) {}
@@ -142,6 +154,9 @@ public:
             return (mKey & ROUNDED_CORNERS_MASK) == ROUNDED_CORNERS_ON;
         }
         inline bool drawShadows() const { return (mKey & SHADOW_MASK) == SHADOW_ON; }
+        inline bool hasVertexColor() const {
+            return (mKey & VERTEX_COLOR_MASK) == VERTEX_COLOR_ON;
+        }
         inline bool hasInputTransformMatrix() const {
             return (mKey & INPUT_TRANSFORM_MATRIX_MASK) == INPUT_TRANSFORM_MATRIX_ON;
         }
@@ -191,18 +206,42 @@ public:
     };
 
     ProgramCache() = default;
-    ~ProgramCache() = default;
+    ~ProgramCache();
+
+    // Programs are loaded from and saved to binaryCache from then on. Must be
+    // called before the cache is primed.
+    void setProgramBinaryCache(std::unique_ptr<ProgramBinaryCache> binaryCache);
+
+    // Sets up a context sharing objects with the contexts drawn with, so that
+    // primeCache() can build the color managed variants in the background.
+    void setPrimeContext(EGLDisplay display, EGLContext context, EGLSurface surface)
+            EXCLUDES(mPrimeMutex);
 
     // Generate shaders to populate the cache
-    void primeCache(const EGLContext context, bool useColorManagement, bool toneMapperShaderOnly);
+    void primeCache(const EGLContext context, bool useColorManagement, bool toneMapperShaderOnly)
+            EXCLUDES(mPrimeMutex);
+
+    // Blocks until background priming, if any, is done.
+    void waitForPrimeCache() EXCLUDES(mPrimeMutex);
 
-    size_t getSize(const EGLContext context) { return mCaches[context].size(); }
+    // Waits for background priming, then destroys the prime context and its
+    // surface and drops the binary cache. The engine that set them up calls
+    // this before it terminates the display, since the cache outlives it.
+    void releaseEngineResources() EXCLUDES(mPrimeMutex);
+
+    size_t getSize(const EGLContext context) EXCLUDES(mMutex);
 
     // useProgram lookup a suitable program in the cache or generates one
     // if none can be found.
-    void useProgram(const EGLContext context, const Description& description);
+    void useProgram(const EGLContext context, const Description& description) EXCLUDES(mMutex);
+
+    void dump(std::string& result) EXCLUDES(mMutex);
 
 private:
+    // Builds the programs for keys that are not cached yet with the current
+    // context, which must share objects with context.
+    void primePrograms(const EGLContext context, const std::vector<Key>& keys) EXCLUDES(mMutex);
+
     // compute a cache Key from a Description
     static Key computeKey(const Description& description);
     // Generate EOTF based from Key.
@@ -213,17 +252,32 @@ private:
     static void generateOOTF(Formatter& fs, const Key& needs);
     // Generate OETF based from Key.
     static void generateOETF(Formatter& fs, const Key& needs);
-    // generates a program from the Key
-    static std::unique_ptr<Program> generateProgram(const Key& needs);
+    // generates a program from the Key, or loads it from the binary cache
+    std::unique_ptr<Program> generateProgram(const Key& needs, bool* fromBinary = nullptr);
     // generates the vertex shader from the Key
     static String8 generateVertexShader(const Key& needs);
     // generates the fragment shader from the Key
     static String8 generateFragmentShader(const Key& needs);
 
+    std::unique_ptr<ProgramBinaryCache> mBinaryCache;
+
+    std::mutex mMutex;
     // Key/Value map used for caching Programs. Currently the cache
     // is never shrunk (and the GL program objects are never deleted).
     std::unordered_map<EGLContext, std::unordered_map<Key, std::unique_ptr<Program>, Key::Hash>>
-            mCaches;
+            mCaches GUARDED_BY(mMutex);
+    // Time spent priming, split between programs compiled from source (a
+    // cold start) and programs loaded from mBinaryCache (a warm start).
+    size_t mCompiledPrograms GUARDED_BY(mMutex) = 0;
+    nsecs_t mCompileTime GUARDED_BY(mMutex) = 0;
+    size_t mLoadedPrograms GUARDED_BY(mMutex) = 0;
+    nsecs_t mLoadTime GUARDED_BY(mMutex) = 0;
+
+    std::mutex mPrimeMutex;
+    EGLDisplay mPrimeDisplay GUARDED_BY(mPrimeMutex) = EGL_NO_DISPLAY;
+    EGLContext mPrimeContext GUARDED_BY(mPrimeMutex) = EGL_NO_CONTEXT;
+    EGLSurface mPrimeSurface GUARDED_BY(mPrimeMutex) = EGL_NO_SURFACE;
+    std::thread mPrimeThread GUARDED_BY(mPrimeMutex);
 };
 
 } // namespace gl
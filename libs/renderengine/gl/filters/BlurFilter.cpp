@@ -23,6 +23,8 @@
 #include <GLES3/gl3.h>
 #include <GLES3/gl3ext.h>
 #include <ui/GraphicTypes.h>
+#include <algorithm>
+#include <cfloat>
 #include <cstdint>
 
 #include <utils/Trace.h>
@@ -37,23 +39,19 @@ static const GLenum kInvalidateAttachment = GL_COLOR_ATTACHMENT0;
 BlurFilter::BlurFilter(GLESRenderEngine& engine)
       : mEngine(engine),
         mCompositionFbo(engine),
+        mDownsampleFbo(engine),
         mPingFbo(engine),
         mPongFbo(engine),
         mDitherFbo(engine),
-        mMixProgram(engine),
         mDitherMixProgram(engine),
         mBlurProgram(engine) {
-    mMixProgram.compile(getMixVertShader(), getMixFragShader());
-    mMBlurTextureLoc = mMixProgram.getUniformLocation("uBlurTexture");
-    mMCompositionTextureLoc = mMixProgram.getUniformLocation("uCompositionTexture");
-    mMBlurOpacityLoc = mMixProgram.getUniformLocation("uBlurOpacity");
-
     mDitherMixProgram.compile(getDitherMixVertShader(), getDitherMixFragShader());
     mDNoiseUvScaleLoc = mDitherMixProgram.getUniformLocation("uNoiseUVScale");
     mDBlurTextureLoc = mDitherMixProgram.getUniformLocation("uBlurTexture");
     mDDitherTextureLoc = mDitherMixProgram.getUniformLocation("uDitherTexture");
     mDCompositionTextureLoc = mDitherMixProgram.getUniformLocation("uCompositionTexture");
     mDBlurOpacityLoc = mDitherMixProgram.getUniformLocation("uBlurOpacity");
+    mDBlurRectLoc = mDitherMixProgram.getUniformLocation("uBlurRect");
     mDitherFbo.allocateBuffers(64, 64, (void *) kNoiseData,
                                GL_NEAREST, GL_REPEAT,
                                GL_RGB8, GL_RGB, GL_UNSIGNED_BYTE);
@@ -63,9 +61,6 @@ BlurFilter::BlurFilter(GLESRenderEngine& engine)
     mBOffsetLoc = mBlurProgram.getUniformLocation("uOffset");
 
     // Initialize constant shader uniforms
-    mMixProgram.useProgram();
-    glUniform1i(mMBlurTextureLoc, 0);
-    glUniform1i(mMCompositionTextureLoc, 1);
     mDitherMixProgram.useProgram();
     glUniform1i(mDBlurTextureLoc, 0);
     glUniform1i(mDCompositionTextureLoc, 1);
@@ -75,9 +70,8 @@ BlurFilter::BlurFilter(GLESRenderEngine& engine)
     glUseProgram(0);
 }
 
-status_t BlurFilter::setAsDrawTarget(const DisplaySettings& display, uint32_t radius) {
+status_t BlurFilter::setAsDrawTarget(const DisplaySettings& display) {
     ATRACE_NAME("BlurFilter::setAsDrawTarget");
-    mRadius = radius;
     mDisplayX = display.physicalDisplay.left;
     mDisplayY = display.physicalDisplay.top;
 
@@ -91,6 +85,9 @@ status_t BlurFilter::setAsDrawTarget(const DisplaySettings& display, uint32_t ra
 
         const uint32_t fboWidth = floorf(mDisplayWidth * kFboScale);
         const uint32_t fboHeight = floorf(mDisplayHeight * kFboScale);
+        mDownsampleFbo.allocateBuffers(fboWidth, fboHeight, nullptr,
+                                       GL_LINEAR, GL_CLAMP_TO_EDGE,
+                                       GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV);
         mPingFbo.allocateBuffers(fboWidth, fboHeight, nullptr,
                                  GL_LINEAR, GL_CLAMP_TO_EDGE,
                                  // 2-10-10-10 reversed is the only 10-bpc format in GLES 3.1
@@ -99,6 +96,12 @@ status_t BlurFilter::setAsDrawTarget(const DisplaySettings& display, uint32_t ra
                                  GL_LINEAR, GL_CLAMP_TO_EDGE,
                                  GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV);
 
+        clearCache();
+
+        if (mDownsampleFbo.getStatus() != GL_FRAMEBUFFER_COMPLETE) {
+            ALOGE("Invalid downsample buffer");
+            return mDownsampleFbo.getStatus();
+        }
         if (mPingFbo.getStatus() != GL_FRAMEBUFFER_COMPLETE) {
             ALOGE("Invalid ping buffer");
             return mPingFbo.getStatus();
@@ -124,19 +127,138 @@ status_t BlurFilter::setAsDrawTarget(const DisplaySettings& display, uint32_t ra
         glUseProgram(0);
     }
 
+    // Layers are projected differently, or drawn over a different background.
+    if (!(display == mDisplay)) {
+        clearCache();
+        mDisplay = display;
+    }
+    mLayers.clear();
+    mBlurredPixels = 0;
+
     mCompositionFbo.bind();
     glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &kInvalidateAttachment);
     glViewport(0, 0, mCompositionFbo.getBufferWidth(), mCompositionFbo.getBufferHeight());
     return NO_ERROR;
 }
 
+void BlurFilter::clearCache() {
+    mDownsampledLayers.clear();
+    mDownsampledRegion.clear();
+    mHasBlur = false;
+}
+
+void BlurFilter::addLayer(const LayerSettings& layer, const mat4& projectionMatrix) {
+    mLayers.push_back({layer, getBufferBounds(layer, projectionMatrix)});
+}
+
+Rect BlurFilter::getBufferBounds(const LayerSettings& layer, const mat4& projectionMatrix) const {
+    // Shadows are drawn outside of the layer bounds.
+    if (layer.shadow.length > 0.0f) {
+        return Rect(mCompositionFbo.getBufferWidth(), mCompositionFbo.getBufferHeight());
+    }
+
+    const float width = mCompositionFbo.getBufferWidth();
+    const float height = mCompositionFbo.getBufferHeight();
+
+    const mat4 transform = projectionMatrix * layer.geometry.positionTransform;
+    const FloatRect& bounds = layer.geometry.boundaries;
+    const vec4 corners[] = {
+            transform * vec4(bounds.left, bounds.top, 0.0f, 1.0f),
+            transform * vec4(bounds.left, bounds.bottom, 0.0f, 1.0f),
+            transform * vec4(bounds.right, bounds.bottom, 0.0f, 1.0f),
+            transform * vec4(bounds.right, bounds.top, 0.0f, 1.0f),
+    };
+    // The viewport covers the whole composition buffer.
+    FloatRect result(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (const vec4& corner : corners) {
+        const float x = std::clamp((corner.x / corner.w + 1.0f) * 0.5f * width, 0.0f, width);
+        const float y = std::clamp((corner.y / corner.w + 1.0f) * 0.5f * height, 0.0f, height);
+        result.left = std::min(result.left, x);
+        result.top = std::min(result.top, y);
+        result.right = std::max(result.right, x);
+        result.bottom = std::max(result.bottom, y);
+    }
+    return Rect(floorf(result.left), floorf(result.top), ceilf(result.right),
+                ceilf(result.bottom));
+}
+
+Rect BlurFilter::getDownsampledBounds(const Rect& bounds) const {
+    const float scaleX =
+            mDownsampleFbo.getBufferWidth() / (float)mCompositionFbo.getBufferWidth();
+    const float scaleY =
+            mDownsampleFbo.getBufferHeight() / (float)mCompositionFbo.getBufferHeight();
+    return Rect(floorf(bounds.left * scaleX), floorf(bounds.top * scaleY),
+                ceilf(bounds.right * scaleX), ceilf(bounds.bottom * scaleY));
+}
+
+Region BlurFilter::getDirtyRegion() const {
+    Region dirty;
+    const size_t count = max(mLayers.size(), mDownsampledLayers.size());
+    for (size_t i = 0; i < count; i++) {
+        if (i >= mLayers.size()) {
+            dirty.orSelf(mDownsampledLayers[i].bounds);
+        } else if (i >= mDownsampledLayers.size()) {
+            dirty.orSelf(mLayers[i].bounds);
+        } else if (!(mLayers[i] == mDownsampledLayers[i])) {
+            dirty.orSelf(mLayers[i].bounds);
+            dirty.orSelf(mDownsampledLayers[i].bounds);
+        }
+    }
+    return dirty;
+}
+
 void BlurFilter::drawMesh() {
     // draw mesh
     glDrawArrays(GL_TRIANGLES, 0 /* first */, 3 /* count */);
 }
 
-status_t BlurFilter::prepare() {
+status_t BlurFilter::prepare(const LayerSettings& blurLayer, const mat4& projectionMatrix) {
     ATRACE_NAME("BlurFilter::prepare");
+    mRadius = blurLayer.backgroundBlurRadius;
+    mBlurBounds = getBufferBounds(blurLayer, projectionMatrix);
+
+    // Pixels within the blur radius of the layer bleed into it.
+    Rect region = Rect::EMPTY_RECT;
+    if (!mBlurBounds.isEmpty()) {
+        const Rect expanded(mBlurBounds.left - mRadius, mBlurBounds.top - mRadius,
+                            mBlurBounds.right + mRadius, mBlurBounds.bottom + mRadius);
+        expanded.intersect(Rect(mCompositionFbo.getBufferWidth(),
+                                mCompositionFbo.getBufferHeight()),
+                           &region);
+    }
+    if (region.isEmpty()) {
+        mLastDrawTarget = &mDownsampleFbo;
+        return NO_ERROR;
+    }
+
+    // Only downsample what changed beneath since the downsampled texture was last built.
+    const Region clean = mDownsampledRegion.subtract(getDirtyRegion());
+    const Region stale = Region(region).subtractSelf(clean);
+    mDownsampledRegion = clean.merge(region);
+    mDownsampledLayers = mLayers;
+
+    glEnable(GL_SCISSOR_TEST);
+    if (!stale.isEmpty()) {
+        ATRACE_NAME("BlurFilter::downsample");
+        const Rect scissor = getDownsampledBounds(stale.getBounds());
+        glScissor(scissor.left, scissor.top, scissor.width(), scissor.height());
+        // This initial downscaling blit makes the first pass correct and improves performance.
+        // The scissor test applies to blits, so only the stale area is written.
+        mCompositionFbo.bindAsReadBuffer();
+        mDownsampleFbo.bindAsDrawBuffer();
+        glBlitFramebuffer(0, 0,
+                          mCompositionFbo.getBufferWidth(), mCompositionFbo.getBufferHeight(),
+                          0, 0,
+                          mDownsampleFbo.getBufferWidth(), mDownsampleFbo.getBufferHeight(),
+                          GL_COLOR_BUFFER_BIT, GL_LINEAR);
+    }
+
+    // Nothing changed beneath the layer since the last blur, which is still around.
+    if (mHasBlur && stale.isEmpty() && mBlurRadius == mRadius && mBlurRegion == region) {
+        glDisable(GL_SCISSOR_TEST);
+        mLastDrawTarget = mBlurTarget;
+        return NO_ERROR;
+    }
 
     // Kawase is an approximation of Gaussian, but it behaves differently from it.
     // A radius transformation is required for approximating them, and also to introduce
@@ -151,27 +273,20 @@ status_t BlurFilter::prepare() {
     const float stepX = radiusByPasses / (float)mCompositionFbo.getBufferWidth();
     const float stepY = radiusByPasses / (float)mCompositionFbo.getBufferHeight();
 
-    // This initial downscaling blit makes the first pass correct and improves performance.
-    GLFramebuffer* read = &mCompositionFbo;
-    GLFramebuffer* draw = &mPingFbo;
-    read->bindAsReadBuffer();
-    draw->bindAsDrawBuffer();
-    glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &kInvalidateAttachment);
-    glBlitFramebuffer(0, 0,
-                      read->getBufferWidth(), read->getBufferHeight(),
-                      0, 0,
-                      draw->getBufferWidth(), draw->getBufferHeight(),
-                      GL_COLOR_BUFFER_BIT, GL_LINEAR);
-    read = &mPingFbo;
-    draw = &mPongFbo;
+    // Taps outside of the scissor only land within the blur radius of the region's edge,
+    // which the layer doesn't cover.
+    const Rect scissor = getDownsampledBounds(region);
+    glScissor(scissor.left, scissor.top, scissor.width(), scissor.height());
 
     // And now we'll ping pong between our textures, to accumulate the result of various offsets.
+    GLFramebuffer* read = &mDownsampleFbo;
+    GLFramebuffer* draw = &mPingFbo;
     mBlurProgram.useProgram();
-    glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &kInvalidateAttachment);
     glViewport(0, 0, draw->getBufferWidth(), draw->getBufferHeight());
     for (auto i = 1; i < passes; i++) {
         ATRACE_NAME("BlurFilter::renderPass");
         draw->bind();
+        glInvalidateFramebuffer(GL_FRAMEBUFFER, 1, &kInvalidateAttachment);
 
         glBindTexture(GL_TEXTURE_2D, read->getTextureName());
         glUniform2f(mBOffsetLoc, stepX * i, stepY * i);
@@ -179,10 +294,18 @@ status_t BlurFilter::prepare() {
         drawMesh();
 
         // Swap buffers for next iteration
-        std::swap(read, draw);
+        read = draw;
+        draw = read == &mPingFbo ? &mPongFbo : &mPingFbo;
     }
+    glDisable(GL_SCISSOR_TEST);
     mLastDrawTarget = read;
 
+    mHasBlur = true;
+    mBlurTarget = read;
+    mBlurRadius = mRadius;
+    mBlurRegion = region;
+    mBlurGeneration++;
+    mBlurredPixels += scissor.width() * scissor.height();
     return NO_ERROR;
 }
 
@@ -193,13 +316,42 @@ status_t BlurFilter::render(size_t layers, int currentLayer) {
     // texture for the first frames, to hide downscaling artifacts.
     GLfloat opacity = fmin(1.0, mRadius / kMaxCrossFadeRadius);
 
-    // When doing multiple passes, we cannot try to read mCompositionFbo, given that we'll
-    // be writing onto it. Let's disable the crossfade, otherwise we'd need 1 extra frame buffer,
-    // as large as the screen size.
+    // When doing multiple passes, the blur behind the front layer was drawn over the ones
+    // behind it without a crossfade. Let's not crossfade it either, so that they match.
     if (opacity >= 1 || layers > 1) {
         opacity = 1.0f;
     }
 
+    // There are more blur layers to come: write the blur back to the offscreen texture,
+    // which is still the draw target.
+    if (currentLayer < layers - 1) {
+        if (!mBlurBounds.isEmpty()) {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(mBlurBounds.left, mBlurBounds.top, mBlurBounds.width(),
+                      mBlurBounds.height());
+            mLastDrawTarget->bindAsReadBuffer();
+            mCompositionFbo.bindAsDrawBuffer();
+            glBlitFramebuffer(0, 0,
+                              mLastDrawTarget->getBufferWidth(),
+                              mLastDrawTarget->getBufferHeight(),
+                              0, 0,
+                              mCompositionFbo.getBufferWidth(), mCompositionFbo.getBufferHeight(),
+                              GL_COLOR_BUFFER_BIT, GL_LINEAR);
+            glDisable(GL_SCISSOR_TEST);
+            mLayers.push_back({LayerSettings(), mBlurBounds, mBlurGeneration});
+        }
+        mCompositionFbo.bind();
+        glViewport(0, 0, mCompositionFbo.getBufferWidth(), mCompositionFbo.getBufferHeight());
+        mEngine.checkErrors("Drawing blur back to offscreen texture");
+        return NO_ERROR;
+    }
+
+    // Only the area behind the layer is blurred, in texture coordinates.
+    const float width = mCompositionFbo.getBufferWidth();
+    const float height = mCompositionFbo.getBufferHeight();
+    const float blurRect[] = {mBlurBounds.left / width, mBlurBounds.top / height,
+                              mBlurBounds.right / width, mBlurBounds.bottom / height};
+
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, mLastDrawTarget->getTextureName());
     glActiveTexture(GL_TEXTURE1);
@@ -208,15 +360,10 @@ status_t BlurFilter::render(size_t layers, int currentLayer) {
     glBindTexture(GL_TEXTURE_2D, mDitherFbo.getTextureName());
 
     // Dither the last layer
-    if (currentLayer == layers - 1) {
-        mDitherMixProgram.useProgram();
-        glUniform1f(mDBlurOpacityLoc, opacity);
-        drawMesh();
-    } else {
-        mMixProgram.useProgram();
-        glUniform1f(mMBlurOpacityLoc, opacity);
-        drawMesh();
-    }
+    mDitherMixProgram.useProgram();
+    glUniform1f(mDBlurOpacityLoc, opacity);
+    glUniform4fv(mDBlurRectLoc, 1, blurRect);
+    drawMesh();
 
     glUseProgram(0);
     glActiveTexture(GL_TEXTURE0);
@@ -267,39 +414,6 @@ string BlurFilter::getBlurFragShader() const {
     )SHADER";
 }
 
-string BlurFilter::getMixVertShader() const {
-    return R"SHADER(#version 310 es
-        precision mediump float;
-
-        out vec2 vUV;
-
-        void main() {
-            vUV = vec2((gl_VertexID == 2) ? 2.0 : 0.0, (gl_VertexID == 1) ? 2.0 : 0.0);
-            gl_Position = vec4(vUV * 2.0 - 1.0, 1.0, 1.0);
-        }
-    )SHADER";
-}
-
-string BlurFilter::getMixFragShader() const {
-    string shader = R"SHADER(#version 310 es
-        precision mediump float;
-
-        in vec2 vUV;
-        out vec4 fragColor;
-
-        uniform sampler2D uCompositionTexture;
-        uniform sampler2D uBlurTexture;
-        uniform float uBlurOpacity;
-
-        void main() {
-            vec3 blurred = texture(uBlurTexture, vUV).rgb;
-            vec3 composition = texture(uCompositionTexture, vUV).rgb;
-            fragColor = vec4(mix(composition, blurred, uBlurOpacity), 1.0);
-        }
-    )SHADER";
-    return shader;
-}
-
 string BlurFilter::getDitherMixVertShader() const {
     return R"SHADER(#version 310 es
         precision mediump float;
@@ -330,6 +444,7 @@ string BlurFilter::getDitherMixFragShader() const {
         uniform sampler2D uBlurTexture;
         uniform sampler2D uDitherTexture;
         uniform float uBlurOpacity;
+        uniform vec4 uBlurRect;
 
         // Fast implementation of sign(vec3)
         // Using overflow trick from https://twitter.com/SebAaltonen/status/878250919879639040
@@ -354,7 +469,9 @@ string BlurFilter::getDitherMixFragShader() const {
 
             vec3 blurred = srgbToLinear(linearToSrgb(texture(uBlurTexture, vUV).rgb) + dither);
             vec3 composition = texture(uCompositionTexture, vUV).rgb;
-            fragColor = vec4(mix(composition, blurred, uBlurOpacity), 1.0);
+            // Only blur behind the blur layer
+            vec2 inside = step(uBlurRect.xy, vUV) * step(vUV, uBlurRect.zw);
+            fragColor = vec4(mix(composition, blurred, uBlurOpacity * inside.x * inside.y), 1.0);
         }
     )SHADER";
 }
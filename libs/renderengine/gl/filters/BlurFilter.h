@@ -16,7 +16,10 @@
 
 #pragma once
 
+#include <renderengine/LayerSettings.h>
 #include <ui/GraphicTypes.h>
+#include <ui/Region.h>
+#include <vector>
 #include "../GLESRenderEngine.h"
 #include "../GLFramebuffer.h"
 #include "../GLVertexBuffer.h"
@@ -32,6 +35,11 @@ namespace gl {
  * This is an implementation of a Kawase blur, as described in here:
  * https://community.arm.com/cfs-file/__key/communityserver-blogs-components-weblogfiles/
  * 00-00-00-20-66/siggraph2015_2D00_mmg_2D00_marius_2D00_notes.pdf
+ *
+ * Only the area behind blur layers, grown by the blur radius, is downsampled and blurred.
+ * The downsampled composition is kept across blur layers and frames, and is only rebuilt
+ * where the layers drawn beneath changed since it was last built. When nothing beneath a
+ * blur layer changed, the blurred result of the last frame is reused as is.
  */
 class BlurFilter {
 public:
@@ -47,25 +55,51 @@ public:
     virtual ~BlurFilter(){};
 
     // Set up render targets, redirecting output to offscreen texture.
-    status_t setAsDrawTarget(const DisplaySettings&, uint32_t radius);
-    // Execute blur passes, rendering to offscreen texture.
-    status_t prepare();
-    // Render blur to the bound framebuffer (screen).
+    status_t setAsDrawTarget(const DisplaySettings&);
+    // Record a layer drawn to the offscreen texture, so that we know what changed beneath
+    // the next blur layer.
+    void addLayer(const LayerSettings& layer, const mat4& projectionMatrix);
+    // Execute blur passes behind the blur layer, rendering to offscreen texture.
+    status_t prepare(const LayerSettings& blurLayer, const mat4& projectionMatrix);
+    // Render blur to the bound framebuffer (screen) for the last blur layer, or back to the
+    // offscreen texture for the others.
     status_t render(size_t layers, int currentLayer);
+    // Pixels of the downsampled texture that went through blur passes since the last
+    // setAsDrawTarget().
+    size_t getBlurredPixels() const { return mBlurredPixels; }
+    // Drop what is kept from previous frames, which holds references to their buffers.
+    void clearCache();
 
 private:
+    // A layer drawn to the offscreen texture. Blurs rendered back to it are recorded with
+    // the generation of the blur passes that produced them.
+    struct DrawnLayer {
+        LayerSettings settings;
+        Rect bounds;
+        uint64_t blurGeneration = 0;
+
+        bool operator==(const DrawnLayer& other) const {
+            return settings == other.settings && bounds == other.bounds &&
+                    blurGeneration == other.blurGeneration;
+        }
+    };
+
+    Rect getBufferBounds(const LayerSettings& layer, const mat4& projectionMatrix) const;
+    Rect getDownsampledBounds(const Rect& bounds) const;
+    Region getDirtyRegion() const;
+
     uint32_t mRadius;
     void drawMesh();
     string getBlurVertShader() const;
     string getBlurFragShader() const;
-    string getMixVertShader() const;
-    string getMixFragShader() const;
     string getDitherMixVertShader() const;
     string getDitherMixFragShader() const;
 
     GLESRenderEngine& mEngine;
     // Frame buffer holding the composited background.
     GLFramebuffer mCompositionFbo;
+    // Frame buffer holding the downsampled composition, which blur passes read from.
+    GLFramebuffer mDownsampleFbo;
     // Frame buffers holding the blur passes.
     GLFramebuffer mPingFbo;
     GLFramebuffer mPongFbo;
@@ -76,16 +110,30 @@ private:
     uint32_t mDisplayX = 0;
     uint32_t mDisplayY = 0;
     // Buffer holding the final blur pass.
-    GLFramebuffer* mLastDrawTarget;
+    GLFramebuffer* mLastDrawTarget = nullptr;
 
-    GenericProgram mMixProgram;
-    GLuint mMBlurOpacityLoc;
-    GLuint mMBlurTextureLoc;
-    GLuint mMCompositionTextureLoc;
+    DisplaySettings mDisplay;
+    // Area of the composition, in buffer coordinates, that the current blur is rendered to.
+    Rect mBlurBounds;
+    // Layers drawn to the offscreen texture so far in this frame.
+    std::vector<DrawnLayer> mLayers;
+    // Layers that had been drawn when mDownsampleFbo was last built, and the area of the
+    // composition, in buffer coordinates, where it still holds their downsampled result.
+    std::vector<DrawnLayer> mDownsampledLayers;
+    Region mDownsampledRegion;
+    // Buffer, radius and area of the last blur, if any. This is kept apart from
+    // mLastDrawTarget, which an empty blur region points elsewhere.
+    bool mHasBlur = false;
+    GLFramebuffer* mBlurTarget = nullptr;
+    uint32_t mBlurRadius = 0;
+    Rect mBlurRegion;
+    uint64_t mBlurGeneration = 0;
+    size_t mBlurredPixels = 0;
 
     GenericProgram mDitherMixProgram;
     GLuint mDNoiseUvScaleLoc;
     GLuint mDBlurOpacityLoc;
+    GLuint mDBlurRectLoc;
     GLuint mDBlurTextureLoc;
     GLuint mDDitherTextureLoc;
     GLuint mDCompositionTextureLoc;
@@ -86,6 +86,11 @@ public:
         return VertexArray<TYPE>(getShadowParams(), mStride);
     }
 
+    template <typename TYPE>
+    VertexArray<TYPE> getColorArray() {
+        return VertexArray<TYPE>(getColors(), mStride);
+    }
+
     uint16_t* getIndicesArray() { return getIndices(); }
 
     Primitive getPrimitive() const;
@@ -105,6 +110,9 @@ public:
     // returns a pointer to the shadow params
     float const* getShadowParams() const;
 
+    // returns a pointer to the per-vertex colors
+    float const* getColors() const;
+
     // returns a pointer to indices
     uint16_t const* getIndices() const;
 
@@ -121,6 +129,9 @@ public:
 
     size_t getShadowColorSize() const;
 
+    // dimension of per-vertex colors, 0 if the mesh has none
+    size_t getColorSize() const;
+
     size_t getIndexCount() const;
 
     // return stride in bytes
@@ -131,7 +142,8 @@ public:
 
 private:
     Mesh(Primitive primitive, size_t vertexCount, size_t vertexSize, size_t texCoordSize,
-         size_t cropCoordsSize, size_t shadowColorSize, size_t shadowParamsSize, size_t indexCount);
+         size_t cropCoordsSize, size_t shadowColorSize, size_t shadowParamsSize, size_t colorSize,
+         size_t indexCount);
     Mesh(const Mesh&);
     Mesh& operator=(const Mesh&);
     Mesh const& operator=(const Mesh&) const;
@@ -141,6 +153,7 @@ private:
     float* getCropCoords();
     float* getShadowColor();
     float* getShadowParams();
+    float* getColors();
     uint16_t* getIndices();
 
     std::vector<float> mVertices;
@@ -150,6 +163,7 @@ private:
     size_t mCropCoordsSize;
     size_t mShadowColorSize;
     size_t mShadowParamsSize;
+    size_t mColorSize;
     size_t mStride;
     Primitive mPrimitive;
     std::vector<uint16_t> mIndices;
@@ -180,13 +194,18 @@ public:
         mShadowColorSize = 4;
         return *this;
     };
+    Builder& setColors(size_t colorSize) {
+        mColorSize = colorSize;
+        return *this;
+    };
     Builder& setIndices(size_t indexCount) {
         mIndexCount = indexCount;
         return *this;
     };
     Mesh build() const {
-        return Mesh{mPrimitive,      mVertexCount,     mVertexSize,       mTexCoordsSize,
-                    mCropCoordsSize, mShadowColorSize, mShadowParamsSize, mIndexCount};
+        return Mesh{mPrimitive,        mVertexCount,     mVertexSize,
+                    mTexCoordsSize,    mCropCoordsSize,  mShadowColorSize,
+                    mShadowParamsSize, mColorSize,       mIndexCount};
     }
 
 private:
@@ -196,6 +215,7 @@ private:
     size_t mCropCoordsSize = 0;
     size_t mShadowColorSize = 0;
     size_t mShadowParamsSize = 0;
+    size_t mColorSize = 0;
     size_t mIndexCount = 0;
     Primitive mPrimitive;
 };
@@ -64,6 +64,9 @@ struct Description {
     // color used when texturing is disabled or when setting alpha.
     half4 color;
 
+    // true if color comes from the mesh colors instead, one per vertex
+    bool vertexColor = false;
+
     // true if the sampled pixel values are in Y410/BT2020 rather than RGBA
     bool isY410BT2020 = false;
 
@@ -0,0 +1,142 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+#include "../gl/GLShadowCache.h"
+#include "../gl/GLShadowVertexGenerator.h"
+
+namespace android {
+namespace renderengine {
+namespace gl {
+namespace {
+
+// The cache never touches GL, so these tests need no context.
+GLShadowCache::Key getKey(float offset) {
+    return {FloatRect(offset, offset, offset + 100.0f, offset + 200.0f),
+            8.0f /* casterCornerRadius */,
+            12.0f /* casterZ */,
+            false /* casterIsTranslucent */,
+            vec4(0.0f, 0.0f, 0.0f, 0.039f) /* ambientColor */,
+            vec4(0.0f, 0.0f, 0.0f, 0.19f) /* spotColor */,
+            vec3(540.0f, -200.0f, 600.0f) /* lightPosition */,
+            800.0f /* lightRadius */};
+}
+
+void expectMatchesGenerator(const GLShadowCache::Key& key, const Mesh& mesh) {
+    const GLShadowVertexGenerator shadows(key.casterRect, key.casterCornerRadius, key.casterZ,
+                                          key.casterIsTranslucent, key.ambientColor,
+                                          key.spotColor, key.lightPosition, key.lightRadius);
+    Mesh generated = Mesh::Builder()
+                             .setPrimitive(Mesh::TRIANGLES)
+                             .setVertices(shadows.getVertexCount(), 2 /* size */)
+                             .setShadowAttrs()
+                             .setIndices(shadows.getIndexCount())
+                             .build();
+    Mesh::VertexArray<vec2> position = generated.getPositionArray<vec2>();
+    Mesh::VertexArray<vec4> shadowColor = generated.getShadowColorArray<vec4>();
+    Mesh::VertexArray<vec3> shadowParams = generated.getShadowParamsArray<vec3>();
+    shadows.fillVertices(position, shadowColor, shadowParams);
+    shadows.fillIndices(generated.getIndicesArray());
+    const Mesh& expected = generated;
+
+    ASSERT_EQ(expected.getVertexCount(), mesh.getVertexCount());
+    ASSERT_EQ(expected.getIndexCount(), mesh.getIndexCount());
+    ASSERT_EQ(expected.getStride(), mesh.getStride());
+    const size_t floatCount = expected.getVertexCount() * expected.getStride();
+    EXPECT_TRUE(std::equal(expected.getPositions(), expected.getPositions() + floatCount,
+                           mesh.getPositions()));
+    EXPECT_TRUE(std::equal(expected.getIndices(), expected.getIndices() + expected.getIndexCount(),
+                           mesh.getIndices()));
+}
+
+TEST(GLShadowCacheTest, missThenHit) {
+    GLShadowCache cache(4);
+    const Mesh& first = cache.getMesh(getKey(0.0f));
+    EXPECT_EQ(0u, cache.getHitCount());
+    EXPECT_EQ(1u, cache.getMissCount());
+
+    const Mesh& second = cache.getMesh(getKey(0.0f));
+    EXPECT_EQ(&first, &second);
+    EXPECT_EQ(1u, cache.getHitCount());
+    EXPECT_EQ(1u, cache.getMissCount());
+    EXPECT_EQ(1u, cache.getSize());
+}
+
+TEST(GLShadowCacheTest, meshMatchesUncachedTessellation) {
+    GLShadowCache cache(4);
+    expectMatchesGenerator(getKey(10.0f), cache.getMesh(getKey(10.0f)));
+    expectMatchesGenerator(getKey(10.0f), cache.getMesh(getKey(10.0f)));
+}
+
+TEST(GLShadowCacheTest, anyChangeInTheKeyMisses) {
+    GLShadowCache cache(16);
+    cache.getMesh(getKey(0.0f));
+
+    GLShadowCache::Key key = getKey(0.0f);
+    key.casterCornerRadius = 16.0f;
+    cache.getMesh(key);
+    key = getKey(0.0f);
+    key.casterZ = 24.0f;
+    cache.getMesh(key);
+    key = getKey(0.0f);
+    key.casterIsTranslucent = true;
+    cache.getMesh(key);
+    key = getKey(0.0f);
+    key.spotColor.a = 0.0f;
+    cache.getMesh(key);
+    key = getKey(0.0f);
+    key.lightPosition.x = 0.0f;
+    cache.getMesh(key);
+
+    EXPECT_EQ(0u, cache.getHitCount());
+    EXPECT_EQ(6u, cache.getMissCount());
+    EXPECT_EQ(6u, cache.getSize());
+}
+
+TEST(GLShadowCacheTest, evictsLeastRecentlyUsed) {
+    GLShadowCache cache(2);
+    cache.getMesh(getKey(0.0f));
+    cache.getMesh(getKey(1.0f));
+    // Touch the oldest entry so that the other one is evicted instead.
+    cache.getMesh(getKey(0.0f));
+    cache.getMesh(getKey(2.0f));
+    EXPECT_EQ(2u, cache.getSize());
+    EXPECT_EQ(1u, cache.getHitCount());
+    EXPECT_EQ(3u, cache.getMissCount());
+
+    cache.getMesh(getKey(0.0f));
+    EXPECT_EQ(2u, cache.getHitCount());
+    cache.getMesh(getKey(1.0f));
+    EXPECT_EQ(4u, cache.getMissCount());
+    EXPECT_EQ(2u, cache.getSize());
+}
+
+TEST(GLShadowCacheTest, dumpsStats) {
+    GLShadowCache cache(8);
+    cache.getMesh(getKey(0.0f));
+    cache.getMesh(getKey(0.0f));
+    std::string result;
+    cache.dump(result);
+    EXPECT_EQ("RenderEngine shadow cache size: 1/8, hits: 1, misses: 1\n", result);
+}
+
+} // namespace
+} // namespace gl
+} // namespace renderengine
+} // namespace android
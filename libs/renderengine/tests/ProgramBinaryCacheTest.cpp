@@ -0,0 +1,98 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <android-base/file.h>
+
+#include "../gl/ProgramBinaryCache.h"
+
+namespace android {
+namespace renderengine {
+namespace gl {
+namespace {
+
+constexpr const char* kDriverVersion = "vendor/renderer/OpenGL ES 3.2 v1";
+
+// The cache never touches GL, so these tests need no context.
+ProgramBinaryCache::Binary getBinary(uint8_t seed) {
+    ProgramBinaryCache::Binary binary;
+    binary.format = 0x1234;
+    for (uint8_t i = 0; i < 64; i++) {
+        binary.data.push_back(seed + i);
+    }
+    return binary;
+}
+
+class ProgramBinaryCacheTest : public ::testing::Test {
+protected:
+    // FileBlobCache creates the file itself.
+    ProgramBinaryCacheTest() { unlink(mFile.path); }
+
+    TemporaryFile mFile;
+};
+
+TEST_F(ProgramBinaryCacheTest, getReturnsWhatWasSet) {
+    ProgramBinaryCache cache(mFile.path, kDriverVersion);
+    ProgramBinaryCache::Binary binary;
+    EXPECT_FALSE(cache.get(1, 42, &binary));
+
+    cache.set(1, 42, getBinary(0));
+    ASSERT_TRUE(cache.get(1, 42, &binary));
+    EXPECT_EQ(getBinary(0).format, binary.format);
+    EXPECT_EQ(getBinary(0).data, binary.data);
+}
+
+TEST_F(ProgramBinaryCacheTest, keyAndSourcesAreBothMatched) {
+    ProgramBinaryCache cache(mFile.path, kDriverVersion);
+    cache.set(1, 42, getBinary(0));
+    cache.set(2, 42, getBinary(1));
+
+    ProgramBinaryCache::Binary binary;
+    EXPECT_FALSE(cache.get(1, 43, &binary));
+    ASSERT_TRUE(cache.get(2, 42, &binary));
+    EXPECT_EQ(getBinary(1).data, binary.data);
+}
+
+TEST_F(ProgramBinaryCacheTest, binariesSurviveSave) {
+    {
+        ProgramBinaryCache cache(mFile.path, kDriverVersion);
+        cache.set(1, 42, getBinary(0));
+        cache.save();
+    }
+
+    ProgramBinaryCache cache(mFile.path, kDriverVersion);
+    ProgramBinaryCache::Binary binary;
+    ASSERT_TRUE(cache.get(1, 42, &binary));
+    EXPECT_EQ(getBinary(0).data, binary.data);
+}
+
+TEST_F(ProgramBinaryCacheTest, driverUpdateMisses) {
+    {
+        ProgramBinaryCache cache(mFile.path, kDriverVersion);
+        cache.set(1, 42, getBinary(0));
+        cache.save();
+    }
+
+    ProgramBinaryCache cache(mFile.path, "vendor/renderer/OpenGL ES 3.2 v2");
+    ProgramBinaryCache::Binary binary;
+    EXPECT_FALSE(cache.get(1, 42, &binary));
+}
+
+} // namespace
+} // namespace gl
+} // namespace renderengine
+} // namespace android
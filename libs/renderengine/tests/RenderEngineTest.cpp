@@ -27,6 +27,7 @@
 #include <renderengine/RenderEngine.h>
 #include <sync/sync.h>
 #include <ui/PixelFormat.h>
+#include "../cpu/CpuRenderEngine.h"
 #include "../gl/GLESRenderEngine.h"
 
 constexpr int DEFAULT_DISPLAY_WIDTH = 128;
@@ -52,6 +53,11 @@ struct RenderEngineTest : public ::testing::Test {
 
         reCreationArgs.useColorManagement = true;
         sRECM = renderengine::gl::GLESRenderEngine::create(reCreationArgs);
+
+        reCreationArgs.useColorManagement = false;
+        sCpuRE = renderengine::cpu::CpuRenderEngine::create(reCreationArgs);
+        reCreationArgs.useColorManagement = true;
+        sCpuRECM = renderengine::cpu::CpuRenderEngine::create(reCreationArgs);
     }
 
     static void TearDownTestSuite() {
@@ -59,6 +65,8 @@ struct RenderEngineTest : public ::testing::Test {
         // than RenderEngine to avoid a null reference on tear-down.
         sRE = nullptr;
         sRECM = nullptr;
+        sCpuRE = nullptr;
+        sCpuRECM = nullptr;
         sCurrentBuffer = nullptr;
     }
 
@@ -78,7 +86,10 @@ struct RenderEngineTest : public ::testing::Test {
                                  "input");
     }
 
-    RenderEngineTest() { mBuffer = allocateDefaultBuffer(); }
+    RenderEngineTest() {
+        mBuffer = allocateDefaultBuffer();
+        mCpuBuffer = allocateDefaultBuffer();
+    }
 
     ~RenderEngineTest() {
         if (WRITE_BUFFER_TO_FILE_ON_FAILURE && ::testing::Test::HasFailure()) {
@@ -156,14 +167,26 @@ struct RenderEngineTest : public ::testing::Test {
 
     void expectBufferColor(const Rect& region, uint8_t r, uint8_t g, uint8_t b, uint8_t a,
                            std::function<bool(const uint8_t* a, const uint8_t* b)> colorCompare) {
+        expectBufferColor(mBuffer, region, r, g, b, a, colorCompare);
+        // Whatever the GLES backend is expected to draw, the CPU backend
+        // should draw too.
+        if (mCpuBufferDrawn) {
+            SCOPED_TRACE("CPU backend");
+            expectBufferColor(mCpuBuffer, region, r, g, b, a, colorCompare);
+        }
+    }
+
+    void expectBufferColor(const sp<GraphicBuffer>& buffer, const Rect& region, uint8_t r,
+                           uint8_t g, uint8_t b, uint8_t a,
+                           std::function<bool(const uint8_t* a, const uint8_t* b)> colorCompare) {
         uint8_t* pixels;
-        mBuffer->lock(GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN,
-                      reinterpret_cast<void**>(&pixels));
+        buffer->lock(GRALLOC_USAGE_SW_READ_OFTEN | GRALLOC_USAGE_SW_WRITE_OFTEN,
+                     reinterpret_cast<void**>(&pixels));
         int32_t maxFails = 10;
         int32_t fails = 0;
         for (int32_t j = 0; j < region.getHeight(); j++) {
             const uint8_t* src =
-                    pixels + (mBuffer->getStride() * (region.top + j) + region.left) * 4;
+                    pixels + (buffer->getStride() * (region.top + j) + region.left) * 4;
             for (int32_t i = 0; i < region.getWidth(); i++) {
                 const uint8_t expected[4] = {r, g, b, a};
                 bool equal = colorCompare(src, expected);
@@ -184,6 +207,28 @@ struct RenderEngineTest : public ::testing::Test {
                 break;
             }
         }
+        buffer->unlock();
+    }
+
+    // Compares mBuffer with another buffer drawn by the GLES backend.
+    void expectBufferMatches(const sp<GraphicBuffer>& other, uint8_t tolerance = 0) {
+        uint8_t* pixels;
+        uint8_t* otherPixels;
+        mBuffer->lock(GRALLOC_USAGE_SW_READ_OFTEN, reinterpret_cast<void**>(&pixels));
+        other->lock(GRALLOC_USAGE_SW_READ_OFTEN, reinterpret_cast<void**>(&otherPixels));
+        int32_t fails = 0;
+        for (int32_t j = 0; j < DEFAULT_DISPLAY_HEIGHT && fails < 10; j++) {
+            for (int32_t i = 0; i < DEFAULT_DISPLAY_WIDTH && fails < 10; i++) {
+                const uint8_t* a = pixels + (mBuffer->getStride() * j + i) * 4;
+                const uint8_t* b = otherPixels + (other->getStride() * j + i) * 4;
+                const bool equal = std::equal(a, a + 4, b, [tolerance](uint8_t x, uint8_t y) {
+                    return (x >= y ? x - y : y - x) <= tolerance;
+                });
+                EXPECT_TRUE(equal) << "pixel @ (" << i << ", " << j << ")";
+                fails += equal ? 0 : 1;
+            }
+        }
+        other->unlock();
         mBuffer->unlock();
     }
 
@@ -283,6 +328,14 @@ struct RenderEngineTest : public ::testing::Test {
                 ASSERT_TRUE(sRE->isFramebufferImageCachedForTesting(buffer->getId()));
             }
         }
+
+        if (buffer == mBuffer) {
+            const auto& cpuRE = useColorManagement ? sCpuRECM : sCpuRE;
+            status = cpuRE->drawLayers(settings, layers, mCpuBuffer->getNativeBuffer(), true,
+                                       base::unique_fd(), &fence);
+            ASSERT_EQ(NO_ERROR, status);
+            mCpuBufferDrawn = true;
+        }
     }
 
     void drawEmptyLayers() {
@@ -385,12 +438,18 @@ struct RenderEngineTest : public ::testing::Test {
     static std::unique_ptr<renderengine::gl::GLESRenderEngine> sRE;
     // renderengine object with Color Management enabled
     static std::unique_ptr<renderengine::gl::GLESRenderEngine> sRECM;
+    // The CPU backend draws everything the GLES backend does into mCpuBuffer,
+    // so that the same expectations hold for both.
+    static std::unique_ptr<renderengine::cpu::CpuRenderEngine> sCpuRE;
+    static std::unique_ptr<renderengine::cpu::CpuRenderEngine> sCpuRECM;
     // Dumb hack to avoid NPE in the EGL driver: the GraphicBuffer needs to
     // be freed *after* RenderEngine is destroyed, so that the EGL image is
     // destroyed first.
     static sp<GraphicBuffer> sCurrentBuffer;
 
     sp<GraphicBuffer> mBuffer;
+    sp<GraphicBuffer> mCpuBuffer;
+    bool mCpuBufferDrawn = false;
 
     std::vector<uint32_t> mTexNames;
     std::vector<uint32_t> mTexNamesCM;
@@ -398,6 +457,8 @@ struct RenderEngineTest : public ::testing::Test {
 
 std::unique_ptr<renderengine::gl::GLESRenderEngine> RenderEngineTest::sRE = nullptr;
 std::unique_ptr<renderengine::gl::GLESRenderEngine> RenderEngineTest::sRECM = nullptr;
+std::unique_ptr<renderengine::cpu::CpuRenderEngine> RenderEngineTest::sCpuRE = nullptr;
+std::unique_ptr<renderengine::cpu::CpuRenderEngine> RenderEngineTest::sCpuRECM = nullptr;
 
 sp<GraphicBuffer> RenderEngineTest::sCurrentBuffer = nullptr;
 
@@ -1450,6 +1511,176 @@ TEST_F(RenderEngineTest, drawLayers_fillShadow_translucentCasterWithAlpha) {
                       backgroundColor.a);
 }
 
+TEST_F(RenderEngineTest, drawLayers_batchedColorLayers_matchUnbatched) {
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+
+    // Overlapping translucent layers, so that a change in blend order would show.
+    std::vector<renderengine::LayerSettings> layerSettings(8);
+    std::vector<const renderengine::LayerSettings*> layers;
+    for (size_t i = 0; i < layerSettings.size(); i++) {
+        renderengine::LayerSettings& layer = layerSettings[i];
+        const float offset = 8.0f * i;
+        layer.geometry.boundaries = FloatRect(offset, offset, offset + 48.0f, offset + 64.0f);
+        layer.geometry.positionTransform = mat4::translate(vec4(4.0f * i, 0.0f, 0.0f, 0.0f));
+        layer.source.solidColor = half3(i % 2, 0.5f, 1.0f - i / 8.0f);
+        layer.alpha = 0.3f + 0.1f * i;
+        layers.push_back(&layer);
+    }
+
+    sp<GraphicBuffer> unbatchedBuffer = allocateDefaultBuffer();
+    sRE->setLayerBatchingEnabledForTesting(false);
+    invokeDraw(settings, layers, unbatchedBuffer);
+    EXPECT_EQ(layers.size(), sRE->getLastFrameDrawCallsForTesting());
+
+    sRE->setLayerBatchingEnabledForTesting(true);
+    invokeDraw(settings, layers, mBuffer);
+    EXPECT_EQ(1u, sRE->getLastFrameDrawCallsForTesting());
+
+    // The per-vertex color is interpolated, which some GPUs may round differently.
+    expectBufferMatches(unbatchedBuffer, 1 /* tolerance */);
+}
+
+TEST_F(RenderEngineTest, drawLayers_blurSmallLayer_onlyBlursBehindLayer) {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.surface_flinger.supports_background_blur", value, "0");
+    if (!atoi(value)) {
+        // This device doesn't support blurs, no-op.
+        return;
+    }
+
+    const auto center = DEFAULT_DISPLAY_WIDTH / 2;
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+
+    renderengine::LayerSettings backgroundLayer;
+    backgroundLayer.geometry.boundaries = fullscreenRect().toFloatRect();
+    backgroundLayer.source.solidColor = half3(0.0f, 1.0f, 0.0f);
+    backgroundLayer.alpha = 1.0f;
+
+    renderengine::LayerSettings leftLayer;
+    leftLayer.geometry.boundaries = Rect(center, DEFAULT_DISPLAY_HEIGHT).toFloatRect();
+    leftLayer.source.solidColor = half3(1.0f, 0.0f, 0.0f);
+    leftLayer.alpha = 1.0f;
+
+    // Straddles both colors in the upper part of the display only, so that a flipped
+    // blur region would show.
+    renderengine::LayerSettings blurLayer;
+    blurLayer.geometry.boundaries = Rect(center - 16, 32, center + 16, 96).toFloatRect();
+    blurLayer.backgroundBlurRadius = 50;
+    blurLayer.alpha = 0;
+
+    renderengine::LayerSettings fullscreenBlurLayer = blurLayer;
+    fullscreenBlurLayer.geometry.boundaries = fullscreenRect().toFloatRect();
+    invokeDraw(settings, {&backgroundLayer, &leftLayer, &fullscreenBlurLayer}, mBuffer);
+    const size_t fullscreenBlurredPixels = sRE->getLastFrameBlurredPixelsForTesting();
+
+    invokeDraw(settings, {&backgroundLayer, &leftLayer, &blurLayer}, mBuffer);
+    EXPECT_GT(sRE->getLastFrameBlurredPixelsForTesting(), 0u);
+    EXPECT_LT(sRE->getLastFrameBlurredPixelsForTesting(), fullscreenBlurredPixels);
+
+    expectBufferColor(Rect(center - 1, 60, center, 68), 150, 150, 0, 255, 50 /* tolerance */);
+    expectBufferColor(Rect(center, 60, center + 1, 68), 150, 150, 0, 255, 50 /* tolerance */);
+    expectBufferColor(Rect(0, 0, center - 16, DEFAULT_DISPLAY_HEIGHT), 255, 0, 0, 255);
+    expectBufferColor(Rect(center - 16, 96, center, DEFAULT_DISPLAY_HEIGHT), 255, 0, 0, 255);
+    expectBufferColor(Rect(center, 96, DEFAULT_DISPLAY_WIDTH, DEFAULT_DISPLAY_HEIGHT), 0, 255, 0,
+                      255);
+}
+
+TEST_F(RenderEngineTest, drawLayers_blurUnchangedBackground_reusesBlur) {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.surface_flinger.supports_background_blur", value, "0");
+    if (!atoi(value)) {
+        // This device doesn't support blurs, no-op.
+        return;
+    }
+
+    const auto center = DEFAULT_DISPLAY_WIDTH / 2;
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+
+    renderengine::LayerSettings backgroundLayer;
+    backgroundLayer.geometry.boundaries = fullscreenRect().toFloatRect();
+    backgroundLayer.source.solidColor = half3(0.0f, 1.0f, 0.0f);
+    backgroundLayer.alpha = 1.0f;
+
+    renderengine::LayerSettings leftLayer;
+    leftLayer.geometry.boundaries = Rect(center, DEFAULT_DISPLAY_HEIGHT).toFloatRect();
+    leftLayer.source.solidColor = half3(1.0f, 0.0f, 0.0f);
+    leftLayer.alpha = 1.0f;
+
+    renderengine::LayerSettings blurLayer;
+    blurLayer.geometry.boundaries = fullscreenRect().toFloatRect();
+    blurLayer.backgroundBlurRadius = 50;
+    blurLayer.alpha = 0;
+
+    const std::vector<const renderengine::LayerSettings*> layers = {&backgroundLayer,
+                                                                    &leftLayer, &blurLayer};
+    invokeDraw(settings, layers, mBuffer);
+
+    // Nothing changed beneath the blur, so it's not redone, and looks the same.
+    sp<GraphicBuffer> reusedBuffer = allocateDefaultBuffer();
+    invokeDraw(settings, layers, reusedBuffer);
+    EXPECT_EQ(0u, sRE->getLastFrameBlurredPixelsForTesting());
+    expectBufferMatches(reusedBuffer);
+
+    leftLayer.source.solidColor = half3(0.0f, 0.0f, 1.0f);
+    invokeDraw(settings, layers, mBuffer);
+    EXPECT_GT(sRE->getLastFrameBlurredPixelsForTesting(), 0u);
+    expectBufferColor(Rect(center - 1, center - 5, center, center + 5), 0, 150, 150, 255,
+                      50 /* tolerance */);
+    expectBufferColor(Rect(center, center - 5, center + 1, center + 5), 0, 150, 150, 255,
+                      50 /* tolerance */);
+}
+
+TEST_F(RenderEngineTest, drawLayers_blurOffscreen_keepsReusableBlur) {
+    char value[PROPERTY_VALUE_MAX];
+    property_get("ro.surface_flinger.supports_background_blur", value, "0");
+    if (!atoi(value)) {
+        // This device doesn't support blurs, no-op.
+        return;
+    }
+
+    const auto center = DEFAULT_DISPLAY_WIDTH / 2;
+    renderengine::DisplaySettings settings;
+    settings.physicalDisplay = fullscreenRect();
+    settings.clip = fullscreenRect();
+
+    renderengine::LayerSettings backgroundLayer;
+    backgroundLayer.geometry.boundaries = fullscreenRect().toFloatRect();
+    backgroundLayer.source.solidColor = half3(0.0f, 1.0f, 0.0f);
+    backgroundLayer.alpha = 1.0f;
+
+    renderengine::LayerSettings leftLayer;
+    leftLayer.geometry.boundaries = Rect(center, DEFAULT_DISPLAY_HEIGHT).toFloatRect();
+    leftLayer.source.solidColor = half3(1.0f, 0.0f, 0.0f);
+    leftLayer.alpha = 1.0f;
+
+    renderengine::LayerSettings blurLayer;
+    blurLayer.geometry.boundaries = fullscreenRect().toFloatRect();
+    blurLayer.backgroundBlurRadius = 50;
+    blurLayer.alpha = 0;
+
+    const std::vector<const renderengine::LayerSettings*> layers = {&backgroundLayer,
+                                                                    &leftLayer, &blurLayer};
+    invokeDraw(settings, layers, mBuffer);
+
+    // A frame in which the blur covers nothing on screen.
+    renderengine::LayerSettings offscreenBlurLayer = blurLayer;
+    offscreenBlurLayer.geometry.boundaries = FloatRect(-400.0f, -400.0f, -300.0f, -300.0f);
+    sp<GraphicBuffer> offscreenBuffer = allocateDefaultBuffer();
+    invokeDraw(settings, {&backgroundLayer, &leftLayer, &offscreenBlurLayer}, offscreenBuffer);
+
+    // The earlier blur is still reused, rather than the unblurred background.
+    sp<GraphicBuffer> reusedBuffer = allocateDefaultBuffer();
+    invokeDraw(settings, layers, reusedBuffer);
+    EXPECT_EQ(0u, sRE->getLastFrameBlurredPixelsForTesting());
+    expectBufferMatches(reusedBuffer);
+}
+
 TEST_F(RenderEngineTest, cleanupPostRender_cleansUpOnce) {
     renderengine::DisplaySettings settings;
     settings.physicalDisplay = fullscreenRect();
@@ -6,6 +6,7 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <string_view>
 #include <vector>
 
 #include <pdx/rpc/argument_encoder.h>
@@ -440,6 +441,17 @@ int main(int /*argc*/, char** /*argv*/) {
   test_runner.AddDeserializationTest(GenerateContainerName("string", 10240),
                                      std::string(10240, '*'));
 
+  // std::string_view deserializes to a view into the input buffer instead of
+  // copying the payload; compare with the string tests above.
+  const std::vector<std::string> view_strings = {
+      std::string(0, '*'),  std::string(1, '*'),   std::string(8, '*'),
+      std::string(64, '*'), std::string(256, '*'), std::string(10240, '*')};
+  for (const auto& view_string : view_strings) {
+    test_runner.AddDeserializationTest(
+        GenerateContainerName("string_view", view_string.size()),
+        std::string_view(view_string));
+  }
+
   for (size_t len : {0, 1, 8, 64, 256}) {
     std::vector<int32_t> int_vector(len);
     std::iota(int_vector.begin(), int_vector.end(), 0);
@@ -0,0 +1,59 @@
+#ifndef ANDROID_PDX_RPC_BUFFER_VIEW_H_
+#define ANDROID_PDX_RPC_BUFFER_VIEW_H_
+
+#include <cstddef>
+#include <type_traits>
+
+namespace android {
+namespace pdx {
+namespace rpc {
+
+// Read-only view of a buffer, serialized to the same format as BufferWrapper.
+// Deserializing a BufferView does not copy the payload: the view points
+// directly into the input buffer of the message. This lets remote method
+// handlers take large buffers without copying them, by declaring a BufferView
+// parameter where the method signature uses a BufferWrapper.
+//
+// The view is only valid for as long as the message buffer it was deserialized
+// from. For remote method handlers this is the duration of the handler call; a
+// handler must not keep the view beyond that or use it after moving the
+// message for a delayed reply.
+//
+// Bin payloads have no alignment, so only byte sized value types are
+// supported.
+template <typename T>
+class BufferView {
+ public:
+  static_assert(sizeof(T) == 1 && std::is_trivially_copyable<T>::value,
+                "BufferView only supports byte sized trivial types.");
+
+  // Define types in the style of STL containers to support STL operators.
+  typedef T value_type;
+  typedef std::size_t size_type;
+  typedef const T& const_reference;
+  typedef const T* const_pointer;
+  typedef const T* const_iterator;
+
+  BufferView() : data_(nullptr), size_(0) {}
+  BufferView(const_pointer data, size_type size) : data_(data), size_(size) {}
+
+  const_pointer data() const { return data_; }
+
+  const_iterator begin() const { return data_; }
+  const_iterator end() const { return data_ + size_; }
+
+  size_type size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const_reference operator[](size_type pos) const { return data_[pos]; }
+
+ private:
+  const_pointer data_;
+  size_type size_;
+};
+
+}  // namespace rpc
+}  // namespace pdx
+}  // namespace android
+
+#endif  // ANDROID_PDX_RPC_BUFFER_VIEW_H_
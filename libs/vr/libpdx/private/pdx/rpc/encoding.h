@@ -7,6 +7,7 @@
 #include <map>
 #include <numeric>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <unordered_map>
 #include <vector>
@@ -15,6 +16,7 @@
 #include <pdx/file_handle.h>
 
 #include "array_wrapper.h"
+#include "buffer_view.h"
 #include "buffer_wrapper.h"
 #include "string_wrapper.h"
 #include "variant.h"
@@ -451,6 +453,10 @@ inline constexpr EncodingType EncodeType(const std::string& value) {
   return EncodeStringType(value.length());
 }
 
+inline constexpr EncodingType EncodeType(const std::string_view& value) {
+  return EncodeStringType(value.length());
+}
+
 template <typename T, std::size_t Size>
 inline constexpr EncodingType EncodeType(const std::array<T, Size>& /*value*/) {
   return EncodeArrayType(Size);
@@ -487,6 +493,12 @@ inline constexpr EncodingType EncodeType(const BufferWrapper<T>& value) {
                        sizeof(typename BufferWrapper<T>::value_type));
 }
 
+template <typename T>
+inline constexpr EncodingType EncodeType(const BufferView<T>& value) {
+  // BIN size is in bytes.
+  return EncodeBinType(value.size() * sizeof(T));
+}
+
 template <typename T, typename U>
 inline constexpr EncodingType EncodeType(const std::pair<T, U>& /*value*/) {
   return EncodeArrayType(2);
@@ -8,6 +8,7 @@
 #include <numeric>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
 #include <unordered_map>
@@ -22,6 +23,7 @@
 #include <pdx/utility.h>
 
 #include "array_wrapper.h"
+#include "buffer_view.h"
 #include "default_initialization_allocator.h"
 #include "encoding.h"
 #include "pointer_wrapper.h"
@@ -58,6 +60,9 @@ namespace rpc {
 //   * ArrayWrapper of any supported basic type.
 //   * BufferWrapper of any POD type.
 //   * StringWrapper of any supported char type.
+//   * std::string_view and BufferView of byte sized POD types. These
+//     deserialize to views into the input buffer instead of copying the
+//     payload; see buffer_view.h for the lifetime rules.
 //   * User types with correctly defined SerializableMembers member type.
 //
 // Planned support for:
@@ -254,10 +259,13 @@ inline constexpr std::size_t GetSerializedSize(const T&);
 template <typename T>
 inline constexpr std::size_t GetSerializedSize(const PointerWrapper<T>&);
 inline constexpr std::size_t GetSerializedSize(const std::string&);
+inline constexpr std::size_t GetSerializedSize(const std::string_view&);
 template <typename T>
 inline constexpr std::size_t GetSerializedSize(const StringWrapper<T>&);
 template <typename T>
 inline constexpr std::size_t GetSerializedSize(const BufferWrapper<T>&);
+template <typename T>
+inline constexpr std::size_t GetSerializedSize(const BufferView<T>&);
 template <FileHandleMode Mode>
 inline constexpr std::size_t GetSerializedSize(const FileHandle<Mode>&);
 template <ChannelHandleMode Mode>
@@ -312,6 +320,12 @@ inline constexpr std::size_t GetSerializedSize(const std::string& s) {
          s.length() * sizeof(std::string::value_type);
 }
 
+// Overload for std::string_view.
+inline constexpr std::size_t GetSerializedSize(const std::string_view& s) {
+  return GetEncodingSize(EncodeType(s)) +
+         s.length() * sizeof(std::string_view::value_type);
+}
+
 // Overload for StringWrapper.
 template <typename T>
 inline constexpr std::size_t GetSerializedSize(const StringWrapper<T>& s) {
@@ -326,6 +340,12 @@ inline constexpr std::size_t GetSerializedSize(const BufferWrapper<T>& b) {
          b.size() * sizeof(typename BufferWrapper<T>::value_type);
 }
 
+// Overload for BufferView types.
+template <typename T>
+inline constexpr std::size_t GetSerializedSize(const BufferView<T>& b) {
+  return GetEncodingSize(EncodeType(b)) + b.size() * sizeof(T);
+}
+
 // Overload for FileHandle. FileHandle is encoded as a FIXEXT2, with a type code
 // of "FileHandle" and a signed 16-bit offset into the pushed fd array. Empty
 // FileHandles are encoded with an array index of -1.
@@ -537,11 +557,15 @@ inline void SerializeStringType(const StringType& value, void*& buffer) {
   }
 }
 
-// Serializes the type code for std::string and StringWrapper. These types are
-// interchangeable and must serialize to the same format.
+// Serializes the type code for std::string, std::string_view and
+// StringWrapper. These types are interchangeable and must serialize to the same
+// format.
 inline void SerializeType(const std::string& value, void*& buffer) {
   SerializeStringType(value, buffer);
 }
+inline void SerializeType(const std::string_view& value, void*& buffer) {
+  SerializeStringType(value, buffer);
+}
 template <typename T>
 inline void SerializeType(const StringWrapper<T>& value, void*& buffer) {
   SerializeStringType(value, buffer);
@@ -574,6 +598,13 @@ inline void SerializeType(const BufferWrapper<T>& value, void*& buffer) {
       buffer);
 }
 
+// Serializes the type code for BufferView types.
+template <typename T>
+inline void SerializeType(const BufferView<T>& value, void*& buffer) {
+  const EncodingType encoding = EncodeType(value);
+  SerializeBinEncoding(encoding, value.size() * sizeof(T), buffer);
+}
+
 // Serializes the array encoding type and length.
 inline void SerializeArrayEncoding(EncodingType encoding, std::size_t size,
                                    void*& buffer) {
@@ -850,7 +881,10 @@ template <typename T, typename Allocator>
 inline void SerializeObject(const BufferWrapper<std::vector<T, Allocator>>&, MessageWriter*, void*&);
 template <typename T>
 inline void SerializeObject(const BufferWrapper<T*>&, MessageWriter*, void*&);
+template <typename T>
+inline void SerializeObject(const BufferView<T>&, MessageWriter*, void*&);
 inline void SerializeObject(const std::string&, MessageWriter*, void*&);
+inline void SerializeObject(const std::string_view&, MessageWriter*, void*&);
 template <typename T>
 inline void SerializeObject(const StringWrapper<T>&, MessageWriter*, void*&);
 template <typename T, typename Allocator>
@@ -940,6 +974,12 @@ inline void SerializeObject(const BufferWrapper<T*>& b,
   SerializeType(b, buffer);
   WriteRawData(buffer, b.data(), b.size() * value_type_size);
 }
+template <typename T>
+inline void SerializeObject(const BufferView<T>& b, MessageWriter* /*writer*/,
+                            void*& buffer) {
+  SerializeType(b, buffer);
+  WriteRawData(buffer, b.data(), b.size() * sizeof(T));
+}
 
 // Serializes the payload of string types.
 template <typename StringType>
@@ -949,12 +989,17 @@ inline void SerializeString(const StringType& s, void*& buffer) {
   WriteRawData(buffer, s.data(), s.length() * value_type_size);
 }
 
-// Overload of SerializeObject() for std::string and StringWrapper. These types
-// are interchangeable and must serialize to the same format.
+// Overload of SerializeObject() for std::string, std::string_view and
+// StringWrapper. These types are interchangeable and must serialize to the same
+// format.
 inline void SerializeObject(const std::string& s, MessageWriter* /*writer*/,
                             void*& buffer) {
   SerializeString(s, buffer);
 }
+inline void SerializeObject(const std::string_view& s,
+                            MessageWriter* /*writer*/, void*& buffer) {
+  SerializeString(s, buffer);
+}
 template <typename T>
 inline void SerializeObject(const StringWrapper<T>& s,
                             MessageWriter* /*writer*/, void*& buffer) {
@@ -1125,6 +1170,19 @@ inline ErrorType ReadRawData(void* dest, MessageReader* /*reader*/,
   return ErrorCode::NO_ERROR;
 }
 
+// Points |data| at the next |size| bytes of the input buffer without copying
+// them. Like ReadRawData(), this requires the data to be contiguous in the
+// current buffer section.
+inline ErrorType ReadRawDataView(const void** data, MessageReader* /*reader*/,
+                                 const void*& start, const void*& end,
+                                 size_t size) {
+  if (PDX_UNLIKELY(AdvancePointer(start, size) > end))
+    return ErrorCode::INSUFFICIENT_BUFFER;
+  *data = start;
+  start = AdvancePointer(start, size);
+  return ErrorCode::NO_ERROR;
+}
+
 // Deserializes a primitive object from raw bytes.
 template <typename T,
           typename = typename std::enable_if<std::is_pod<T>::value>::type>
@@ -1397,8 +1455,13 @@ inline ErrorType DeserializeObject(BufferWrapper<std::vector<T, Allocator>>*,
 template <typename T>
 inline ErrorType DeserializeObject(BufferWrapper<T*>*, MessageReader*,
                                    const void*&, const void*&);
+template <typename T>
+inline ErrorType DeserializeObject(BufferView<T>*, MessageReader*,
+                                   const void*&, const void*&);
 inline ErrorType DeserializeObject(std::string*, MessageReader*, const void*&,
                                    const void*&);
+inline ErrorType DeserializeObject(std::string_view*, MessageReader*,
+                                   const void*&, const void*&);
 template <typename T>
 inline ErrorType DeserializeObject(StringWrapper<T>*, MessageReader*,
                                    const void*&, const void*&);
@@ -1609,6 +1672,30 @@ inline ErrorType DeserializeObject(BufferWrapper<T*>* value,
   }
 }
 
+// Overload of DeserializeObject() for BufferView types. The view points into
+// the input buffer, no data is copied.
+template <typename T>
+inline ErrorType DeserializeObject(BufferView<T>* value, MessageReader* reader,
+                                   const void*& start, const void*& end) {
+  EncodingType encoding;
+  std::size_t size;
+  const void* data = nullptr;
+
+  if (const auto error =
+          DeserializeBinType(&encoding, &size, reader, start, end)) {
+    return error;
+  } else if (size == 0U) {
+    *value = BufferView<T>();
+    return ErrorCode::NO_ERROR;
+  } else if (const auto error =
+                 ReadRawDataView(&data, reader, start, end, size)) {
+    return error;
+  } else {
+    *value = BufferView<T>(static_cast<const T*>(data), size / sizeof(T));
+    return ErrorCode::NO_ERROR;
+  }
+}
+
 // Deserializes the type code and size for string types.
 inline ErrorType DeserializeStringType(EncodingType* encoding,
                                        std::size_t* size, MessageReader* reader,
@@ -1648,6 +1735,30 @@ inline ErrorType DeserializeObject(std::string* value, MessageReader* reader,
   }
 }
 
+// Overload of DeserializeObject() for std::string_view. The view points into
+// the input buffer, no data is copied.
+inline ErrorType DeserializeObject(std::string_view* value,
+                                   MessageReader* reader, const void*& start,
+                                   const void*& end) {
+  EncodingType encoding;
+  std::size_t size;
+  const void* data = nullptr;
+
+  if (const auto error =
+          DeserializeStringType(&encoding, &size, reader, start, end)) {
+    return error;
+  } else if (size == 0U) {
+    *value = std::string_view();
+    return ErrorCode::NO_ERROR;
+  } else if (const auto error =
+                 ReadRawDataView(&data, reader, start, end, size)) {
+    return error;
+  } else {
+    *value = std::string_view(static_cast<const char*>(data), size);
+    return ErrorCode::NO_ERROR;
+  }
+}
+
 // Overload of DeserializeObject() for StringWrapper types.
 template <typename T>
 inline ErrorType DeserializeObject(StringWrapper<T>* value,
@@ -3,6 +3,8 @@
 
 #include <array>
 #include <map>
+#include <string>
+#include <string_view>
 #include <type_traits>
 #include <unordered_map>
 #include <vector>
@@ -10,6 +12,7 @@
 #include <pdx/channel_handle.h>
 #include <pdx/file_handle.h>
 #include <pdx/rpc/array_wrapper.h>
+#include <pdx/rpc/buffer_view.h>
 #include <pdx/rpc/buffer_wrapper.h>
 #include <pdx/rpc/copy_cv_reference.h>
 #include <pdx/rpc/pointer_wrapper.h>
@@ -146,6 +149,20 @@ template <typename A, typename B>
 struct IsConvertible<BufferWrapper<A*>, BufferWrapper<B*>>
     : IsEquivalent<A, B> {};
 
+// Compares BufferWrapper and BufferView; these are convertible if the value
+// types are equivalent. This lets remote method handlers take a BufferView in
+// place of a BufferWrapper parameter to avoid copying the payload.
+template <typename A, typename B, typename Allocator>
+struct IsConvertible<BufferWrapper<std::vector<A, Allocator>>, BufferView<B>>
+    : IsEquivalent<A, B> {};
+template <typename A, typename B, typename Allocator>
+struct IsConvertible<BufferView<A>, BufferWrapper<std::vector<B, Allocator>>>
+    : IsEquivalent<A, B> {};
+template <typename A, typename B>
+struct IsConvertible<BufferWrapper<A*>, BufferView<B>> : IsEquivalent<A, B> {};
+template <typename A, typename B>
+struct IsConvertible<BufferView<A>, BufferWrapper<B*>> : IsEquivalent<A, B> {};
+
 // Compares std::basic_string<A, ...> and StringWrapper<B>; these are
 // convertible if A and B are equivalent.
 template <typename A, typename B, typename... Any>
@@ -155,6 +172,22 @@ template <typename A, typename B, typename... Any>
 struct IsConvertible<StringWrapper<A>, std::basic_string<B, Any...>>
     : IsEquivalent<A, B> {};
 
+// Compares std::string_view with std::string and StringWrapper<char>; these
+// are always convertible. This lets remote method handlers take a
+// std::string_view in place of a string parameter to avoid copying the payload.
+template <typename... Any>
+struct IsConvertible<std::basic_string<char, Any...>, std::string_view>
+    : std::true_type {};
+template <typename... Any>
+struct IsConvertible<std::string_view, std::basic_string<char, Any...>>
+    : std::true_type {};
+template <typename A>
+struct IsConvertible<StringWrapper<A>, std::string_view>
+    : IsEquivalent<A, char> {};
+template <typename B>
+struct IsConvertible<std::string_view, StringWrapper<B>>
+    : IsEquivalent<char, B> {};
+
 // Compares PointerWrapper<A> and B; these are convertible if A and B are
 // convertible.
 template <typename A, typename B>
@@ -4,12 +4,14 @@
 
 #include <memory>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <utility>
 
 #include <gtest/gtest.h>
 #include <pdx/rpc/argument_encoder.h>
 #include <pdx/rpc/array_wrapper.h>
+#include <pdx/rpc/buffer_view.h>
 #include <pdx/rpc/default_initialization_allocator.h>
 #include <pdx/rpc/payload.h>
 #include <pdx/rpc/serializable.h>
@@ -857,6 +859,38 @@ TEST(SerializationTest, StringWrapper) {
   result.Clear();
 }
 
+TEST(SerializationTest, string_view) {
+  Payload result;
+  Payload expected;
+  std::string value;
+
+  // std::string_view must serialize to the same format as std::string.
+  for (std::size_t size : {0, (1 << 5) - 1, 1 << 5, 1 << 8, 1 << 16}) {
+    value = std::string(size, 'x');
+    Serialize(std::string_view(value), &result);
+    Serialize(value, &expected);
+    EXPECT_EQ(expected, result);
+    result.Clear();
+    expected.Clear();
+  }
+}
+
+TEST(SerializationTest, BufferView) {
+  Payload result;
+  Payload expected;
+  std::vector<std::uint8_t> value;
+
+  // BufferView must serialize to the same format as BufferWrapper.
+  for (std::size_t size : {0, 1, 1 << 8, 1 << 16}) {
+    value = std::vector<std::uint8_t>(size, 'x');
+    Serialize(BufferView<std::uint8_t>(value.data(), value.size()), &result);
+    Serialize(WrapBuffer(value.data(), value.size()), &expected);
+    EXPECT_EQ(expected, result);
+    result.Clear();
+    expected.Clear();
+  }
+}
+
 TEST(SerializationTest, vector) {
   Payload result;
   Payload expected;
@@ -1991,6 +2025,82 @@ TEST(DeserializationTest, string) {
   EXPECT_EQ(std::string(0x10000, 'x'), result);
 }
 
+TEST(DeserializationTest, string_view) {
+  Payload buffer;
+  std::string_view result;
+  ErrorType error;
+
+  // Min FIXSTR.
+  buffer = {ENCODING_TYPE_FIXSTR_MIN};
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ("", result);
+
+  // Max STR8. The view must point into the input buffer.
+  buffer = {ENCODING_TYPE_STR8, 0xff};
+  buffer.Append(0xff, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(std::string(0xff, 'x'), result);
+  EXPECT_EQ(reinterpret_cast<const char*>(buffer.Data() + 2), result.data());
+
+  // STR32 with max STR16 + 1 bytes.
+  buffer = {ENCODING_TYPE_STR32, 0x00, 0x00, 0x01, 0x00};
+  buffer.Append(0x10000, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(std::string(0x10000, 'x'), result);
+  EXPECT_EQ(reinterpret_cast<const char*>(buffer.Data() + 5), result.data());
+
+  // Payload extends past the end of the buffer.
+  buffer = {ENCODING_TYPE_STR8, 0x10};
+  buffer.Append(0x0f, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_BUFFER, error);
+}
+
+TEST(DeserializationTest, BufferView) {
+  Payload buffer;
+  BufferView<std::uint8_t> result;
+  ErrorType error;
+
+  // Min BIN8.
+  buffer = {ENCODING_TYPE_BIN8, 0x00};
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_TRUE(result.empty());
+
+  // Max BIN8. The view must point into the input buffer.
+  buffer = {ENCODING_TYPE_BIN8, 0xff};
+  buffer.Append(0xff, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(0xffu, result.size());
+  EXPECT_EQ(buffer.Data() + 2, result.data());
+  EXPECT_EQ(std::vector<std::uint8_t>(0xff, 'x'),
+            std::vector<std::uint8_t>(result.begin(), result.end()));
+
+  // BIN32 with max BIN16 + 1 bytes.
+  buffer = {ENCODING_TYPE_BIN32, 0x00, 0x00, 0x01, 0x00};
+  buffer.Append(0x10000, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::NO_ERROR, error);
+  EXPECT_EQ(0x10000u, result.size());
+  EXPECT_EQ(buffer.Data() + 5, result.data());
+
+  // Payload extends past the end of the buffer.
+  buffer = {ENCODING_TYPE_BIN8, 0x10};
+  buffer.Append(0x0f, 'x');
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::INSUFFICIENT_BUFFER, error);
+
+  // Strings are not bin encoded.
+  buffer = {ENCODING_TYPE_FIXSTR_MIN};
+  error = Deserialize(&result, &buffer);
+  EXPECT_EQ(ErrorCode::UNEXPECTED_ENCODING, error);
+  EXPECT_EQ(ENCODING_CLASS_BINARY, error.encoding_class());
+}
+
 TEST(DeserializationTest, vector) {
   Payload buffer;
   std::vector<std::uint8_t, DefaultInitializationAllocator<std::uint8_t>>
@@ -9,6 +9,7 @@
 #include <errno.h>
 #include <getopt.h>
 #include <pdx/client.h>
+#include <pdx/default_transport/client_channel.h>
 #include <pdx/default_transport/client_channel_factory.h>
 #include <pdx/default_transport/service_endpoint.h>
 #include <pdx/rpc/buffer_wrapper.h>
@@ -28,6 +29,7 @@
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <numeric>
 #include <sstream>
@@ -42,6 +44,7 @@ using android::pdx::ErrorStatus;
 using android::pdx::Message;
 using android::pdx::Service;
 using android::pdx::ServiceBase;
+using android::pdx::default_transport::ClientChannel;
 using android::pdx::default_transport::ClientChannelFactory;
 using android::pdx::Status;
 using android::pdx::Transaction;
@@ -167,6 +170,13 @@ struct BenchmarkResult {
   SchedStats sched_stats = {};
 };
 
+// How the client moves payloads to the service.
+enum class Transport {
+  Default,       // Shared memory above the transport's default threshold.
+  Socket,        // Always the socket.
+  SharedMemory,  // Always shared memory.
+};
+
 // Global command line option values.
 struct Options {
   bool verbose = false;
@@ -177,6 +187,8 @@ struct Options {
   int instances = 1;
   int timeout = 1;
   int warmup = 0;
+  Transport transport = Transport::Default;
+  bool sweep = false;
 } ProgramOptions;
 
 // Command line option names.
@@ -191,6 +203,8 @@ const char kOptionInstances[] = "instances";
 const char kOptionTimeout[] = "timeout";
 const char kOptionTrace[] = "trace";
 const char kOptionWarmup[] = "warmup";
+const char kOptionTransport[] = "transport";
+const char kOptionSweep[] = "sweep";
 
 // getopt() long options.
 static option long_options[] = {
@@ -205,6 +219,8 @@ static option long_options[] = {
     {kOptionTimeout, required_argument, 0, 0},
     {kOptionTrace, no_argument, 0, 0},
     {kOptionWarmup, required_argument, 0, 0},
+    {kOptionTransport, required_argument, 0, 0},
+    {kOptionSweep, no_argument, 0, 0},
     {0, 0, 0, 0},
 };
 
@@ -232,6 +248,21 @@ void ParseOpcodeOption(const std::string& argument) {
   }
 }
 
+// Parses the argument for kOptionTransport and sets the value of
+// ProgramOptions.transport. Returns false if the argument is invalid.
+bool ParseTransportOption(const std::string& argument) {
+  if (argument == "default") {
+    ProgramOptions.transport = Transport::Default;
+  } else if (argument == "socket") {
+    ProgramOptions.transport = Transport::Socket;
+  } else if (argument == "shm") {
+    ProgramOptions.transport = Transport::SharedMemory;
+  } else {
+    return false;
+  }
+  return true;
+}
+
 // Implements the service side of the benchmark.
 class BenchmarkService : public ServiceBase<BenchmarkService> {
  public:
@@ -489,6 +520,20 @@ class BenchmarkClient : public ClientBase<BenchmarkClient> {
     return ReturnStatusOrError(transaction.Send<int>(BenchmarkOps::Echo));
   }
 
+  void SetTransport(Transport transport) {
+    auto* channel = static_cast<ClientChannel*>(GetChannel());
+    switch (transport) {
+      case Transport::Default:
+        break;
+      case Transport::Socket:
+        channel->SetPayloadBufferThreshold(std::numeric_limits<size_t>::max());
+        break;
+      case Transport::SharedMemory:
+        channel->SetPayloadBufferThreshold(0);
+        break;
+    }
+  }
+
  private:
   friend BASE;
 
@@ -625,6 +670,7 @@ int ClientCommand(const std::string& path) {
                         << std::endl;
               return -ENOMEM;
             }
+            client->SetTransport(ProgramOptions.transport);
 
             uint64_t* thread_samples =
                 &latency_samples_ns[samples_per_thread * thread_id];
@@ -985,6 +1031,29 @@ int ClientCommand(const std::string& path) {
   return 0;
 }
 
+// Runs the client benchmark over a range of payload sizes, once through the
+// socket and once through shared memory, and prints one line per run to stdout:
+// <transport> <block size> <total time ns> <avg latency s> <latency std dev s>
+int SweepCommand(const std::string& path) {
+  constexpr int kMinBlocksize = 64;
+  constexpr int kMaxBlocksize = 1024 * 1024;
+  const std::pair<Transport, const char*> transports[] = {
+      {Transport::Socket, "socket"}, {Transport::SharedMemory, "shm"}};
+
+  for (int blocksize = kMinBlocksize; blocksize <= kMaxBlocksize;
+       blocksize *= 4) {
+    for (const auto& transport : transports) {
+      ProgramOptions.blocksize = blocksize;
+      ProgramOptions.transport = transport.first;
+      std::cout << transport.second << " " << blocksize << " ";
+      const int ret = ClientCommand(path);
+      if (ret < 0)
+        return ret;
+    }
+  }
+  return 0;
+}
+
 int Usage(const std::string& command_name) {
   // clang-format off
   std::cout << "Usage: " << command_name << " [options]" << std::endl;
@@ -999,6 +1068,8 @@ int Usage(const std::string& command_name) {
   std::cout << "\t--timeout <timeout ms | -1> : Timeout to wait for services." << std::endl;
   std::cout << "\t--trace                     : Enable systrace logging." << std::endl;
   std::cout << "\t--warmup <iterations>       : Busy loops before running benchmarks." << std::endl;
+  std::cout << "\t--transport <default | socket | shm> : Specify how payloads are sent." << std::endl;
+  std::cout << "\t--sweep                     : Compare transports over a range of block sizes." << std::endl;
   // clang-format on
   return -1;
 }
@@ -1063,6 +1134,13 @@ int main(int argc, char** argv) {
           tracing_enabled = true;
         } else if (option == kOptionWarmup) {
           ProgramOptions.warmup = std::stoi(optarg);
+        } else if (option == kOptionTransport) {
+          if (!ParseTransportOption(optarg)) {
+            std::cerr << "Invalid transport argument: " << optarg << std::endl;
+            return -EINVAL;
+          }
+        } else if (option == kOptionSweep) {
+          ProgramOptions.sweep = true;
         } else {
           command = option;
           if (optarg)
@@ -1082,6 +1160,8 @@ int main(int argc, char** argv) {
     return Usage(argv[0]);
   } else if (command == kOptionService) {
     return ServiceCommand(command_argument);
+  } else if (command == kOptionClient && ProgramOptions.sweep) {
+    return SweepCommand(command_argument);
   } else if (command == kOptionClient) {
     return ClientCommand(command_argument);
   } else {
@@ -6,6 +6,8 @@
 #include <sys/epoll.h>
 #include <sys/socket.h>
 
+#include <algorithm>
+
 #include <pdx/client.h>
 #include <pdx/service_endpoint.h>
 #include <uds/ipc_helper.h>
@@ -89,26 +91,59 @@ Status<void> ReadAndDiscardData(const BorrowedHandle& socket_fd, size_t size) {
 Status<void> SendRequest(const BorrowedHandle& socket_fd,
                          TransactionState* transaction_state, int opcode,
                          const iovec* send_vector, size_t send_count,
-                         size_t max_recv_len) {
+                         size_t max_recv_len, uint32_t capabilities,
+                         SharedPayloadBuffer* payload_buffer,
+                         bool share_payload_buffer) {
   size_t send_len = CountVectorSize(send_vector, send_count);
   InitRequest(&transaction_state->request, opcode, send_len, max_recv_len,
               false);
-  if (send_len == 0) {
+  if (capabilities == 0) {
+    // The service may predate the header extension, keep the old layout.
+    return SendData(socket_fd, transaction_state->request, send_vector,
+                    send_count);
+  }
+
+  HeaderExtension<BorrowedHandle> extension;
+  if (payload_buffer) {
+    // Only the header goes over the socket, the payload is already in place.
+    SharedPayloadBuffer::CopyFromVector(payload_buffer->request_data(),
+                                        send_vector, send_count);
+    extension.use_payload_buffer = true;
+    if (share_payload_buffer)
+      extension.payload_buffer = payload_buffer->fd();
+  }
+  if (send_len == 0 || payload_buffer) {
     send_vector = nullptr;
     send_count = 0;
   }
-  return SendData(socket_fd, transaction_state->request, send_vector,
-                  send_count);
+  return SendData(socket_fd, transaction_state->request, extension,
+                  send_vector, send_count);
 }
 
 Status<void> ReceiveResponse(const BorrowedHandle& socket_fd,
                              TransactionState* transaction_state,
                              const iovec* receive_vector, size_t receive_count,
-                             size_t max_recv_len) {
-  auto status = ReceiveData(socket_fd, &transaction_state->response);
+                             size_t max_recv_len,
+                             SharedPayloadBuffer* payload_buffer) {
+  HeaderExtension<LocalHandle> extension;
+  bool has_extension = false;
+  auto status = ReceiveData(socket_fd, &transaction_state->response,
+                            &extension, &has_extension);
   if (!status)
     return status;
 
+  const uint32_t recv_len = transaction_state->response.recv_len;
+  if (extension.use_payload_buffer) {
+    if (!payload_buffer || recv_len > payload_buffer->capacity())
+      return ErrorStatus(EIO);
+    // A reply larger than the buffers provided by the caller is truncated to
+    // |max_recv_len| bytes, the rest of it is left in the shared buffer.
+    SharedPayloadBuffer::CopyToVector(
+        receive_vector, receive_count, payload_buffer->response_data(),
+        std::min<size_t>(recv_len, max_recv_len));
+    return status;
+  }
+
   if (transaction_state->response.recv_len > 0) {
     std::vector<iovec> read_buffers;
     size_t size_remaining = 0;
@@ -137,15 +172,16 @@ Status<void> ReceiveResponse(const BorrowedHandle& socket_fd,
 
 }  // anonymous namespace
 
-ClientChannel::ClientChannel(LocalChannelHandle channel_handle)
-    : channel_handle_{std::move(channel_handle)} {
+ClientChannel::ClientChannel(LocalChannelHandle channel_handle,
+                             uint32_t capabilities)
+    : channel_handle_{std::move(channel_handle)}, capabilities_{capabilities} {
   channel_data_ = ChannelManager::Get().GetChannelData(channel_handle_.value());
 }
 
 std::unique_ptr<pdx::ClientChannel> ClientChannel::Create(
-    LocalChannelHandle channel_handle) {
+    LocalChannelHandle channel_handle, uint32_t capabilities) {
   return std::unique_ptr<pdx::ClientChannel>{
-      new ClientChannel{std::move(channel_handle)}};
+      new ClientChannel{std::move(channel_handle), capabilities}};
 }
 
 ClientChannel::~ClientChannel() {
@@ -189,13 +225,21 @@ Status<int> ClientChannel::SendAndReceive(void* transaction_state, int opcode,
   }
 
   auto* state = static_cast<TransactionState*>(transaction_state);
+  size_t send_len = CountVectorSize(send_vector, send_count);
   size_t max_recv_len = CountVectorSize(receive_vector, receive_count);
 
+  SharedPayloadBuffer* payload_buffer =
+      GetPayloadBuffer(send_len, max_recv_len);
+  const bool share_payload_buffer = payload_buffer && !payload_buffer_shared_;
   auto status = SendRequest(BorrowedHandle{channel_handle_.value()}, state,
-                            opcode, send_vector, send_count, max_recv_len);
+                            opcode, send_vector, send_count, max_recv_len,
+                            capabilities_, payload_buffer,
+                            share_payload_buffer);
   if (status) {
+    payload_buffer_shared_ |= share_payload_buffer;
     status = ReceiveResponse(BorrowedHandle{channel_handle_.value()}, state,
-                             receive_vector, receive_count, max_recv_len);
+                             receive_vector, receive_count, max_recv_len,
+                             payload_buffer);
   }
   if (!result.PropagateError(status)) {
     const int return_code = state->response.ret_code;
@@ -207,6 +251,40 @@ Status<int> ClientChannel::SendAndReceive(void* transaction_state, int opcode,
   return result;
 }
 
+SharedPayloadBuffer* ClientChannel::GetPayloadBuffer(size_t send_len,
+                                                     size_t max_recv_len) {
+  if (!(capabilities_ & kCapabilitySharedPayloadBuffer) ||
+      std::max(send_len, max_recv_len) < payload_buffer_threshold_ ||
+      send_len > SharedPayloadBuffer::kMaxCapacity) {
+    return nullptr;
+  }
+
+  // Replies that outgrow the buffer are sent over the socket by the service,
+  // so the receive size does not need to fit.
+  const size_t capacity = std::max(
+      send_len, std::min(max_recv_len, SharedPayloadBuffer::kMaxCapacity));
+  if (!payload_buffer_ || payload_buffer_->capacity() < capacity) {
+    auto status = SharedPayloadBuffer::Create(capacity);
+    if (!status) {
+      // Fall back to the socket.
+      return nullptr;
+    }
+    payload_buffer_ = status.take();
+    payload_buffer_shared_ = false;
+  }
+  return payload_buffer_.get();
+}
+
+void ClientChannel::SetPayloadBufferThreshold(size_t threshold) {
+  std::unique_lock<std::mutex> lock(socket_mutex_);
+  payload_buffer_threshold_ = threshold;
+}
+
+size_t ClientChannel::GetPayloadBufferCapacity() {
+  std::unique_lock<std::mutex> lock(socket_mutex_);
+  return payload_buffer_ ? payload_buffer_->capacity() : 0;
+}
+
 Status<int> ClientChannel::SendWithInt(void* transaction_state, int opcode,
                                        const iovec* send_vector,
                                        size_t send_count,
@@ -139,17 +139,27 @@ Status<std::unique_ptr<pdx::ClientChannel>> ClientChannelFactory::Connect(
 
   RequestHeader<BorrowedHandle> request;
   InitRequest(&request, opcodes::CHANNEL_OPEN, 0, 0, false);
+  HeaderExtension<BorrowedHandle> request_extension;
+  request_extension.capabilities = kSupportedCapabilities;
 
-  status = SendData(socket_.Borrow(), request);
+  status = SendData(socket_.Borrow(), request, request_extension);
   if (!status)
     return status.error_status();
 
+  // Services which predate the header extension reply without one, and no
+  // capabilities are used with them.
   ResponseHeader<LocalHandle> response;
-  status = ReceiveData(socket_.Borrow(), &response);
+  HeaderExtension<LocalHandle> response_extension;
+  bool has_extension = false;
+  status = ReceiveData(socket_.Borrow(), &response, &response_extension,
+                       &has_extension);
   if (!status)
     return status.error_status();
   else if (response.ret_code < 0 || response.channels.size() != 1)
     return ErrorStatus(EIO);
+  const uint32_t capabilities =
+      has_extension ? response_extension.capabilities & kSupportedCapabilities
+                    : 0;
 
   LocalHandle pollin_event_fd = std::move(response.channels[0].pollin_event_fd);
   LocalHandle pollhup_event_fd =
@@ -165,7 +175,8 @@ Status<std::unique_ptr<pdx::ClientChannel>> ClientChannelFactory::Connect(
 
   return ClientChannel::Create(ChannelManager::Get().CreateHandle(
       std::move(socket_), std::move(pollin_event_fd),
-      std::move(pollhup_event_fd)));
+      std::move(pollhup_event_fd)),
+      capabilities);
 }
 
 }  // namespace uds
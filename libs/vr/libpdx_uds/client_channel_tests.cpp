@@ -16,11 +16,13 @@
 #include <pdx/service_dispatcher.h>
 
 #include <uds/client_channel_factory.h>
+#include <uds/ipc_helper.h>
 #include <uds/service_endpoint.h>
 
 using testing::Return;
 using testing::_;
 
+using android::pdx::BorrowedHandle;
 using android::pdx::ClientBase;
 using android::pdx::LocalChannelHandle;
 using android::pdx::LocalHandle;
@@ -32,6 +34,9 @@ using android::pdx::rpc::DispatchRemoteMethod;
 using android::pdx::uds::ClientChannel;
 using android::pdx::uds::ClientChannelFactory;
 using android::pdx::uds::Endpoint;
+using android::pdx::uds::HeaderExtension;
+using android::pdx::uds::RequestHeader;
+using android::pdx::uds::ResponseHeader;
 
 namespace {
 
@@ -39,6 +44,7 @@ struct TestProtocol {
   using DataType = int8_t;
   enum {
     kOpSum = 0,
+    kOpEcho,
   };
   PDX_REMOTE_METHOD(Sum, kOpSum, int64_t(const std::vector<DataType>&));
 };
@@ -55,6 +61,18 @@ class TestService : public ServiceBase<TestService> {
                                                 message);
         return {};
 
+      case TestProtocol::kOpEcho: {
+        std::vector<uint8_t> data(message.GetSendLength());
+        auto status = message.ReadAll(data.data(), data.size());
+        if (status)
+          status = message.WriteAll(data.data(), data.size());
+        if (status)
+          message.Reply(data.size());
+        else
+          message.ReplyError(status.error());
+        return {};
+      }
+
       default:
         return Service::HandleMessage(message);
     }
@@ -74,6 +92,17 @@ class TestClient : public ClientBase<TestClient> {
     auto status = InvokeRemoteMethod<TestProtocol::Sum>(data);
     return status ? status.get() : -1;
   }
+
+  int Echo(const std::vector<uint8_t>& data, std::vector<uint8_t>* reply) {
+    android::pdx::Transaction transaction{*this};
+    return ReturnStatusOrError(
+        transaction.Send<int>(TestProtocol::kOpEcho, data.data(), data.size(),
+                              reply->data(), reply->size()));
+  }
+
+  ClientChannel* GetUdsChannel() const {
+    return static_cast<ClientChannel*>(GetChannel());
+  }
 };
 
 class TestServiceRunner {
@@ -160,4 +189,75 @@ TEST_F(ClientChannelTest, MultithreadedClient) {
     thread.join();
 }
 
+TEST_F(ClientChannelTest, LargePayloadsUseSharedMemory) {
+  constexpr size_t kDataSize = 256 * 1024;
+  std::vector<uint8_t> data(kDataSize);
+  std::iota(data.begin(), data.end(), 0);
+  std::vector<uint8_t> reply(kDataSize);
+
+  EXPECT_EQ(0u, client_->GetUdsChannel()->GetPayloadBufferCapacity());
+  ASSERT_EQ(static_cast<int>(kDataSize), client_->Echo(data, &reply));
+  EXPECT_EQ(data, reply);
+  EXPECT_LE(kDataSize, client_->GetUdsChannel()->GetPayloadBufferCapacity());
+
+  // The buffer is reused by later transactions.
+  std::reverse(data.begin(), data.end());
+  ASSERT_EQ(static_cast<int>(kDataSize), client_->Echo(data, &reply));
+  EXPECT_EQ(data, reply);
+}
+
+TEST_F(ClientChannelTest, SharedMemoryGrowsWithPayload) {
+  std::vector<uint8_t> data(32 * 1024, 1);
+  std::vector<uint8_t> reply(data.size());
+  ASSERT_EQ(static_cast<int>(data.size()), client_->Echo(data, &reply));
+  const size_t capacity = client_->GetUdsChannel()->GetPayloadBufferCapacity();
+  EXPECT_LE(data.size(), capacity);
+
+  data.assign(capacity * 2, 2);
+  reply.resize(data.size());
+  ASSERT_EQ(static_cast<int>(data.size()), client_->Echo(data, &reply));
+  EXPECT_EQ(data, reply);
+  EXPECT_LT(capacity, client_->GetUdsChannel()->GetPayloadBufferCapacity());
+}
+
+TEST_F(ClientChannelTest, ShortReplyBufferTruncates) {
+  std::vector<uint8_t> data(64 * 1024);
+  std::iota(data.begin(), data.end(), 0);
+  std::vector<uint8_t> reply(data.size() / 2);
+  ASSERT_EQ(static_cast<int>(data.size()), client_->Echo(data, &reply));
+  EXPECT_TRUE(std::equal(reply.begin(), reply.end(), data.begin()));
+}
+
+TEST_F(ClientChannelTest, SharedMemoryDisabled) {
+  client_->GetUdsChannel()->SetPayloadBufferThreshold(
+      std::numeric_limits<size_t>::max());
+  std::vector<uint8_t> data(256 * 1024, 4);
+  std::vector<uint8_t> reply(data.size());
+  ASSERT_EQ(static_cast<int>(data.size()), client_->Echo(data, &reply));
+  EXPECT_EQ(data, reply);
+  EXPECT_EQ(0u, client_->GetUdsChannel()->GetPayloadBufferCapacity());
+}
+
+TEST_F(ClientChannelTest, OldClientGetsOldHeaderLayout) {
+  int channel_sockets[2] = {};
+  ASSERT_EQ(
+      0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, channel_sockets));
+  TestServiceRunner service_runner{LocalHandle{channel_sockets[0]}};
+  LocalHandle client_socket{channel_sockets[1]};
+
+  // A client which predates HeaderExtension opens the channel without one.
+  RequestHeader<BorrowedHandle> request;
+  android::pdx::uds::InitRequest(&request, android::pdx::opcodes::CHANNEL_OPEN,
+                                 0, 0, false);
+  ASSERT_TRUE(android::pdx::uds::SendData(client_socket.Borrow(), request));
+
+  ResponseHeader<LocalHandle> response;
+  HeaderExtension<LocalHandle> extension;
+  bool has_extension = true;
+  ASSERT_TRUE(android::pdx::uds::ReceiveData(client_socket.Borrow(), &response,
+                                             &extension, &has_extension));
+  EXPECT_EQ(0, response.ret_code);
+  EXPECT_FALSE(has_extension);
+}
+
 }  // namespace
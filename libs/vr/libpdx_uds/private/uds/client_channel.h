@@ -8,6 +8,7 @@
 #include <uds/channel_event_set.h>
 #include <uds/channel_manager.h>
 #include <uds/service_endpoint.h>
+#include <uds/shared_payload_buffer.h>
 
 namespace android {
 namespace pdx {
@@ -17,8 +18,10 @@ class ClientChannel : public pdx::ClientChannel {
  public:
   ~ClientChannel() override;
 
+  // |capabilities| are the ones negotiated with the service when the channel
+  // was opened, see HeaderExtension.
   static std::unique_ptr<pdx::ClientChannel> Create(
-      LocalChannelHandle channel_handle);
+      LocalChannelHandle channel_handle, uint32_t capabilities = 0);
 
   uint32_t GetIpcTag() const override { return Endpoint::kIpcTag; }
 
@@ -79,16 +82,32 @@ class ClientChannel : public pdx::ClientChannel {
 
   std::unique_ptr<pdx::ChannelParcelable> TakeChannelParcelable() override;
 
+  // Request and reply payloads of at least |threshold| bytes are moved through
+  // a SharedPayloadBuffer instead of the socket, provided the service
+  // supports it. SIZE_MAX disables the buffer.
+  void SetPayloadBufferThreshold(size_t threshold);
+
+  // Returns the capacity of the channel's SharedPayloadBuffer in each
+  // direction, or 0 if no payload has been large enough to set one up.
+  size_t GetPayloadBufferCapacity();
+
  private:
-  explicit ClientChannel(LocalChannelHandle channel_handle);
+  ClientChannel(LocalChannelHandle channel_handle, uint32_t capabilities);
 
   Status<int> SendAndReceive(void* transaction_state, int opcode,
                              const iovec* send_vector, size_t send_count,
                              const iovec* receive_vector, size_t receive_count);
+  SharedPayloadBuffer* GetPayloadBuffer(size_t send_len, size_t max_recv_len);
 
   LocalChannelHandle channel_handle_;
+  const uint32_t capabilities_;
   ChannelEventReceiver* channel_data_;
   std::mutex socket_mutex_;
+
+  // Guarded by |socket_mutex_|.
+  std::unique_ptr<SharedPayloadBuffer> payload_buffer_;
+  bool payload_buffer_shared_{false};
+  size_t payload_buffer_threshold_{SharedPayloadBuffer::kDefaultThreshold};
 };
 
 }  // namespace uds
@@ -159,6 +159,35 @@ class ResponseHeader {
                            channels);
 };
 
+// Channel capabilities. Each end advertises the ones it supports in the
+// HeaderExtension of the CHANNEL_OPEN request and response, and a capability is
+// only used once both ends advertised it.
+//
+// Large payloads may travel through a SharedPayloadBuffer.
+constexpr uint32_t kCapabilitySharedPayloadBuffer = 1 << 0;
+constexpr uint32_t kSupportedCapabilities = kCapabilitySharedPayloadBuffer;
+
+// Follows a request or response header in the same message. The CHANNEL_OPEN
+// request carries one to advertise the client's capabilities, and after that
+// they are only sent over channels which have any capabilities in common.
+// Peers which predate it read the header alone and never look at what follows,
+// so the header layout stays the same for them.
+template <typename FileHandleType>
+class HeaderExtension {
+ public:
+  // Capabilities of the sender, only set on CHANNEL_OPEN.
+  uint32_t capabilities{0};
+  // Set when the client hands a new SharedPayloadBuffer over to the service.
+  FileHandleType payload_buffer;
+  // When set, the request data and the reply data travel through the channel's
+  // SharedPayloadBuffer instead of the socket.
+  bool use_payload_buffer{false};
+
+ private:
+  PDX_SERIALIZABLE_MEMBERS(HeaderExtension, capabilities, payload_buffer,
+                           use_payload_buffer);
+};
+
 template <typename T>
 inline Status<void> SendData(const BorrowedHandle& socket_fd, const T& data,
                              const iovec* data_vec = nullptr,
@@ -178,6 +207,28 @@ inline Status<void> SendData(const BorrowedHandle& socket_fd,
   return payload.Send(socket_fd, &request.cred, data_vec, vec_count);
 }
 
+// Sends |data| followed by |extension| in the same message.
+template <typename T, typename FileHandleType>
+inline Status<void> SendData(const BorrowedHandle& socket_fd, const T& data,
+                             const HeaderExtension<FileHandleType>& extension) {
+  SendPayload payload;
+  rpc::Serialize(data, &payload);
+  rpc::Serialize(extension, &payload);
+  return payload.Send(socket_fd);
+}
+
+template <typename FileHandleType>
+inline Status<void> SendData(const BorrowedHandle& socket_fd,
+                             const RequestHeader<FileHandleType>& request,
+                             const HeaderExtension<FileHandleType>& extension,
+                             const iovec* data_vec = nullptr,
+                             size_t vec_count = 0) {
+  SendPayload payload;
+  rpc::Serialize(request, &payload);
+  rpc::Serialize(extension, &payload);
+  return payload.Send(socket_fd, &request.cred, data_vec, vec_count);
+}
+
 Status<void> SendData(const BorrowedHandle& socket_fd, const void* data,
                       size_t size);
 Status<void> SendDataVector(const BorrowedHandle& socket_fd, const iovec* data,
@@ -202,6 +253,48 @@ inline Status<void> ReceiveData(const BorrowedHandle& socket_fd,
   return status;
 }
 
+// Deserializes the HeaderExtension which may follow a header in |payload|.
+// Leaves |extension| untouched when there is none.
+template <typename FileHandleType>
+inline Status<void> ReceiveExtension(ReceivePayload* payload,
+                                     HeaderExtension<FileHandleType>* extension,
+                                     bool* has_extension) {
+  auto section = payload->GetNextReadBufferSection();
+  *has_extension = section.first != section.second;
+  if (*has_extension &&
+      rpc::Deserialize(extension, payload) != rpc::ErrorCode::NO_ERROR)
+    return ErrorStatus(EIO);
+  return {};
+}
+
+// Receives |data| and the extension after it, if the sender added one.
+template <typename T, typename FileHandleType>
+inline Status<void> ReceiveData(const BorrowedHandle& socket_fd, T* data,
+                                HeaderExtension<FileHandleType>* extension,
+                                bool* has_extension) {
+  ReceivePayload payload;
+  Status<void> status = payload.Receive(socket_fd);
+  if (status && rpc::Deserialize(data, &payload) != rpc::ErrorCode::NO_ERROR)
+    status.SetError(EIO);
+  if (status)
+    status = ReceiveExtension(&payload, extension, has_extension);
+  return status;
+}
+
+template <typename FileHandleType>
+inline Status<void> ReceiveData(const BorrowedHandle& socket_fd,
+                                RequestHeader<FileHandleType>* request,
+                                HeaderExtension<FileHandleType>* extension,
+                                bool* has_extension) {
+  ReceivePayload payload;
+  Status<void> status = payload.Receive(socket_fd, &request->cred);
+  if (status && rpc::Deserialize(request, &payload) != rpc::ErrorCode::NO_ERROR)
+    status.SetError(EIO);
+  if (status)
+    status = ReceiveExtension(&payload, extension, has_extension);
+  return status;
+}
+
 Status<void> ReceiveData(const BorrowedHandle& socket_fd, void* data,
                          size_t size);
 Status<void> ReceiveDataVector(const BorrowedHandle& socket_fd,
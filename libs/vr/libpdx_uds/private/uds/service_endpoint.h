@@ -13,6 +13,7 @@
 #include <pdx/service.h>
 #include <pdx/service_endpoint.h>
 #include <uds/channel_event_set.h>
+#include <uds/shared_payload_buffer.h>
 
 namespace android {
 namespace pdx {
@@ -112,6 +113,9 @@ class Endpoint : public pdx::Endpoint {
     LocalHandle data_fd;
     ChannelEventSet event_set;
     Channel* channel_state{nullptr};
+    std::shared_ptr<SharedPayloadBuffer> payload_buffer;
+    // Negotiated when the channel is opened, see HeaderExtension.
+    uint32_t capabilities{0};
   };
 
   // This class must be instantiated using Create() static methods above.
@@ -139,6 +143,12 @@ class Endpoint : public pdx::Endpoint {
   Status<void> CloseChannelLocked(int32_t channel_id);
   Status<void> ReenableEpollEvent(const BorrowedHandle& channel_fd);
   Channel* GetChannelState(int32_t channel_id);
+  Status<void> SetChannelPayloadBuffer(int32_t channel_id,
+                                       LocalHandle buffer_fd);
+  void SetChannelCapabilities(int32_t channel_id, uint32_t capabilities);
+  uint32_t GetChannelCapabilities(int32_t channel_id);
+  std::shared_ptr<SharedPayloadBuffer> GetChannelPayloadBuffer(
+      int32_t channel_id);
   BorrowedHandle GetChannelSocketFd(int32_t channel_id);
   Status<std::pair<BorrowedHandle, BorrowedHandle>> GetChannelEventFd(
       int32_t channel_id);
@@ -0,0 +1,69 @@
+#ifndef ANDROID_PDX_UDS_SHARED_PAYLOAD_BUFFER_H_
+#define ANDROID_PDX_UDS_SHARED_PAYLOAD_BUFFER_H_
+
+#include <sys/uio.h>
+
+#include <memory>
+
+#include <pdx/file_handle.h>
+#include <pdx/status.h>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+// A memfd-backed buffer shared by both ends of a channel, used to move large
+// request and response payloads without copying them through the socket. The
+// buffer is split in two halves of equal capacity: the client writes requests
+// into the first and the service writes replies into the second. The client
+// can still write to a request while the service handles it, so the service
+// copies it out once on receipt and never reads it from the buffer again. Only
+// the descriptors of the payloads travel over the socket.
+class SharedPayloadBuffer {
+ public:
+  // Payloads this large and larger go through the buffer by default.
+  static constexpr size_t kDefaultThreshold = 16 * 1024;
+  // Payloads larger than this always go through the socket.
+  static constexpr size_t kMaxCapacity = 16 * 1024 * 1024;
+
+  ~SharedPayloadBuffer();
+
+  // Creates a buffer that can hold at least |capacity| bytes in each
+  // direction. The size of the memfd is sealed, so that the other end can
+  // safely map it.
+  static Status<std::unique_ptr<SharedPayloadBuffer>> Create(size_t capacity);
+
+  // Maps a buffer received from the other end of the channel. Fails unless
+  // the size of the memfd is sealed.
+  static Status<std::unique_ptr<SharedPayloadBuffer>> Import(LocalHandle fd);
+
+  BorrowedHandle fd() const { return fd_.Borrow(); }
+  size_t capacity() const { return capacity_; }
+
+  uint8_t* request_data() { return data_; }
+  uint8_t* response_data() { return data_ + capacity_; }
+
+  // Gathers |vector| into |dest| and returns the number of bytes copied.
+  static size_t CopyFromVector(uint8_t* dest, const iovec* vector,
+                               size_t vector_length);
+  // Scatters up to |size| bytes of |src| into |vector| and returns the number
+  // of bytes copied.
+  static size_t CopyToVector(const iovec* vector, size_t vector_length,
+                             const uint8_t* src, size_t size);
+
+ private:
+  SharedPayloadBuffer(LocalHandle fd, uint8_t* data, size_t capacity);
+
+  SharedPayloadBuffer(const SharedPayloadBuffer&) = delete;
+  void operator=(const SharedPayloadBuffer&) = delete;
+
+  LocalHandle fd_;
+  uint8_t* data_;
+  size_t capacity_;
+};
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
+
+#endif  // ANDROID_PDX_UDS_SHARED_PAYLOAD_BUFFER_H_
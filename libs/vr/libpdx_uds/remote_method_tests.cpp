@@ -2,11 +2,13 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <memory>
 #include <numeric>
 #include <string>
+#include <string_view>
 #include <thread>
 
 #include <gtest/gtest.h>
@@ -150,6 +152,8 @@ struct TestInterface final {
     kOpReadFile,
     kOpPushChannel,
     kOpPositive,
+    kOpCountChar,
+    kOpSumBytes,
   };
 
   // Methods.
@@ -178,10 +182,14 @@ struct TestInterface final {
                         const std::string&, int, std::size_t));
   PDX_REMOTE_METHOD(PushChannel, kOpPushChannel, LocalChannelHandle(Void));
   PDX_REMOTE_METHOD(Positive, kOpPositive, void(int));
+  PDX_REMOTE_METHOD(CountChar, kOpCountChar, int(const std::string&, char));
+  PDX_REMOTE_METHOD(SumBytes, kOpSumBytes,
+                    int(const BufferWrapper<std::vector<std::uint8_t>>&));
 
   PDX_REMOTE_API(API, Add, Foo, Concatenate, SumVector, StringLength,
                  SendTestType, SendVector, Rot13, NoArgs, SendFile, GetFile,
-                 GetTestFdType, OpenFiles, PushChannel, Positive);
+                 GetTestFdType, OpenFiles, PushChannel, Positive, CountChar,
+                 SumBytes);
 };
 
 constexpr char TestInterface::kClientPath[];
@@ -323,6 +331,16 @@ class TestClient : public ClientBase<TestClient> {
     return status.ok();
   }
 
+  int CountChar(const std::string& string, char c) {
+    return ReturnStatusOrError(
+        InvokeRemoteMethod<TestInterface::CountChar>(string, c));
+  }
+
+  int SumBytes(const std::uint8_t* buffer, std::size_t size) {
+    return ReturnStatusOrError(InvokeRemoteMethod<TestInterface::SumBytes>(
+        WrapBuffer(buffer, size)));
+  }
+
   int GetFd() const { return event_fd(); }
 
  private:
@@ -424,6 +442,16 @@ class TestService : public ServiceBase<TestService> {
             *this, &TestService::OnPositive, message);
         return {};
 
+      case TestInterface::CountChar::Opcode:
+        DispatchRemoteMethod<TestInterface::CountChar>(
+            *this, &TestService::OnCountChar, message);
+        return {};
+
+      case TestInterface::SumBytes::Opcode:
+        DispatchRemoteMethod<TestInterface::SumBytes>(
+            *this, &TestService::OnSumBytes, message);
+        return {};
+
       default:
         return Service::DefaultHandleMessage(message);
     }
@@ -539,6 +567,16 @@ class TestService : public ServiceBase<TestService> {
       return ErrorStatus(EINVAL);
   }
 
+  // Takes a view in place of the std::string in the method signature.
+  int OnCountChar(Message&, const std::string_view& string, char c) {
+    return std::count(string.begin(), string.end(), c);
+  }
+
+  // Takes a view in place of the BufferWrapper in the method signature.
+  int OnSumBytes(Message&, const BufferView<std::uint8_t>& buffer) {
+    return std::accumulate(buffer.begin(), buffer.end(), 0);
+  }
+
   TestService(const TestService&) = delete;
   void operator=(const TestService&) = delete;
 };
@@ -764,6 +802,26 @@ TEST_F(RemoteMethodTest, BufferWrapper) {
   EXPECT_EQ(expected, buffer);
 }
 
+TEST_F(RemoteMethodTest, Views) {
+  // Create a test service and add it to the dispatcher.
+  auto service = TestService::Create();
+  ASSERT_NE(nullptr, service);
+  ASSERT_EQ(0, dispatcher_->AddService(service));
+
+  // Create a client to service.
+  auto client = TestClient::Create();
+  ASSERT_NE(nullptr, client);
+
+  EXPECT_EQ(0, client->CountChar("", 'a'));
+  EXPECT_EQ(3, client->CountChar("abracadabra", 'b') +
+                   client->CountChar("abracadabra", 'd'));
+  EXPECT_EQ(1000, client->CountChar(std::string(1000, 'x'), 'x'));
+
+  std::vector<std::uint8_t> buffer(1000, 1);
+  EXPECT_EQ(0, client->SumBytes(buffer.data(), 0));
+  EXPECT_EQ(1000, client->SumBytes(buffer.data(), buffer.size()));
+}
+
 //
 // RemoteMethodFramework: Tests the type-based framework that remote method
 // support is built upon.
@@ -904,6 +962,24 @@ TEST(RemoteMethodFramework, IsConvertible) {
   EXPECT_TRUE((IsConvertible<BufferWrapper<char*>,
                              BufferWrapper<std::vector<char>>>::value));
 
+  // std::string_view.
+  EXPECT_TRUE((IsConvertible<std::string, std::string_view>::value));
+  EXPECT_TRUE((IsConvertible<std::string_view, std::string>::value));
+  EXPECT_TRUE((IsConvertible<StringWrapper<char>, std::string_view>::value));
+  EXPECT_FALSE((IsConvertible<std::string_view, int>::value));
+  EXPECT_FALSE(
+      (IsConvertible<std::string_view, BufferWrapper<char*>>::value));
+
+  // BufferView.
+  EXPECT_TRUE((IsConvertible<BufferWrapper<std::vector<std::uint8_t>>,
+                             BufferView<std::uint8_t>>::value));
+  EXPECT_TRUE(
+      (IsConvertible<BufferWrapper<char*>, BufferView<const char>>::value));
+  EXPECT_TRUE((IsConvertible<BufferView<char>, BufferWrapper<char*>>::value));
+  EXPECT_FALSE(
+      (IsConvertible<BufferWrapper<char*>, BufferView<std::uint8_t>>::value));
+  EXPECT_FALSE((IsConvertible<std::string, BufferView<char>>::value));
+
   // RemoteHandle and BorrowedHandle.
   EXPECT_TRUE((IsConvertible<LocalHandle, RemoteHandle>::value));
   EXPECT_TRUE((IsConvertible<LocalHandle, BorrowedHandle>::value));
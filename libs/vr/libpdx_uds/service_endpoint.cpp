@@ -15,6 +15,7 @@
 #include <uds/channel_manager.h>
 #include <uds/client_channel_factory.h>
 #include <uds/ipc_helper.h>
+#include <uds/shared_payload_buffer.h>
 
 namespace {
 
@@ -30,6 +31,7 @@ using android::pdx::LocalHandle;
 using android::pdx::Status;
 using android::pdx::uds::ChannelInfo;
 using android::pdx::uds::ChannelManager;
+using android::pdx::uds::SharedPayloadBuffer;
 
 struct MessageState {
   bool GetLocalFileHandle(int index, LocalHandle* handle) {
@@ -94,6 +96,21 @@ struct MessageState {
   }
 
   Status<size_t> WriteData(const iovec* vector, size_t vector_length) {
+    if (payload_buffer && response_data.empty()) {
+      size_t size = android::pdx::uds::CountVectorSize(vector, vector_length);
+      if (response_buffer_size + size <= payload_buffer->capacity()) {
+        response_buffer_size += SharedPayloadBuffer::CopyFromVector(
+            payload_buffer->response_data() + response_buffer_size, vector,
+            vector_length);
+        return size;
+      }
+      // The reply outgrew the shared buffer, send all of it over the socket.
+      response_data.assign(
+          payload_buffer->response_data(),
+          payload_buffer->response_data() + response_buffer_size);
+      response_buffer_size = 0;
+    }
+
     size_t size = 0;
     for (size_t i = 0; i < vector_length; i++) {
       const auto* data = reinterpret_cast<const uint8_t*>(vector[i].iov_base);
@@ -104,16 +121,10 @@ struct MessageState {
   }
 
   Status<size_t> ReadData(const iovec* vector, size_t vector_length) {
-    size_t size_remaining = request_data.size() - request_data_read_pos;
-    size_t size = 0;
-    for (size_t i = 0; i < vector_length && size_remaining > 0; i++) {
-      size_t size_to_copy = std::min(size_remaining, vector[i].iov_len);
-      memcpy(vector[i].iov_base, request_data.data() + request_data_read_pos,
-             size_to_copy);
-      size += size_to_copy;
-      request_data_read_pos += size_to_copy;
-      size_remaining -= size_to_copy;
-    }
+    size_t size = SharedPayloadBuffer::CopyToVector(
+        vector, vector_length, request_data.data() + request_data_read_pos,
+        request_data.size() - request_data_read_pos);
+    request_data_read_pos += size;
     return size;
   }
 
@@ -123,6 +134,15 @@ struct MessageState {
   std::vector<uint8_t> request_data;
   size_t request_data_read_pos{0};
   std::vector<uint8_t> response_data;
+  // Holds the reply instead of |response_data| when the client asked for it.
+  // The request is copied out of it into |request_data| on receipt, as the
+  // client can still write to it. Shared with the channel, so that it
+  // outlives the channel being closed while the message is handled.
+  std::shared_ptr<SharedPayloadBuffer> payload_buffer;
+  size_t response_buffer_size{0};
+  // Capabilities negotiated for the channel. The reply only carries a
+  // HeaderExtension when there are any.
+  uint32_t capabilities{0};
 };
 
 }  // anonymous namespace
@@ -350,6 +370,43 @@ Status<void> Endpoint::CloseChannelLocked(int32_t channel_id) {
   return status;
 }
 
+Status<void> Endpoint::SetChannelPayloadBuffer(int32_t channel_id,
+                                               LocalHandle buffer_fd) {
+  auto buffer = SharedPayloadBuffer::Import(std::move(buffer_fd));
+  if (!buffer)
+    return buffer.error_status();
+
+  std::lock_guard<std::mutex> autolock(channel_mutex_);
+  auto channel_data = channels_.find(channel_id);
+  if (channel_data == channels_.end())
+    return ErrorStatus{EINVAL};
+  channel_data->second.payload_buffer = buffer.take();
+  return {};
+}
+
+void Endpoint::SetChannelCapabilities(int32_t channel_id,
+                                      uint32_t capabilities) {
+  std::lock_guard<std::mutex> autolock(channel_mutex_);
+  auto channel_data = channels_.find(channel_id);
+  if (channel_data != channels_.end())
+    channel_data->second.capabilities = capabilities;
+}
+
+uint32_t Endpoint::GetChannelCapabilities(int32_t channel_id) {
+  std::lock_guard<std::mutex> autolock(channel_mutex_);
+  auto channel_data = channels_.find(channel_id);
+  return (channel_data != channels_.end()) ? channel_data->second.capabilities
+                                           : 0;
+}
+
+std::shared_ptr<SharedPayloadBuffer> Endpoint::GetChannelPayloadBuffer(
+    int32_t channel_id) {
+  std::lock_guard<std::mutex> autolock(channel_mutex_);
+  auto channel_data = channels_.find(channel_id);
+  return (channel_data != channels_.end()) ? channel_data->second.payload_buffer
+                                           : nullptr;
+}
+
 Status<void> Endpoint::ModifyChannelEvents(int channel_id, int clear_mask,
                                            int set_mask) {
   std::lock_guard<std::mutex> autolock(channel_mutex_);
@@ -497,8 +554,11 @@ int32_t Endpoint::GetChannelId(const BorrowedHandle& channel_fd) {
 Status<void> Endpoint::ReceiveMessageForChannel(
     const BorrowedHandle& channel_fd, Message* message) {
   RequestHeader<LocalHandle> request;
+  HeaderExtension<LocalHandle> extension;
+  bool has_extension = false;
   int32_t channel_id = GetChannelId(channel_fd);
-  auto status = ReceiveData(channel_fd.Borrow(), &request);
+  auto status =
+      ReceiveData(channel_fd.Borrow(), &request, &extension, &has_extension);
   if (!status) {
     if (status.error() == ESHUTDOWN) {
       BuildCloseMessage(channel_id, message);
@@ -535,7 +595,38 @@ Status<void> Endpoint::ReceiveMessageForChannel(
   *message = Message{info};
   auto* state = static_cast<MessageState*>(message->GetState());
   state->request = std::move(request);
-  if (state->request.send_len > 0 && !state->request.is_impulse) {
+  if (state->request.op == opcodes::CHANNEL_OPEN) {
+    // Clients which predate the header extension don't advertise anything.
+    state->capabilities =
+        has_extension ? extension.capabilities & kSupportedCapabilities : 0;
+    SetChannelCapabilities(channel_id, state->capabilities);
+  } else {
+    state->capabilities = GetChannelCapabilities(channel_id);
+  }
+  const bool shared_payload_buffer =
+      (state->capabilities & kCapabilitySharedPayloadBuffer) != 0;
+  if (shared_payload_buffer && extension.payload_buffer) {
+    status = SetChannelPayloadBuffer(channel_id,
+                                     std::move(extension.payload_buffer));
+  }
+  if (status && shared_payload_buffer && extension.use_payload_buffer &&
+      !state->request.is_impulse) {
+    // The request data is already in shared memory. Take a private copy of
+    // it, so that the client can't change it while the service reads it.
+    state->payload_buffer = GetChannelPayloadBuffer(channel_id);
+    if (!state->payload_buffer ||
+        state->request.send_len > state->payload_buffer->capacity()) {
+      ALOGE(
+          "Endpoint::ReceiveMessageForChannel: Invalid payload buffer "
+          "request on channel %d",
+          channel_id);
+      status.SetError(EIO);
+    } else {
+      const uint8_t* data = state->payload_buffer->request_data();
+      state->request_data.assign(data, data + state->request.send_len);
+    }
+  } else if (status && state->request.send_len > 0 &&
+             !state->request.is_impulse) {
     state->request_data.resize(state->request.send_len);
     status = ReceiveData(channel_fd, state->request_data.data(),
                          state->request_data.size());
@@ -625,6 +716,7 @@ Status<void> Endpoint::MessageReply(Message* message, int return_code) {
         // Open messages do not have a payload and may not transfer any channels
         // or file descriptors on behalf of the service.
         state->response_data.clear();
+        state->response_buffer_size = 0;
         state->response.file_descriptors.clear();
         state->response.channels.clear();
 
@@ -644,8 +736,20 @@ Status<void> Endpoint::MessageReply(Message* message, int return_code) {
   }
 
   state->response.ret_code = return_code;
-  state->response.recv_len = state->response_data.size();
-  auto status = SendData(channel_socket, state->response);
+  const bool use_payload_buffer = state->response_buffer_size > 0;
+  state->response.recv_len = use_payload_buffer ? state->response_buffer_size
+                                                : state->response_data.size();
+  Status<void> status;
+  if (state->capabilities != 0) {
+    HeaderExtension<BorrowedHandle> extension;
+    if (message->GetOp() == opcodes::CHANNEL_OPEN)
+      extension.capabilities = state->capabilities;
+    extension.use_payload_buffer = use_payload_buffer;
+    status = SendData(channel_socket, state->response, extension);
+  } else {
+    // The client may predate the header extension, keep the old layout.
+    status = SendData(channel_socket, state->response);
+  }
   if (status && !state->response_data.empty()) {
     status = SendData(channel_socket, state->response_data.data(),
                       state->response_data.size());
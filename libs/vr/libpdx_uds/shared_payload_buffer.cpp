@@ -0,0 +1,121 @@
+#include "uds/shared_payload_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <log/log.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace android {
+namespace pdx {
+namespace uds {
+
+namespace {
+
+constexpr int kRequiredSeals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+
+size_t GetCapacityForSize(size_t size) {
+  size_t capacity = getpagesize();
+  while (capacity < size)
+    capacity *= 2;
+  return capacity;
+}
+
+}  // anonymous namespace
+
+SharedPayloadBuffer::SharedPayloadBuffer(LocalHandle fd, uint8_t* data,
+                                         size_t capacity)
+    : fd_{std::move(fd)}, data_{data}, capacity_{capacity} {}
+
+SharedPayloadBuffer::~SharedPayloadBuffer() { munmap(data_, capacity_ * 2); }
+
+Status<std::unique_ptr<SharedPayloadBuffer>> SharedPayloadBuffer::Create(
+    size_t capacity) {
+  if (capacity > kMaxCapacity)
+    return ErrorStatus(EINVAL);
+  capacity = GetCapacityForSize(capacity);
+
+  LocalHandle fd{
+      memfd_create("pdx_uds_payload", MFD_CLOEXEC | MFD_ALLOW_SEALING)};
+  if (!fd) {
+    ALOGE("SharedPayloadBuffer::Create: Failed to create memfd: %s",
+          strerror(errno));
+    return ErrorStatus(errno);
+  }
+  if (ftruncate(fd.Get(), capacity * 2) < 0 ||
+      fcntl(fd.Get(), F_ADD_SEALS, kRequiredSeals) < 0) {
+    ALOGE("SharedPayloadBuffer::Create: Failed to size memfd: %s",
+          strerror(errno));
+    return ErrorStatus(errno);
+  }
+
+  void* data = mmap(nullptr, capacity * 2, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    fd.Get(), 0);
+  if (data == MAP_FAILED) {
+    ALOGE("SharedPayloadBuffer::Create: Failed to map memfd: %s",
+          strerror(errno));
+    return ErrorStatus(errno);
+  }
+  return std::unique_ptr<SharedPayloadBuffer>{new SharedPayloadBuffer{
+      std::move(fd), static_cast<uint8_t*>(data), capacity}};
+}
+
+Status<std::unique_ptr<SharedPayloadBuffer>> SharedPayloadBuffer::Import(
+    LocalHandle fd) {
+  // Without the seals the other end could shrink the memfd while it is mapped
+  // here and fault this process on the next access.
+  int seals = fcntl(fd.Get(), F_GET_SEALS);
+  if (seals < 0 || (seals & kRequiredSeals) != kRequiredSeals) {
+    ALOGE("SharedPayloadBuffer::Import: Payload buffer is not sealed");
+    return ErrorStatus(EINVAL);
+  }
+
+  struct stat stat_buf;
+  if (fstat(fd.Get(), &stat_buf) < 0)
+    return ErrorStatus(errno);
+  const size_t size = stat_buf.st_size;
+  if (size == 0 || size % 2 != 0 || size / 2 > kMaxCapacity) {
+    ALOGE("SharedPayloadBuffer::Import: Invalid payload buffer size %zu", size);
+    return ErrorStatus(EINVAL);
+  }
+
+  void* data =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.Get(), 0);
+  if (data == MAP_FAILED) {
+    ALOGE("SharedPayloadBuffer::Import: Failed to map memfd: %s",
+          strerror(errno));
+    return ErrorStatus(errno);
+  }
+  return std::unique_ptr<SharedPayloadBuffer>{new SharedPayloadBuffer{
+      std::move(fd), static_cast<uint8_t*>(data), size / 2}};
+}
+
+size_t SharedPayloadBuffer::CopyFromVector(uint8_t* dest, const iovec* vector,
+                                           size_t vector_length) {
+  size_t size = 0;
+  for (size_t i = 0; i < vector_length; i++) {
+    memcpy(dest + size, vector[i].iov_base, vector[i].iov_len);
+    size += vector[i].iov_len;
+  }
+  return size;
+}
+
+size_t SharedPayloadBuffer::CopyToVector(const iovec* vector,
+                                         size_t vector_length,
+                                         const uint8_t* src, size_t size) {
+  size_t copied = 0;
+  for (size_t i = 0; i < vector_length && copied < size; i++) {
+    size_t size_to_copy = std::min(size - copied, vector[i].iov_len);
+    memcpy(vector[i].iov_base, src + copied, size_to_copy);
+    copied += size_to_copy;
+  }
+  return copied;
+}
+
+}  // namespace uds
+}  // namespace pdx
+}  // namespace android
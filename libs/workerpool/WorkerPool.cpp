@@ -0,0 +1,121 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include <workerpool/WorkerPool.h>
+
+#include <log/log.h>
+#include <pthread.h>
+#include <sched.h>
+#include <utils/Trace.h>
+
+#include <cstring>
+
+namespace android {
+
+WorkerPool::WorkerPool(size_t threadCount, const char* name) {
+    for (size_t i = 0; i < threadCount; i++) {
+        mThreads.emplace_back(&WorkerPool::loop, this);
+        pthread_setname_np(mThreads.back().native_handle(), name);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mWorkAvailable.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void WorkerPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (mThreads.empty() || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(i);
+        }
+        return;
+    }
+
+    matchCallerScheduling();
+
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mTask = &task;
+        mCount = count;
+        mNext = 0;
+        mGeneration++;
+        mBusyWorkers = mThreads.size();
+    }
+    mWorkAvailable.notify_all();
+
+    drain(task, count);
+
+    // Every worker checks in for every batch, so once they all have, none of
+    // them can still be holding on to the task.
+    ATRACE_NAME("WorkerPool::waitForBatch");
+    std::unique_lock<std::mutex> lock(mLock);
+    mBatchDone.wait(lock, [this] { return mBusyWorkers == 0; });
+    mTask = nullptr;
+}
+
+void WorkerPool::matchCallerScheduling() {
+    int policy;
+    sched_param param;
+    if (pthread_getschedparam(pthread_self(), &policy, &param) != 0 ||
+        (policy == mPolicy && param.sched_priority == mPriority)) {
+        return;
+    }
+    // Not retried on failure, which would only fail again every time.
+    mPolicy = policy;
+    mPriority = param.sched_priority;
+    for (auto& thread : mThreads) {
+        if (const int error = pthread_setschedparam(thread.native_handle(), policy, &param)) {
+            ALOGW("Failed to set the scheduling policy of a worker: %s", strerror(error));
+        }
+    }
+}
+
+void WorkerPool::drain(const std::function<void(size_t)>& task, size_t count) {
+    for (size_t i = mNext.fetch_add(1); i < count; i = mNext.fetch_add(1)) {
+        task(i);
+    }
+}
+
+void WorkerPool::loop() {
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mWorkAvailable.wait(lock, [&] { return mStopping || mGeneration != generation; });
+        if (mStopping) {
+            return;
+        }
+        generation = mGeneration;
+        const std::function<void(size_t)>* task = mTask;
+        const size_t count = mCount;
+        lock.unlock();
+        drain(*task, count);
+        lock.lock();
+        if (--mBusyWorkers == 0) {
+            mBatchDone.notify_one();
+        }
+    }
+}
+
+} // namespace android
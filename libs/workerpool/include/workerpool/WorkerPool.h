@@ -0,0 +1,78 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+/**
+ * A fixed set of threads that share out independent pieces of work with the
+ * thread calling run(), so a pool of N threads keeps N + 1 cores busy.
+ */
+class WorkerPool {
+public:
+    // |name| names the threads of the pool.
+    WorkerPool(size_t threadCount, const char* name);
+    ~WorkerPool();
+
+    // Calls task(i) for every i in [0, count), spread across the pool and the
+    // calling thread, and returns once all calls have finished. Tasks must not
+    // call run() themselves.
+    //
+    // The workers take on the scheduling policy and priority of the calling
+    // thread first, so that a real-time caller, like the main thread of
+    // SurfaceFlinger, never waits on lower priority workers.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+    size_t getThreadCount() const { return mThreads.size(); }
+
+private:
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    void loop();
+    void drain(const std::function<void(size_t)>& task, size_t count);
+    void matchCallerScheduling();
+
+    std::mutex mLock;
+    // Signalled when a new batch of tasks is posted, or on shutdown.
+    std::condition_variable mWorkAvailable;
+    // Signalled when the last worker leaves a batch.
+    std::condition_variable mBatchDone;
+    const std::function<void(size_t)>* mTask = nullptr;
+    size_t mCount = 0;
+    uint64_t mGeneration = 0;
+    size_t mBusyWorkers = 0;
+    bool mStopping = false;
+
+    // Index of the next task to hand out in the current batch.
+    std::atomic<size_t> mNext = 0;
+
+    std::vector<std::thread> mThreads;
+
+    // The scheduling the workers were last given, only used by run().
+    int mPolicy = -1;
+    int mPriority = 0;
+};
+
+} // namespace android
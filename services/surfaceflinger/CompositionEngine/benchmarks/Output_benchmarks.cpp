@@ -0,0 +1,146 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <compositionengine/CompositionRefreshArgs.h>
+#include <compositionengine/LayerFECompositionState.h>
+#include <compositionengine/impl/Output.h>
+#include <compositionengine/mock/CompositionEngine.h>
+#include <gmock/gmock.h>
+#include <ui/Rect.h>
+#include <ui/Region.h>
+#include <workerpool/WorkerPool.h>
+
+#include <memory>
+#include <vector>
+
+namespace android::compositionengine {
+
+using testing::NiceMock;
+
+// Does about as much work as a front-end layer preparing its geometry, without
+// going through gmock, which serializes calls.
+class FakeLayerFE : public LayerFE {
+public:
+    const LayerFECompositionState* getCompositionState() const override { return &state; }
+    bool onPreComposition(nsecs_t) override { return false; }
+    void prepareCompositionState(StateSubset) override {
+        state.geomLayerTransform.set(static_cast<float>(++frame), 0.f);
+        state.geomInverseLayerTransform = state.geomLayerTransform.inverse();
+        state.geomLayerBounds = state.geomLayerTransform.transform(FloatRect(0, 0, 100, 100));
+        state.transparentRegionHint = Region(Rect(0, 0, 10, 10)).merge(Rect(5, 5, 20, 20));
+    }
+    std::vector<LayerSettings> prepareClientCompositionList(
+            ClientCompositionTargetSettings&) override {
+        return {};
+    }
+    void onLayerDisplayed(const sp<Fence>&) override {}
+    const char* getDebugName() const override { return "FakeLayerFE"; }
+
+    LayerFECompositionState state;
+    int frame = 0;
+};
+
+// An output with |state.range(0)| layers, on layer stack 0.
+class OutputBenchmark {
+public:
+    explicit OutputBenchmark(benchmark::State& state) {
+        mOutput->editState().layerStackId = 0;
+        mOutput->editState().bounds = Rect(0, 0, 200, 300);
+        mOutput->editState().viewport = Rect(0, 0, 200, 300);
+        mOutput->editState().transform = ui::Transform(ui::Transform::ROT_0, 200, 300);
+
+        for (int64_t i = 0; i < state.range(0); i++) {
+            sp<FakeLayerFE> layerFE = new FakeLayerFE;
+            layerFE->state.layerStackId = 0;
+            mOutput->injectOutputLayerForTest(layerFE);
+            mLayerFEs.push_back(std::move(layerFE));
+        }
+    }
+
+    impl::Output& output() { return *mOutput; }
+    const std::vector<sp<FakeLayerFE>>& layerFEs() const { return mLayerFEs; }
+
+private:
+    class Output : public impl::Output {
+    public:
+        using impl::Output::injectOutputLayerForTest;
+    };
+
+    NiceMock<mock::CompositionEngine> mCompositionEngine;
+    std::shared_ptr<Output> mOutput = impl::createOutputTemplated<Output>(mCompositionEngine);
+    std::vector<sp<FakeLayerFE>> mLayerFEs;
+};
+
+// Main thread time per geometry frame, with |state.range(1)| workers.
+static void benchmarkUpdateLayerStateFromFE(benchmark::State& state) {
+    OutputBenchmark fixture(state);
+    std::unique_ptr<WorkerPool> workers;
+    CompositionRefreshArgs refreshArgs;
+    refreshArgs.updatingGeometryThisFrame = true;
+    if (state.range(1) > 0) {
+        workers = std::make_unique<WorkerPool>(static_cast<size_t>(state.range(1)),
+                                               "OutputBenchmark");
+        refreshArgs.layerStateWorkers = workers.get();
+    }
+
+    for (auto _ : state) {
+        fixture.output().updateLayerStateFromFE(refreshArgs);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+// Time per frame to cull the layers behind a fullscreen opaque app, whose
+// coverage is a single rectangle or not.
+static void benchmarkCullLayersBehindOpaqueApp(benchmark::State& state, bool rectangular) {
+    OutputBenchmark fixture(state);
+    std::vector<sp<LayerFE>> layerFEs;
+    LayerFESet latchedLayers;
+    for (const auto& layerFE : fixture.layerFEs()) {
+        layerFE->state.isVisible = true;
+        layerFE->state.isOpaque = true;
+        layerFE->state.geomLayerBounds = FloatRect{0, 0, 100, 200};
+        layerFE->state.geomLayerTransform = ui::Transform();
+        // Already latched, so that only the culling is measured.
+        latchedLayers.insert(layerFE);
+        layerFEs.push_back(layerFE);
+    }
+
+    Region appRegion(Rect(0, 0, 200, 300));
+    if (!rectangular) {
+        // Also covering a sliver outside of the output.
+        appRegion.orSelf(Rect(200, 0, 210, 10));
+    }
+
+    Output::CoverageState coverage(latchedLayers);
+    for (auto _ : state) {
+        coverage.aboveCoveredLayers = appRegion;
+        coverage.aboveOpaqueLayers = appRegion;
+        for (auto& layerFE : layerFEs) {
+            fixture.output().ensureOutputLayerIfVisible(layerFE, coverage);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(benchmarkUpdateLayerStateFromFE)->Args({300, 0})->Args({300, 3});
+BENCHMARK_CAPTURE(benchmarkCullLayersBehindOpaqueApp, rectangular, true)->Arg(200);
+BENCHMARK_CAPTURE(benchmarkCullLayersBehindOpaqueApp, complex, false)->Arg(200);
+
+} // namespace android::compositionengine
+
+BENCHMARK_MAIN();
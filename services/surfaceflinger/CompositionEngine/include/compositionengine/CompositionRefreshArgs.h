@@ -25,6 +25,7 @@
 #include <compositionengine/OutputColorSetting.h>
 #include <math/mat4.h>
 #include <ui/Transform.h>
+#include <workerpool/WorkerPool.h>
 
 namespace android::compositionengine {
 
@@ -79,6 +80,11 @@ struct CompositionRefreshArgs {
 
     // If set, causes the dirty regions to flash with the delay
     std::optional<std::chrono::microseconds> devOptFlashDirtyRegionsDelay;
+
+    // If set, the layers of each output prepare their composition state on
+    // these workers as well as the calling thread. See
+    // Output::updateLayerStateFromFE for what this requires of the layers.
+    WorkerPool* layerStateWorkers{nullptr};
 };
 
 } // namespace android::compositionengine
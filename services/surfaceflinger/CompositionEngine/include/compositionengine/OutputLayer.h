@@ -93,6 +93,11 @@ public:
     // Updates the cursor position with the HWC
     virtual void writeCursorPositionToHWC() const = 0;
 
+    // Forgets the per-frame state last written to the HWC, so that all of it is
+    // written again with the next frame, or does nothing if this layer does
+    // not use the HWC.
+    virtual void invalidateWrittenHwcState() = 0;
+
     // Returns the HWC2::Layer associated with this layer, if it exists
     virtual HWC2::Layer* getHwcLayer() const = 0;
 
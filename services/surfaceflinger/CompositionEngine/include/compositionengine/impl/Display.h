@@ -77,6 +77,7 @@ public:
     virtual void applyDisplayRequests(const DisplayRequests&);
     virtual void applyLayerRequestsToLayers(const LayerRequests&);
     virtual void applyClientTargetRequests(const ClientTargetProperty&);
+    virtual void invalidateWrittenHwcLayerState();
 
     // Internal
     virtual void setConfiguration(const compositionengine::DisplayCreationArgs&);
@@ -43,6 +43,7 @@ public:
                                 ui::Transform::RotationFlags) override;
     void writeStateToHWC(bool) override;
     void writeCursorPositionToHWC() const override;
+    void invalidateWrittenHwcState() override;
 
     HWC2::Layer* getHwcLayer() const override;
     bool requiresClientComposition() const override;
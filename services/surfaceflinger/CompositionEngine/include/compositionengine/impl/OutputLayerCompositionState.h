@@ -21,6 +21,8 @@
 #include <string>
 
 #include <compositionengine/impl/HwcBufferCache.h>
+#include <gui/HdrMetadata.h>
+#include <math/mat4.h>
 #include <renderengine/Mesh.h>
 #include <ui/FloatRect.h>
 #include <ui/GraphicTypes.h>
@@ -100,6 +102,23 @@ struct OutputLayerCompositionState {
         // The buffer cache for this layer. This is used to lower the
         // cost of sending reused buffers to the HWC.
         HwcBufferCache hwcBufferCache;
+
+        // The per-frame state most recently written to the HWC for this layer,
+        // which is not written again until it changes. A field is unset if it
+        // was not written successfully yet, so that it is always written.
+        // Since it lives with hwcLayer, new HWC layers made after a hotplug or
+        // a composer restart start with all of it unset.
+        struct WrittenState {
+            std::optional<Region> visibleRegion;
+            std::optional<ui::Dataspace> dataspace;
+            std::optional<mat4> colorTransform;
+            std::optional<Region> surfaceDamage;
+            std::optional<int32_t> supportedPerFrameMetadata;
+            std::optional<HdrMetadata> hdrMetadata;
+            std::optional<Hwc2::IComposerClient::Composition> compositionType;
+            std::optional<Hwc2::IComposerClient::Color> color;
+        };
+        WrittenState writtenState;
     };
 
     // The HWC state is optional, and is only set up if there is any potential
@@ -253,6 +253,7 @@ void Display::chooseCompositionStrategy() {
         result != NO_ERROR) {
         ALOGE("chooseCompositionStrategy failed for %s: %d (%s)", getName().c_str(), result,
               strerror(-result));
+        invalidateWrittenHwcLayerState();
         return;
     }
     if (changes) {
@@ -337,6 +338,14 @@ void Display::applyClientTargetRequests(const ClientTargetProperty& clientTarget
     getRenderSurface()->setBufferPixelFormat(clientTargetProperty.pixelFormat);
 }
 
+void Display::invalidateWrittenHwcLayerState() {
+    // The HWC may not have applied any of the layer state written for a frame
+    // it failed, so all of it is written again with the next one.
+    for (auto* layer : getOutputLayersOrderedByZ()) {
+        layer->invalidateWrittenHwcState();
+    }
+}
+
 compositionengine::Output::FrameFences Display::presentAndGetFrameFences() {
     auto result = impl::Output::presentAndGetFrameFences();
 
@@ -345,7 +354,9 @@ compositionengine::Output::FrameFences Display::presentAndGetFrameFences() {
     }
 
     auto& hwc = getCompositionEngine().getHwComposer();
-    hwc.presentAndGetReleaseFences(*mId);
+    if (hwc.presentAndGetReleaseFences(*mId) != NO_ERROR) {
+        invalidateWrittenHwcLayerState();
+    }
 
     result.presentFence = hwc.getPresentFence(*mId);
 
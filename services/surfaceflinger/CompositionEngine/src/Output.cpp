@@ -69,6 +69,15 @@ Reversed<T> reversed(const T& c) {
     return Reversed<T>(c);
 }
 
+// Whether |region| is known to contain all of |rect| without doing any region
+// math, which is the case when the region is a single rectangle.
+bool coversRect(const Region& region, const Rect& rect) {
+    if (!region.isRect()) return false;
+    const Rect bounds = region.getBounds();
+    return rect.left >= bounds.left && rect.top >= bounds.top && rect.right <= bounds.right &&
+            rect.bottom <= bounds.bottom;
+}
+
 } // namespace
 
 std::shared_ptr<Output> createOutput(
@@ -349,11 +358,10 @@ void Output::collectVisibleLayers(const compositionengine::CompositionRefreshArg
     // also incrementally calculates the coverage information for each layer as
     // well as the entire output.
     for (auto layer : reversed(refreshArgs.layers)) {
-        // Incrementally process the coverage for each layer
+        // Incrementally process the coverage for each layer. This does not stop
+        // once the output is covered, as the layers underneath still latch
+        // their geometry, but they are culled before any region math.
         ensureOutputLayerIfVisible(layer, coverage);
-
-        // TODO(b/121291683): Stop early if the output is completely covered and
-        // no more layers could even be visible underneath the ones on top.
     }
 
     setReleasedLayers(refreshArgs);
@@ -449,6 +457,16 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
         return;
     }
 
+    // Once something opaque covers the output, like a fullscreen app, the
+    // layers behind it are culled here. Their whole footprint is then within
+    // aboveOpaqueLayers, and so also within aboveCoveredLayers, which means
+    // the region math below would leave the coverage unchanged, and return
+    // on an empty visible region.
+    const Rect visibleBounds = visibleRegion.getBounds();
+    if (coversRect(coverage.aboveOpaqueLayers, visibleBounds)) {
+        return;
+    }
+
     // Remove the transparent area from the visible region
     if (!layerFEState->isOpaque) {
         if (tr.preserveRects()) {
@@ -472,14 +490,25 @@ void Output::ensureOutputLayerIfVisible(sp<compositionengine::LayerFE>& layerFE,
         opaqueRegion.set(visibleRect);
     }
 
+    // Layers which overlap nothing above them, as is the case for many of
+    // them, are neither covered nor clipped. This only compares bounds, as
+    // aboveOpaqueLayers is within aboveCoveredLayers.
+    Rect overlap;
+    const bool overlapsLayersAbove =
+            visibleBounds.intersect(coverage.aboveCoveredLayers.getBounds(), &overlap);
+
     // Clip the covered region to the visible region
-    coveredRegion = coverage.aboveCoveredLayers.intersect(visibleRegion);
+    if (overlapsLayersAbove) {
+        coveredRegion = coverage.aboveCoveredLayers.intersect(visibleRegion);
+    }
 
     // Update accumAboveCoveredLayers for next (lower) layer
     coverage.aboveCoveredLayers.orSelf(visibleRegion);
 
     // subtract the opaque region covered by the layers above us
-    visibleRegion.subtractSelf(coverage.aboveOpaqueLayers);
+    if (overlapsLayersAbove) {
+        visibleRegion.subtractSelf(coverage.aboveOpaqueLayers);
+    }
 
     if (visibleRegion.isEmpty()) {
         return;
@@ -566,11 +595,39 @@ void Output::setReleasedLayers(const compositionengine::CompositionRefreshArgs&)
 }
 
 void Output::updateLayerStateFromFE(const CompositionRefreshArgs& args) const {
+    const auto subset = args.updatingGeometryThisFrame ? LayerFE::StateSubset::GeometryAndContent
+                                                       : LayerFE::StateSubset::Content;
+    if (!args.layerStateWorkers) {
+        for (auto* layer : getOutputLayersOrderedByZ()) {
+            layer->getLayerFE().prepareCompositionState(subset);
+        }
+        return;
+    }
+
+    ATRACE_CALL();
+
+    // Layers are prepared in any order and concurrently, which is safe because
+    // the front-end has already resolved everything that flows from parent to
+    // child (bounds, transforms) top-down, before composition starts. From
+    // there, a layer only reads its own and its ancestors' drawing state and
+    // only writes its own composition state. A layer appears at most once in
+    // an output, and outputs are still updated one after the other.
+    std::vector<LayerFE*> layerFEs;
+    layerFEs.reserve(getOutputLayerCount());
     for (auto* layer : getOutputLayersOrderedByZ()) {
-        layer->getLayerFE().prepareCompositionState(
-                args.updatingGeometryThisFrame ? LayerFE::StateSubset::GeometryAndContent
-                                               : LayerFE::StateSubset::Content);
+        layerFEs.push_back(&layer->getLayerFE());
     }
+
+    // Preparing a single layer is cheap, so hand them out in chunks.
+    constexpr size_t kLayersPerTask = 16;
+    const size_t taskCount = (layerFEs.size() + kLayersPerTask - 1) / kLayersPerTask;
+    args.layerStateWorkers->run(taskCount, [&](size_t task) {
+        const size_t begin = task * kLayersPerTask;
+        const size_t end = std::min(begin + kLayersPerTask, layerFEs.size());
+        for (size_t i = begin; i < end; i++) {
+            layerFEs[i]->prepareCompositionState(subset);
+        }
+    });
 }
 
 void Output::updateAndWriteCompositionState(
@@ -427,43 +427,69 @@ void OutputLayer::writeOutputIndependentGeometryStateToHWC(
 }
 
 void OutputLayer::writeOutputDependentPerFrameStateToHWC(HWC2::Layer* hwcLayer) {
-    const auto& outputDependentState = getState();
+    auto& outputDependentState = editState();
+    auto& writtenState = outputDependentState.hwc->writtenState;
 
     // TODO(lpique): b/121291683 outputSpaceVisibleRegion is output-dependent geometry
     // state and should not change every frame.
-    if (auto error = hwcLayer->setVisibleRegion(outputDependentState.outputSpaceVisibleRegion);
-        error != hal::Error::NONE) {
-        ALOGE("[%s] Failed to set visible region: %s (%d)", getLayerFE().getDebugName(),
-              to_string(error).c_str(), static_cast<int32_t>(error));
-        outputDependentState.outputSpaceVisibleRegion.dump(LOG_TAG);
+    if (!writtenState.visibleRegion ||
+        !writtenState.visibleRegion->hasSameRects(outputDependentState.outputSpaceVisibleRegion)) {
+        if (auto error = hwcLayer->setVisibleRegion(outputDependentState.outputSpaceVisibleRegion);
+            error != hal::Error::NONE) {
+            ALOGE("[%s] Failed to set visible region: %s (%d)", getLayerFE().getDebugName(),
+                  to_string(error).c_str(), static_cast<int32_t>(error));
+            outputDependentState.outputSpaceVisibleRegion.dump(LOG_TAG);
+            writtenState.visibleRegion.reset();
+        } else {
+            writtenState.visibleRegion = outputDependentState.outputSpaceVisibleRegion;
+        }
     }
 
-    if (auto error = hwcLayer->setDataspace(outputDependentState.dataspace);
-        error != hal::Error::NONE) {
-        ALOGE("[%s] Failed to set dataspace %d: %s (%d)", getLayerFE().getDebugName(),
-              outputDependentState.dataspace, to_string(error).c_str(),
-              static_cast<int32_t>(error));
+    if (writtenState.dataspace != outputDependentState.dataspace) {
+        if (auto error = hwcLayer->setDataspace(outputDependentState.dataspace);
+            error != hal::Error::NONE) {
+            ALOGE("[%s] Failed to set dataspace %d: %s (%d)", getLayerFE().getDebugName(),
+                  outputDependentState.dataspace, to_string(error).c_str(),
+                  static_cast<int32_t>(error));
+            writtenState.dataspace.reset();
+        } else {
+            writtenState.dataspace = outputDependentState.dataspace;
+        }
     }
 }
 
 void OutputLayer::writeOutputIndependentPerFrameStateToHWC(
         HWC2::Layer* hwcLayer, const LayerFECompositionState& outputIndependentState) {
-    switch (auto error = hwcLayer->setColorTransform(outputIndependentState.colorTransform)) {
-        case hal::Error::NONE:
-            break;
-        case hal::Error::UNSUPPORTED:
-            editState().forceClientComposition = true;
-            break;
-        default:
-            ALOGE("[%s] Failed to set color transform: %s (%d)", getLayerFE().getDebugName(),
-                  to_string(error).c_str(), static_cast<int32_t>(error));
+    auto& writtenState = editState().hwc->writtenState;
+
+    // An unsupported color transform is never recorded as written, so that
+    // client composition is forced again with every frame.
+    if (writtenState.colorTransform != outputIndependentState.colorTransform) {
+        writtenState.colorTransform.reset();
+        switch (auto error = hwcLayer->setColorTransform(outputIndependentState.colorTransform)) {
+            case hal::Error::NONE:
+                writtenState.colorTransform = outputIndependentState.colorTransform;
+                break;
+            case hal::Error::UNSUPPORTED:
+                editState().forceClientComposition = true;
+                break;
+            default:
+                ALOGE("[%s] Failed to set color transform: %s (%d)", getLayerFE().getDebugName(),
+                      to_string(error).c_str(), static_cast<int32_t>(error));
+        }
     }
 
-    if (auto error = hwcLayer->setSurfaceDamage(outputIndependentState.surfaceDamage);
-        error != hal::Error::NONE) {
-        ALOGE("[%s] Failed to set surface damage: %s (%d)", getLayerFE().getDebugName(),
-              to_string(error).c_str(), static_cast<int32_t>(error));
-        outputIndependentState.surfaceDamage.dump(LOG_TAG);
+    if (!writtenState.surfaceDamage ||
+        !writtenState.surfaceDamage->hasSameRects(outputIndependentState.surfaceDamage)) {
+        if (auto error = hwcLayer->setSurfaceDamage(outputIndependentState.surfaceDamage);
+            error != hal::Error::NONE) {
+            ALOGE("[%s] Failed to set surface damage: %s (%d)", getLayerFE().getDebugName(),
+                  to_string(error).c_str(), static_cast<int32_t>(error));
+            outputIndependentState.surfaceDamage.dump(LOG_TAG);
+            writtenState.surfaceDamage.reset();
+        } else {
+            writtenState.surfaceDamage = outputIndependentState.surfaceDamage;
+        }
     }
 
     // Content-specific per-frame state
@@ -496,9 +522,17 @@ void OutputLayer::writeSolidColorStateToHWC(HWC2::Layer* hwcLayer,
                         static_cast<uint8_t>(std::round(255.0f * outputIndependentState.color.b)),
                         255};
 
+    auto& writtenState = editState().hwc->writtenState;
+    if (writtenState.color == color) {
+        return;
+    }
+
     if (auto error = hwcLayer->setColor(color); error != hal::Error::NONE) {
         ALOGE("[%s] Failed to set color: %s (%d)", getLayerFE().getDebugName(),
               to_string(error).c_str(), static_cast<int32_t>(error));
+        writtenState.color.reset();
+    } else {
+        writtenState.color = color;
     }
 }
 
@@ -514,13 +548,22 @@ void OutputLayer::writeSidebandStateToHWC(HWC2::Layer* hwcLayer,
 
 void OutputLayer::writeBufferStateToHWC(HWC2::Layer* hwcLayer,
                                         const LayerFECompositionState& outputIndependentState) {
+    auto& writtenState = editState().hwc->writtenState;
     auto supportedPerFrameMetadata =
             getOutput().getDisplayColorProfile()->getSupportedPerFrameMetadata();
-    if (auto error = hwcLayer->setPerFrameMetadata(supportedPerFrameMetadata,
-                                                   outputIndependentState.hdrMetadata);
-        error != hal::Error::NONE && error != hal::Error::UNSUPPORTED) {
-        ALOGE("[%s] Failed to set hdrMetadata: %s (%d)", getLayerFE().getDebugName(),
-              to_string(error).c_str(), static_cast<int32_t>(error));
+    if (writtenState.supportedPerFrameMetadata != supportedPerFrameMetadata ||
+        writtenState.hdrMetadata != outputIndependentState.hdrMetadata) {
+        if (auto error = hwcLayer->setPerFrameMetadata(supportedPerFrameMetadata,
+                                                       outputIndependentState.hdrMetadata);
+            error != hal::Error::NONE && error != hal::Error::UNSUPPORTED) {
+            ALOGE("[%s] Failed to set hdrMetadata: %s (%d)", getLayerFE().getDebugName(),
+                  to_string(error).c_str(), static_cast<int32_t>(error));
+            writtenState.supportedPerFrameMetadata.reset();
+            writtenState.hdrMetadata.reset();
+        } else {
+            writtenState.supportedPerFrameMetadata = supportedPerFrameMetadata;
+            writtenState.hdrMetadata = outputIndependentState.hdrMetadata;
+        }
     }
 
     uint32_t hwcSlot = 0;
@@ -548,19 +591,36 @@ void OutputLayer::writeCompositionTypeToHWC(HWC2::Layer* hwcLayer,
         requestedCompositionType = hal::Composition::CLIENT;
     }
 
-    // Set the requested composition type with the HWC whenever it changes
-    if (outputDependentState.hwc->hwcCompositionType != requestedCompositionType) {
-        outputDependentState.hwc->hwcCompositionType = requestedCompositionType;
+    // Set the requested composition type with the HWC whenever it changes,
+    // including when the device changed it during validation.
+    auto& hwcState = *outputDependentState.hwc;
+    if (hwcState.hwcCompositionType != requestedCompositionType ||
+        hwcState.writtenState.compositionType != requestedCompositionType) {
+        hwcState.hwcCompositionType = requestedCompositionType;
+
+        // The color of a solid color layer is written again after its
+        // composition type.
+        hwcState.writtenState.color.reset();
 
         if (auto error = hwcLayer->setCompositionType(requestedCompositionType);
             error != hal::Error::NONE) {
             ALOGE("[%s] Failed to set composition type %s: %s (%d)", getLayerFE().getDebugName(),
                   toString(requestedCompositionType).c_str(), to_string(error).c_str(),
                   static_cast<int32_t>(error));
+            hwcState.writtenState.compositionType.reset();
+        } else {
+            hwcState.writtenState.compositionType = requestedCompositionType;
         }
     }
 }
 
+void OutputLayer::invalidateWrittenHwcState() {
+    auto& state = editState();
+    if (state.hwc) {
+        state.hwc->writtenState = {};
+    }
+}
+
 void OutputLayer::writeCursorPositionToHWC() const {
     // Skip doing this if there is no HWC interface
     auto hwcLayer = getHwcLayer();
@@ -124,6 +124,7 @@ struct DisplayTestCommon : public testing::Test {
         MOCK_METHOD1(applyChangedTypesToLayers, void(const impl::Display::ChangedTypes&));
         MOCK_METHOD1(applyDisplayRequests, void(const impl::Display::DisplayRequests&));
         MOCK_METHOD1(applyLayerRequestsToLayers, void(const impl::Display::LayerRequests&));
+        MOCK_METHOD0(invalidateWrittenHwcLayerState, void());
 
         const compositionengine::CompositionEngine& mCompositionEngine;
         impl::OutputCompositionState mState;
@@ -619,6 +620,7 @@ TEST_F(DisplayChooseCompositionStrategyTest, takesEarlyOutOnHwcError) {
     EXPECT_CALL(*mDisplay, anyLayersRequireClientComposition()).WillOnce(Return(false));
     EXPECT_CALL(mHwComposer, getDeviceCompositionChanges(DEFAULT_DISPLAY_ID, false, _))
             .WillOnce(Return(INVALID_OPERATION));
+    EXPECT_CALL(*mDisplay, invalidateWrittenHwcLayerState()).Times(1);
 
     mDisplay->chooseCompositionStrategy();
 
@@ -835,6 +837,20 @@ TEST_F(DisplayApplyLayerRequestsToLayersTest, appliesDeviceLayerRequests) {
     });
 }
 
+/*
+ * Display::invalidateWrittenHwcLayerState()
+ */
+
+using DisplayInvalidateWrittenHwcLayerStateTest = DisplayWithLayersTestCommon;
+
+TEST_F(DisplayInvalidateWrittenHwcLayerStateTest, invalidatesAllLayers) {
+    EXPECT_CALL(*mLayer1.outputLayer, invalidateWrittenHwcState()).Times(1);
+    EXPECT_CALL(*mLayer2.outputLayer, invalidateWrittenHwcState()).Times(1);
+    EXPECT_CALL(*mLayer3.outputLayer, invalidateWrittenHwcState()).Times(1);
+
+    mDisplay->invalidateWrittenHwcLayerState();
+}
+
 /*
  * Display::presentAndGetFrameFences()
  */
@@ -876,6 +892,22 @@ TEST_F(DisplayPresentAndGetFrameFencesTest, returnsPresentAndLayerFences) {
     EXPECT_EQ(layer2Fence, result.layerFences[&mLayer2.hwc2Layer]);
 }
 
+TEST_F(DisplayPresentAndGetFrameFencesTest, invalidatesWrittenLayerStateOnPresentError) {
+    EXPECT_CALL(mHwComposer, presentAndGetReleaseFences(DEFAULT_DISPLAY_ID))
+            .WillOnce(Return(INVALID_OPERATION));
+    EXPECT_CALL(*mLayer1.outputLayer, invalidateWrittenHwcState()).Times(1);
+    EXPECT_CALL(*mLayer2.outputLayer, invalidateWrittenHwcState()).Times(1);
+    EXPECT_CALL(*mLayer3.outputLayer, invalidateWrittenHwcState()).Times(1);
+    EXPECT_CALL(mHwComposer, getPresentFence(DEFAULT_DISPLAY_ID)).WillOnce(Return(Fence::NO_FENCE));
+    EXPECT_CALL(mHwComposer, getLayerReleaseFence(DEFAULT_DISPLAY_ID, &mLayer1.hwc2Layer))
+            .WillOnce(Return(Fence::NO_FENCE));
+    EXPECT_CALL(mHwComposer, getLayerReleaseFence(DEFAULT_DISPLAY_ID, &mLayer2.hwc2Layer))
+            .WillOnce(Return(Fence::NO_FENCE));
+    EXPECT_CALL(mHwComposer, clearReleaseFences(DEFAULT_DISPLAY_ID)).Times(1);
+
+    mDisplay->presentAndGetFrameFences();
+}
+
 /*
  * Display::setExpensiveRenderingExpected()
  */
@@ -33,6 +33,7 @@ namespace hal = android::hardware::graphics::composer::hal;
 
 using testing::_;
 using testing::InSequence;
+using testing::Mock;
 using testing::Return;
 using testing::ReturnRef;
 using testing::StrictMock;
@@ -761,6 +762,33 @@ struct OutputLayerWriteStateToHWCTest : public OutputLayerTest {
                 .WillOnce(Return(kError));
     }
 
+    // Expects the per-frame state of a static scene to be written successfully
+    // only once over all frames, and its buffer with every frame.
+    void expectStaticSceneCalls(Hwc2::IComposerClient::Composition compositionType, int frames) {
+        EXPECT_CALL(*mHwcLayer, setVisibleRegion(RegionEq(kOutputSpaceVisibleRegion)))
+                .WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setDataspace(kDataspace)).WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setColorTransform(kColorTransform))
+                .WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setSurfaceDamage(RegionEq(kSurfaceDamage)))
+                .WillOnce(Return(hal::Error::NONE));
+        EXPECT_CALL(*mHwcLayer, setCompositionType(compositionType))
+                .WillOnce(Return(hal::Error::NONE));
+        if (compositionType == Hwc2::IComposerClient::Composition::DEVICE) {
+            EXPECT_CALL(*mHwcLayer, setPerFrameMetadata(kSupportedPerFrameMetadata, kHdrMetadata))
+                    .WillOnce(Return(hal::Error::NONE));
+            EXPECT_CALL(*mHwcLayer, setBuffer(kExpectedHwcSlot, kBuffer, kFence))
+                    .Times(frames)
+                    .WillRepeatedly(Return(hal::Error::NONE));
+        }
+    }
+
+    void writeFrames(int frames) {
+        for (int i = 0; i < frames; i++) {
+            mOutputLayer.writeStateToHWC(false);
+        }
+    }
+
     void expectSetCompositionTypeCall(Hwc2::IComposerClient::Composition compositionType) {
         EXPECT_CALL(*mHwcLayer, setCompositionType(compositionType)).WillOnce(Return(kError));
     }
@@ -915,6 +943,8 @@ TEST_F(OutputLayerWriteStateToHWCTest, canSetPerFrameStateForDevice) {
 TEST_F(OutputLayerWriteStateToHWCTest, compositionTypeIsNotSetIfUnchanged) {
     (*mOutputLayer.editState().hwc).hwcCompositionType =
             Hwc2::IComposerClient::Composition::SOLID_COLOR;
+    (*mOutputLayer.editState().hwc).writtenState.compositionType =
+            Hwc2::IComposerClient::Composition::SOLID_COLOR;
 
     mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::SOLID_COLOR;
 
@@ -971,6 +1001,107 @@ TEST_F(OutputLayerWriteStateToHWCTest, perFrameStateDoesNotIncludeMetadataIfPres
     mOutputLayer.writeStateToHWC(false);
 }
 
+TEST_F(OutputLayerWriteStateToHWCTest, staticSceneWritesPerFrameStateOnce) {
+    constexpr int kFrames = 10;
+    mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::DEVICE;
+
+    expectStaticSceneCalls(Hwc2::IComposerClient::Composition::DEVICE, kFrames);
+
+    writeFrames(kFrames);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, staticSolidColorSceneWritesColorOnce) {
+    constexpr int kFrames = 10;
+    mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::SOLID_COLOR;
+
+    expectStaticSceneCalls(Hwc2::IComposerClient::Composition::SOLID_COLOR, kFrames);
+    EXPECT_CALL(*mHwcLayer, setColor(_)).WillOnce(Return(hal::Error::NONE));
+
+    writeFrames(kFrames);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, changedStateIsWrittenAgain) {
+    constexpr ui::Dataspace kOtherDataspace = static_cast<ui::Dataspace>(72);
+    const Region kOtherSurfaceDamage{Rect{2025, 2026, 2027, 2028}};
+    mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::SOLID_COLOR;
+
+    expectStaticSceneCalls(Hwc2::IComposerClient::Composition::SOLID_COLOR, 1);
+    EXPECT_CALL(*mHwcLayer, setColor(_)).WillOnce(Return(hal::Error::NONE));
+    writeFrames(1);
+
+    EXPECT_CALL(*mHwcLayer, setDataspace(kOtherDataspace)).WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setSurfaceDamage(RegionEq(kOtherSurfaceDamage)))
+            .WillOnce(Return(hal::Error::NONE));
+    mOutputLayer.editState().dataspace = kOtherDataspace;
+    mLayerFEState.surfaceDamage = kOtherSurfaceDamage;
+    writeFrames(2);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, failedWritesAreRetried) {
+    mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::SOLID_COLOR;
+
+    EXPECT_CALL(*mHwcLayer, setVisibleRegion(RegionEq(kOutputSpaceVisibleRegion)))
+            .WillOnce(Return(kError))
+            .WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setDataspace(kDataspace))
+            .WillOnce(Return(kError))
+            .WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setColorTransform(kColorTransform))
+            .WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setSurfaceDamage(RegionEq(kSurfaceDamage)))
+            .WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setCompositionType(Hwc2::IComposerClient::Composition::SOLID_COLOR))
+            .WillOnce(Return(kError))
+            .WillOnce(Return(hal::Error::NONE));
+    // Written again after each composition type.
+    EXPECT_CALL(*mHwcLayer, setColor(_)).Times(2).WillRepeatedly(Return(hal::Error::NONE));
+
+    writeFrames(3);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, unsupportedColorTransformIsWrittenEveryFrame) {
+    mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::SIDEBAND;
+
+    EXPECT_CALL(*mHwcLayer, setVisibleRegion(RegionEq(kOutputSpaceVisibleRegion)))
+            .WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setDataspace(kDataspace)).WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setColorTransform(kColorTransform))
+            .Times(2)
+            .WillRepeatedly(Return(hal::Error::UNSUPPORTED));
+    EXPECT_CALL(*mHwcLayer, setSurfaceDamage(RegionEq(kSurfaceDamage)))
+            .WillOnce(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setSidebandStream(kSidebandStreamHandle))
+            .Times(2)
+            .WillRepeatedly(Return(hal::Error::NONE));
+    EXPECT_CALL(*mHwcLayer, setCompositionType(Hwc2::IComposerClient::Composition::CLIENT))
+            .WillOnce(Return(hal::Error::NONE));
+
+    writeFrames(1);
+    mOutputLayer.editState().forceClientComposition = false;
+    writeFrames(1);
+
+    EXPECT_TRUE(mOutputLayer.getState().forceClientComposition);
+}
+
+TEST_F(OutputLayerWriteStateToHWCTest, invalidatedStateIsWrittenAgain) {
+    mLayerFEState.compositionType = Hwc2::IComposerClient::Composition::DEVICE;
+
+    expectStaticSceneCalls(Hwc2::IComposerClient::Composition::DEVICE, 1);
+    writeFrames(1);
+    Mock::VerifyAndClearExpectations(mHwcLayer.get());
+
+    mOutputLayer.invalidateWrittenHwcState();
+
+    expectStaticSceneCalls(Hwc2::IComposerClient::Composition::DEVICE, 1);
+    writeFrames(1);
+}
+
+TEST_F(OutputLayerTest, invalidateWrittenHwcStateHandlesNoHwcState) {
+    mOutputLayer.editState().hwc.reset();
+
+    mOutputLayer.invalidateWrittenHwcState();
+}
+
 /*
  * OutputLayer::writeCursorPositionToHWC()
  */
@@ -30,6 +30,7 @@
 #include <renderengine/mock/RenderEngine.h>
 #include <ui/Rect.h>
 #include <ui/Region.h>
+#include <workerpool/WorkerPool.h>
 
 #include "CallOrderStateMachineHelper.h"
 #include "MockHWC2.h"
@@ -663,6 +664,24 @@ TEST_F(OutputUpdateLayerStateFromFETest, preparesGeometryAndContentStateForAllCo
     mOutput->updateLayerStateFromFE(refreshArgs);
 }
 
+TEST_F(OutputUpdateLayerStateFromFETest, preparesStateForAllContainedLayersOnWorkers) {
+    // Enough layers to be split across several tasks.
+    constexpr size_t kLayerCount = 40;
+    InjectedLayer layers[kLayerCount];
+    for (auto& layer : layers) {
+        EXPECT_CALL(*layer.layerFE,
+                    prepareCompositionState(LayerFE::StateSubset::GeometryAndContent));
+        injectOutputLayer(layer);
+    }
+
+    WorkerPool workers(2, "OutputTest");
+    CompositionRefreshArgs refreshArgs;
+    refreshArgs.updatingGeometryThisFrame = true;
+    refreshArgs.layerStateWorkers = &workers;
+
+    mOutput->updateLayerStateFromFE(refreshArgs);
+}
+
 /*
  * Output::updateAndWriteCompositionState()
  */
@@ -1534,6 +1553,59 @@ TEST_F(OutputEnsureOutputLayerIfVisibleTest, takesNotSoEarlyOutifLayerWithShadow
     ensureOutputLayerIfVisible();
 }
 
+TEST_F(OutputEnsureOutputLayerIfVisibleTest, takesEarlyOutIfLayerIsBehindOpaqueRect) {
+    mCoverageState.dirtyRegion = Region(Rect(0, 0, 500, 500));
+    // A fullscreen opaque layer is above
+    mCoverageState.aboveCoveredLayers = Region(Rect(0, 0, 200, 300));
+    mCoverageState.aboveOpaqueLayers = Region(Rect(0, 0, 200, 300));
+
+    ensureOutputLayerIfVisible();
+
+    EXPECT_THAT(mCoverageState.dirtyRegion, RegionEq(Region(Rect(0, 0, 500, 500))));
+    EXPECT_THAT(mCoverageState.aboveCoveredLayers, RegionEq(Region(Rect(0, 0, 200, 300))));
+    EXPECT_THAT(mCoverageState.aboveOpaqueLayers, RegionEq(Region(Rect(0, 0, 200, 300))));
+}
+
+TEST_F(OutputEnsureOutputLayerIfVisibleTest, takesNotSoEarlyOutIfLayerIsBehindOpaqueRegion) {
+    // The layer is covered, but not by a single rectangle
+    const Region kOpaqueRegion = Region(Rect(0, 0, 200, 300)).orSelf(Rect(200, 0, 210, 10));
+
+    mCoverageState.dirtyRegion = Region(Rect(0, 0, 500, 500));
+    mCoverageState.aboveCoveredLayers = kOpaqueRegion;
+    mCoverageState.aboveOpaqueLayers = kOpaqueRegion;
+
+    ensureOutputLayerIfVisible();
+
+    EXPECT_THAT(mCoverageState.dirtyRegion, RegionEq(Region(Rect(0, 0, 500, 500))));
+    EXPECT_THAT(mCoverageState.aboveCoveredLayers, RegionEq(kOpaqueRegion));
+    EXPECT_THAT(mCoverageState.aboveOpaqueLayers, RegionEq(kOpaqueRegion));
+}
+
+TEST_F(OutputEnsureOutputLayerIfVisibleTest, handlesLayerNotOverlappingLayersAbove) {
+    mCoverageState.dirtyRegion = Region(Rect(0, 0, 0, 0));
+    // An opaque layer is above, right next to the layer
+    mCoverageState.aboveCoveredLayers = Region(Rect(100, 0, 200, 300));
+    mCoverageState.aboveOpaqueLayers = Region(Rect(100, 0, 200, 300));
+
+    EXPECT_CALL(mOutput, ensureOutputLayer(Eq(0u), Eq(mLayer.layerFE)))
+            .WillOnce(Return(&mLayer.outputLayer));
+
+    ensureOutputLayerIfVisible();
+
+    const Region kExpectedAboveRegion =
+            Region(Rect(0, 0, 100, 200)).orSelf(Rect(100, 0, 200, 300));
+
+    EXPECT_THAT(mCoverageState.dirtyRegion, RegionEq(kFullBoundsNoRotation));
+    EXPECT_THAT(mCoverageState.aboveCoveredLayers, RegionEq(kExpectedAboveRegion));
+    EXPECT_THAT(mCoverageState.aboveOpaqueLayers, RegionEq(kExpectedAboveRegion));
+
+    EXPECT_THAT(mLayer.outputLayerState.visibleRegion, RegionEq(kFullBoundsNoRotation));
+    EXPECT_THAT(mLayer.outputLayerState.visibleNonTransparentRegion,
+                RegionEq(kFullBoundsNoRotation));
+    EXPECT_THAT(mLayer.outputLayerState.coveredRegion, RegionEq(kEmptyRegion));
+    EXPECT_THAT(mLayer.outputLayerState.outputSpaceVisibleRegion, RegionEq(kFullBoundsNoRotation));
+}
+
 /*
  * Output::present()
  */
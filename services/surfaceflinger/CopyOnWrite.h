@@ -0,0 +1,70 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+namespace android {
+
+/*
+ * A value that copies share until one of them is edited, for the parts of
+ * Layer::State whose copies allocate. Committing a transaction copies the whole
+ * state, so without this a change to any field copied all of them.
+ *
+ * An edit never changes what another copy sees, so copies can be edited and
+ * read on different threads. A single instance must not be copied and edited
+ * at the same time, as with any other member of Layer::State.
+ */
+template <typename T>
+class CopyOnWrite {
+public:
+    CopyOnWrite() : mValue(std::make_shared<T>()) {}
+    CopyOnWrite(const T& value) : mValue(std::make_shared<T>(value)) {}
+    CopyOnWrite(T&& value) : mValue(std::make_shared<T>(std::move(value))) {}
+
+    CopyOnWrite& operator=(const T& value) {
+        if (mValue.use_count() == 1) {
+            *mValue = value;
+        } else {
+            mValue = std::make_shared<T>(value);
+        }
+        return *this;
+    }
+
+    const T& get() const { return *mValue; }
+    const T& operator*() const { return *mValue; }
+    const T* operator->() const { return mValue.get(); }
+    operator const T&() const { return *mValue; }
+
+    // Returns the value for writing, first copying it if it is shared.
+    T& edit() {
+        if (mValue.use_count() > 1) {
+            mValue = std::make_shared<T>(*mValue);
+        }
+        return *mValue;
+    }
+
+    // Whether this and |other| are copies that neither has edited since.
+    bool shares(const CopyOnWrite& other) const { return mValue == other.mValue; }
+
+private:
+    std::shared_ptr<T> mValue;
+};
+
+} // namespace android
@@ -793,12 +793,6 @@ Error Layer::setBuffer(uint32_t slot, const sp<GraphicBuffer>& buffer,
 
 Error Layer::setSurfaceDamage(const Region& damage)
 {
-    if (damage.isRect() && mDamageRegion.isRect() &&
-        (damage.getBounds() == mDamageRegion.getBounds())) {
-        return Error::NONE;
-    }
-    mDamageRegion = damage;
-
     // We encode default full-screen damage as INVALID_RECT upstream, but as 0
     // rects for HWC
     Hwc2::Error intError = Hwc2::Error::NONE;
@@ -840,67 +834,58 @@ Error Layer::setCompositionType(Composition type)
 
 Error Layer::setDataspace(Dataspace dataspace)
 {
-    if (dataspace == mDataSpace) {
-        return Error::NONE;
-    }
-    mDataSpace = dataspace;
-    auto intError = mComposer.setLayerDataspace(mDisplayId, mId, mDataSpace);
+    auto intError = mComposer.setLayerDataspace(mDisplayId, mId, dataspace);
     return static_cast<Error>(intError);
 }
 
 Error Layer::setPerFrameMetadata(const int32_t supportedPerFrameMetadata,
         const android::HdrMetadata& metadata)
 {
-    if (metadata == mHdrMetadata) {
-        return Error::NONE;
-    }
-
-    mHdrMetadata = metadata;
-    int validTypes = mHdrMetadata.validTypes & supportedPerFrameMetadata;
+    int validTypes = metadata.validTypes & supportedPerFrameMetadata;
     std::vector<Hwc2::PerFrameMetadata> perFrameMetadatas;
     if (validTypes & HdrMetadata::SMPTE2086) {
         perFrameMetadatas.insert(perFrameMetadatas.end(),
                                  {{Hwc2::PerFrameMetadataKey::DISPLAY_RED_PRIMARY_X,
-                                   mHdrMetadata.smpte2086.displayPrimaryRed.x},
+                                   metadata.smpte2086.displayPrimaryRed.x},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_RED_PRIMARY_Y,
-                                   mHdrMetadata.smpte2086.displayPrimaryRed.y},
+                                   metadata.smpte2086.displayPrimaryRed.y},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_GREEN_PRIMARY_X,
-                                   mHdrMetadata.smpte2086.displayPrimaryGreen.x},
+                                   metadata.smpte2086.displayPrimaryGreen.x},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_GREEN_PRIMARY_Y,
-                                   mHdrMetadata.smpte2086.displayPrimaryGreen.y},
+                                   metadata.smpte2086.displayPrimaryGreen.y},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_BLUE_PRIMARY_X,
-                                   mHdrMetadata.smpte2086.displayPrimaryBlue.x},
+                                   metadata.smpte2086.displayPrimaryBlue.x},
                                   {Hwc2::PerFrameMetadataKey::DISPLAY_BLUE_PRIMARY_Y,
-                                   mHdrMetadata.smpte2086.displayPrimaryBlue.y},
+                                   metadata.smpte2086.displayPrimaryBlue.y},
                                   {Hwc2::PerFrameMetadataKey::WHITE_POINT_X,
-                                   mHdrMetadata.smpte2086.whitePoint.x},
+                                   metadata.smpte2086.whitePoint.x},
                                   {Hwc2::PerFrameMetadataKey::WHITE_POINT_Y,
-                                   mHdrMetadata.smpte2086.whitePoint.y},
+                                   metadata.smpte2086.whitePoint.y},
                                   {Hwc2::PerFrameMetadataKey::MAX_LUMINANCE,
-                                   mHdrMetadata.smpte2086.maxLuminance},
+                                   metadata.smpte2086.maxLuminance},
                                   {Hwc2::PerFrameMetadataKey::MIN_LUMINANCE,
-                                   mHdrMetadata.smpte2086.minLuminance}});
+                                   metadata.smpte2086.minLuminance}});
     }
 
     if (validTypes & HdrMetadata::CTA861_3) {
         perFrameMetadatas.insert(perFrameMetadatas.end(),
                                  {{Hwc2::PerFrameMetadataKey::MAX_CONTENT_LIGHT_LEVEL,
-                                   mHdrMetadata.cta8613.maxContentLightLevel},
+                                   metadata.cta8613.maxContentLightLevel},
                                   {Hwc2::PerFrameMetadataKey::MAX_FRAME_AVERAGE_LIGHT_LEVEL,
-                                   mHdrMetadata.cta8613.maxFrameAverageLightLevel}});
+                                   metadata.cta8613.maxFrameAverageLightLevel}});
     }
 
     Error error = static_cast<Error>(
             mComposer.setLayerPerFrameMetadata(mDisplayId, mId, perFrameMetadatas));
 
     if (validTypes & HdrMetadata::HDR10PLUS) {
-        if (CC_UNLIKELY(mHdrMetadata.hdr10plus.size() == 0)) {
+        if (CC_UNLIKELY(metadata.hdr10plus.size() == 0)) {
             return Error::BAD_PARAMETER;
         }
 
         std::vector<Hwc2::PerFrameMetadataBlob> perFrameMetadataBlobs;
         perFrameMetadataBlobs.push_back(
-                {Hwc2::PerFrameMetadataKey::HDR10_PLUS_SEI, mHdrMetadata.hdr10plus});
+                {Hwc2::PerFrameMetadataKey::HDR10_PLUS_SEI, metadata.hdr10plus});
         Error setMetadataBlobsError = static_cast<Error>(
                 mComposer.setLayerPerFrameMetadataBlobs(mDisplayId, mId, perFrameMetadataBlobs));
         if (error == Error::NONE) {
@@ -952,12 +937,6 @@ Error Layer::setTransform(Transform transform)
 
 Error Layer::setVisibleRegion(const Region& region)
 {
-    if (region.isRect() && mVisibleRegion.isRect() &&
-        (region.getBounds() == mVisibleRegion.getBounds())) {
-        return Error::NONE;
-    }
-    mVisibleRegion = region;
-
     size_t rectCount = 0;
     auto rectArray = region.getArray(&rectCount);
 
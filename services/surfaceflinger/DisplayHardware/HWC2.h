@@ -442,11 +442,8 @@ private:
     hal::HWLayerId mId;
 
     // Cached HWC2 data, to ensure the same commands aren't sent to the HWC
-    // multiple times.
-    android::Region mVisibleRegion = android::Region::INVALID_REGION;
-    android::Region mDamageRegion = android::Region::INVALID_REGION;
-    hal::Dataspace mDataSpace = hal::Dataspace::UNKNOWN;
-    android::HdrMetadata mHdrMetadata;
+    // multiple times. Most per-frame state is cached by the
+    // compositionengine::OutputLayer which owns this layer instead.
     android::mat4 mColorMatrix;
     uint32_t mBufferSlot;
 };
@@ -106,7 +106,7 @@ Layer::Layer(const LayerCreationArgs& args)
     mCurrentState.crop.makeInvalid();
     mCurrentState.acquireFence = new Fence(-1);
     mCurrentState.dataspace = ui::Dataspace::UNKNOWN;
-    mCurrentState.hdrMetadata.validTypes = 0;
+    mCurrentState.hdrMetadata.edit().validTypes = 0;
     mCurrentState.surfaceDamageRegion = Region::INVALID_REGION;
     mCurrentState.cornerRadius = 0.0f;
     mCurrentState.backgroundBlurRadius = 0;
@@ -471,13 +471,13 @@ void Layer::prepareBasicGeometryCompositionState() {
 void Layer::prepareGeometryCompositionState() {
     const auto& drawingState{getDrawingState()};
 
-    int type = drawingState.metadata.getInt32(METADATA_WINDOW_TYPE, 0);
-    int appId = drawingState.metadata.getInt32(METADATA_OWNER_UID, 0);
+    int type = drawingState.metadata->getInt32(METADATA_WINDOW_TYPE, 0);
+    int appId = drawingState.metadata->getInt32(METADATA_OWNER_UID, 0);
     sp<Layer> parent = mDrawingParent.promote();
     if (parent.get()) {
         auto& parentState = parent->getDrawingState();
-        const int parentType = parentState.metadata.getInt32(METADATA_WINDOW_TYPE, 0);
-        const int parentAppId = parentState.metadata.getInt32(METADATA_OWNER_UID, 0);
+        const int parentType = parentState.metadata->getInt32(METADATA_WINDOW_TYPE, 0);
+        const int parentAppId = parentState.metadata->getInt32(METADATA_OWNER_UID, 0);
         if (parentType > 0 && parentAppId > 0) {
             type = parentType;
             appId = parentAppId;
@@ -508,8 +508,8 @@ void Layer::prepareGeometryCompositionState() {
         }
         const uint32_t id = compatIter->second;
 
-        auto it = drawingState.metadata.mMap.find(id);
-        if (it == std::end(drawingState.metadata.mMap)) {
+        auto it = drawingState.metadata->mMap.find(id);
+        if (it == std::end(drawingState.metadata->mMap)) {
             continue;
         }
 
@@ -987,6 +987,12 @@ uint32_t Layer::doTransaction(uint32_t flags) {
 
     const State& s(getDrawingState());
 
+    if (c.z != s.z || c.layerStack != s.layerStack || c.zOrderRelativeOf != s.zOrderRelativeOf ||
+        !std::equal(c.zOrderRelatives.begin(), c.zOrderRelatives.end(),
+                    s.zOrderRelatives.begin(), s.zOrderRelatives.end())) {
+        flags |= eZOrderChanged;
+    }
+
     if (getActiveGeometry(c) != getActiveGeometry(s)) {
         // invalidate and recompute the visible regions if needed
         flags |= Layer::eVisibleRegion;
@@ -1279,8 +1285,21 @@ bool Layer::setOverrideScalingMode(int32_t scalingMode) {
     return true;
 }
 
+// Whether merging |data| into |metadata| with eraseEmpty would change it.
+static bool changesMetadata(const LayerMetadata& metadata, const LayerMetadata& data) {
+    for (const auto& [key, value] : data.mMap) {
+        const auto it = metadata.mMap.find(key);
+        if (it == metadata.mMap.end() ? !value.empty() : it->second != value) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool Layer::setMetadata(const LayerMetadata& data) {
-    if (!mCurrentState.metadata.merge(data, true /* eraseEmpty */)) return false;
+    // Check first, as editing copies the metadata if the drawing state still shares it.
+    if (!changesMetadata(*mCurrentState.metadata, data)) return false;
+    mCurrentState.metadata.edit().merge(data, true /* eraseEmpty */);
     mCurrentState.sequence++;
     mCurrentState.modified = true;
     setTransactionFlags(eTransactionNeeded);
@@ -2174,13 +2193,18 @@ renderengine::ShadowSettings Layer::getShadowSettings(const Rect& viewport) cons
     return state;
 }
 
-void Layer::commitChildList() {
+bool Layer::commitChildList() {
+    bool changed = false;
     for (size_t i = 0; i < mCurrentChildren.size(); i++) {
         const auto& child = mCurrentChildren[i];
-        child->commitChildList();
+        changed |= child->commitChildList();
     }
+    changed |= mDrawingParent != mCurrentParent ||
+            !std::equal(mCurrentChildren.begin(), mCurrentChildren.end(),
+                        mDrawingChildren.begin(), mDrawingChildren.end());
     mDrawingChildren = mCurrentChildren;
     mDrawingParent = mCurrentParent;
+    return changed;
 }
 
 static wp<Layer> extractLayerFromBinder(const wp<IBinder>& weakBinderHandle) {
@@ -2354,13 +2378,13 @@ void Layer::writeToProtoCommonState(LayerProto* layerInfo, LayerVector::StateSet
     }
 
     if (traceFlags & SurfaceTracing::TRACE_INPUT) {
-        LayerProtoHelper::writeToProto(state.inputInfo, state.touchableRegionCrop,
+        LayerProtoHelper::writeToProto(*state.inputInfo, state.touchableRegionCrop,
                                        [&]() { return layerInfo->mutable_input_window_info(); });
     }
 
     if (traceFlags & SurfaceTracing::TRACE_EXTRA) {
         auto protoMap = layerInfo->mutable_metadata();
-        for (const auto& entry : state.metadata.mMap) {
+        for (const auto& entry : state.metadata->mMap) {
             (*protoMap)[entry.first] = std::string(entry.second.cbegin(), entry.second.cend());
         }
     }
@@ -2372,16 +2396,16 @@ bool Layer::isRemovedFromCurrentState() const  {
 
 InputWindowInfo Layer::fillInputInfo() {
     if (!hasInputInfo()) {
-        mDrawingState.inputInfo.name = getName();
-        mDrawingState.inputInfo.ownerUid = mCallingUid;
-        mDrawingState.inputInfo.ownerPid = mCallingPid;
-        mDrawingState.inputInfo.inputFeatures =
-            InputWindowInfo::INPUT_FEATURE_NO_INPUT_CHANNEL;
-        mDrawingState.inputInfo.layoutParamsFlags = InputWindowInfo::FLAG_NOT_TOUCH_MODAL;
-        mDrawingState.inputInfo.displayId = getLayerStack();
+        auto& inputInfo = mDrawingState.inputInfo.edit();
+        inputInfo.name = getName();
+        inputInfo.ownerUid = mCallingUid;
+        inputInfo.ownerPid = mCallingPid;
+        inputInfo.inputFeatures = InputWindowInfo::INPUT_FEATURE_NO_INPUT_CHANNEL;
+        inputInfo.layoutParamsFlags = InputWindowInfo::FLAG_NOT_TOUCH_MODAL;
+        inputInfo.displayId = getLayerStack();
     }
 
-    InputWindowInfo info = mDrawingState.inputInfo;
+    InputWindowInfo info = *mDrawingState.inputInfo;
     info.id = sequence;
 
     if (info.displayId == ADISPLAY_ID_NONE) {
@@ -2493,7 +2517,7 @@ sp<Layer> Layer::getClonedRoot() {
 }
 
 bool Layer::hasInputInfo() const {
-    return mDrawingState.inputInfo.token != nullptr;
+    return mDrawingState.inputInfo->token != nullptr;
 }
 
 bool Layer::canReceiveInput() const {
@@ -2601,7 +2625,7 @@ void Layer::updateClonedInputInfo(const std::map<sp<Layer>, sp<Layer>>& clonedLa
     }
     // Cloned layers shouldn't handle watch outside since their z order is not determined by
     // WM or the client.
-    mDrawingState.inputInfo.layoutParamsFlags &= ~InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH;
+    mDrawingState.inputInfo.edit().layoutParamsFlags &= ~InputWindowInfo::FLAG_WATCH_OUTSIDE_TOUCH;
 }
 
 void Layer::updateClonedRelatives(const std::map<sp<Layer>, sp<Layer>>& clonedLayersMap) {
@@ -43,6 +43,7 @@
 
 #include "Client.h"
 #include "ClientCache.h"
+#include "CopyOnWrite.h"
 #include "DisplayHardware/ComposerHal.h"
 #include "DisplayHardware/HWComposer.h"
 #include "FrameTracker.h"
@@ -118,7 +119,8 @@ public:
     enum { // flags for doTransaction()
         eDontUpdateGeometryState = 0x00000001,
         eVisibleRegion = 0x00000002,
-        eInputInfoChanged = 0x00000004
+        eInputInfoChanged = 0x00000004,
+        eZOrderChanged = 0x00000008
     };
 
     struct Geometry {
@@ -208,7 +210,7 @@ public:
         Region activeTransparentRegion_legacy;
         Region requestedTransparentRegion_legacy;
 
-        LayerMetadata metadata;
+        CopyOnWrite<LayerMetadata> metadata;
 
         // If non-null, a Surface this Surface's Z-order is interpreted relative to.
         wp<Layer> zOrderRelativeOf;
@@ -222,7 +224,7 @@ public:
         int backgroundBlurRadius;
 
         bool inputInfoChanged;
-        InputWindowInfo inputInfo;
+        CopyOnWrite<InputWindowInfo> inputInfo;
         wp<Layer> touchableRegionCrop;
 
         // dataspace is only used by BufferStateLayer and EffectLayer
@@ -241,7 +243,7 @@ public:
         sp<GraphicBuffer> buffer;
         client_cache_t clientCacheId;
         sp<Fence> acquireFence;
-        HdrMetadata hdrMetadata;
+        CopyOnWrite<HdrMetadata> hdrMetadata;
         Region surfaceDamageRegion;
         int32_t api;
 
@@ -805,8 +807,9 @@ public:
             const sp<IBinder>& relativeToHandle, int32_t relativeZ);
 
     // Copy the current list of children to the drawing state. Called by
-    // SurfaceFlinger to complete a transaction.
-    void commitChildList();
+    // SurfaceFlinger to complete a transaction. Returns whether the drawing
+    // children or parent of this layer or its descendants changed.
+    bool commitChildList();
     int32_t getZ(LayerVector::StateSet stateSet) const;
     virtual void pushPendingState();
 
@@ -865,6 +868,7 @@ protected:
     friend class TestableSurfaceFlinger;
     friend class RefreshRateSelectionTest;
     friend class SetFrameRateTest;
+    friend class LayerZOrderTraversalTest;
 
     virtual void commitTransaction(const State& stateToCommit);
 
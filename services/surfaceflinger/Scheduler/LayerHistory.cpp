@@ -97,13 +97,13 @@ void LayerHistory::record(Layer* layer, nsecs_t presentTime, nsecs_t now,
     }
 }
 
-LayerHistory::Summary LayerHistory::summarize(nsecs_t now) {
+void LayerHistory::summarize(nsecs_t now, Summary* summary) {
     ATRACE_CALL();
     std::lock_guard lock(mLock);
 
     partitionLayers(now);
 
-    LayerHistory::Summary summary;
+    summary->clear();
     for (const auto& [weakLayer, info] : activeLayers()) {
         const bool recent = info->isRecentlyActive(now);
         auto layer = weakLayer.promote();
@@ -124,10 +124,10 @@ LayerHistory::Summary LayerHistory::summarize(nsecs_t now) {
                             return LayerVoteType::NoVote;
                     }
                 }();
-                summary.push_back({layer->getName(), voteType, frameRate.rate, /* weight */ 1.0f,
+                summary->push_back({layer->getName(), voteType, frameRate.rate, /* weight */ 1.0f,
                                    layerFocused});
             } else if (recent) {
-                summary.push_back({layer->getName(), LayerVoteType::Heuristic,
+                summary->push_back({layer->getName(), LayerVoteType::Heuristic,
                                    info->getRefreshRate(now),
                                    /* weight */ 1.0f, layerFocused});
             }
@@ -137,8 +137,6 @@ LayerHistory::Summary LayerHistory::summarize(nsecs_t now) {
             }
         }
     }
-
-    return summary;
 }
 
 void LayerHistory::partitionLayers(nsecs_t now) {
@@ -20,6 +20,7 @@
 #include <utils/RefBase.h>
 #include <utils/Timers.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <utility>
@@ -67,8 +68,9 @@ public:
 
     using Summary = std::vector<RefreshRateConfigs::LayerRequirement>;
 
-    // Rebuilds sets of active/inactive layers, and accumulates stats for active layers.
-    virtual Summary summarize(nsecs_t now) = 0;
+    // Rebuilds sets of active/inactive layers, and accumulates stats for active layers into the
+    // caller's summary, reusing its storage.
+    virtual void summarize(nsecs_t now, Summary* summary) = 0;
 
     virtual void clear() = 0;
 };
@@ -94,7 +96,7 @@ public:
     void record(Layer*, nsecs_t presentTime, nsecs_t now, LayerUpdateType updateType) override;
 
     // Rebuilds sets of active/inactive layers, and accumulates stats for active layers.
-    android::scheduler::LayerHistory::Summary summarize(nsecs_t now) override;
+    void summarize(nsecs_t now, Summary* summary) override;
 
     void clear() override;
 
@@ -152,7 +154,7 @@ public:
     void record(Layer*, nsecs_t presentTime, nsecs_t now, LayerUpdateType updateType) override;
 
     // Rebuilds sets of active/inactive layers, and accumulates stats for active layers.
-    android::scheduler::LayerHistory::Summary summarize(nsecs_t /*now*/) override;
+    void summarize(nsecs_t now, Summary* summary) override;
 
     void clear() override;
 
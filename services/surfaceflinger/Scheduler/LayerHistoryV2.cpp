@@ -39,9 +39,10 @@ namespace android::scheduler::impl {
 
 namespace {
 
-bool isLayerActive(const Layer& layer, const LayerInfoV2& info, nsecs_t threshold) {
+bool isLayerActive(const Layer& layer, const Layer::FrameRate& frameRate, const LayerInfoV2& info,
+                   nsecs_t threshold) {
     // Layers with an explicit vote are always kept active
-    if (layer.getFrameRateForLayerTree().rate > 0) {
+    if (frameRate.rate > 0) {
         return true;
     }
 
@@ -112,13 +113,12 @@ void LayerHistoryV2::record(Layer* layer, nsecs_t presentTime, nsecs_t now,
     }
 }
 
-LayerHistoryV2::Summary LayerHistoryV2::summarize(nsecs_t now) {
-    LayerHistory::Summary summary;
-
+void LayerHistoryV2::summarize(nsecs_t now, Summary* summary) {
     std::lock_guard lock(mLock);
 
     partitionLayers(now);
 
+    size_t count = 0;
     for (const auto& [layer, info] : activeLayers()) {
         const auto strong = layer.promote();
         if (!strong) {
@@ -144,14 +144,25 @@ LayerHistoryV2::Summary LayerHistoryV2::summarize(nsecs_t now) {
 
         const float layerArea = transformed.getWidth() * transformed.getHeight();
         float weight = mDisplayArea ? layerArea / mDisplayArea : 0.0f;
-        summary.push_back({strong->getName(), type, refreshRate, weight, layerFocused});
+
+        // Overwrite the requirements in place, so that their names keep their storage from one
+        // summary to the next.
+        if (count == summary->size()) {
+            summary->emplace_back();
+        }
+        auto& requirement = (*summary)[count++];
+        requirement.name = strong->getName();
+        requirement.vote = type;
+        requirement.desiredRefreshRate = refreshRate;
+        requirement.weight = weight;
+        requirement.focused = layerFocused;
 
         if (CC_UNLIKELY(mTraceEnabled)) {
             trace(layer, *info, type, static_cast<int>(std::round(refreshRate)));
         }
     }
 
-    return summary;
+    summary->resize(count);
 }
 
 void LayerHistoryV2::partitionLayers(nsecs_t now) {
@@ -161,10 +172,11 @@ void LayerHistoryV2::partitionLayers(nsecs_t now) {
     size_t i = 0;
     while (i < mActiveLayersEnd) {
         auto& [weak, info] = mLayerInfos[i];
-        if (const auto layer = weak.promote(); layer && isLayerActive(*layer, *info, threshold)) {
+        const auto layer = weak.promote();
+        // Set layer vote if set
+        const auto frameRate = layer ? layer->getFrameRateForLayerTree() : Layer::FrameRate();
+        if (layer && isLayerActive(*layer, frameRate, *info, threshold)) {
             i++;
-            // Set layer vote if set
-            const auto frameRate = layer->getFrameRateForLayerTree();
             const auto voteType = [&]() {
                 switch (frameRate.type) {
                     case Layer::FrameRateCompatibility::Default:
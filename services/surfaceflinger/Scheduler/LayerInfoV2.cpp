@@ -20,6 +20,7 @@
 #include "LayerInfoV2.h"
 
 #include <algorithm>
+#include <limits>
 #include <utility>
 
 #include <cutils/compiler.h>
@@ -56,12 +57,76 @@ void LayerInfoV2::setLastPresentTime(nsecs_t lastPresentTime, nsecs_t now,
             FrameTimeData frameTime = {.presetTime = lastPresentTime,
                                        .queueTime = mLastUpdatedTime,
                                        .pendingConfigChange = pendingConfigChange};
-            mFrameTimes.push_back(frameTime);
-            if (mFrameTimes.size() > HISTORY_SIZE) {
-                mFrameTimes.pop_front();
-            }
+            addFrameTime(frameTime);
             break;
     }
+    mCachedRefreshRate.reset();
+}
+
+void LayerInfoV2::addFrameTime(const FrameTimeData& frameTime) {
+    if (mFrameTimes.full()) {
+        removeOldestFrameTime();
+    }
+
+    if (!mFrameTimes.empty()) {
+        const FrameTimeData& previous = mFrameTimes.back();
+        FrameTimeDelta delta = {
+                .queueTime = std::max(frameTime.queueTime - previous.queueTime,
+                                      mHighRefreshRatePeriod),
+                .presentTime = std::max(frameTime.presetTime - previous.presetTime,
+                                        mHighRefreshRatePeriod),
+                .pendingConfigChange =
+                        previous.pendingConfigChange || frameTime.pendingConfigChange,
+                .missingPresentTime = previous.presetTime == 0 || frameTime.presetTime == 0,
+                .presentTimeOnlyFramesBefore = mFrameTimeTotals.presentTimeOnlyFrames};
+
+        auto& totals = mFrameTimeTotals;
+        if (delta.queueTime < MAX_FRAME_TIME) {
+            totals.queueTimeDeltas += delta.queueTime;
+            totals.queueTimeFrames++;
+        }
+        if (delta.missingPresentTime) {
+            mMissingPresentTimes.push_back(delta.presentTimeOnlyFramesBefore);
+        } else if (delta.presentTime < MAX_FRAME_TIME) {
+            totals.presentTimeDeltas += delta.presentTime;
+            if (delta.queueTime >= MAX_FRAME_TIME) {
+                totals.presentTimeOnlyFrames++;
+            }
+        }
+        if (delta.pendingConfigChange) {
+            totals.pendingConfigChanges++;
+        }
+        mFrameTimeDeltas.push_back(delta);
+    }
+    mFrameTimes.push_back(frameTime);
+}
+
+void LayerInfoV2::removeOldestFrameTime() {
+    mFrameTimes.pop_front();
+    if (mFrameTimeDeltas.empty()) return;
+
+    const FrameTimeDelta& delta = mFrameTimeDeltas.front();
+    auto& totals = mFrameTimeTotals;
+    if (delta.queueTime < MAX_FRAME_TIME) {
+        totals.queueTimeDeltas -= delta.queueTime;
+        totals.queueTimeFrames--;
+    }
+    if (delta.missingPresentTime) {
+        mMissingPresentTimes.pop_front();
+    } else if (delta.presentTime < MAX_FRAME_TIME) {
+        totals.presentTimeDeltas -= delta.presentTime;
+    }
+    if (delta.pendingConfigChange) {
+        totals.pendingConfigChanges--;
+    }
+    mFrameTimeDeltas.pop_front();
+}
+
+void LayerInfoV2::clearFrameTimes() {
+    mFrameTimes.clear();
+    mFrameTimeDeltas.clear();
+    mMissingPresentTimes.clear();
+    mFrameTimeTotals = {};
 }
 
 bool LayerInfoV2::isFrameTimeValid(const FrameTimeData& frameTime) const {
@@ -70,6 +135,14 @@ bool LayerInfoV2::isFrameTimeValid(const FrameTimeData& frameTime) const {
                                           .count();
 }
 
+size_t LayerInfoV2::getFirstActiveFrame(nsecs_t now) const {
+    size_t i = 0;
+    while (i < mFrameTimes.size() && mFrameTimes[i].queueTime < getActiveLayerThreshold(now)) {
+        i++;
+    }
+    return i;
+}
+
 bool LayerInfoV2::isFrequent(nsecs_t now) const {
     // If we know nothing about this layer we consider it as frequent as it might be the start
     // of an animation.
@@ -77,24 +150,31 @@ bool LayerInfoV2::isFrequent(nsecs_t now) const {
         return true;
     }
 
-    // Find the first active frame
-    auto it = mFrameTimes.begin();
-    for (; it != mFrameTimes.end(); ++it) {
-        if (it->queueTime >= getActiveLayerThreshold(now)) {
-            break;
-        }
-    }
-
-    const auto numFrames = std::distance(it, mFrameTimes.end());
+    const size_t first = getFirstActiveFrame(now);
+    const size_t numFrames = mFrameTimes.size() - first;
     if (numFrames < FREQUENT_LAYER_WINDOW_SIZE) {
         return false;
     }
 
     // Layer is considered frequent if the average frame rate is higher than the threshold
-    const auto totalTime = mFrameTimes.back().queueTime - it->queueTime;
+    const auto totalTime = mFrameTimes.back().queueTime - mFrameTimes[first].queueTime;
     return (1e9f * (numFrames - 1)) / totalTime >= MIN_FPS_FOR_FREQUENT_LAYER;
 }
 
+nsecs_t LayerInfoV2::getFrequentValidUntil(nsecs_t now) const {
+    constexpr nsecs_t kForever = std::numeric_limits<nsecs_t>::max();
+    if (mFrameTimes.size() < FREQUENT_LAYER_WINDOW_SIZE) {
+        return kForever;
+    }
+
+    // The window of isFrequent() changes once its oldest frame is no longer recent.
+    const size_t first = getFirstActiveFrame(now);
+    if (first == mFrameTimes.size()) {
+        return kForever;
+    }
+    return mFrameTimes[first].queueTime + MAX_ACTIVE_LAYER_PERIOD_NS.count() + 1;
+}
+
 bool LayerInfoV2::isAnimating(nsecs_t now) const {
     return mLastAnimationTime >= getActiveLayerThreshold(now);
 }
@@ -122,45 +202,29 @@ bool LayerInfoV2::hasEnoughDataForHeuristic() const {
 }
 
 std::optional<nsecs_t> LayerInfoV2::calculateAverageFrameTime() const {
-    nsecs_t totalPresentTimeDeltas = 0;
-    nsecs_t totalQueueTimeDeltas = 0;
-    bool missingPresentTime = false;
-    int numFrames = 0;
-    for (auto it = mFrameTimes.begin(); it != mFrameTimes.end() - 1; ++it) {
-        bool noUpdate = false;
-        // Ignore frames captured during a config change
-        if (it->pendingConfigChange || (it + 1)->pendingConfigChange) {
-            return std::nullopt;
-        }
-        nsecs_t val = std::max(((it + 1)->queueTime - it->queueTime), mHighRefreshRatePeriod);
-        // Only if val < 10,000,000ns (10FPS) add to count.
-        if (val < MAX_FRAME_TIME) {
-            totalQueueTimeDeltas += val;
-            numFrames++;
-        } else {
-            noUpdate = true;
-        }
+    const auto& totals = mFrameTimeTotals;
 
-        if (!missingPresentTime && (it->presetTime == 0 || (it + 1)->presetTime == 0)) {
-            missingPresentTime = true;
-            // If there are no presentation timestamps and we haven't calculated
-            // one in the past then we can't calculate the refresh rate
-            if (mLastRefreshRate.reported == 0) {
-                return std::nullopt;
-            }
-            continue;
-        }
-        // Check threshold here as well
-        val = std::max(((it + 1)->presetTime - it->presetTime), mHighRefreshRatePeriod);
-        if (val < MAX_FRAME_TIME) {
-            totalPresentTimeDeltas += val;
-            if (noUpdate && !missingPresentTime) {
-                //If queueTime was out of bound but presentTime was in bound, increment numFrames
-                numFrames++;
-            }
-        }
+    // Ignore frames captured during a config change
+    if (totals.pendingConfigChanges > 0) {
+        return std::nullopt;
+    }
+
+    const bool missingPresentTime = !mMissingPresentTimes.empty();
+    // If there are no presentation timestamps and we haven't calculated
+    // one in the past then we can't calculate the refresh rate
+    if (missingPresentTime && mLastRefreshRate.reported == 0) {
+        return std::nullopt;
     }
 
+    // Frames whose queueTime was out of bound but presentTime was in bound count too, up to
+    // the first frame missing a presentation timestamp.
+    const uint64_t presentTimeOnlyFramesEnd =
+            missingPresentTime ? mMissingPresentTimes.front() : totals.presentTimeOnlyFrames;
+    const uint64_t presentTimeOnlyFrames = mFrameTimeDeltas.empty()
+            ? 0
+            : presentTimeOnlyFramesEnd - mFrameTimeDeltas.front().presentTimeOnlyFramesBefore;
+    const int numFrames = totals.queueTimeFrames + static_cast<int>(presentTimeOnlyFrames);
+
     // Calculate the average frame time based on presentation timestamps. If those
     // doesn't exist, we look at the time the buffer was queued only. We can do that only if
     // we calculated a refresh rate based on presentation timestamps in the past. The reason
@@ -173,12 +237,14 @@ std::optional<nsecs_t> LayerInfoV2::calculateAverageFrameTime() const {
         return std::nullopt;
     }
     const auto averageFrameTime =
-            static_cast<float>(missingPresentTime ? totalQueueTimeDeltas : totalPresentTimeDeltas) /
+            static_cast<float>(missingPresentTime ? totals.queueTimeDeltas
+                                                  : totals.presentTimeDeltas) /
             numFrames;
     return static_cast<nsecs_t>(averageFrameTime);
 }
 
-std::optional<float> LayerInfoV2::calculateRefreshRateIfPossible(nsecs_t now) {
+std::optional<float> LayerInfoV2::calculateRefreshRateIfPossible(
+        nsecs_t now, std::optional<float>* outAddedRefreshRate) {
     static constexpr float MARGIN = 1.0f; // 1Hz
     if (!hasEnoughDataForHeuristic()) {
         ALOGV("Not enough data");
@@ -189,6 +255,7 @@ std::optional<float> LayerInfoV2::calculateRefreshRateIfPossible(nsecs_t now) {
     if (averageFrameTime.has_value()) {
         const auto refreshRate = 1e9f / *averageFrameTime;
         const bool refreshRateConsistent = mRefreshRateHistory.add(refreshRate, now);
+        *outAddedRefreshRate = refreshRate;
         if (refreshRateConsistent) {
             const auto knownRefreshRate =
                     sRefreshRateConfigs->findClosestKnownFrameRate(refreshRate);
@@ -214,21 +281,44 @@ std::optional<float> LayerInfoV2::calculateRefreshRateIfPossible(nsecs_t now) {
 }
 
 std::pair<LayerHistory::LayerVoteType, float> LayerInfoV2::getRefreshRate(nsecs_t now) {
+    if (mCachedRefreshRate && now >= mCachedRefreshRate->computedAt &&
+        now < mCachedRefreshRate->validUntil) {
+        if (const auto refreshRate = mCachedRefreshRate->historyRefreshRate) {
+            mSkippedRefreshRate = {*refreshRate, now};
+        }
+        return {mCachedRefreshRate->type, mCachedRefreshRate->fps};
+    }
+
+    // The history only holds copies of the refresh rate until the last skipped one, so adding
+    // that one is enough to catch up.
+    if (mSkippedRefreshRate) {
+        mRefreshRateHistory.add(mSkippedRefreshRate->refreshRate, mSkippedRefreshRate->time);
+        mSkippedRefreshRate.reset();
+    }
+
+    mCachedRefreshRate = calculateRefreshRate(now);
+    return {mCachedRefreshRate->type, mCachedRefreshRate->fps};
+}
+
+LayerInfoV2::CachedRefreshRate LayerInfoV2::calculateRefreshRate(nsecs_t now) {
+    constexpr nsecs_t kForever = std::numeric_limits<nsecs_t>::max();
+
     if (mLayerVote.type != LayerHistory::LayerVoteType::Heuristic) {
         ALOGV("%s voted %d ", mName.c_str(), static_cast<int>(mLayerVote.type));
-        return {mLayerVote.type, mLayerVote.fps};
+        return {mLayerVote.type, mLayerVote.fps, now, kForever};
     }
 
     if (isAnimating(now)) {
         ALOGV("%s is animating", mName.c_str());
         mLastRefreshRate.animatingOrInfrequent = true;
-        return {LayerHistory::LayerVoteType::Max, 0};
+        return {LayerHistory::LayerVoteType::Max, 0, now,
+                mLastAnimationTime + MAX_ACTIVE_LAYER_PERIOD_NS.count() + 1};
     }
 
     if (!isFrequent(now)) {
         ALOGV("%s is infrequent", mName.c_str());
         mLastRefreshRate.animatingOrInfrequent = true;
-        return {LayerHistory::LayerVoteType::Min, 0};
+        return {LayerHistory::LayerVoteType::Min, 0, now, getFrequentValidUntil(now)};
     }
 
     // If the layer was previously tagged as animating or infrequent, we clear
@@ -238,14 +328,30 @@ std::pair<LayerHistory::LayerVoteType, float> LayerInfoV2::getRefreshRate(nsecs_
         clearHistory(now);
     }
 
-    auto refreshRate = calculateRefreshRateIfPossible(now);
+    std::optional<float> addedRefreshRate;
+    auto refreshRate = calculateRefreshRateIfPossible(now, &addedRefreshRate);
+
+    CachedRefreshRate result{LayerHistory::LayerVoteType::Max, 0, now, getFrequentValidUntil(now)};
     if (refreshRate.has_value()) {
         ALOGV("%s calculated refresh rate: %.2f", mName.c_str(), refreshRate.value());
-        return {LayerHistory::LayerVoteType::Heuristic, refreshRate.value()};
+        result.type = LayerHistory::LayerVoteType::Heuristic;
+        result.fps = refreshRate.value();
+    } else {
+        ALOGV("%s Max (can't resolve refresh rate)", mName.c_str());
     }
 
-    ALOGV("%s Max (can't resolve refresh rate)", mName.c_str());
-    return {LayerHistory::LayerVoteType::Max, 0};
+    // Adding the same refresh rate again only changes the outcome if the history holds others,
+    // or once it has been dropped from the history.
+    if (addedRefreshRate) {
+        if (mRefreshRateHistory.isUniform()) {
+            result.validUntil =
+                    std::min(result.validUntil, now + RefreshRateHistory::HISTORY_DURATION.count());
+            result.historyRefreshRate = addedRefreshRate;
+        } else {
+            result.validUntil = now;
+        }
+    }
+    return result;
 }
 
 const char* LayerInfoV2::getTraceTag(android::scheduler::LayerHistory::LayerVoteType type) const {
@@ -289,20 +395,31 @@ bool LayerInfoV2::RefreshRateHistory::add(float refreshRate, nsecs_t now) {
     return isConsistent();
 }
 
+bool LayerInfoV2::RefreshRateHistory::isUniform() const {
+    for (size_t i = 1; i < mRefreshRates.size(); i++) {
+        if (mRefreshRates[i].refreshRate != mRefreshRates[0].refreshRate) return false;
+    }
+    return true;
+}
+
 bool LayerInfoV2::RefreshRateHistory::isConsistent() const {
     if (mRefreshRates.empty()) return true;
 
-    const auto max = std::max_element(mRefreshRates.begin(), mRefreshRates.end());
-    const auto min = std::min_element(mRefreshRates.begin(), mRefreshRates.end());
-    const auto consistent = max->refreshRate - min->refreshRate <= MARGIN_FPS;
+    float min = mRefreshRates[0].refreshRate;
+    float max = min;
+    for (size_t i = 1; i < mRefreshRates.size(); i++) {
+        min = std::min(min, mRefreshRates[i].refreshRate);
+        max = std::max(max, mRefreshRates[i].refreshRate);
+    }
+    const auto consistent = max - min <= MARGIN_FPS;
 
     if (CC_UNLIKELY(sTraceEnabled)) {
         if (!mHeuristicTraceTagData.has_value()) {
             mHeuristicTraceTagData = makeHeuristicTraceTagData();
         }
 
-        ATRACE_INT(mHeuristicTraceTagData->max.c_str(), static_cast<int>(max->refreshRate));
-        ATRACE_INT(mHeuristicTraceTagData->min.c_str(), static_cast<int>(min->refreshRate));
+        ATRACE_INT(mHeuristicTraceTagData->max.c_str(), static_cast<int>(max));
+        ATRACE_INT(mHeuristicTraceTagData->min.c_str(), static_cast<int>(min));
         ATRACE_INT(mHeuristicTraceTagData->consistent.c_str(), consistent);
     }
 
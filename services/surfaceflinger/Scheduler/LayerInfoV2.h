@@ -19,10 +19,11 @@
 #include <utils/Timers.h>
 
 #include <chrono>
-#include <deque>
+#include <optional>
 
 #include "LayerHistory.h"
 #include "RefreshRateConfigs.h"
+#include "RingBuffer.h"
 #include "SchedulerUtils.h"
 
 namespace android {
@@ -76,7 +77,12 @@ public:
 
     // Sets an explicit layer vote. This usually comes directly from the application via
     // ANativeWindow_setFrameRate API
-    void setLayerVote(LayerHistory::LayerVoteType type, float fps) { mLayerVote = {type, fps}; }
+    void setLayerVote(LayerHistory::LayerVoteType type, float fps) {
+        if (mLayerVote.type != type || mLayerVote.fps != fps) {
+            mLayerVote = {type, fps};
+            mCachedRefreshRate.reset();
+        }
+    }
 
     // Sets the default layer vote. This will be the layer vote after calling to resetLayerVote().
     // This is used for layers that called to setLayerVote() and then removed the vote, so that the
@@ -84,8 +90,10 @@ public:
     void setDefaultLayerVote(LayerHistory::LayerVoteType type) { mDefaultVote = type; }
 
     // Resets the layer vote to its default.
-    void resetLayerVote() { mLayerVote = {mDefaultVote, 0.0f}; }
+    void resetLayerVote() { setLayerVote(mDefaultVote, 0.0f); }
 
+    // Returns the vote of the layer. Recomputing it is skipped when nothing it depends on has
+    // changed since the last call.
     std::pair<LayerHistory::LayerVoteType, float> getRefreshRate(nsecs_t now);
 
     // Return the last updated time. If the present time is farther in the future than the
@@ -104,11 +112,13 @@ public:
         mFrameTimeValidSince = std::chrono::time_point<std::chrono::steady_clock>(timePoint);
         mLastRefreshRate = {};
         mRefreshRateHistory.clear();
+        mCachedRefreshRate.reset();
+        mSkippedRefreshRate.reset();
     }
 
     void clearHistory(nsecs_t now) {
         onLayerInactive(now);
-        mFrameTimes.clear();
+        clearFrameTimes();
     }
 
 private:
@@ -119,6 +129,28 @@ private:
         bool pendingConfigChange;
     };
 
+    // How a frame follows the previous one, as used by calculateAverageFrameTime().
+    struct FrameTimeDelta {
+        nsecs_t queueTime;
+        nsecs_t presentTime;
+        bool pendingConfigChange;
+        bool missingPresentTime;
+        // The value of FrameTimeTotals::presentTimeOnlyFrames before this delta.
+        uint64_t presentTimeOnlyFramesBefore;
+    };
+
+    // Running totals over the deltas of the recorded frames, so that the average frame time
+    // doesn't need to go through all of them.
+    struct FrameTimeTotals {
+        nsecs_t queueTimeDeltas = 0;
+        int queueTimeFrames = 0;
+        nsecs_t presentTimeDeltas = 0;
+        int pendingConfigChanges = 0;
+        // The deltas ever added which only count as a frame by their present time. Never
+        // decremented, so that the deltas before a given one can be counted by subtraction.
+        uint64_t presentTimeOnlyFrames = 0;
+    };
+
     // Holds information about the calculated and reported refresh rate
     struct RefreshRateHeuristicData {
         // Rate calculated on the layer
@@ -136,6 +168,24 @@ private:
         float fps = 0.0f;
     };
 
+    // The vote returned by getRefreshRate(), which stays the same for calls in
+    // [computedAt, validUntil) unless the layer is updated or its vote changes.
+    struct CachedRefreshRate {
+        LayerHistory::LayerVoteType type;
+        float fps;
+        nsecs_t computedAt;
+        nsecs_t validUntil;
+        // The refresh rate added to the history when computing the vote, which every call
+        // reusing the vote would have added again.
+        std::optional<float> historyRefreshRate;
+    };
+
+    // A refresh rate which was not added to the history by a call reusing the cached vote.
+    struct SkippedRefreshRate {
+        float refreshRate;
+        nsecs_t time;
+    };
+
     // Class to store past calculated refresh rate and determine whether
     // the refresh rate calculated is consistent with past values
     class RefreshRateHistory {
@@ -151,6 +201,10 @@ private:
         // Adds a new refresh rate and returns true if it is consistent
         bool add(float refreshRate, nsecs_t now);
 
+        // Whether all the refresh rates are the same, so that adding the same one again
+        // doesn't change whether they are consistent.
+        bool isUniform() const;
+
     private:
         friend class LayerHistoryTestV2;
 
@@ -177,14 +231,25 @@ private:
 
         const std::string mName;
         mutable std::optional<HeuristicTraceTagData> mHeuristicTraceTagData;
-        std::deque<RefreshRateData> mRefreshRates;
+        RingBuffer<RefreshRateData, HISTORY_SIZE> mRefreshRates;
         static constexpr float MARGIN_FPS = 1.0;
     };
 
+    void addFrameTime(const FrameTimeData&);
+    void removeOldestFrameTime();
+    void clearFrameTimes();
+
+    // Index of the oldest frame recent enough for the layer to be active at |now|.
+    size_t getFirstActiveFrame(nsecs_t now) const;
     bool isFrequent(nsecs_t now) const;
+    // The time until which isFrequent() stays the same, without new frames.
+    nsecs_t getFrequentValidUntil(nsecs_t now) const;
     bool isAnimating(nsecs_t now) const;
     bool hasEnoughDataForHeuristic() const;
-    std::optional<float> calculateRefreshRateIfPossible(nsecs_t now);
+    CachedRefreshRate calculateRefreshRate(nsecs_t now);
+    // Sets |outAddedRefreshRate| to the refresh rate added to the history, if any.
+    std::optional<float> calculateRefreshRateIfPossible(nsecs_t now,
+                                                        std::optional<float>* outAddedRefreshRate);
     std::optional<nsecs_t> calculateAverageFrameTime() const;
     bool isFrameTimeValid(const FrameTimeData&) const;
 
@@ -202,14 +267,23 @@ private:
 
     RefreshRateHeuristicData mLastRefreshRate;
 
-    std::deque<FrameTimeData> mFrameTimes;
-    std::chrono::time_point<std::chrono::steady_clock> mFrameTimeValidSince =
-            std::chrono::steady_clock::now();
     static constexpr size_t HISTORY_SIZE = RefreshRateHistory::HISTORY_SIZE;
     static constexpr std::chrono::nanoseconds HISTORY_DURATION = 1s;
 
+    RingBuffer<FrameTimeData, HISTORY_SIZE> mFrameTimes;
+    // mFrameTimeDeltas[i] is between mFrameTimes[i] and mFrameTimes[i + 1].
+    RingBuffer<FrameTimeDelta, HISTORY_SIZE> mFrameTimeDeltas;
+    FrameTimeTotals mFrameTimeTotals;
+    // The presentTimeOnlyFramesBefore of the deltas missing a present time, oldest first.
+    RingBuffer<uint64_t, HISTORY_SIZE> mMissingPresentTimes;
+    std::chrono::time_point<std::chrono::steady_clock> mFrameTimeValidSince =
+            std::chrono::steady_clock::now();
+
     RefreshRateHistory mRefreshRateHistory;
 
+    std::optional<CachedRefreshRate> mCachedRefreshRate;
+    std::optional<SkippedRefreshRate> mSkippedRefreshRate;
+
     mutable std::unordered_map<LayerHistory::LayerVoteType, std::string> mTraceTags;
 
     // Shared for all LayerInfo instances
@@ -18,95 +18,114 @@
 
 #include <chrono>
 #include <sstream>
-#include <thread>
 
 namespace android {
 namespace scheduler {
 
+namespace {
+
+using Clock = TimerService::Clock;
+
+int64_t toNs(Clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+Clock::time_point fromNs(int64_t ns) {
+    return Clock::time_point(std::chrono::duration_cast<Clock::duration>(
+            std::chrono::nanoseconds(ns)));
+}
+
+} // namespace
+
 OneShotTimer::OneShotTimer(const Interval& interval, const ResetCallback& resetCallback,
-                           const TimeoutCallback& timeoutCallback)
-      : mInterval(interval), mResetCallback(resetCallback), mTimeoutCallback(timeoutCallback) {}
+                           const TimeoutCallback& timeoutCallback, TimerService& service)
+      : mService(service),
+        mInterval(interval),
+        mResetCallback(resetCallback),
+        mTimeoutCallback(timeoutCallback) {}
 
 OneShotTimer::~OneShotTimer() {
     stop();
 }
 
 void OneShotTimer::start() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::RESET;
+    mState = RESET;
+    if (mRegistered) {
+        mService.wake();
+    } else {
+        mService.add(this);
+        mRegistered = true;
     }
-    mThread = std::thread(&OneShotTimer::loop, this);
 }
 
 void OneShotTimer::stop() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::STOPPED;
-    }
-    mCondition.notify_all();
-    if (mThread.joinable()) {
-        mThread.join();
+    mState = STOPPED;
+    if (mRegistered) {
+        // Waits for callbacks in progress, so there are none once this returns.
+        mService.remove(this);
+        mRegistered = false;
     }
 }
 
-void OneShotTimer::loop() {
+int64_t OneShotTimer::deadlineFromNow() const {
+    return toNs(Clock::now() + mInterval);
+}
+
+std::optional<Clock::time_point> OneShotTimer::dispatch() {
+    int64_t state = mState;
     while (true) {
-        bool triggerReset = false;
-        bool triggerTimeout = false;
-        {
-            std::lock_guard<std::mutex> lock(mMutex);
-            if (mState == TimerState::STOPPED) {
-                break;
-            }
+        if (state == STOPPED || state == IDLE) {
+            return {};
+        }
 
-            if (mState == TimerState::IDLE) {
-                mCondition.wait(mMutex);
-                continue;
+        if (state == RESET) {
+            if (mResetCallback) {
+                mResetCallback();
             }
-
-            if (mState == TimerState::RESET) {
-                triggerReset = true;
+            // Someone might have called stop meanwhile.
+            state = RESET;
+            const int64_t deadline = deadlineFromNow();
+            if (mState.compare_exchange_strong(state, deadline)) {
+                return fromNs(deadline);
             }
+            continue;
         }
-        if (triggerReset && mResetCallback) {
-            mResetCallback();
-        }
-
-        { // lock the mutex again. someone might have called stop meanwhile
-            std::lock_guard<std::mutex> lock(mMutex);
-            if (mState == TimerState::STOPPED) {
-                break;
-            }
 
-            auto triggerTime = std::chrono::steady_clock::now() + mInterval;
-            mState = TimerState::WAITING;
-            while (mState == TimerState::WAITING) {
-                constexpr auto zero = std::chrono::steady_clock::duration::zero();
-                auto waitTime = triggerTime - std::chrono::steady_clock::now();
-                if (waitTime > zero) mCondition.wait_for(mMutex, waitTime);
-                if (mState == TimerState::RESET) {
-                    triggerTime = std::chrono::steady_clock::now() + mInterval;
-                    mState = TimerState::WAITING;
-                } else if (mState == TimerState::WAITING &&
-                           (triggerTime - std::chrono::steady_clock::now()) <= zero) {
-                    triggerTimeout = true;
-                    mState = TimerState::IDLE;
-                }
-            }
+        if (Clock::now() < fromNs(state)) {
+            return fromNs(state);
         }
-        if (triggerTimeout && mTimeoutCallback) {
-            mTimeoutCallback();
+        // Races with reset(): either it moved the deadline, and this sees it,
+        // or it sees IDLE and wakes up the service to fire the reset callback.
+        if (mState.compare_exchange_strong(state, IDLE)) {
+            if (mTimeoutCallback) {
+                mTimeoutCallback();
+            }
+            return {};
         }
     }
 }
 
 void OneShotTimer::reset() {
-    {
-        std::lock_guard<std::mutex> lock(mMutex);
-        mState = TimerState::RESET;
+    int64_t state = mState;
+    while (true) {
+        if (state == STOPPED || state == RESET) {
+            return;
+        }
+
+        if (state == IDLE) {
+            if (mState.compare_exchange_weak(state, RESET)) {
+                mService.wake();
+                return;
+            }
+            continue;
+        }
+
+        // The deadline only moves later, so the service doesn't need to be
+        // woken up: it finds the new deadline once the old one passes.
+        if (mState.compare_exchange_weak(state, deadlineFromNow())) {
+            return;
+        }
     }
-    mCondition.notify_all();
 }
 
 std::string OneShotTimer::dump() const {
@@ -16,11 +16,13 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
-#include <condition_variable>
-#include <thread>
+#include <functional>
+#include <optional>
+#include <string>
 
-#include <android-base/thread_annotations.h>
+#include "TimerService.h"
 
 namespace android {
 namespace scheduler {
@@ -28,15 +30,20 @@ namespace scheduler {
 /*
  * Class that sets off a timer for a given interval, and fires a callback when the
  * interval expires.
+ *
+ * The timer runs on a TimerService, which fires the callbacks on its thread.
+ * Resetting a timer which is waiting only moves its deadline, so it is cheap
+ * and does not wake up the service.
  */
-class OneShotTimer {
+class OneShotTimer : private TimerService::Timer {
 public:
     using Interval = std::chrono::milliseconds;
     using ResetCallback = std::function<void()>;
     using TimeoutCallback = std::function<void()>;
 
     OneShotTimer(const Interval& interval, const ResetCallback& resetCallback,
-                 const TimeoutCallback& timeoutCallback);
+                 const TimeoutCallback& timeoutCallback,
+                 TimerService& service = TimerService::getInstance());
     ~OneShotTimer();
 
     // Initializes and turns on the idle timer.
@@ -49,38 +56,31 @@ public:
     std::string dump() const;
 
 private:
-    // Enum to track in what state is the timer.
-    enum class TimerState {
-        // The internal timer thread has been destroyed, and no state is
-        // tracked.
-        // Possible state transitions: RESET
-        STOPPED = 0,
-        // An external thread has just reset this timer.
-        // If there is a reset callback, then that callback is fired.
-        // Possible state transitions: STOPPED, WAITING
-        RESET = 1,
-        // This timer is waiting for the timeout interval to expire.
-        // Possible state transaitions: STOPPED, RESET, IDLE
-        WAITING = 2,
-        // The timeout interval has expired, so we are sleeping now.
-        // Possible state transaitions: STOPPED, RESET
-        IDLE = 3
-    };
-
-    // Function that loops until the condition for stopping is met.
-    void loop();
-
-    // Thread waiting for timer to expire.
-    std::thread mThread;
-
-    // Condition used to notify mThread.
-    std::condition_variable_any mCondition;
-
-    // Lock used for synchronizing the waiting thread with the application thread.
-    std::mutex mMutex;
-
-    // Current timer state
-    TimerState mState GUARDED_BY(mMutex) = TimerState::RESET;
+    // States the timer can be in, besides waiting for the timeout interval to
+    // expire, in which case mState holds the time it expires at.
+    //
+    // The timer isn't registered with the service, and no state is tracked.
+    // Possible state transitions: RESET
+    static constexpr int64_t STOPPED = -1;
+    // An external thread has just reset this timer.
+    // If there is a reset callback, then that callback is fired.
+    // Possible state transitions: STOPPED, waiting
+    static constexpr int64_t RESET = -2;
+    // The timeout interval has expired, so we are sleeping now.
+    // Possible state transitions: STOPPED, RESET
+    static constexpr int64_t IDLE = -3;
+    // While waiting, possible state transitions: STOPPED, waiting with a later
+    // deadline, IDLE
+
+    std::optional<TimerService::Clock::time_point> dispatch() override;
+    int64_t deadlineFromNow() const;
+
+    TimerService& mService;
+    // Only used by start() and stop().
+    bool mRegistered = false;
+
+    // Current timer state, or deadline while waiting.
+    std::atomic<int64_t> mState{RESET};
 
     // Interval after which timer expires.
     const Interval mInterval;
@@ -192,12 +192,7 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
     }
 
     // Find the best refresh rate based on score
-    std::vector<std::pair<const RefreshRate*, float>> scores;
-    scores.reserve(mAppRequestRefreshRates.size());
-
-    for (const auto refreshRate : mAppRequestRefreshRates) {
-        scores.emplace_back(refreshRate, 0.0f);
-    }
+    mScores.assign(mAppRequestRefreshRates.size(), 0.0f);
 
     for (const auto& layer : layers) {
         ALOGV("Calculating score for %s (%s, weight %.2f)", layer.name.c_str(),
@@ -206,106 +201,30 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
             continue;
         }
 
-        auto weight = layer.weight;
-
-        for (auto i = 0u; i < scores.size(); i++) {
-            bool inPrimaryRange =
-                    scores[i].first->inPolicy(policy->primaryRange.min, policy->primaryRange.max);
-            if ((primaryRangeIsSingleRate || !inPrimaryRange) &&
-                !(layer.focused && layer.vote == LayerVoteType::ExplicitDefault)) {
-                // Only focused layers with ExplicitDefault frame rate settings are allowed to score
-                // refresh rates outside the primary range.
-                continue;
-            }
-
-            // If the layer wants Max, give higher score to the higher refresh rate
-            if (layer.vote == LayerVoteType::Max) {
-                const auto ratio = scores[i].first->fps / scores.back().first->fps;
-                // use ratio^2 to get a lower score the more we get further from peak
-                const auto layerScore = ratio * ratio;
-                ALOGV("%s (Max, weight %.2f) gives %s score of %.2f", layer.name.c_str(), weight,
-                      scores[i].first->name.c_str(), layerScore);
-                scores[i].second += weight * layerScore;
-                continue;
-            }
-
-            const auto displayPeriod = scores[i].first->hwcConfig->getVsyncPeriod();
-            const auto layerPeriod = round<nsecs_t>(1e9f / layer.desiredRefreshRate);
-            if (layer.vote == LayerVoteType::ExplicitDefault) {
-                const auto layerScore = [&]() {
-                    // Find the actual rate the layer will render, assuming
-                    // that layerPeriod is the minimal time to render a frame
-                    auto actualLayerPeriod = displayPeriod;
-                    int multiplier = 1;
-                    while (layerPeriod > actualLayerPeriod + MARGIN_FOR_PERIOD_CALCULATION) {
-                        multiplier++;
-                        actualLayerPeriod = displayPeriod * multiplier;
-                    }
-                    return std::min(1.0f,
-                                    static_cast<float>(layerPeriod) /
-                                            static_cast<float>(actualLayerPeriod));
-                }();
-
-                ALOGV("%s (ExplicitDefault, weight %.2f) %.2fHz gives %s score of %.2f",
-                      layer.name.c_str(), weight, 1e9f / layerPeriod, scores[i].first->name.c_str(),
-                      layerScore);
-                scores[i].second += weight * layerScore;
-                continue;
-            }
-
-            if (layer.vote == LayerVoteType::ExplicitExactOrMultiple ||
-                layer.vote == LayerVoteType::Heuristic) {
-                const auto layerScore = [&] {
-                    // Calculate how many display vsyncs we need to present a single frame for this
-                    // layer
-                    const auto [displayFramesQuot, displayFramesRem] =
-                            getDisplayFrames(layerPeriod, displayPeriod);
-                    static constexpr size_t MAX_FRAMES_TO_FIT =
-                            10; // Stop calculating when score < 0.1
-                    if (displayFramesRem == 0) {
-                        // Layer desired refresh rate matches the display rate.
-                        return 1.0f;
-                    }
-
-                    if (displayFramesQuot == 0) {
-                        // Layer desired refresh rate is higher the display rate.
-                        return (static_cast<float>(layerPeriod) /
-                                static_cast<float>(displayPeriod)) *
-                                (1.0f / (MAX_FRAMES_TO_FIT + 1));
-                    }
-
-                    // Layer desired refresh rate is lower the display rate. Check how well it fits
-                    // the cadence
-                    auto diff = std::abs(displayFramesRem - (displayPeriod - displayFramesRem));
-                    int iter = 2;
-                    while (diff > MARGIN_FOR_PERIOD_CALCULATION && iter < MAX_FRAMES_TO_FIT) {
-                        diff = diff - (displayPeriod - diff);
-                        iter++;
-                    }
-
-                    return 1.0f / iter;
-                }();
-                ALOGV("%s (%s, weight %.2f) %.2fHz gives %s score of %.2f", layer.name.c_str(),
-                      layerVoteTypeString(layer.vote).c_str(), weight, 1e9f / layerPeriod,
-                      scores[i].first->name.c_str(), layerScore);
-                scores[i].second += weight * layerScore;
-                continue;
-            }
+        // Only focused layers with ExplicitDefault frame rate settings are allowed to score
+        // refresh rates outside the primary range.
+        const auto& layerScores = getLayerScoresLocked(layer);
+        const auto& scores = layer.focused && layer.vote == LayerVoteType::ExplicitDefault
+                ? layerScores.all
+                : layerScores.primaryRange;
+
+        // The refresh rates the layer doesn't score have a score of zero, so that the loop has no
+        // branches and can be vectorized.
+        const auto weight = layer.weight;
+        for (size_t i = 0; i < mScores.size(); i++) {
+            mScores[i] += weight * scores[i];
         }
     }
 
     // Now that we scored all the refresh rates we need to pick the one that got the highest score.
     // In case of a tie we will pick the higher refresh rate if any of the layers wanted Max,
     // or the lower otherwise.
-    const RefreshRate* bestRefreshRate = maxVoteLayers > 0
-            ? getBestRefreshRate(scores.rbegin(), scores.rend())
-            : getBestRefreshRate(scores.begin(), scores.end());
+    const RefreshRate* bestRefreshRate = getBestScoredRefreshRateLocked(maxVoteLayers > 0);
 
     if (primaryRangeIsSingleRate) {
         // If we never scored any layers, then choose the rate from the primary
         // range instead of picking a random score from the app range.
-        if (std::all_of(scores.begin(), scores.end(),
-                        [](std::pair<const RefreshRate*, float> p) { return p.second == 0; })) {
+        if (std::all_of(mScores.begin(), mScores.end(), [](float score) { return score == 0; })) {
             ALOGV("layers not scored - choose %s",
                   getMaxRefreshRateByPolicyLocked().getName().c_str());
             return getMaxRefreshRateByPolicyLocked();
@@ -330,24 +249,121 @@ const RefreshRate& RefreshRateConfigs::getBestRefreshRate(
     return *bestRefreshRate;
 }
 
-template <typename Iter>
-const RefreshRate* RefreshRateConfigs::getBestRefreshRate(Iter begin, Iter end) const {
+const RefreshRateConfigs::LayerScores& RefreshRateConfigs::getLayerScoresLocked(
+        const LayerRequirement& layer) const {
+    // Max votes don't depend on the layer period, and Heuristic ones score like
+    // ExplicitExactOrMultiple ones.
+    const auto vote =
+            layer.vote == LayerVoteType::Heuristic ? LayerVoteType::ExplicitExactOrMultiple
+                                                   : layer.vote;
+    const auto layerPeriod =
+            vote == LayerVoteType::Max ? 0 : round<nsecs_t>(1e9f / layer.desiredRefreshRate);
+    const auto key = std::make_pair(vote, layerPeriod);
+
+    if (const auto it = mLayerScores.find(key); it != mLayerScores.end()) {
+        return it->second;
+    }
+
+    // Apps may vote for any frame rate, so keep the table from growing without bounds.
+    if (mLayerScores.size() >= MAX_LAYER_SCORES) {
+        mLayerScores.clear();
+    }
+
+    const Policy* policy = getCurrentPolicyLocked();
+    const bool primaryRangeIsSingleRate = policy->primaryRange.min == policy->primaryRange.max;
+
+    LayerScores layerScores;
+    layerScores.all.reserve(mAppRequestRefreshRates.size());
+    layerScores.primaryRange.reserve(mAppRequestRefreshRates.size());
+    for (const auto refreshRate : mAppRequestRefreshRates) {
+        const float score = calculateLayerScoreLocked(vote, layerPeriod, *refreshRate);
+        ALOGV("%s (%s) %.2fHz gives %s score of %.2f", layer.name.c_str(),
+              layerVoteTypeString(vote).c_str(), 1e9f / layerPeriod, refreshRate->name.c_str(),
+              score);
+        const bool inPrimaryRange =
+                refreshRate->inPolicy(policy->primaryRange.min, policy->primaryRange.max);
+
+        layerScores.all.push_back(score);
+        layerScores.primaryRange.push_back(!primaryRangeIsSingleRate && inPrimaryRange ? score
+                                                                                       : 0.0f);
+    }
+
+    return mLayerScores.emplace(key, std::move(layerScores)).first->second;
+}
+
+float RefreshRateConfigs::calculateLayerScoreLocked(LayerVoteType vote, nsecs_t layerPeriod,
+                                                    const RefreshRate& refreshRate) const {
+    // If the layer wants Max, give higher score to the higher refresh rate
+    if (vote == LayerVoteType::Max) {
+        const auto ratio = refreshRate.fps / mAppRequestRefreshRates.back()->fps;
+        // use ratio^2 to get a lower score the more we get further from peak
+        return ratio * ratio;
+    }
+
+    const auto displayPeriod = refreshRate.hwcConfig->getVsyncPeriod();
+    if (vote == LayerVoteType::ExplicitDefault) {
+        // Find the actual rate the layer will render, assuming
+        // that layerPeriod is the minimal time to render a frame
+        auto actualLayerPeriod = displayPeriod;
+        int multiplier = 1;
+        while (layerPeriod > actualLayerPeriod + MARGIN_FOR_PERIOD_CALCULATION) {
+            multiplier++;
+            actualLayerPeriod = displayPeriod * multiplier;
+        }
+        return std::min(1.0f,
+                        static_cast<float>(layerPeriod) / static_cast<float>(actualLayerPeriod));
+    }
+
+    // ExplicitExactOrMultiple or Heuristic
+    // Calculate how many display vsyncs we need to present a single frame for this layer
+    const auto [displayFramesQuot, displayFramesRem] =
+            getDisplayFrames(layerPeriod, displayPeriod);
+    static constexpr size_t MAX_FRAMES_TO_FIT = 10; // Stop calculating when score < 0.1
+    if (displayFramesRem == 0) {
+        // Layer desired refresh rate matches the display rate.
+        return 1.0f;
+    }
+
+    if (displayFramesQuot == 0) {
+        // Layer desired refresh rate is higher the display rate.
+        return (static_cast<float>(layerPeriod) / static_cast<float>(displayPeriod)) *
+                (1.0f / (MAX_FRAMES_TO_FIT + 1));
+    }
+
+    // Layer desired refresh rate is lower the display rate. Check how well it fits the cadence
+    auto diff = std::abs(displayFramesRem - (displayPeriod - displayFramesRem));
+    int iter = 2;
+    while (diff > MARGIN_FOR_PERIOD_CALCULATION && iter < MAX_FRAMES_TO_FIT) {
+        diff = diff - (displayPeriod - diff);
+        iter++;
+    }
+
+    return 1.0f / iter;
+}
+
+const RefreshRate* RefreshRateConfigs::getBestScoredRefreshRateLocked(
+        bool preferHigherRefreshRate) const {
     constexpr auto EPSILON = 0.001f;
-    const RefreshRate* bestRefreshRate = begin->first;
-    float max = begin->second;
-    for (auto i = begin; i != end; ++i) {
-        const auto [refreshRate, score] = *i;
+    const size_t count = mScores.size();
+    // Visit the refresh rates from the preferred end, so that it wins ties.
+    const auto index = [&](size_t i) { return preferHigherRefreshRate ? count - 1 - i : i; };
+
+    size_t best = index(0);
+    float max = mScores[best];
+    for (size_t i = 0; i < count; i++) {
+        const RefreshRate* refreshRate = mAppRequestRefreshRates[index(i)];
+        const float score = mScores[index(i)];
         ALOGV("%s scores %.2f", refreshRate->name.c_str(), score);
 
         ATRACE_INT(refreshRate->name.c_str(), round<int>(score * 100));
 
         if (score > max * (1 + EPSILON)) {
             max = score;
-            bestRefreshRate = refreshRate;
+            best = index(i);
         }
     }
 
-    return bestRefreshRate;
+    return mAppRequestRefreshRates[best];
 }
 
 const AllRefreshRatesMapType& RefreshRateConfigs::getAllRefreshRates() const {
@@ -556,6 +572,9 @@ void RefreshRateConfigs::constructAvailableRefreshRates() {
                        &mPrimaryRefreshRates);
     filterRefreshRates(policy->appRequestRange.min, policy->appRequestRange.max, "app request",
                        &mAppRequestRefreshRates);
+
+    // The scores depend on both the policy and the refresh rates in it.
+    mLayerScores.clear();
 }
 
 std::vector<float> RefreshRateConfigs::constructKnownFrameRates(
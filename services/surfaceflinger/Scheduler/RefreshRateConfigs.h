@@ -17,8 +17,14 @@
 #pragma once
 
 #include <android-base/stringprintf.h>
+#include <android-base/thread_annotations.h>
+#include <utils/Errors.h>
 
 #include <algorithm>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
 #include <numeric>
 #include <optional>
 #include <type_traits>
@@ -302,11 +308,25 @@ private:
             const std::function<bool(const RefreshRate&)>& shouldAddRefreshRate,
             std::vector<const RefreshRate*>* outRefreshRates);
 
-    // Returns the refresh rate with the highest score in the collection specified from begin
-    // to end. If there are more than one with the same highest refresh rate, the first one is
-    // returned.
-    template <typename Iter>
-    const RefreshRate* getBestRefreshRate(Iter begin, Iter end) const;
+    // The scores a layer gives to each of mAppRequestRefreshRates.
+    struct LayerScores {
+        std::vector<float> all;
+        // Zero for the refresh rates outside of the primary range, or for all of them if the
+        // primary range is a single refresh rate.
+        std::vector<float> primaryRange;
+    };
+
+    // Returns the scores of the layer, which are only calculated once per vote type and layer
+    // period until the policy changes.
+    const LayerScores& getLayerScoresLocked(const LayerRequirement& layer) const REQUIRES(mLock);
+    float calculateLayerScoreLocked(LayerVoteType vote, nsecs_t layerPeriod,
+                                    const RefreshRate& refreshRate) const REQUIRES(mLock);
+
+    // Returns the refresh rate with the highest score in mScores. If there are more than one with
+    // the same highest score, the lowest refresh rate is returned, or the highest one if
+    // preferHigherRefreshRate is set.
+    const RefreshRate* getBestScoredRefreshRateLocked(bool preferHigherRefreshRate) const
+            REQUIRES(mLock);
 
     // Returns number of display frames and remainder when dividing the layer refresh period by
     // display refresh period.
@@ -355,6 +375,15 @@ private:
 
     mutable std::mutex mLock;
 
+    // The scores of the layers getBestRefreshRate() was called with, by vote type and layer
+    // period. Cleared when the policy changes.
+    static constexpr size_t MAX_LAYER_SCORES = 64;
+    mutable std::map<std::pair<LayerVoteType, nsecs_t>, LayerScores> mLayerScores GUARDED_BY(mLock);
+
+    // The scores of mAppRequestRefreshRates, only kept around to be reused by
+    // getBestRefreshRate().
+    mutable std::vector<float> mScores GUARDED_BY(mLock);
+
     // A sorted list of known frame rates that a Heuristic layer will choose
     // from based on the closest value.
     const std::vector<float> mKnownFrameRates;
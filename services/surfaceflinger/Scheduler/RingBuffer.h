@@ -0,0 +1,68 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace android::scheduler {
+
+// Fixed-capacity queue, stored inline so that it never allocates. Elements are
+// indexed from the oldest one.
+template <typename T, size_t N>
+class RingBuffer {
+public:
+    static constexpr size_t capacity() { return N; }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+    bool full() const { return mSize == N; }
+
+    T& operator[](size_t i) { return mData[wrap(mHead + i)]; }
+    const T& operator[](size_t i) const { return mData[wrap(mHead + i)]; }
+
+    T& front() { return (*this)[0]; }
+    const T& front() const { return (*this)[0]; }
+    T& back() { return (*this)[mSize - 1]; }
+    const T& back() const { return (*this)[mSize - 1]; }
+
+    // Appends |value|, dropping the oldest element if full.
+    void push_back(const T& value) {
+        if (full()) pop_front();
+        mData[wrap(mHead + mSize)] = value;
+        mSize++;
+    }
+
+    void pop_front() {
+        mHead = wrap(mHead + 1);
+        mSize--;
+    }
+
+    void clear() {
+        mHead = 0;
+        mSize = 0;
+    }
+
+private:
+    static size_t wrap(size_t i) { return i < N ? i : i - N; }
+
+    std::array<T, N> mData{};
+    size_t mHead = 0;
+    size_t mSize = 0;
+};
+
+} // namespace android::scheduler
@@ -160,7 +160,7 @@ Scheduler::Scheduler(std::unique_ptr<DispSync> primaryDispSync,
         mUseContentDetectionV2(useContentDetectionV2) {}
 
 Scheduler::~Scheduler() {
-    // Ensure the OneShotTimer threads are joined before we start destroying state.
+    // Ensure the OneShotTimers are stopped before we start destroying state.
     mDisplayPowerTimer.reset();
     mTouchTimer.reset();
     mIdleTimer.reset();
@@ -463,7 +463,8 @@ void Scheduler::chooseRefreshRateForContent() {
 
     ATRACE_CALL();
 
-    scheduler::LayerHistory::Summary summary = mLayerHistory->summarize(systemTime());
+    mLayerHistory->summarize(systemTime(), &mLayerSummary);
+    const auto& summary = mLayerSummary;
     HwcConfigIndexType newConfigId;
     {
         std::lock_guard<std::mutex> lock(mFeatureStateLock);
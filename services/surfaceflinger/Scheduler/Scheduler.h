@@ -232,6 +232,9 @@ private:
 
     // Used to choose refresh rate if content detection is enabled.
     std::unique_ptr<LayerHistory> mLayerHistory;
+    // Filled by mLayerHistory on each chooseRefreshRateForContent(), which only runs on the main
+    // thread, so that its storage is reused.
+    LayerHistory::Summary mLayerSummary;
 
     // Timer that records time between requests for next vsync.
     std::optional<scheduler::OneShotTimer> mIdleTimer;
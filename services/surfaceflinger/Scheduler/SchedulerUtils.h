@@ -17,7 +17,10 @@
 #pragma once
 
 #include <utils/Timers.h>
+#include <algorithm>
 #include <cinttypes>
+#include <cmath>
+#include <limits>
 #include <numeric>
 #include <unordered_map>
 #include <vector>
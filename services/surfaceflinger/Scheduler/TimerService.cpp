@@ -0,0 +1,192 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "SchedulerTimerService"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "TimerService.h"
+
+#include <android-base/stringprintf.h>
+#include <log/log.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace android::scheduler {
+using base::StringAppendF;
+
+namespace {
+
+enum DispatchType : uint32_t { TIMER, EVENT, MAX_DISPATCH_TYPE };
+
+// steady_clock is CLOCK_MONOTONIC, which the timerfd is set against.
+timespec toTimespec(TimerService::Clock::time_point time) {
+    using namespace std::chrono;
+    const auto ns = duration_cast<nanoseconds>(time.time_since_epoch()).count();
+    constexpr int64_t kNsPerS = duration_cast<nanoseconds>(1s).count();
+    return {.tv_sec = static_cast<time_t>(ns / kNsPerS), .tv_nsec = static_cast<long>(ns % kNsPerS)};
+}
+
+} // namespace
+
+TimerService::TimerService()
+      : mTimerFd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)),
+        mEventFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)),
+        mEpollFd(epoll_create1(EPOLL_CLOEXEC)) {
+    LOG_ALWAYS_FATAL_IF(!mTimerFd.ok() || !mEventFd.ok() || !mEpollFd.ok(),
+                        "Could not create timer service fds: %s", strerror(errno));
+
+    epoll_event timerEvent{.events = EPOLLIN, .data = {.u32 = DispatchType::TIMER}};
+    epoll_event wakeEvent{.events = EPOLLIN, .data = {.u32 = DispatchType::EVENT}};
+    LOG_ALWAYS_FATAL_IF(epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mTimerFd, &timerEvent) == -1 ||
+                                epoll_ctl(mEpollFd, EPOLL_CTL_ADD, mEventFd, &wakeEvent) == -1,
+                        "Could not add timer service fds to epoll: %s", strerror(errno));
+
+    mThread = std::thread(&TimerService::loop, this);
+}
+
+TimerService::~TimerService() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    wake();
+    mThread.join();
+}
+
+TimerService& TimerService::getInstance() {
+    // Never destroyed, so that timers can be stopped during static destruction.
+    static TimerService* sInstance = new TimerService;
+    return *sInstance;
+}
+
+void TimerService::add(Timer* timer) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTimers.push_back(timer);
+    }
+    wake();
+}
+
+void TimerService::remove(Timer* timer) {
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mTimers.erase(std::remove(mTimers.begin(), mTimers.end(), timer), mTimers.end());
+        if (std::this_thread::get_id() != mThread.get_id()) {
+            mCondition.wait(lock, [&]() REQUIRES(mMutex) { return mDispatching != timer; });
+        }
+    }
+    // The service may have skipped another timer while the list changed.
+    wake();
+}
+
+void TimerService::wake() {
+    const uint64_t one = 1;
+    if (write(mEventFd, &one, sizeof(one)) != sizeof(one) && errno != EAGAIN) {
+        ALOGW("Failed to wake up the timer service: %s", strerror(errno));
+    }
+}
+
+void TimerService::loop() {
+    if (pthread_setname_np(pthread_self(), "TimerService")) {
+        ALOGW("Failed to set thread name on timer service");
+    }
+
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mStopping) return;
+        }
+
+        arm(dispatchTimers());
+
+        epoll_event events[DispatchType::MAX_DISPATCH_TYPE];
+        const int nfds = epoll_wait(mEpollFd, events, DispatchType::MAX_DISPATCH_TYPE, -1);
+        if (nfds == -1) {
+            if (errno != EINTR) {
+                ALOGE("Error waiting on epoll: %s", strerror(errno));
+            }
+            continue;
+        }
+        mWakeupCount++;
+
+        // Drain both fds before dispatching, so that anything which happens
+        // while dispatching wakes the service up again.
+        uint64_t ignored;
+        for (int i = 0; i < nfds; i++) {
+            const int fd = events[i].data.u32 == DispatchType::TIMER ? mTimerFd.get()
+                                                                     : mEventFd.get();
+            (void)read(fd, &ignored, sizeof(ignored));
+        }
+        if (std::any_of(events, events + nfds,
+                        [](const epoll_event& e) { return e.data.u32 == DispatchType::TIMER; })) {
+            mArmedDeadline.reset();
+        }
+    }
+}
+
+std::optional<TimerService::Clock::time_point> TimerService::dispatchTimers() {
+    ATRACE_CALL();
+    std::optional<Clock::time_point> earliest;
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (size_t i = 0; i < mTimers.size(); i++) {
+        Timer* const timer = mTimers[i];
+        mDispatching = timer;
+        lock.unlock();
+
+        const auto deadline = timer->dispatch();
+
+        lock.lock();
+        mDispatching = nullptr;
+        mCondition.notify_all();
+        if (deadline && (!earliest || *deadline < *earliest)) {
+            earliest = deadline;
+        }
+    }
+    return earliest;
+}
+
+void TimerService::arm(std::optional<Clock::time_point> deadline) {
+    if (deadline == mArmedDeadline) return;
+
+    // A zero it_value disarms the timer.
+    itimerspec timer{};
+    if (deadline) {
+        timer.it_value = toTimespec(*deadline);
+        // Deadlines in the past fire right away, but a zero one would disarm.
+        if (timer.it_value.tv_sec == 0 && timer.it_value.tv_nsec == 0) timer.it_value.tv_nsec = 1;
+    }
+    if (timerfd_settime(mTimerFd, TFD_TIMER_ABSTIME, &timer, nullptr)) {
+        ALOGW("Failed to set timerfd: %s", strerror(errno));
+        return;
+    }
+    mArmedDeadline = deadline;
+}
+
+void TimerService::dump(std::string& result) const {
+    std::lock_guard<std::mutex> lock(mMutex);
+    StringAppendF(&result, "TimerService: %zu timers, %zu wakeups\n", mTimers.size(),
+                  mWakeupCount.load());
+}
+
+} // namespace android::scheduler
@@ -0,0 +1,101 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android::scheduler {
+
+/*
+ * Runs the timers of the scheduler on a single thread, which waits on a timerfd
+ * armed for the earliest of their deadlines.
+ *
+ * Timers keep their own state, and are only asked for their next deadline when
+ * the service wakes up: at the earliest deadline it knows of, or when woken
+ * up explicitly. So a timer can move its deadline later without waking up the
+ * service, which then finds out about it when the old deadline passes.
+ */
+class TimerService {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Timer {
+    public:
+        virtual ~Timer() = default;
+
+        // Called on the service thread when it wakes up, and at least once
+        // after the timer is added. Fires whatever callbacks are due, and
+        // returns the deadline to be called again by, if any.
+        virtual std::optional<Clock::time_point> dispatch() = 0;
+    };
+
+    TimerService();
+    ~TimerService();
+
+    // The service shared by the timers of the process.
+    static TimerService& getInstance();
+
+    void add(Timer* timer);
+    // Once this returns, dispatch() of |timer| is neither running nor called
+    // again, unless this is called from dispatch() itself.
+    void remove(Timer* timer);
+    // Dispatches all timers soon. Only needed when a deadline moves earlier.
+    void wake();
+
+    // The number of times the service thread woke up.
+    size_t getWakeupCount() const { return mWakeupCount; }
+
+    void dump(std::string& result) const;
+
+private:
+    TimerService(const TimerService&) = delete;
+    TimerService& operator=(const TimerService&) = delete;
+
+    void loop();
+    std::optional<Clock::time_point> dispatchTimers() EXCLUDES(mMutex);
+    void arm(std::optional<Clock::time_point> deadline);
+
+    base::unique_fd mTimerFd;
+    base::unique_fd mEventFd;
+    base::unique_fd mEpollFd;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<Timer*> mTimers GUARDED_BY(mMutex);
+    // The timer dispatch() is running for, if any.
+    Timer* mDispatching GUARDED_BY(mMutex) = nullptr;
+    bool mStopping GUARDED_BY(mMutex) = false;
+
+    // Only used by the service thread.
+    std::optional<Clock::time_point> mArmedDeadline;
+
+    std::atomic<size_t> mWakeupCount{0};
+
+    std::thread mThread;
+};
+
+} // namespace android::scheduler
@@ -29,6 +29,7 @@
 #include <utils/Trace.h>
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <sstream>
 
 namespace android::scheduler {
@@ -36,6 +37,12 @@ using base::StringAppendF;
 
 static auto constexpr kMaxPercent = 100u;
 
+// TODO (b/144707443): its important that there's some precision in the mean of the ordinals
+//                     for the intercept calculation, so scale the ordinals by 1000 to continue
+//                     fixed point calculation. Explore expanding
+//                     scheduler::utils::calculate_mean to have a fixed point fractional part.
+static constexpr int64_t kScalingFactor = 1000;
+
 VSyncPredictor::~VSyncPredictor() = default;
 
 VSyncPredictor::VSyncPredictor(nsecs_t idealPeriod, size_t historySize,
@@ -45,9 +52,42 @@ VSyncPredictor::VSyncPredictor(nsecs_t idealPeriod, size_t historySize,
         kMinimumSamplesForPrediction(minimumSamplesForPrediction),
         kOutlierTolerancePercent(std::min(outlierTolerancePercent, kMaxPercent)),
         mIdealPeriod(idealPeriod) {
+    mTimestamps.reserve(kHistorySize);
+    mOrdinals.reserve(kHistorySize);
+    mEarliest.reserve(kHistorySize);
     resetModel();
 }
 
+void VSyncPredictor::PublishedModel::store(const Model& model) {
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &model, sizeof(model));
+
+    auto const sequence = mSequence.load(std::memory_order_relaxed);
+    mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < kWords; i++) {
+        mWords[i].store(words[i], std::memory_order_relaxed);
+    }
+    mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+VSyncPredictor::Model VSyncPredictor::PublishedModel::load() const {
+    uint64_t words[kWords];
+    uint32_t before, after;
+    do {
+        before = mSequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < kWords; i++) {
+            words[i] = mWords[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = mSequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+
+    Model model;
+    std::memcpy(&model, words, sizeof(model));
+    return model;
+}
+
 inline void VSyncPredictor::traceInt64If(const char* name, int64_t value) const {
     if (CC_UNLIKELY(mTraceOn)) {
         ATRACE_INT64(name, value);
@@ -58,6 +98,110 @@ inline size_t VSyncPredictor::next(int i) const {
     return (i + 1) % mTimestamps.size();
 }
 
+void VSyncPredictor::EarliestIndices::push(size_t index, const std::vector<nsecs_t>& timestamps) {
+    // Later timestamps can never be the earliest once this one is added.
+    while (mSize > 0 &&
+           timestamps[mIndices[(mHead + mSize - 1) % mIndices.size()]] >= timestamps[index]) {
+        mSize--;
+    }
+    mIndices[(mHead + mSize) % mIndices.size()] = index;
+    mSize++;
+}
+
+void VSyncPredictor::EarliestIndices::remove(size_t index) {
+    // Only the oldest timestamp is ever removed, which is either the earliest
+    // or was dropped already by a push().
+    if (mSize > 0 && mIndices[mHead] == index) {
+        mHead = (mHead + 1) % mIndices.size();
+        mSize--;
+    }
+}
+
+inline size_t VSyncPredictor::oldestIndex() const {
+    return mTimestamps.size() < kHistorySize ? 0 : next(mLastTimestampIndex);
+}
+
+void VSyncPredictor::addToRegression(nsecs_t timestamp, int64_t ordinal) {
+    auto const x = ordinal - mRegression.baseOrdinal;
+    auto const y = timestamp - mRegression.baseTimestamp;
+    mRegression.x += x;
+    mRegression.y += y;
+    mRegression.xx += x * x;
+    mRegression.xy += x * y;
+
+    auto const r = residual(timestamp, ordinal);
+    mRegression.minResidual = std::min(mRegression.minResidual, r);
+    mRegression.maxResidual = std::max(mRegression.maxResidual, r);
+    mRegression.minOrdinal = std::min(mRegression.minOrdinal, ordinal);
+    mRegression.maxOrdinal = std::max(mRegression.maxOrdinal, ordinal);
+}
+
+void VSyncPredictor::removeFromRegression(nsecs_t timestamp, int64_t ordinal) {
+    // The bounds are left as they are, which only makes them looser.
+    auto const x = ordinal - mRegression.baseOrdinal;
+    auto const y = timestamp - mRegression.baseTimestamp;
+    mRegression.x -= x;
+    mRegression.y -= y;
+    mRegression.xx -= x * x;
+    mRegression.xy -= x * y;
+}
+
+void VSyncPredictor::rebaseRegression(size_t count, nsecs_t timestamp, int64_t ordinal) {
+    // Moving the origin by (a, b) turns each X into X - a and each Y into Y - b.
+    auto const n = static_cast<int64_t>(count);
+    auto const a = ordinal - mRegression.baseOrdinal;
+    auto const b = timestamp - mRegression.baseTimestamp;
+    mRegression.xy -= b * mRegression.x + a * mRegression.y - n * a * b;
+    mRegression.xx -= 2 * a * mRegression.x - n * a * a;
+    mRegression.x -= n * a;
+    mRegression.y -= n * b;
+
+    auto const shift = residual(timestamp, ordinal);
+    mRegression.minResidual -= shift;
+    mRegression.maxResidual -= shift;
+
+    mRegression.baseOrdinal = ordinal;
+    mRegression.baseTimestamp = timestamp;
+}
+
+// How far |timestamp| is from the time of its ordinal, at the period ordinals were
+// snapped with, relative to the base timestamp.
+nsecs_t VSyncPredictor::residual(nsecs_t timestamp, int64_t ordinal) const {
+    return (timestamp - mRegression.baseTimestamp) -
+            (ordinal - mRegression.baseOrdinal) / kScalingFactor * mRegression.snapPeriod;
+}
+
+// Snaps all timestamps to the ordinal they are at with |period|, counting from the
+// earliest one, and recomputes the regression from them.
+void VSyncPredictor::snapOrdinals(nsecs_t period) {
+    auto const earliest = mEarliest.front();
+    auto const baseTimestamp = mTimestamps[earliest];
+    auto const baseOrdinal = mOrdinals[earliest];
+
+    mRegression = {};
+    mRegression.baseTimestamp = baseTimestamp;
+    mRegression.baseOrdinal = baseOrdinal;
+    mRegression.snapPeriod = period;
+    mRegression.minOrdinal = baseOrdinal;
+    mRegression.maxOrdinal = baseOrdinal;
+    for (size_t i = 0; i < mTimestamps.size(); i++) {
+        mOrdinals[i] = baseOrdinal +
+                ((mTimestamps[i] - baseTimestamp + (period / 2)) / period) * kScalingFactor;
+        addToRegression(mTimestamps[i], mOrdinals[i]);
+    }
+}
+
+void VSyncPredictor::publishModel() {
+    Model model;
+    model.idealPeriod = mIdealPeriod;
+    std::tie(model.slope, model.intercept) = mRateMap.find(mIdealPeriod)->second;
+    if (!mTimestamps.empty()) {
+        model.oldestTimestamp = mTimestamps[mEarliest.front()];
+    }
+    model.knownTimestamp = mKnownTimestamp;
+    mModel.store(model);
+}
+
 bool VSyncPredictor::validate(nsecs_t timestamp) const {
     if (mLastTimestampIndex < 0 || mTimestamps.empty()) {
         return true;
@@ -69,8 +213,7 @@ bool VSyncPredictor::validate(nsecs_t timestamp) const {
 }
 
 nsecs_t VSyncPredictor::currentPeriod() const {
-    std::lock_guard<std::mutex> lk(mMutex);
-    return std::get<0>(mRateMap.find(mIdealPeriod)->second);
+    return mModel.load().slope;
 }
 
 bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
@@ -89,19 +232,65 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
         } else {
             mKnownTimestamp = timestamp;
         }
+        publishModel();
         return false;
     }
 
+    auto it = mRateMap.find(mIdealPeriod);
+    auto const currentPeriod = std::get<0>(it->second);
+
+    // The ordinals and timestamps are kept relative to the earliest timestamp, as
+    // normalizing to it cuts down on error in calculating the intercept.
+    size_t index;
     if (mTimestamps.size() != kHistorySize) {
+        index = mTimestamps.size();
         mTimestamps.push_back(timestamp);
-        mLastTimestampIndex = next(mLastTimestampIndex);
+        mOrdinals.push_back(0);
     } else {
-        mLastTimestampIndex = next(mLastTimestampIndex);
-        mTimestamps[mLastTimestampIndex] = timestamp;
+        index = oldestIndex();
+        removeFromRegression(mTimestamps[index], mOrdinals[index]);
+        mEarliest.remove(index);
+    }
+    mLastTimestampIndex = index;
+    auto const count = mTimestamps.size() - 1;
+
+    if (count == 0) {
+        mRegression = {};
+        mRegression.baseTimestamp = timestamp;
+        mRegression.snapPeriod = currentPeriod;
+    } else if (mTimestamps[mEarliest.front()] != mRegression.baseTimestamp) {
+        rebaseRegression(count, mTimestamps[mEarliest.front()], mOrdinals[mEarliest.front()]);
+    }
+
+    auto const distance = timestamp - mRegression.baseTimestamp;
+    auto const ordinal = mRegression.baseOrdinal +
+            (distance >= 0 ? (distance + (currentPeriod / 2)) / currentPeriod
+                           : -((-distance + (currentPeriod / 2)) / currentPeriod)) *
+                    kScalingFactor;
+    traceInt64If("VSP-ts", timestamp);
+
+    mTimestamps[index] = timestamp;
+    mOrdinals[index] = ordinal;
+    mEarliest.push(index, mTimestamps);
+    addToRegression(timestamp, ordinal);
+    if (mEarliest.front() == index && count != 0) {
+        rebaseRegression(count + 1, timestamp, ordinal);
+    }
+
+    // Each ordinal must be what the timestamp snaps to with the current period,
+    // counting from the earliest timestamp. That holds for the new one, and for
+    // the others unless the bounds say that one of them may be within half a
+    // period of another ordinal, which is rare outside of a change of period.
+    auto const spread = (mRegression.maxResidual - mRegression.minResidual) +
+            (mRegression.maxOrdinal - mRegression.minOrdinal) / kScalingFactor *
+                    std::abs(currentPeriod - mRegression.snapPeriod);
+    if (spread >= currentPeriod / 2 - 1) {
+        snapOrdinals(currentPeriod);
     }
 
     if (mTimestamps.size() < kMinimumSamplesForPrediction) {
-        mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
+        it->second = {mIdealPeriod, 0};
+        publishModel();
         return true;
     }
 
@@ -120,43 +309,27 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     //
     // intercept = mean(Y) - slope * mean(X)
     //
-    std::vector<nsecs_t> vsyncTS(mTimestamps.size());
-    std::vector<nsecs_t> ordinals(mTimestamps.size());
-
-    // normalizing to the oldest timestamp cuts down on error in calculating the intercept.
-    auto const oldest_ts = *std::min_element(mTimestamps.begin(), mTimestamps.end());
-    auto it = mRateMap.find(mIdealPeriod);
-    auto const currentPeriod = std::get<0>(it->second);
-    // TODO (b/144707443): its important that there's some precision in the mean of the ordinals
-    //                     for the intercept calculation, so scale the ordinals by 1000 to continue
-    //                     fixed point calculation. Explore expanding
-    //                     scheduler::utils::calculate_mean to have a fixed point fractional part.
-    static constexpr int64_t kScalingFactor = 1000;
-
-    for (auto i = 0u; i < mTimestamps.size(); i++) {
-        traceInt64If("VSP-ts", mTimestamps[i]);
-
-        vsyncTS[i] = mTimestamps[i] - oldest_ts;
-        ordinals[i] = ((vsyncTS[i] + (currentPeriod / 2)) / currentPeriod) * kScalingFactor;
-    }
-
-    auto meanTS = scheduler::calculate_mean(vsyncTS);
-    auto meanOrdinal = scheduler::calculate_mean(ordinals);
-    for (auto i = 0; i < vsyncTS.size(); i++) {
-        vsyncTS[i] -= meanTS;
-        ordinals[i] -= meanOrdinal;
-    }
-
-    auto top = 0ll;
-    auto bottom = 0ll;
-    for (auto i = 0; i < vsyncTS.size(); i++) {
-        top += vsyncTS[i] * ordinals[i];
-        bottom += ordinals[i] * ordinals[i];
-    }
+    // Both sums are expanded so that they are computed from the running sums
+    // in O(1), rather than over all the timestamps for every new one:
+    //
+    // Sigma_i( (X_i - mean(X)) * (Y_i - mean(Y) ) =
+    //         Sigma_i(X_i * Y_i) - mean(X) * Sigma_i(Y_i) - mean(Y) * Sigma_i(X_i)
+    //         + n * mean(X) * mean(Y)
+    //
+    // Sigma_i ( X_i - mean(X) ) ^ 2 =
+    //         Sigma_i(X_i ^ 2) - 2 * mean(X) * Sigma_i(X_i) + n * mean(X) ^ 2
+    //
+    auto const& sums = mRegression;
+    auto const n = static_cast<int64_t>(mTimestamps.size());
+    auto const meanTS = sums.y / n;
+    auto const meanOrdinal = sums.x / n;
+    auto const top = sums.xy - meanOrdinal * sums.y - meanTS * sums.x + n * meanOrdinal * meanTS;
+    auto const bottom = sums.xx - 2 * meanOrdinal * sums.x + n * meanOrdinal * meanOrdinal;
 
     if (CC_UNLIKELY(bottom == 0)) {
         it->second = {mIdealPeriod, 0};
         clearTimestamps();
+        publishModel();
         return false;
     }
 
@@ -167,6 +340,7 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     if (percent >= kOutlierTolerancePercent) {
         it->second = {mIdealPeriod, 0};
         clearTimestamps();
+        publishModel();
         return false;
     }
 
@@ -174,6 +348,7 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
     traceInt64If("VSP-intercept", intercept);
 
     it->second = {anticipatedPeriod, intercept};
+    publishModel();
 
     ALOGV("model update ts: %" PRId64 " slope: %" PRId64 " intercept: %" PRId64, timestamp,
           anticipatedPeriod, intercept);
@@ -181,18 +356,20 @@ bool VSyncPredictor::addVsyncTimestamp(nsecs_t timestamp) {
 }
 
 nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
-    std::lock_guard<std::mutex> lk(mMutex);
-
-    auto const [slope, intercept] = getVSyncPredictionModel(lk);
+    // Predictions are made often and from several threads, so they are made
+    // from the published model rather than under mMutex.
+    auto const model = mModel.load();
+    auto const slope = model.slope;
+    auto const intercept = model.intercept;
 
-    if (mTimestamps.empty()) {
+    if (!model.oldestTimestamp) {
         traceInt64If("VSP-mode", 1);
-        auto const knownTimestamp = mKnownTimestamp ? *mKnownTimestamp : timePoint;
-        auto const numPeriodsOut = ((timePoint - knownTimestamp) / mIdealPeriod) + 1;
-        return knownTimestamp + numPeriodsOut * mIdealPeriod;
+        auto const knownTimestamp = model.knownTimestamp ? *model.knownTimestamp : timePoint;
+        auto const numPeriodsOut = ((timePoint - knownTimestamp) / model.idealPeriod) + 1;
+        return knownTimestamp + numPeriodsOut * model.idealPeriod;
     }
 
-    auto const oldest = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+    auto const oldest = *model.oldestTimestamp;
 
     // See b/145667109, the ordinal calculation must take into account the intercept.
     auto const zeroPoint = oldest + intercept;
@@ -203,7 +380,7 @@ nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
     traceInt64If("VSP-timePoint", timePoint);
     traceInt64If("VSP-prediction", prediction);
 
-    auto const printer = [&, slope = slope, intercept = intercept] {
+    auto const printer = [&] {
         std::stringstream str;
         str << "prediction made from: " << timePoint << "prediction: " << prediction << " (+"
             << prediction - timePoint << ") slope: " << slope << " intercept: " << intercept
@@ -219,13 +396,8 @@ nsecs_t VSyncPredictor::nextAnticipatedVSyncTimeFrom(nsecs_t timePoint) const {
 }
 
 std::tuple<nsecs_t, nsecs_t> VSyncPredictor::getVSyncPredictionModel() const {
-    std::lock_guard<std::mutex> lk(mMutex);
-    return VSyncPredictor::getVSyncPredictionModel(lk);
-}
-
-std::tuple<nsecs_t, nsecs_t> VSyncPredictor::getVSyncPredictionModel(
-        std::lock_guard<std::mutex> const&) const {
-    return mRateMap.find(mIdealPeriod)->second;
+    auto const model = mModel.load();
+    return {model.slope, model.intercept};
 }
 
 void VSyncPredictor::setPeriod(nsecs_t period) {
@@ -243,6 +415,7 @@ void VSyncPredictor::setPeriod(nsecs_t period) {
     }
 
     clearTimestamps();
+    publishModel();
 }
 
 void VSyncPredictor::clearTimestamps() {
@@ -254,7 +427,10 @@ void VSyncPredictor::clearTimestamps() {
             mKnownTimestamp = maxRb;
         }
 
+        // clear() keeps the capacity, so adding timestamps never allocates.
         mTimestamps.clear();
+        mOrdinals.clear();
+        mEarliest.clear();
         mLastTimestampIndex = 0;
     }
 }
@@ -268,6 +444,7 @@ void VSyncPredictor::resetModel() {
     std::lock_guard<std::mutex> lk(mMutex);
     mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
     clearTimestamps();
+    publishModel();
 }
 
 void VSyncPredictor::dump(std::string& result) const {
@@ -17,7 +17,9 @@
 #pragma once
 
 #include <android-base/thread_annotations.h>
+#include <atomic>
 #include <mutex>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 #include "SchedulerUtils.h"
@@ -66,6 +68,60 @@ private:
     VSyncPredictor& operator=(VSyncPredictor const&) = delete;
     void clearTimestamps() REQUIRES(mMutex);
 
+    // What predictions are made from. It is copied out of the state guarded by
+    // mMutex whenever that changes, so that predictions don't take mMutex.
+    struct Model {
+        nsecs_t idealPeriod = 0;
+        nsecs_t slope = 0;
+        nsecs_t intercept = 0;
+        // The timestamp the regression was made relative to, if any.
+        std::optional<nsecs_t> oldestTimestamp;
+        std::optional<nsecs_t> knownTimestamp;
+    };
+
+    // A Model written by one thread at a time and read by any, using a
+    // sequence lock: readers retry if the model changed while they copied it.
+    class PublishedModel {
+    public:
+        void store(const Model& model);
+        Model load() const;
+
+    private:
+        static constexpr size_t kWords = (sizeof(Model) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+        std::atomic<uint32_t> mSequence{0};
+        std::atomic<uint64_t> mWords[kWords] = {};
+    };
+
+    // Indices into the timestamp ring buffer, of increasingly late timestamps
+    // each followed by none earlier, so that the first one is that of the
+    // earliest timestamp in the ring buffer. Timestamps are mostly in order,
+    // so this is usually just the oldest one, but the fences they come from
+    // aren't always.
+    class EarliestIndices {
+    public:
+        void reserve(size_t capacity) { mIndices.resize(capacity); }
+        void clear() { mHead = mSize = 0; }
+        size_t front() const { return mIndices[mHead]; }
+        void push(size_t index, const std::vector<nsecs_t>& timestamps);
+        void remove(size_t index);
+
+    private:
+        std::vector<size_t> mIndices;
+        size_t mHead = 0;
+        size_t mSize = 0;
+    };
+
+    void publishModel() REQUIRES(mMutex);
+
+    // The regression is kept up to date with sums over the timestamps and
+    // their ordinals, relative to those of the earliest timestamp.
+    void addToRegression(nsecs_t timestamp, int64_t ordinal) REQUIRES(mMutex);
+    void removeFromRegression(nsecs_t timestamp, int64_t ordinal) REQUIRES(mMutex);
+    void rebaseRegression(size_t count, nsecs_t timestamp, int64_t ordinal) REQUIRES(mMutex);
+    void snapOrdinals(nsecs_t period) REQUIRES(mMutex);
+    nsecs_t residual(nsecs_t timestamp, int64_t ordinal) const REQUIRES(mMutex);
+    size_t oldestIndex() const REQUIRES(mMutex);
+
     inline void traceInt64If(const char* name, int64_t value) const;
     bool const mTraceOn;
 
@@ -76,8 +132,6 @@ private:
     std::mutex mutable mMutex;
     size_t next(int i) const REQUIRES(mMutex);
     bool validate(nsecs_t timestamp) const REQUIRES(mMutex);
-    std::tuple<nsecs_t, nsecs_t> getVSyncPredictionModel(std::lock_guard<std::mutex> const&) const
-            REQUIRES(mMutex);
 
     nsecs_t mIdealPeriod GUARDED_BY(mMutex);
     std::optional<nsecs_t> mKnownTimestamp GUARDED_BY(mMutex);
@@ -86,6 +140,35 @@ private:
 
     int mLastTimestampIndex GUARDED_BY(mMutex) = 0;
     std::vector<nsecs_t> mTimestamps GUARDED_BY(mMutex);
+    // The scaled ordinal of each timestamp in mTimestamps, counting from the
+    // earliest one in periods of the model.
+    std::vector<int64_t> mOrdinals GUARDED_BY(mMutex);
+    EarliestIndices mEarliest GUARDED_BY(mMutex);
+
+    struct Regression {
+        nsecs_t baseTimestamp = 0;
+        int64_t baseOrdinal = 0;
+
+        // Sums of X, Y, X^2 and XY, with X the ordinals and Y the timestamps
+        // relative to the base ones.
+        int64_t x = 0;
+        int64_t y = 0;
+        int64_t xx = 0;
+        int64_t xy = 0;
+
+        // The period all ordinals were last snapped with, and bounds since then
+        // on the distance of timestamps to their ordinal at that period, and on
+        // the ordinals. They tell whether snapping with another period could
+        // move any timestamp to another ordinal.
+        nsecs_t snapPeriod = 0;
+        nsecs_t minResidual = 0;
+        nsecs_t maxResidual = 0;
+        int64_t minOrdinal = 0;
+        int64_t maxOrdinal = 0;
+    };
+    Regression mRegression GUARDED_BY(mMutex);
+
+    PublishedModel mModel;
 };
 
 } // namespace android::scheduler
@@ -438,6 +438,12 @@ SurfaceFlinger::SurfaceFlinger(Factory& factory) : SurfaceFlinger(factory, SkipI
     property_get("debug.sf.disable_client_composition_cache", value, "0");
     mDisableClientCompositionCache = atoi(value);
 
+    const int32_t layerStateWorkers = property_get_int32("debug.sf.layer_state_workers", 0);
+    if (layerStateWorkers > 0) {
+        mLayerStateWorkers =
+                std::make_unique<WorkerPool>(size_t(layerStateWorkers), "CompositionPool");
+    }
+
     property_get("ro.sf.force_light_brightness", value, "0");
     mForceLightBrightness = atoi(value);
 
@@ -2093,6 +2099,7 @@ void SurfaceFlinger::onMessageRefresh() {
     refreshArgs.updatingOutputGeometryThisFrame = mVisibleRegionsDirty;
     refreshArgs.updatingGeometryThisFrame = mGeometryInvalid || mVisibleRegionsDirty;
     refreshArgs.blursAreExpensive = mBlursAreExpensive;
+    refreshArgs.layerStateWorkers = mLayerStateWorkers.get();
     refreshArgs.internalDisplayRotationFlags = DisplayDevice::getPrimaryDisplayRotationFlags();
 
     if (CC_UNLIKELY(mDrawingState.colorMatrixChanged)) {
@@ -2829,6 +2836,10 @@ void SurfaceFlinger::handleTransactionLocked(uint32_t transactionFlags)
             if (flags & Layer::eInputInfoChanged) {
                 mInputInfoChanged = true;
             }
+
+            if (flags & Layer::eZOrderChanged) {
+                mLayerZOrderChanged = true;
+            }
         });
     }
 
@@ -2917,6 +2928,7 @@ void SurfaceFlinger::handleTransactionLocked(uint32_t transactionFlags)
         mLayersAdded = false;
         // Layers have been added.
         mVisibleRegionsDirty = true;
+        mLayerZOrderChanged = true;
     }
 
     // some layers might have been removed, so
@@ -2924,6 +2936,7 @@ void SurfaceFlinger::handleTransactionLocked(uint32_t transactionFlags)
     if (mLayersRemoved) {
         mLayersRemoved = false;
         mVisibleRegionsDirty = true;
+        mLayerZOrderChanged = true;
         mDrawingState.traverseInZOrder([&](Layer* layer) {
             if (mLayersPendingRemoval.indexOf(layer) >= 0) {
                 // this layer is not visible anymore
@@ -3090,7 +3103,9 @@ void SurfaceFlinger::commitTransactionLocked() {
     mCurrentState.colorMatrixChanged = false;
 
     mDrawingState.traverse([&](Layer* layer) {
-        layer->commitChildList();
+        if (layer->commitChildList()) {
+            mLayerZOrderChanged = true;
+        }
 
         // If the layer can be reached when traversing mDrawingState, then the layer is no
         // longer offscreen. Remove the layer from the offscreenLayer set.
@@ -3101,6 +3116,11 @@ void SurfaceFlinger::commitTransactionLocked() {
 
     commitOffscreenLayers();
     mDrawingState.traverse([&](Layer* layer) { layer->updateMirrorInfo(); });
+
+    if (mLayerZOrderChanged) {
+        mLayerZOrderChanged = false;
+        mDrawingState.updateZOrderSnapshot();
+    }
 }
 
 void SurfaceFlinger::commitOffscreenLayers() {
@@ -5186,6 +5206,8 @@ status_t SurfaceFlinger::onTransact(uint32_t code, const Parcel& data, Parcel* r
                 n = data.readInt32();
                 if (n) {
                     ALOGV("Interceptor enabled");
+                    // 2 streams the trace to the file as it is recorded.
+                    mInterceptor->setStreaming(n == 2);
                     mInterceptor->enable(mDrawingState.layersSortedByZ, mDrawingState.displays);
                 }
                 else{
@@ -5977,11 +5999,37 @@ void SurfaceFlinger::State::traverse(const LayerVector::Visitor& visitor) const
 }
 
 void SurfaceFlinger::State::traverseInZOrder(const LayerVector::Visitor& visitor) const {
-    layersSortedByZ.traverseInZOrder(stateSet, visitor);
+    if (!mHasZOrderSnapshot) {
+        layersSortedByZ.traverseInZOrder(stateSet, visitor);
+        return;
+    }
+    for (Layer* layer : mLayersInZOrder) {
+        visitor(layer);
+    }
 }
 
 void SurfaceFlinger::State::traverseInReverseZOrder(const LayerVector::Visitor& visitor) const {
-    layersSortedByZ.traverseInReverseZOrder(stateSet, visitor);
+    if (!mHasZOrderSnapshot) {
+        layersSortedByZ.traverseInReverseZOrder(stateSet, visitor);
+        return;
+    }
+    for (Layer* layer : mLayersInReverseZOrder) {
+        visitor(layer);
+    }
+}
+
+void SurfaceFlinger::State::updateZOrderSnapshot() {
+    ATRACE_CALL();
+    // The reverse order is not always the mirror image of the forward one,
+    // as the lists of children are sorted by layer stack before Z.
+    mLayersInZOrder.clear();
+    layersSortedByZ.traverseInZOrder(stateSet,
+                                     [&](Layer* layer) { mLayersInZOrder.push_back(layer); });
+    mLayersInReverseZOrder.clear();
+    layersSortedByZ.traverseInReverseZOrder(stateSet, [&](Layer* layer) {
+        mLayersInReverseZOrder.push_back(layer);
+    });
+    mHasZOrderSnapshot = true;
 }
 
 void SurfaceFlinger::traverseLayersInDisplay(const sp<const DisplayDevice>& display,
@@ -395,6 +395,18 @@ private:
         void traverse(const LayerVector::Visitor& visitor) const;
         void traverseInZOrder(const LayerVector::Visitor& visitor) const;
         void traverseInReverseZOrder(const LayerVector::Visitor& visitor) const;
+
+        // Flattens the Z order traversals into arrays, which the traversals
+        // then iterate instead of building the lists of relatives of every
+        // layer they visit. Only done for the drawing state, whose hierarchy
+        // only changes when a transaction is committed, so it has to be called
+        // again after any commit that changes the hierarchy or Z order.
+        void updateZOrderSnapshot();
+
+    private:
+        bool mHasZOrderSnapshot = false;
+        std::vector<Layer*> mLayersInZOrder;
+        std::vector<Layer*> mLayersInReverseZOrder;
     };
 
     /* ------------------------------------------------------------------------
@@ -1025,6 +1037,8 @@ private:
     // protected by mStateLock (but we could use another lock)
     bool mLayersRemoved = false;
     bool mLayersAdded = false;
+    // Whether the hierarchy or Z order of the layers changes with the next commit.
+    bool mLayerZOrderChanged = true;
 
     std::atomic<bool> mRepaintEverything = false;
 
@@ -1101,6 +1115,8 @@ private:
     std::atomic<bool> mDisableBlurs = false;
     // If blurs are considered expensive and should require high GPU frequency.
     bool mBlursAreExpensive = false;
+    // If set, layers prepare their composition state on these threads too.
+    std::unique_ptr<WorkerPool> mLayerStateWorkers;
     std::atomic<uint32_t> mFrameMissedCount = 0;
     std::atomic<uint32_t> mHwcFrameMissedCount = 0;
     std::atomic<uint32_t> mGpuFrameMissedCount = 0;
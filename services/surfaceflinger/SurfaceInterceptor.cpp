@@ -54,8 +54,16 @@ void SurfaceInterceptor::enable(const SortedVector<sp<Layer>>& layers,
     ATRACE_CALL();
     mEnabled = true;
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
+    if (mStreaming) {
+        mStream = std::make_unique<SurfaceInterceptorStream>();
+        if (mStream->start(mOutputFileName) != NO_ERROR) {
+            ALOGE("Could not stream the trace, keeping it in memory instead");
+            mStream.reset();
+        }
+    }
     saveExistingDisplaysLocked(displays);
     saveExistingSurfacesLocked(layers);
+    flushIncrementsLocked();
 }
 
 void SurfaceInterceptor::disable() {
@@ -65,9 +73,17 @@ void SurfaceInterceptor::disable() {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     mEnabled = false;
-    status_t err(writeProtoFileLocked());
-    ALOGE_IF(err == PERMISSION_DENIED, "Could not save the proto file! Permission denied");
-    ALOGE_IF(err == NOT_ENOUGH_DATA, "Could not save the proto file! There are missing fields");
+    if (mStream) {
+        status_t err(mStream->stop());
+        ALOGE_IF(err != NO_ERROR, "Could not save the streamed trace!");
+        const size_t dropped = mStream->getDroppedCount();
+        ALOGW_IF(dropped > 0, "Dropped %zu increments while streaming the trace", dropped);
+        mStream.reset();
+    } else {
+        status_t err(writeProtoFileLocked());
+        ALOGE_IF(err == PERMISSION_DENIED, "Could not save the proto file! Permission denied");
+        ALOGE_IF(err == NOT_ENOUGH_DATA, "Could not save the proto file! There are missing fields");
+    }
     mTrace.Clear();
 }
 
@@ -75,6 +91,11 @@ bool SurfaceInterceptor::isEnabled() {
     return mEnabled;
 }
 
+void SurfaceInterceptor::setStreaming(bool streaming) {
+    std::lock_guard<std::mutex> protoGuard(mTraceMutex);
+    mStreaming = streaming;
+}
+
 void SurfaceInterceptor::saveExistingDisplaysLocked(
         const DefaultKeyedVector< wp<IBinder>, DisplayDeviceState>& displays)
 {
@@ -192,6 +213,17 @@ int32_t SurfaceInterceptor::getLayerIdFromHandle(const sp<const IBinder>& handle
     return layer == nullptr ? -1 : getLayerId(layer);
 }
 
+void SurfaceInterceptor::flushIncrementsLocked() {
+    if (!mStream) {
+        return;
+    }
+    for (const Increment& increment : mTrace.increment()) {
+        mStream->write(increment);
+    }
+    // Cleared increments stay allocated and are reused by the next createTraceIncrementLocked().
+    mTrace.clear_increment();
+}
+
 Increment* SurfaceInterceptor::createTraceIncrementLocked() {
     Increment* increment(mTrace.add_increment());
     increment->set_time_stamp(elapsedRealtimeNano());
@@ -624,6 +656,7 @@ void SurfaceInterceptor::saveTransaction(const Vector<ComposerState>& stateUpdat
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addTransactionLocked(createTraceIncrementLocked(), stateUpdates, displays, changedDisplays,
             flags);
+    flushIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveSurfaceCreation(const sp<const Layer>& layer) {
@@ -633,6 +666,7 @@ void SurfaceInterceptor::saveSurfaceCreation(const sp<const Layer>& layer) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addSurfaceCreationLocked(createTraceIncrementLocked(), layer);
+    flushIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveSurfaceDeletion(const sp<const Layer>& layer) {
@@ -642,6 +676,7 @@ void SurfaceInterceptor::saveSurfaceDeletion(const sp<const Layer>& layer) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addSurfaceDeletionLocked(createTraceIncrementLocked(), layer);
+    flushIncrementsLocked();
 }
 
 /**
@@ -660,6 +695,7 @@ void SurfaceInterceptor::saveBufferUpdate(int32_t layerId, uint32_t width,
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addBufferUpdateLocked(createTraceIncrementLocked(), layerId, width, height, frameNumber);
+    flushIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveVSyncEvent(nsecs_t timestamp) {
@@ -668,6 +704,7 @@ void SurfaceInterceptor::saveVSyncEvent(nsecs_t timestamp) {
     }
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addVSyncUpdateLocked(createTraceIncrementLocked(), timestamp);
+    flushIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveDisplayCreation(const DisplayDeviceState& info) {
@@ -677,6 +714,7 @@ void SurfaceInterceptor::saveDisplayCreation(const DisplayDeviceState& info) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addDisplayCreationLocked(createTraceIncrementLocked(), info);
+    flushIncrementsLocked();
 }
 
 void SurfaceInterceptor::saveDisplayDeletion(int32_t sequenceId) {
@@ -686,6 +724,7 @@ void SurfaceInterceptor::saveDisplayDeletion(int32_t sequenceId) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addDisplayDeletionLocked(createTraceIncrementLocked(), sequenceId);
+    flushIncrementsLocked();
 }
 
 void SurfaceInterceptor::savePowerModeUpdate(int32_t sequenceId, int32_t mode) {
@@ -695,6 +734,7 @@ void SurfaceInterceptor::savePowerModeUpdate(int32_t sequenceId, int32_t mode) {
     ATRACE_CALL();
     std::lock_guard<std::mutex> protoGuard(mTraceMutex);
     addPowerModeUpdateLocked(createTraceIncrementLocked(), sequenceId, mode);
+    flushIncrementsLocked();
 }
 
 } // namespace impl
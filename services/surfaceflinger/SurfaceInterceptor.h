@@ -19,6 +19,7 @@
 
 #include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
 
+#include <memory>
 #include <mutex>
 
 #include <gui/LayerState.h>
@@ -29,6 +30,7 @@
 #include <utils/Vector.h>
 
 #include "DisplayDevice.h"
+#include "SurfaceInterceptorStream.h"
 
 namespace android {
 
@@ -57,6 +59,9 @@ public:
                         const DefaultKeyedVector<wp<IBinder>, DisplayDeviceState>& displays) = 0;
     virtual void disable() = 0;
     virtual bool isEnabled() = 0;
+    // Applies from the next enable(). When set, increments are written to the output file while
+    // recording instead of being held in memory until disable().
+    virtual void setStreaming(bool streaming) = 0;
 
     // Intercept display and surface transactions
     virtual void saveTransaction(
@@ -93,6 +98,7 @@ public:
                 const DefaultKeyedVector<wp<IBinder>, DisplayDeviceState>& displays) override;
     void disable() override;
     bool isEnabled() override;
+    void setStreaming(bool streaming) override;
 
     // Intercept display and surface transactions
     void saveTransaction(const Vector<ComposerState>& stateUpdates,
@@ -128,6 +134,8 @@ private:
     int32_t getLayerIdFromHandle(const sp<const IBinder>& weakHandle) const;
 
     Increment* createTraceIncrementLocked();
+    // Hands the increments recorded so far to mStream, if streaming.
+    void flushIncrementsLocked();
     void addSurfaceCreationLocked(Increment* increment, const sp<const Layer>& layer);
     void addSurfaceDeletionLocked(Increment* increment, const sp<const Layer>& layer);
     void addBufferUpdateLocked(Increment* increment, int32_t layerId, uint32_t width,
@@ -187,6 +195,8 @@ private:
     std::string mOutputFileName {DEFAULT_FILENAME};
     std::mutex mTraceMutex {};
     Trace mTrace {};
+    bool mStreaming {false};
+    std::unique_ptr<SurfaceInterceptorStream> mStream;
     SurfaceFlinger* const mFlinger;
 };
 
@@ -0,0 +1,171 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "SurfaceInterceptor"
+#define ATRACE_TAG ATRACE_TAG_GRAPHICS
+
+#include "SurfaceInterceptorStream.h"
+
+#include <android-base/file.h>
+#include <fcntl.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <log/log.h>
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace android {
+
+using namespace std::chrono_literals;
+using google::protobuf::io::CodedOutputStream;
+
+// Wire format tag of `repeated Increment increment = 1` in Trace.
+static constexpr uint8_t kIncrementTag = (1 << 3) | 2;
+
+// Buffered increments are written out at least this often, even if the ring is mostly empty.
+static constexpr auto kFlushInterval = 1s;
+
+// Writes the framed increment, whose serialized size is `size`, to `out`.
+static void encodeRecord(const surfaceflinger::Increment& increment, size_t size, uint8_t* out) {
+    *out++ = kIncrementTag;
+    out = CodedOutputStream::WriteVarint32ToArray(size, out);
+    increment.SerializeWithCachedSizesToArray(out);
+}
+
+SurfaceInterceptorStream::SurfaceInterceptorStream(size_t bufferSize) : mBuffer(bufferSize) {}
+
+SurfaceInterceptorStream::~SurfaceInterceptorStream() {
+    stop();
+}
+
+status_t SurfaceInterceptorStream::start(const std::string& fileName) {
+    // -rw-r--r--
+    mFd.reset(open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                   S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH));
+    if (mFd < 0) {
+        ALOGE("Could not open %s: %s", fileName.c_str(), strerror(errno));
+        return PERMISSION_DENIED;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mHead = mTail = 0;
+        mDropped = 0;
+        mStopping = false;
+        mError = NO_ERROR;
+        // Records larger than the ring are dropped, so this is as large as mRecord gets.
+        mRecord.reserve(mBuffer.size());
+    }
+    mThread = std::thread(&SurfaceInterceptorStream::threadMain, this);
+    return NO_ERROR;
+}
+
+bool SurfaceInterceptorStream::write(const surfaceflinger::Increment& increment) {
+    // Encoding happens on the calling thread, but doesn't allocate: records are encoded straight
+    // into the ring, or into mRecord, reserved by start(), when they wrap around its end.
+    const size_t size = increment.ByteSizeLong();
+    const size_t recordSize = 1 + CodedOutputStream::VarintSize32(size) + size;
+
+    std::lock_guard<std::mutex> lock(mLock);
+    const size_t capacity = mBuffer.size();
+    if (mStopping || mHead - mTail + recordSize > capacity) {
+        mDropped++;
+        return false;
+    }
+
+    const size_t offset = mHead % capacity;
+    if (recordSize <= capacity - offset) {
+        encodeRecord(increment, size, mBuffer.data() + offset);
+    } else {
+        mRecord.resize(recordSize);
+        encodeRecord(increment, size, reinterpret_cast<uint8_t*>(mRecord.data()));
+        const size_t first = capacity - offset;
+        memcpy(mBuffer.data() + offset, mRecord.data(), first);
+        memcpy(mBuffer.data(), mRecord.data() + first, recordSize - first);
+    }
+    mHead += recordSize;
+
+    // Let the writer batch up a good chunk rather than waking it for every increment.
+    if (mHead - mTail >= capacity / 4) {
+        mCondition.notify_one();
+    }
+    return true;
+}
+
+status_t SurfaceInterceptorStream::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mStopping = true;
+    }
+    mCondition.notify_one();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    if (mFd >= 0) {
+        fsync(mFd);
+        mFd.reset();
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+    return mError;
+}
+
+size_t SurfaceInterceptorStream::getDroppedCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mDropped;
+}
+
+void SurfaceInterceptorStream::threadMain() NO_THREAD_SAFETY_ANALYSIS {
+    const size_t capacity = mBuffer.size();
+    std::unique_lock<std::mutex> lock(mLock);
+    while (true) {
+        mCondition.wait_for(lock, kFlushInterval, [this]() REQUIRES(mLock) {
+            return mStopping || mHead - mTail >= mBuffer.size() / 4;
+        });
+        const uint64_t head = mHead;
+        const uint64_t tail = mTail;
+        const bool stopping = mStopping;
+        lock.unlock();
+
+        // The producer only appends past head, so [tail, head) is stable without the lock.
+        bool ok = true;
+        if (head != tail) {
+            ATRACE_NAME("SurfaceInterceptorStream::flush");
+            const size_t offset = tail % capacity;
+            const size_t length = head - tail;
+            const size_t first = std::min(length, capacity - offset);
+            ok = base::WriteFully(mFd, mBuffer.data() + offset, first) &&
+                    base::WriteFully(mFd, mBuffer.data(), length - first);
+        }
+
+        lock.lock();
+        if (!ok) {
+            ALOGE("Could not write the trace: %s", strerror(errno));
+            mError = PERMISSION_DENIED;
+            // Stop accepting increments; there is nowhere to put them.
+            mStopping = true;
+            return;
+        }
+        mTail = head;
+        if (stopping && mTail == mHead) {
+            return;
+        }
+    }
+}
+
+} // namespace android
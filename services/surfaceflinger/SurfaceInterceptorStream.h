@@ -0,0 +1,81 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <android-base/thread_annotations.h>
+#include <android-base/unique_fd.h>
+#include <frameworks/native/cmds/surfacereplayer/proto/src/trace.pb.h>
+#include <utils/Errors.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+/*
+ * Streams SurfaceInterceptor increments to a file while they are being recorded, so that long
+ * sessions don't accumulate the whole trace in memory.
+ *
+ * Increments are encoded into a preallocated ring buffer by the recording thread and written out by
+ * a background thread. Each one is framed as a length-delimited `increment` field of Trace, so the
+ * file parses as a regular Trace. If the writer falls behind and the ring is full, increments are
+ * dropped and counted rather than stalling the caller.
+ */
+class SurfaceInterceptorStream {
+public:
+    static constexpr size_t kDefaultBufferSize = 4 * 1024 * 1024;
+
+    explicit SurfaceInterceptorStream(size_t bufferSize = kDefaultBufferSize);
+    ~SurfaceInterceptorStream();
+
+    // Truncates fileName and starts the writer thread.
+    status_t start(const std::string& fileName);
+
+    // Returns false if the increment was dropped.
+    bool write(const surfaceflinger::Increment& increment);
+
+    // Writes out everything buffered, then stops the writer and closes the file.
+    status_t stop();
+
+    size_t getDroppedCount() const;
+
+private:
+    void threadMain();
+
+    std::vector<uint8_t> mBuffer;
+    // Scratch space for encoding an increment which wraps around the end of the ring.
+    std::string mRecord GUARDED_BY(mLock);
+
+    mutable std::mutex mLock;
+    std::condition_variable mCondition;
+    // Total bytes ever placed in the ring and ever written out; their difference is the fill level.
+    uint64_t mHead GUARDED_BY(mLock) = 0;
+    uint64_t mTail GUARDED_BY(mLock) = 0;
+    size_t mDropped GUARDED_BY(mLock) = 0;
+    // Set until start() and once the writer stops.
+    bool mStopping GUARDED_BY(mLock) = true;
+    status_t mError GUARDED_BY(mLock) = NO_ERROR;
+
+    base::unique_fd mFd;
+    std::thread mThread;
+};
+
+} // namespace android
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+
+#include <string>
+#include <vector>
+
+#include "Scheduler/LayerHistory.h"
+#include "Scheduler/RefreshRateConfigs.h"
+#include "TestableScheduler.h"
+#include "TestableSurfaceFlinger.h"
+#include "mock/MockLayer.h"
+
+namespace android::scheduler {
+
+using testing::NiceMock;
+using testing::Return;
+
+static constexpr nsecs_t kPeriod = static_cast<nsecs_t>(1e9f / 120.f);
+
+// A 60/120 Hz display with |state.range(0)| visible layers in its history.
+class LayerHistoryBenchmark {
+public:
+    explicit LayerHistoryBenchmark(benchmark::State& state) {
+        mFlinger.resetScheduler(mScheduler);
+        for (int64_t i = 0; i < state.range(0); i++) {
+            const sp<mock::MockLayer> layer =
+                    new NiceMock<mock::MockLayer>(mFlinger.flinger(), "Layer" + std::to_string(i));
+            ON_CALL(*layer, isVisible()).WillByDefault(Return(true));
+            ON_CALL(*layer, getFrameRateForLayerTree()).WillByDefault(Return(Layer::FrameRate()));
+            mLayers.push_back(layer);
+        }
+    }
+
+    impl::LayerHistoryV2& history() { return *mScheduler->mutableLayerHistoryV2(); }
+
+    // Queues a buffer on every layer, as SurfaceFlinger records them for a frame.
+    void recordFrame(nsecs_t time) {
+        for (const auto& layer : mLayers) {
+            history().record(layer.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
+        }
+    }
+
+private:
+    Hwc2::mock::Display mDisplay;
+    RefreshRateConfigs mConfigs{{HWC2::Display::Config::Builder(mDisplay, 0)
+                                         .setVsyncPeriod(static_cast<int32_t>(2 * kPeriod))
+                                         .setConfigGroup(0)
+                                         .build(),
+                                 HWC2::Display::Config::Builder(mDisplay, 1)
+                                         .setVsyncPeriod(static_cast<int32_t>(kPeriod))
+                                         .setConfigGroup(0)
+                                         .build()},
+                                HwcConfigIndexType(0)};
+    TestableScheduler* const mScheduler{new TestableScheduler(mConfigs, true)};
+    TestableSurfaceFlinger mFlinger;
+    std::vector<sp<mock::MockLayer>> mLayers;
+};
+
+// Every layer updating at 120 Hz, summarized after each frame.
+static void benchmarkSummarizeUpdatingLayers(benchmark::State& state) {
+    LayerHistoryBenchmark layers(state);
+    LayerHistory::Summary summary;
+    nsecs_t time = systemTime();
+    for (auto _ : state) {
+        state.PauseTiming();
+        layers.recordFrame(time);
+        time += kPeriod;
+        state.ResumeTiming();
+
+        layers.history().summarize(time, &summary);
+        benchmark::DoNotOptimize(summary);
+    }
+}
+
+// Layers which are still active, but haven't been updated since the last
+// summary.
+static void benchmarkSummarizeIdleLayers(benchmark::State& state) {
+    LayerHistoryBenchmark layers(state);
+    LayerHistory::Summary summary;
+    nsecs_t time = systemTime();
+    for (int i = 0; i < 10; i++) {
+        layers.recordFrame(time);
+        time += kPeriod;
+    }
+
+    for (auto _ : state) {
+        layers.history().summarize(time, &summary);
+        benchmark::DoNotOptimize(summary);
+    }
+}
+
+BENCHMARK(benchmarkSummarizeUpdatingLayers)->Arg(20)->Arg(200);
+BENCHMARK(benchmarkSummarizeIdleLayers)->Arg(20)->Arg(200);
+
+} // namespace android::scheduler
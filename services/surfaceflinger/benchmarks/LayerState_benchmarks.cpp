@@ -0,0 +1,69 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include "Layer.h"
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic pop // ignored "-Wconversion"
+
+namespace android {
+
+using State = Layer::State;
+
+// A state with the fields that allocate when copied filled in, as for a
+// window with input.
+static State makeWindowState() {
+    State state{};
+    auto& inputInfo = state.inputInfo.edit();
+    inputInfo.name = "com.example.app/com.example.app.MainActivity#0";
+    inputInfo.touchableRegion = Region(Rect(0, 0, 1080, 100)).merge(Rect(0, 200, 1080, 2000));
+    auto& metadata = state.metadata.edit();
+    metadata.setInt32(METADATA_WINDOW_TYPE, InputWindowInfo::TYPE_APPLICATION);
+    metadata.setInt32(METADATA_OWNER_UID, 10100);
+    metadata.setInt32(METADATA_TASK_ID, 42);
+    state.hdrMetadata.edit().hdr10plus.assign(64, 0xff);
+    return state;
+}
+
+// Commits a state in which a single field changed, as Layer::doTransaction
+// does with the current state.
+template <typename Change>
+static void benchmarkCommit(benchmark::State& benchmarkState, Change change) {
+    const State current = makeWindowState();
+    State drawing = current;
+    int frame = 0;
+    for (auto _ : benchmarkState) {
+        State c = current;
+        change(c, frame++);
+        drawing = c;
+    }
+    benchmark::DoNotOptimize(drawing);
+}
+
+BENCHMARK_CAPTURE(benchmarkCommit, z, [](State& c, int i) { c.z = i; });
+BENCHMARK_CAPTURE(benchmarkCommit, crop, [](State& c, int i) { c.crop_legacy = Rect(0, 0, i, i); });
+BENCHMARK_CAPTURE(benchmarkCommit, cornerRadius,
+                  [](State& c, int i) { c.cornerRadius = static_cast<float>(i % 8); });
+BENCHMARK_CAPTURE(benchmarkCommit, inputInfo,
+                  [](State& c, int i) { c.inputInfo.edit().frameLeft = i; });
+BENCHMARK_CAPTURE(benchmarkCommit, metadata,
+                  [](State& c, int i) { c.metadata.edit().setInt32(METADATA_TASK_ID, i); });
+
+} // namespace android
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+#include <gui/LayerMetadata.h>
+
+#include <vector>
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include "EffectLayer.h"
+#include "Layer.h"
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic pop // ignored "-Wconversion"
+#include "TestableSurfaceFlinger.h"
+#include "mock/DisplayHardware/MockComposer.h"
+#include "mock/MockDispSync.h"
+#include "mock/MockEventControlThread.h"
+#include "mock/MockEventThread.h"
+
+namespace android {
+
+using testing::_;
+using testing::NiceMock;
+using testing::Return;
+
+using FakeHwcDisplayInjector = TestableSurfaceFlinger::FakeHwcDisplayInjector;
+
+// The drawing state of 10 trees, each a chain of 20 layers with leaves on both
+// sides, and every 7th leaf relative to a layer in the chain of the next tree.
+class LayerZOrderTraversalBenchmark {
+public:
+    static constexpr size_t kRootCount = 10;
+    static constexpr size_t kDepth = 20;
+    static constexpr size_t kRelativeStride = 7;
+
+    LayerZOrderTraversalBenchmark() {
+        setupScheduler();
+        mFlinger.setupComposer(std::make_unique<NiceMock<Hwc2::mock::Composer>>());
+        createHierarchy();
+        commitTransaction();
+    }
+
+    ~LayerZOrderTraversalBenchmark() {
+        mFlinger.mutableCurrentState().layersSortedByZ.clear();
+        mFlinger.mutableDrawingState().layersSortedByZ.clear();
+    }
+
+    SurfaceFlinger::State& drawingState() { return mFlinger.mutableDrawingState(); }
+
+private:
+    void setupScheduler();
+    sp<Layer> createLayer(Layer* parent, int32_t z);
+    void createHierarchy();
+    void commitTransaction();
+
+    TestableSurfaceFlinger mFlinger;
+    std::vector<sp<Layer>> mRoots;
+    std::vector<sp<Layer>> mLayers;
+};
+
+void LayerZOrderTraversalBenchmark::setupScheduler() {
+    auto eventThread = std::make_unique<NiceMock<mock::EventThread>>();
+    auto sfEventThread = std::make_unique<NiceMock<mock::EventThread>>();
+    constexpr auto kConfigChanged = ISurfaceComposer::eConfigChangedSuppress;
+    for (mock::EventThread* thread : {eventThread.get(), sfEventThread.get()}) {
+        ON_CALL(*thread, createEventConnection(_, _))
+                .WillByDefault(Return(
+                        new EventThreadConnection(thread, ResyncCallback(), kConfigChanged)));
+    }
+
+    auto primaryDispSync = std::make_unique<NiceMock<mock::DispSync>>();
+    ON_CALL(*primaryDispSync, getPeriod())
+            .WillByDefault(Return(FakeHwcDisplayInjector::DEFAULT_REFRESH_RATE));
+    mFlinger.setupScheduler(std::move(primaryDispSync),
+                            std::make_unique<mock::EventControlThread>(), std::move(eventThread),
+                            std::move(sfEventThread));
+}
+
+sp<Layer> LayerZOrderTraversalBenchmark::createLayer(Layer* parent, int32_t z) {
+    sp<Client> client;
+    LayerCreationArgs args(mFlinger.flinger(), client, "color-layer", 100, 100, 0,
+                           LayerMetadata());
+    sp<Layer> layer = new EffectLayer(args);
+    layer->setLayer(z);
+    if (parent) {
+        parent->addChild(layer);
+    } else {
+        mRoots.push_back(layer);
+    }
+    mLayers.push_back(layer);
+    return layer;
+}
+
+void LayerZOrderTraversalBenchmark::createHierarchy() {
+    std::vector<std::vector<Layer*>> chains(kRootCount);
+    std::vector<std::vector<Layer*>> leaves(kRootCount);
+    for (size_t root = 0; root < kRootCount; root++) {
+        Layer* parent = createLayer(nullptr, static_cast<int32_t>(root)).get();
+        for (size_t level = 0; level < kDepth; level++) {
+            chains[root].push_back(parent);
+            for (int32_t z = -2; z < 2; z++) {
+                leaves[root].push_back(createLayer(parent, z).get());
+            }
+            parent = createLayer(parent, 2).get();
+        }
+    }
+
+    // Only leaves are made relative, and only to chains, so there are no cycles.
+    for (size_t root = 0; root < kRootCount; root++) {
+        const auto& chain = chains[(root + 1) % kRootCount];
+        for (size_t i = 0; i < leaves[root].size(); i += kRelativeStride) {
+            Layer* layer = leaves[root][i];
+            Layer* relative = chain[i % chain.size()];
+            const int32_t z = i % 2 ? 1 : -1;
+            // Keep the children of the parent sorted, as SurfaceFlinger does.
+            layer->getParent()->setChildLayer(layer, z);
+            layer->setZOrderRelativeOf(relative);
+            relative->addZOrderRelative(layer);
+        }
+    }
+}
+
+void LayerZOrderTraversalBenchmark::commitTransaction() {
+    for (const auto& layer : mLayers) {
+        layer->commitTransaction(layer->getCurrentState());
+    }
+    for (const auto& root : mRoots) {
+        root->commitChildList();
+        mFlinger.mutableCurrentState().layersSortedByZ.add(root);
+        mFlinger.mutableDrawingState().layersSortedByZ.add(root);
+    }
+}
+
+static void benchmarkLayerTreeTraversal(benchmark::State& state) {
+    LayerZOrderTraversalBenchmark fixture;
+    const auto& drawingState = fixture.drawingState();
+    size_t visited = 0;
+    for (auto _ : state) {
+        drawingState.layersSortedByZ.traverseInZOrder(drawingState.stateSet,
+                                                      [&](Layer*) { visited++; });
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(visited));
+}
+
+static void benchmarkZOrderSnapshotTraversal(benchmark::State& state) {
+    LayerZOrderTraversalBenchmark fixture;
+    fixture.drawingState().updateZOrderSnapshot();
+    const auto& drawingState = fixture.drawingState();
+    size_t visited = 0;
+    for (auto _ : state) {
+        drawingState.traverseInZOrder([&](Layer*) { visited++; });
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(visited));
+}
+
+BENCHMARK(benchmarkLayerTreeTraversal);
+BENCHMARK(benchmarkZOrderSnapshotTraversal);
+
+} // namespace android
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+#include <thread>
+
+#include "Scheduler/OneShotTimer.h"
+#include "Scheduler/TimerService.h"
+
+using namespace std::chrono_literals;
+
+namespace android::scheduler {
+
+// Resets of a waiting timer, as done for every touch event and buffer. They
+// only move its deadline, so the service should not wake up.
+static void benchmarkReset(benchmark::State& state) {
+    TimerService service;
+    OneShotTimer timer(100ms, [] {}, [] {}, service);
+    timer.start();
+    // Let the service pick up the timer, so that only resets are measured.
+    std::this_thread::sleep_for(10ms);
+
+    const size_t wakeups = service.getWakeupCount();
+    for (auto _ : state) {
+        timer.reset();
+    }
+    state.counters["wakeups"] = static_cast<double>(service.getWakeupCount() - wakeups);
+    timer.stop();
+}
+
+BENCHMARK(benchmarkReset);
+
+} // namespace android::scheduler
@@ -0,0 +1,87 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "DisplayHardware/HWC2.h"
+#include "Scheduler/RefreshRateConfigs.h"
+#include "mock/DisplayHardware/MockDisplay.h"
+
+namespace android::scheduler {
+
+using LayerRequirement = RefreshRateConfigs::LayerRequirement;
+using LayerVoteType = RefreshRateConfigs::LayerVoteType;
+
+// A display with 30, 60, 72, 90 and 120 Hz configs, starting at 60 Hz.
+static std::unique_ptr<RefreshRateConfigs> createConfigs(Hwc2::mock::Display& display) {
+    constexpr float kRefreshRates[] = {60.f, 30.f, 72.f, 90.f, 120.f};
+    std::vector<std::shared_ptr<const HWC2::Display::Config>> configs;
+    for (size_t i = 0; i < std::size(kRefreshRates); i++) {
+        configs.push_back(HWC2::Display::Config::Builder(display, static_cast<hwc2_config_t>(i))
+                                  .setVsyncPeriod(static_cast<int32_t>(1e9f / kRefreshRates[i]))
+                                  .setConfigGroup(0)
+                                  .build());
+    }
+    return std::make_unique<RefreshRateConfigs>(configs, HwcConfigIndexType(0));
+}
+
+// |count| layers with a mix of votes and frame rates.
+static std::vector<LayerRequirement> createLayers(int64_t count) {
+    constexpr LayerVoteType kVotes[] = {LayerVoteType::Heuristic, LayerVoteType::ExplicitDefault,
+                                        LayerVoteType::ExplicitExactOrMultiple,
+                                        LayerVoteType::Max};
+    constexpr float kFrameRates[] = {24.f, 30.f, 48.f, 60.f, 72.f, 90.f, 120.f};
+    std::vector<LayerRequirement> layers;
+    for (size_t i = 0; i < static_cast<size_t>(count); i++) {
+        layers.push_back({.name = "Layer" + std::to_string(i),
+                          .vote = kVotes[i % std::size(kVotes)],
+                          .desiredRefreshRate = kFrameRates[i % std::size(kFrameRates)],
+                          .weight = 0.5f});
+    }
+    return layers;
+}
+
+// The same layers every frame, as while content plays at a steady rate.
+static void benchmarkGetBestRefreshRate(benchmark::State& state) {
+    Hwc2::mock::Display display;
+    const auto configs = createConfigs(display);
+    const auto layers = createLayers(state.range(0));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(&configs->getBestRefreshRate(layers, {}));
+    }
+}
+
+// A layer changes its frame rate every frame, so its scores are recomputed.
+static void benchmarkGetBestRefreshRateWithChangingLayer(benchmark::State& state) {
+    Hwc2::mock::Display display;
+    const auto configs = createConfigs(display);
+    auto layers = createLayers(state.range(0));
+    float frameRate = 24.f;
+    for (auto _ : state) {
+        layers[0].desiredRefreshRate = frameRate;
+        frameRate = frameRate < 120.f ? frameRate + 1.f : 24.f;
+        benchmark::DoNotOptimize(&configs->getBestRefreshRate(layers, {}));
+    }
+}
+
+BENCHMARK(benchmarkGetBestRefreshRate)->Arg(1)->Arg(20);
+BENCHMARK(benchmarkGetBestRefreshRateWithChangingLayer)->Arg(1)->Arg(20);
+
+} // namespace android::scheduler
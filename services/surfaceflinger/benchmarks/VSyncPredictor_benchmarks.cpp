@@ -0,0 +1,88 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <thread>
+
+#include "Scheduler/VSyncPredictor.h"
+
+namespace android::scheduler {
+
+// The tunables of the predictor created by the scheduler.
+static constexpr nsecs_t kPeriod = 16'666'667;
+static constexpr size_t kHistorySize = 20;
+static constexpr size_t kMinimumSamplesForPrediction = 6;
+static constexpr uint32_t kOutlierTolerancePercent = 20;
+
+// Fills the history of |tracker| with timestamps up to |now|.
+static void fillHistory(VSyncPredictor& tracker, nsecs_t* now) {
+    for (size_t i = 0; i < kHistorySize; i++) {
+        tracker.addVsyncTimestamp(*now += kPeriod);
+    }
+}
+
+static void benchmarkAddVsyncTimestamp(benchmark::State& state) {
+    VSyncPredictor tracker(kPeriod, kHistorySize, kMinimumSamplesForPrediction,
+                           kOutlierTolerancePercent);
+    nsecs_t now = 0;
+    fillHistory(tracker, &now);
+    for (auto _ : state) {
+        tracker.addVsyncTimestamp(now += kPeriod);
+    }
+}
+
+static void benchmarkNextAnticipatedVSyncTime(benchmark::State& state) {
+    VSyncPredictor tracker(kPeriod, kHistorySize, kMinimumSamplesForPrediction,
+                           kOutlierTolerancePercent);
+    nsecs_t now = 0;
+    fillHistory(tracker, &now);
+    nsecs_t timePoint = now;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(tracker.nextAnticipatedVSyncTimeFrom(timePoint++));
+    }
+}
+
+// Timestamps are added on the HWC thread while predictions are made for the
+// vsync callbacks of the app and SurfaceFlinger.
+static void benchmarkAddVsyncTimestampWithConcurrentReader(benchmark::State& state) {
+    VSyncPredictor tracker(kPeriod, kHistorySize, kMinimumSamplesForPrediction,
+                           kOutlierTolerancePercent);
+    nsecs_t now = 0;
+    fillHistory(tracker, &now);
+    std::atomic<bool> done = false;
+    std::atomic<nsecs_t> lastTimestamp = now;
+    std::thread reader([&] {
+        while (!done) {
+            benchmark::DoNotOptimize(tracker.nextAnticipatedVSyncTimeFrom(lastTimestamp));
+        }
+    });
+
+    for (auto _ : state) {
+        tracker.addVsyncTimestamp(now += kPeriod);
+        lastTimestamp = now;
+    }
+
+    done = true;
+    reader.join();
+}
+
+BENCHMARK(benchmarkAddVsyncTimestamp);
+BENCHMARK(benchmarkNextAnticipatedVSyncTime);
+BENCHMARK(benchmarkAddVsyncTimestampWithConcurrentReader);
+
+} // namespace android::scheduler
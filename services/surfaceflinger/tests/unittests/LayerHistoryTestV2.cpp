@@ -53,6 +53,12 @@ protected:
     impl::LayerHistoryV2& history() { return *mScheduler->mutableLayerHistoryV2(); }
     const impl::LayerHistoryV2& history() const { return *mScheduler->mutableLayerHistoryV2(); }
 
+    LayerHistory::Summary summarize(nsecs_t now) {
+        LayerHistory::Summary summary;
+        history().summarize(now, &summary);
+        return summary;
+    }
+
     size_t layerCount() const { return mScheduler->layerHistorySize(); }
     size_t activeLayerCount() const NO_THREAD_SAFETY_ANALYSIS { return history().mActiveLayersEnd; }
 
@@ -94,7 +100,7 @@ protected:
             history().record(layer.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
             time += framePeriod;
 
-            summary = history().summarize(time);
+            summary = summarize(time);
         }
 
         ASSERT_EQ(1, summary.size());
@@ -131,22 +137,22 @@ TEST_F(LayerHistoryTestV2, oneLayer) {
     const nsecs_t time = systemTime();
 
     // No layers returned if no layers are active.
-    EXPECT_TRUE(history().summarize(time).empty());
+    EXPECT_TRUE(summarize(time).empty());
     EXPECT_EQ(0, activeLayerCount());
 
     // Max returned if active layers have insufficient history.
     for (int i = 0; i < PRESENT_TIME_HISTORY_SIZE - 1; i++) {
         history().record(layer.get(), 0, time, LayerHistory::LayerUpdateType::Buffer);
-        ASSERT_EQ(1, history().summarize(time).size());
-        EXPECT_EQ(LayerHistory::LayerVoteType::Max, history().summarize(time)[0].vote);
+        ASSERT_EQ(1, summarize(time).size());
+        EXPECT_EQ(LayerHistory::LayerVoteType::Max, summarize(time)[0].vote);
         EXPECT_EQ(1, activeLayerCount());
     }
 
     // Max is returned since we have enough history but there is no timestamp votes.
     for (int i = 0; i < 10; i++) {
         history().record(layer.get(), 0, time, LayerHistory::LayerUpdateType::Buffer);
-        ASSERT_EQ(1, history().summarize(time).size());
-        EXPECT_EQ(LayerHistory::LayerVoteType::Max, history().summarize(time)[0].vote);
+        ASSERT_EQ(1, summarize(time).size());
+        EXPECT_EQ(LayerHistory::LayerVoteType::Max, summarize(time)[0].vote);
         EXPECT_EQ(1, activeLayerCount());
     }
 }
@@ -162,16 +168,16 @@ TEST_F(LayerHistoryTestV2, oneInvisibleLayer) {
     nsecs_t time = systemTime();
 
     history().record(layer.get(), 0, time, LayerHistory::LayerUpdateType::Buffer);
-    auto summary = history().summarize(time);
-    ASSERT_EQ(1, history().summarize(time).size());
+    auto summary = summarize(time);
+    ASSERT_EQ(1, summarize(time).size());
     // Layer is still considered inactive so we expect to get Min
-    EXPECT_EQ(LayerHistory::LayerVoteType::Max, history().summarize(time)[0].vote);
+    EXPECT_EQ(LayerHistory::LayerVoteType::Max, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
 
     EXPECT_CALL(*layer, isVisible()).WillRepeatedly(Return(false));
 
-    summary = history().summarize(time);
-    EXPECT_TRUE(history().summarize(time).empty());
+    summary = summarize(time);
+    EXPECT_TRUE(summarize(time).empty());
     EXPECT_EQ(0, activeLayerCount());
 }
 
@@ -189,9 +195,9 @@ TEST_F(LayerHistoryTestV2, explicitTimestamp) {
         time += LO_FPS_PERIOD;
     }
 
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Heuristic, history().summarize(time)[0].vote);
-    EXPECT_FLOAT_EQ(LO_FPS, history().summarize(time)[0].desiredRefreshRate);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Heuristic, summarize(time)[0].vote);
+    EXPECT_FLOAT_EQ(LO_FPS, summarize(time)[0].desiredRefreshRate);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 }
@@ -212,13 +218,13 @@ TEST_F(LayerHistoryTestV2, oneLayerNoVote) {
         time += HI_FPS_PERIOD;
     }
 
-    ASSERT_TRUE(history().summarize(time).empty());
+    ASSERT_TRUE(summarize(time).empty());
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 
     // layer became inactive
     time += MAX_ACTIVE_LAYER_PERIOD_NS.count();
-    ASSERT_TRUE(history().summarize(time).empty());
+    ASSERT_TRUE(summarize(time).empty());
     EXPECT_EQ(0, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
 }
@@ -239,14 +245,14 @@ TEST_F(LayerHistoryTestV2, oneLayerMinVote) {
         time += HI_FPS_PERIOD;
     }
 
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Min, history().summarize(time)[0].vote);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Min, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 
     // layer became inactive
     time += MAX_ACTIVE_LAYER_PERIOD_NS.count();
-    ASSERT_TRUE(history().summarize(time).empty());
+    ASSERT_TRUE(summarize(time).empty());
     EXPECT_EQ(0, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
 }
@@ -267,14 +273,14 @@ TEST_F(LayerHistoryTestV2, oneLayerMaxVote) {
         time += LO_FPS_PERIOD;
     }
 
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Max, history().summarize(time)[0].vote);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Max, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 
     // layer became inactive
     time += MAX_ACTIVE_LAYER_PERIOD_NS.count();
-    ASSERT_TRUE(history().summarize(time).empty());
+    ASSERT_TRUE(summarize(time).empty());
     EXPECT_EQ(0, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
 }
@@ -295,18 +301,18 @@ TEST_F(LayerHistoryTestV2, oneLayerExplicitVote) {
         time += HI_FPS_PERIOD;
     }
 
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::ExplicitDefault, history().summarize(time)[0].vote);
-    EXPECT_FLOAT_EQ(73.4f, history().summarize(time)[0].desiredRefreshRate);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::ExplicitDefault, summarize(time)[0].vote);
+    EXPECT_FLOAT_EQ(73.4f, summarize(time)[0].desiredRefreshRate);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 
     // layer became inactive, but the vote stays
     setLayerInfoVote(layer.get(), LayerHistory::LayerVoteType::Heuristic);
     time += MAX_ACTIVE_LAYER_PERIOD_NS.count();
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::ExplicitDefault, history().summarize(time)[0].vote);
-    EXPECT_FLOAT_EQ(73.4f, history().summarize(time)[0].desiredRefreshRate);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::ExplicitDefault, summarize(time)[0].vote);
+    EXPECT_FLOAT_EQ(73.4f, summarize(time)[0].desiredRefreshRate);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
 }
@@ -327,20 +333,20 @@ TEST_F(LayerHistoryTestV2, oneLayerExplicitExactVote) {
         time += HI_FPS_PERIOD;
     }
 
-    ASSERT_EQ(1, history().summarize(time).size());
+    ASSERT_EQ(1, summarize(time).size());
     EXPECT_EQ(LayerHistory::LayerVoteType::ExplicitExactOrMultiple,
-              history().summarize(time)[0].vote);
-    EXPECT_FLOAT_EQ(73.4f, history().summarize(time)[0].desiredRefreshRate);
+              summarize(time)[0].vote);
+    EXPECT_FLOAT_EQ(73.4f, summarize(time)[0].desiredRefreshRate);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 
     // layer became inactive, but the vote stays
     setLayerInfoVote(layer.get(), LayerHistory::LayerVoteType::Heuristic);
     time += MAX_ACTIVE_LAYER_PERIOD_NS.count();
-    ASSERT_EQ(1, history().summarize(time).size());
+    ASSERT_EQ(1, summarize(time).size());
     EXPECT_EQ(LayerHistory::LayerVoteType::ExplicitExactOrMultiple,
-              history().summarize(time)[0].vote);
-    EXPECT_FLOAT_EQ(73.4f, history().summarize(time)[0].desiredRefreshRate);
+              summarize(time)[0].vote);
+    EXPECT_FLOAT_EQ(73.4f, summarize(time)[0].desiredRefreshRate);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
 }
@@ -371,7 +377,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
     for (int i = 0; i < PRESENT_TIME_HISTORY_SIZE; i++) {
         history().record(layer1.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
         time += MAX_FREQUENT_LAYER_PERIOD_NS.count();
-        summary = history().summarize(time);
+        summary = summarize(time);
     }
 
     ASSERT_EQ(1, summary.size());
@@ -383,7 +389,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
     for (int i = 0; i < PRESENT_TIME_HISTORY_SIZE; i++) {
         history().record(layer2.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
         time += HI_FPS_PERIOD;
-        summary = history().summarize(time);
+        summary = summarize(time);
     }
 
     // layer1 is still active but infrequent.
@@ -392,7 +398,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
     ASSERT_EQ(2, summary.size());
     EXPECT_EQ(LayerHistory::LayerVoteType::Min, summary[0].vote);
     ASSERT_EQ(LayerHistory::LayerVoteType::Heuristic, summary[1].vote);
-    EXPECT_FLOAT_EQ(HI_FPS, history().summarize(time)[1].desiredRefreshRate);
+    EXPECT_FLOAT_EQ(HI_FPS, summarize(time)[1].desiredRefreshRate);
     EXPECT_EQ(2, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 
@@ -401,7 +407,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
     for (int i = 0; i < 2 * PRESENT_TIME_HISTORY_SIZE; i++) {
         history().record(layer2.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
         time += LO_FPS_PERIOD;
-        summary = history().summarize(time);
+        summary = summarize(time);
     }
 
     ASSERT_EQ(1, summary.size());
@@ -420,7 +426,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
 
         history().record(layer3.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
         time += HI_FPS_PERIOD;
-        summary = history().summarize(time);
+        summary = summarize(time);
     }
 
     ASSERT_EQ(2, summary.size());
@@ -432,7 +438,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
 
     // layer3 becomes recently active.
     history().record(layer3.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
-    summary = history().summarize(time);
+    summary = summarize(time);
     ASSERT_EQ(2, summary.size());
     EXPECT_EQ(LayerHistory::LayerVoteType::Heuristic, summary[0].vote);
     EXPECT_FLOAT_EQ(LO_FPS, summary[0].desiredRefreshRate);
@@ -443,7 +449,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
 
     // layer1 expires.
     layer1.clear();
-    summary = history().summarize(time);
+    summary = summarize(time);
     ASSERT_EQ(2, summary.size());
     EXPECT_EQ(LayerHistory::LayerVoteType::Heuristic, summary[0].vote);
     EXPECT_EQ(LayerHistory::LayerVoteType::Heuristic, summary[0].vote);
@@ -459,7 +465,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
     for (int i = 0; i < PRESENT_TIME_HISTORY_SIZE; i++) {
         history().record(layer2.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
         time += LO_FPS_PERIOD;
-        summary = history().summarize(time);
+        summary = summarize(time);
     }
 
     ASSERT_EQ(1, summary.size());
@@ -470,7 +476,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
 
     // layer2 expires.
     layer2.clear();
-    summary = history().summarize(time);
+    summary = summarize(time);
     EXPECT_TRUE(summary.empty());
     EXPECT_EQ(1, layerCount());
     EXPECT_EQ(0, activeLayerCount());
@@ -480,7 +486,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
     for (int i = 0; i < PRESENT_TIME_HISTORY_SIZE + FREQUENT_LAYER_WINDOW_SIZE + 1; i++) {
         history().record(layer3.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
         time += HI_FPS_PERIOD;
-        summary = history().summarize(time);
+        summary = summarize(time);
     }
 
     ASSERT_EQ(1, summary.size());
@@ -492,7 +498,7 @@ TEST_F(LayerHistoryTestV2, multipleLayers) {
 
     // layer3 expires.
     layer3.clear();
-    summary = history().summarize(time);
+    summary = summarize(time);
     EXPECT_TRUE(summary.empty());
     EXPECT_EQ(0, layerCount());
     EXPECT_EQ(0, activeLayerCount());
@@ -513,8 +519,8 @@ TEST_F(LayerHistoryTestV2, inactiveLayers) {
         time += MAX_FREQUENT_LAYER_PERIOD_NS.count();
 
         EXPECT_EQ(1, layerCount());
-        ASSERT_EQ(1, history().summarize(time).size());
-        EXPECT_EQ(LayerHistory::LayerVoteType::Max, history().summarize(time)[0].vote);
+        ASSERT_EQ(1, summarize(time).size());
+        EXPECT_EQ(LayerHistory::LayerVoteType::Max, summarize(time)[0].vote);
         EXPECT_EQ(1, activeLayerCount());
         EXPECT_EQ(1, frequentLayerCount(time));
     }
@@ -524,8 +530,8 @@ TEST_F(LayerHistoryTestV2, inactiveLayers) {
     time += MAX_FREQUENT_LAYER_PERIOD_NS.count();
 
     EXPECT_EQ(1, layerCount());
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Min, history().summarize(time)[0].vote);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Min, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
 
@@ -538,8 +544,8 @@ TEST_F(LayerHistoryTestV2, inactiveLayers) {
         time += HI_FPS_PERIOD;
 
         EXPECT_EQ(1, layerCount());
-        ASSERT_EQ(1, history().summarize(time).size());
-        EXPECT_EQ(LayerHistory::LayerVoteType::Min, history().summarize(time)[0].vote);
+        ASSERT_EQ(1, summarize(time).size());
+        EXPECT_EQ(LayerHistory::LayerVoteType::Min, summarize(time)[0].vote);
         EXPECT_EQ(1, activeLayerCount());
         EXPECT_EQ(0, frequentLayerCount(time));
     }
@@ -549,8 +555,8 @@ TEST_F(LayerHistoryTestV2, inactiveLayers) {
     time += HI_FPS_PERIOD;
 
     EXPECT_EQ(1, layerCount());
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Max, history().summarize(time)[0].vote);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Max, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(1, frequentLayerCount(time));
 }
@@ -577,10 +583,10 @@ TEST_F(LayerHistoryTestV2, invisibleExplicitLayer) {
                      LayerHistory::LayerUpdateType::Buffer);
 
     EXPECT_EQ(2, layerCount());
-    ASSERT_EQ(1, history().summarize(time).size());
+    ASSERT_EQ(1, summarize(time).size());
     EXPECT_EQ(LayerHistory::LayerVoteType::ExplicitExactOrMultiple,
-              history().summarize(time)[0].vote);
-    EXPECT_FLOAT_EQ(60.0f, history().summarize(time)[0].desiredRefreshRate);
+              summarize(time)[0].vote);
+    EXPECT_FLOAT_EQ(60.0f, summarize(time)[0].desiredRefreshRate);
     EXPECT_EQ(2, activeLayerCount());
     EXPECT_EQ(2, frequentLayerCount(time));
 }
@@ -604,8 +610,8 @@ TEST_F(LayerHistoryTestV2, infrequentAnimatingLayer) {
         time += MAX_FREQUENT_LAYER_PERIOD_NS.count();
     }
 
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Min, history().summarize(time)[0].vote);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Min, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
     EXPECT_EQ(0, animatingLayerCount(time));
@@ -614,8 +620,8 @@ TEST_F(LayerHistoryTestV2, infrequentAnimatingLayer) {
     history().record(layer.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
     time += MAX_FREQUENT_LAYER_PERIOD_NS.count();
 
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Min, history().summarize(time)[0].vote);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Min, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
     EXPECT_EQ(0, animatingLayerCount(time));
@@ -624,8 +630,8 @@ TEST_F(LayerHistoryTestV2, infrequentAnimatingLayer) {
     history().record(layer.get(), time, time, LayerHistory::LayerUpdateType::AnimationTX);
     time += MAX_FREQUENT_LAYER_PERIOD_NS.count();
 
-    ASSERT_EQ(1, history().summarize(time).size());
-    EXPECT_EQ(LayerHistory::LayerVoteType::Max, history().summarize(time)[0].vote);
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Max, summarize(time)[0].vote);
     EXPECT_EQ(1, activeLayerCount());
     EXPECT_EQ(0, frequentLayerCount(time));
     EXPECT_EQ(1, animatingLayerCount(time));
@@ -671,6 +677,84 @@ TEST_F(LayerHistoryTestV2, heuristicLayerNotOscillating) {
     recordFramesAndExpect(layer, time, 27.10f, 30.0f, PRESENT_TIME_HISTORY_SIZE);
 }
 
+TEST_F(LayerHistoryTestV2, heuristicLayerWithoutPresentTimes) {
+    const auto layer = createLayer();
+    EXPECT_CALL(*layer, isVisible()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*layer, getFrameRateForLayerTree()).WillRepeatedly(Return(Layer::FrameRate()));
+
+    nsecs_t time = systemTime();
+    recordFramesAndExpect(layer, time, 60.0f, 60.0f, PRESENT_TIME_HISTORY_SIZE);
+
+    // Once present times are missing, the rate is calculated from queue times.
+    const nsecs_t framePeriod = static_cast<nsecs_t>(1e9f / 30.0f);
+    for (int i = 0; i < PRESENT_TIME_HISTORY_SIZE * 2; i++) {
+        history().record(layer.get(), 0, time, LayerHistory::LayerUpdateType::Buffer);
+        time += framePeriod;
+        summarize(time);
+    }
+
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Heuristic, summarize(time)[0].vote);
+    EXPECT_FLOAT_EQ(30.0f, summarize(time)[0].desiredRefreshRate);
+}
+
+TEST_F(LayerHistoryTestV2, heuristicLayerBecomesInfrequentWithoutUpdates) {
+    const auto layer = createLayer();
+    EXPECT_CALL(*layer, isVisible()).WillRepeatedly(Return(true));
+    EXPECT_CALL(*layer, getFrameRateForLayerTree()).WillRepeatedly(Return(Layer::FrameRate()));
+
+    nsecs_t time = systemTime();
+    recordFramesAndExpect(layer, time, 60.0f, 60.0f, PRESENT_TIME_HISTORY_SIZE);
+    const nsecs_t framePeriod = static_cast<nsecs_t>(1e9f / 60.0f);
+    const nsecs_t lastFrameTime = time - framePeriod;
+
+    // The vote stays the same until too few frames of the layer are recent for it to be
+    // frequent.
+    const auto recentFrames = static_cast<nsecs_t>(FREQUENT_LAYER_WINDOW_SIZE);
+    const nsecs_t oldestRecentFrameTime = lastFrameTime - framePeriod * (recentFrames - 1);
+    const nsecs_t infrequentTime = oldestRecentFrameTime + MAX_ACTIVE_LAYER_PERIOD_NS.count() + 1;
+    for (; time < infrequentTime; time += HI_FPS_PERIOD) {
+        ASSERT_EQ(1, summarize(time).size());
+        EXPECT_EQ(LayerHistory::LayerVoteType::Heuristic, summarize(time)[0].vote);
+        EXPECT_FLOAT_EQ(60.0f, summarize(time)[0].desiredRefreshRate);
+    }
+
+    time = infrequentTime;
+    ASSERT_EQ(1, summarize(time).size());
+    EXPECT_EQ(LayerHistory::LayerVoteType::Min, summarize(time)[0].vote);
+    EXPECT_EQ(0, frequentLayerCount(time));
+}
+
+TEST_F(LayerHistoryTestV2, summaryIsReused) {
+    const auto layer1 = createLayer("Layer1");
+    const auto layer2 = createLayer("Layer2");
+    for (const auto& layer : {layer1, layer2}) {
+        EXPECT_CALL(*layer, isVisible()).WillRepeatedly(Return(true));
+        EXPECT_CALL(*layer, getFrameRateForLayerTree())
+                .WillRepeatedly(Return(Layer::FrameRate()));
+    }
+
+    nsecs_t time = systemTime();
+    history().record(layer1.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
+    history().record(layer2.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
+
+    LayerHistory::Summary summary;
+    history().summarize(time, &summary);
+    ASSERT_EQ(2, summary.size());
+    const auto* const requirements = summary.data();
+
+    // Only the second layer stays active.
+    time += MAX_ACTIVE_LAYER_PERIOD_NS.count();
+    history().record(layer2.get(), time, time, LayerHistory::LayerUpdateType::Buffer);
+    time += HI_FPS_PERIOD;
+
+    history().summarize(time, &summary);
+    EXPECT_EQ(requirements, summary.data());
+    ASSERT_EQ(1, summary.size());
+    EXPECT_EQ("Layer2", summary[0].name);
+    EXPECT_EQ(LayerHistory::LayerVoteType::Max, summary[0].vote);
+}
+
 class LayerHistoryTestV2Parameterized
       : public LayerHistoryTestV2,
         public testing::WithParamInterface<std::chrono::nanoseconds> {};
@@ -714,13 +798,13 @@ TEST_P(LayerHistoryTestV2Parameterized, HeuristicLayerWithInfrequentLayer) {
         }
 
         if (time - startTime > PRESENT_TIME_HISTORY_DURATION.count()) {
-            ASSERT_NE(0, history().summarize(time).size());
-            ASSERT_GE(2, history().summarize(time).size());
+            ASSERT_NE(0, summarize(time).size());
+            ASSERT_GE(2, summarize(time).size());
 
             bool max = false;
             bool min = false;
             float heuristic = 0;
-            for (const auto& layer : history().summarize(time)) {
+            for (const auto& layer : summarize(time)) {
                 if (layer.vote == LayerHistory::LayerVoteType::Heuristic) {
                     heuristic = layer.desiredRefreshRate;
                 } else if (layer.vote == LayerHistory::LayerVoteType::Max) {
@@ -733,7 +817,7 @@ TEST_P(LayerHistoryTestV2Parameterized, HeuristicLayerWithInfrequentLayer) {
             if (infrequentLayerUpdates > FREQUENT_LAYER_WINDOW_SIZE) {
                 EXPECT_FLOAT_EQ(24.0f, heuristic);
                 EXPECT_FALSE(max);
-                if (history().summarize(time).size() == 2) {
+                if (summarize(time).size() == 2) {
                     EXPECT_TRUE(min);
                 }
             }
@@ -0,0 +1,80 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <gtest/gtest.h>
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include "Layer.h"
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic pop // ignored "-Wconversion"
+
+namespace android {
+namespace {
+
+using State = Layer::State;
+
+// A state with the fields that allocate when copied filled in, as for a
+// window with input.
+State makeWindowState() {
+    State state{};
+    auto& inputInfo = state.inputInfo.edit();
+    inputInfo.name = "com.example.app/com.example.app.MainActivity#0";
+    inputInfo.touchableRegion = Region(Rect(0, 0, 1080, 100)).merge(Rect(0, 200, 1080, 2000));
+    auto& metadata = state.metadata.edit();
+    metadata.setInt32(METADATA_WINDOW_TYPE, InputWindowInfo::TYPE_APPLICATION);
+    metadata.setInt32(METADATA_OWNER_UID, 10100);
+    metadata.setInt32(METADATA_TASK_ID, 42);
+    state.hdrMetadata.edit().hdr10plus.assign(64, 0xff);
+    return state;
+}
+
+TEST(LayerStateTest, copiesShareBlocksUntilEdited) {
+    const State current = makeWindowState();
+    State drawing = current;
+    EXPECT_TRUE(drawing.inputInfo.shares(current.inputInfo));
+    EXPECT_TRUE(drawing.metadata.shares(current.metadata));
+    EXPECT_TRUE(drawing.hdrMetadata.shares(current.hdrMetadata));
+
+    drawing.inputInfo.edit().name = "renamed";
+    EXPECT_FALSE(drawing.inputInfo.shares(current.inputInfo));
+    EXPECT_EQ("renamed", drawing.inputInfo->name);
+    EXPECT_EQ("com.example.app/com.example.app.MainActivity#0", current.inputInfo->name);
+
+    // Other blocks are still shared.
+    EXPECT_TRUE(drawing.metadata.shares(current.metadata));
+    EXPECT_TRUE(drawing.hdrMetadata.shares(current.hdrMetadata));
+}
+
+TEST(LayerStateTest, assignmentReplacesValue) {
+    State state = makeWindowState();
+    const State copy = state;
+
+    LayerMetadata metadata;
+    metadata.setInt32(METADATA_OWNER_UID, 1000);
+    state.metadata = metadata;
+
+    EXPECT_EQ(1000, state.metadata->getInt32(METADATA_OWNER_UID, 0));
+    EXPECT_EQ(10100, copy.metadata->getInt32(METADATA_OWNER_UID, 0));
+}
+
+} // namespace
+} // namespace android
@@ -0,0 +1,244 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "LibSurfaceFlingerUnittests"
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <gui/LayerMetadata.h>
+
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wconversion"
+#include "EffectLayer.h"
+#include "Layer.h"
+// TODO(b/129481165): remove the #pragma below and fix conversion issues
+#pragma clang diagnostic pop // ignored "-Wconversion"
+#include "TestableSurfaceFlinger.h"
+#include "mock/DisplayHardware/MockComposer.h"
+#include "mock/MockDispSync.h"
+#include "mock/MockEventControlThread.h"
+#include "mock/MockEventThread.h"
+
+namespace android {
+
+using testing::_;
+using testing::Mock;
+using testing::Return;
+
+using FakeHwcDisplayInjector = TestableSurfaceFlinger::FakeHwcDisplayInjector;
+
+/**
+ * Checks the Z order snapshot of the drawing state against the traversal of
+ * the layer tree it flattens.
+ */
+class LayerZOrderTraversalTest : public testing::Test {
+protected:
+    static constexpr uint32_t WIDTH = 100;
+    static constexpr uint32_t HEIGHT = 100;
+    static constexpr uint32_t LAYER_FLAGS = 0;
+
+    LayerZOrderTraversalTest();
+    ~LayerZOrderTraversalTest() override;
+
+    void setupScheduler();
+    void setupComposer(uint32_t virtualDisplayCount);
+
+    sp<Layer> createLayer(Layer* parent, int32_t z);
+    void setRelativeLayer(Layer* layer, Layer* relative, int32_t z);
+    // Builds |rootCount| trees, each a chain of |depth| layers with leaves on
+    // both sides, and makes every |relativeStride|th leaf relative to a layer
+    // in the chain of the next tree.
+    void createHierarchy(size_t rootCount, size_t depth, size_t relativeStride);
+    void commitTransaction();
+
+    std::vector<Layer*> traverseTree(bool reverse);
+    std::vector<Layer*> traverseState(bool reverse);
+
+    TestableSurfaceFlinger mFlinger;
+    Hwc2::mock::Composer* mComposer = nullptr;
+
+    std::vector<sp<Layer>> mRoots;
+    std::vector<sp<Layer>> mLayers;
+};
+
+LayerZOrderTraversalTest::LayerZOrderTraversalTest() {
+    const ::testing::TestInfo* const test_info =
+            ::testing::UnitTest::GetInstance()->current_test_info();
+    ALOGD("**** Setting up for %s.%s\n", test_info->test_case_name(), test_info->name());
+
+    setupScheduler();
+    setupComposer(0);
+}
+
+LayerZOrderTraversalTest::~LayerZOrderTraversalTest() {
+    mFlinger.mutableCurrentState().layersSortedByZ.clear();
+    mFlinger.mutableDrawingState().layersSortedByZ.clear();
+
+    const ::testing::TestInfo* const test_info =
+            ::testing::UnitTest::GetInstance()->current_test_info();
+    ALOGD("**** Tearing down after %s.%s\n", test_info->test_case_name(), test_info->name());
+}
+
+void LayerZOrderTraversalTest::setupScheduler() {
+    auto eventThread = std::make_unique<mock::EventThread>();
+    auto sfEventThread = std::make_unique<mock::EventThread>();
+
+    EXPECT_CALL(*eventThread, registerDisplayEventConnection(_));
+    EXPECT_CALL(*eventThread, createEventConnection(_, _))
+            .WillOnce(Return(new EventThreadConnection(eventThread.get(), ResyncCallback(),
+                                                       ISurfaceComposer::eConfigChangedSuppress)));
+
+    EXPECT_CALL(*sfEventThread, registerDisplayEventConnection(_));
+    EXPECT_CALL(*sfEventThread, createEventConnection(_, _))
+            .WillOnce(Return(new EventThreadConnection(sfEventThread.get(), ResyncCallback(),
+                                                       ISurfaceComposer::eConfigChangedSuppress)));
+
+    auto primaryDispSync = std::make_unique<mock::DispSync>();
+
+    EXPECT_CALL(*primaryDispSync, computeNextRefresh(0, _)).WillRepeatedly(Return(0));
+    EXPECT_CALL(*primaryDispSync, getPeriod())
+            .WillRepeatedly(Return(FakeHwcDisplayInjector::DEFAULT_REFRESH_RATE));
+    EXPECT_CALL(*primaryDispSync, expectedPresentTime(_)).WillRepeatedly(Return(0));
+    mFlinger.setupScheduler(std::move(primaryDispSync),
+                            std::make_unique<mock::EventControlThread>(), std::move(eventThread),
+                            std::move(sfEventThread));
+}
+
+void LayerZOrderTraversalTest::setupComposer(uint32_t virtualDisplayCount) {
+    mComposer = new Hwc2::mock::Composer();
+    EXPECT_CALL(*mComposer, getMaxVirtualDisplayCount()).WillOnce(Return(virtualDisplayCount));
+    mFlinger.setupComposer(std::unique_ptr<Hwc2::Composer>(mComposer));
+
+    Mock::VerifyAndClear(mComposer);
+}
+
+sp<Layer> LayerZOrderTraversalTest::createLayer(Layer* parent, int32_t z) {
+    sp<Client> client;
+    LayerCreationArgs args(mFlinger.flinger(), client, "color-layer", WIDTH, HEIGHT, LAYER_FLAGS,
+                           LayerMetadata());
+    sp<Layer> layer = new EffectLayer(args);
+    layer->setLayer(z);
+    if (parent) {
+        parent->addChild(layer);
+    } else {
+        mRoots.push_back(layer);
+    }
+    mLayers.push_back(layer);
+    return layer;
+}
+
+void LayerZOrderTraversalTest::setRelativeLayer(Layer* layer, Layer* relative, int32_t z) {
+    // Keep the children of the parent sorted, as SurfaceFlinger does.
+    layer->getParent()->setChildLayer(layer, z);
+    layer->setZOrderRelativeOf(relative);
+    relative->addZOrderRelative(layer);
+}
+
+void LayerZOrderTraversalTest::createHierarchy(size_t rootCount, size_t depth,
+                                              size_t relativeStride) {
+    std::vector<std::vector<Layer*>> chains(rootCount);
+    std::vector<std::vector<Layer*>> leaves(rootCount);
+    for (size_t root = 0; root < rootCount; root++) {
+        Layer* parent = createLayer(nullptr, static_cast<int32_t>(root)).get();
+        for (size_t level = 0; level < depth; level++) {
+            chains[root].push_back(parent);
+            for (int32_t z = -2; z < 2; z++) {
+                leaves[root].push_back(createLayer(parent, z).get());
+            }
+            parent = createLayer(parent, 2).get();
+        }
+    }
+
+    if (relativeStride == 0) return;
+    // Only leaves are made relative, and only to chains, so there are no cycles.
+    for (size_t root = 0; root < rootCount; root++) {
+        const auto& chain = chains[(root + 1) % rootCount];
+        for (size_t i = 0; i < leaves[root].size(); i += relativeStride) {
+            setRelativeLayer(leaves[root][i], chain[i % chain.size()], i % 2 ? 1 : -1);
+        }
+    }
+}
+
+void LayerZOrderTraversalTest::commitTransaction() {
+    for (const auto& layer : mLayers) {
+        layer->commitTransaction(layer->getCurrentState());
+    }
+    for (const auto& root : mRoots) {
+        root->commitChildList();
+        mFlinger.mutableCurrentState().layersSortedByZ.add(root);
+        mFlinger.mutableDrawingState().layersSortedByZ.add(root);
+    }
+}
+
+std::vector<Layer*> LayerZOrderTraversalTest::traverseTree(bool reverse) {
+    std::vector<Layer*> layers;
+    const auto& state = mFlinger.mutableDrawingState();
+    const auto visitor = [&](Layer* layer) { layers.push_back(layer); };
+    if (reverse) {
+        state.layersSortedByZ.traverseInReverseZOrder(state.stateSet, visitor);
+    } else {
+        state.layersSortedByZ.traverseInZOrder(state.stateSet, visitor);
+    }
+    return layers;
+}
+
+std::vector<Layer*> LayerZOrderTraversalTest::traverseState(bool reverse) {
+    std::vector<Layer*> layers;
+    const auto& state = mFlinger.mutableDrawingState();
+    const auto visitor = [&](Layer* layer) { layers.push_back(layer); };
+    if (reverse) {
+        state.traverseInReverseZOrder(visitor);
+    } else {
+        state.traverseInZOrder(visitor);
+    }
+    return layers;
+}
+
+namespace {
+
+TEST_F(LayerZOrderTraversalTest, snapshotMatchesTreeTraversal) {
+    createHierarchy(/*rootCount=*/3, /*depth=*/5, /*relativeStride=*/4);
+    commitTransaction();
+
+    const auto inZOrder = traverseTree(false);
+    const auto inReverseZOrder = traverseTree(true);
+    // Layers relative to another tree are still visited exactly once.
+    EXPECT_EQ(mLayers.size(), inZOrder.size());
+
+    mFlinger.mutableDrawingState().updateZOrderSnapshot();
+    EXPECT_EQ(inZOrder, traverseState(false));
+    EXPECT_EQ(inReverseZOrder, traverseState(true));
+}
+
+TEST_F(LayerZOrderTraversalTest, commitReportsHierarchyChanges) {
+    createHierarchy(/*rootCount=*/1, /*depth=*/2, /*relativeStride=*/0);
+    commitTransaction();
+    EXPECT_FALSE(mRoots[0]->commitChildList());
+
+    // Also reported for changes further down the tree.
+    const sp<Layer> deepest = mLayers.back();
+    const sp<Layer> child = createLayer(deepest.get(), 5);
+    EXPECT_TRUE(mRoots[0]->commitChildList());
+    EXPECT_FALSE(mRoots[0]->commitChildList());
+
+    deepest->removeChild(child);
+    EXPECT_TRUE(mRoots[0]->commitChildList());
+}
+
+} // namespace
+} // namespace android
@@ -20,6 +20,8 @@
 #include <gtest/gtest.h>
 #include <utils/Log.h>
 
+#include <thread>
+
 #include "AsyncCallRecorder.h"
 #include "Scheduler/OneShotTimer.h"
 
@@ -206,6 +208,100 @@ TEST_F(OneShotTimerTest, noCallbacksAfterStopTest) {
     EXPECT_FALSE(mResetTimerCallback.waitForCall().has_value());
 }
 
+TEST_F(OneShotTimerTest, resetWhileWaitingDoesNotWakeServiceTest) {
+    TimerService service;
+    mIdleTimer = std::make_unique<scheduler::OneShotTimer>(1s, mResetTimerCallback.getInvocable(),
+                                                           mExpiredTimerCallback.getInvocable(),
+                                                           service);
+    mIdleTimer->start();
+    EXPECT_TRUE(mResetTimerCallback.waitForCall().has_value());
+    // Let the service go back to waiting after firing the reset callback.
+    EXPECT_FALSE(mExpiredTimerCallback.waitForCall(waitTimeForUnexpected3msCallback).has_value());
+
+    const size_t wakeups = service.getWakeupCount();
+    for (int i = 0; i < 100; i++) {
+        mIdleTimer->reset();
+    }
+    EXPECT_FALSE(mResetTimerCallback.waitForCall(waitTimeForUnexpected3msCallback).has_value());
+    EXPECT_EQ(wakeups, service.getWakeupCount());
+    mIdleTimer->stop();
+}
+
+TEST_F(OneShotTimerTest, timersShareServiceTest) {
+    TimerService service;
+    AsyncCallRecorder<void (*)()> otherExpiredTimerCallback;
+    mIdleTimer = std::make_unique<scheduler::OneShotTimer>(3ms, mResetTimerCallback.getInvocable(),
+                                                           mExpiredTimerCallback.getInvocable(),
+                                                           service);
+    OneShotTimer otherTimer(
+            20ms, [] {}, otherExpiredTimerCallback.getInvocable(), service);
+    mIdleTimer->start();
+    otherTimer.start();
+    EXPECT_TRUE(mResetTimerCallback.waitForCall().has_value());
+
+    EXPECT_TRUE(mExpiredTimerCallback.waitForCall(waitTimeForExpected3msCallback).has_value());
+    EXPECT_TRUE(otherExpiredTimerCallback.waitForCall(waitTimeForExpected3msCallback + 20ms)
+                        .has_value());
+
+    // Stopping one timer leaves the other one running.
+    otherTimer.stop();
+    mIdleTimer->reset();
+    EXPECT_TRUE(mResetTimerCallback.waitForCall().has_value());
+    EXPECT_TRUE(mExpiredTimerCallback.waitForCall(waitTimeForExpected3msCallback).has_value());
+    EXPECT_FALSE(otherExpiredTimerCallback.waitForCall(0ms).has_value());
+    mIdleTimer->stop();
+}
+
+TEST_F(OneShotTimerTest, stopFromCallbackTest) {
+    mIdleTimer = std::make_unique<scheduler::OneShotTimer>(3ms, mResetTimerCallback.getInvocable(),
+                                                           [this] {
+                                                               mIdleTimer->stop();
+                                                               mExpiredTimerCallback.recordCall();
+                                                           });
+    mIdleTimer->start();
+    EXPECT_TRUE(mResetTimerCallback.waitForCall().has_value());
+    EXPECT_TRUE(mExpiredTimerCallback.waitForCall(waitTimeForExpected3msCallback).has_value());
+
+    mIdleTimer->reset();
+    EXPECT_FALSE(mResetTimerCallback.waitForCall(waitTimeForUnexpected3msCallback).has_value());
+}
+
+// Resets come in at the rate of touch events on a 240Hz panel, and should never
+// wake up the service before the timer expires. The cost of a reset is
+// measured by libsurfaceflinger_benchmarks.
+TEST_F(OneShotTimerTest, touchResetsDoNotWakeUpService) {
+    using Clock = std::chrono::steady_clock;
+    constexpr auto kInterval = 100ms;
+    constexpr auto kTouchPeriod = std::chrono::microseconds(1000000 / 240);
+    constexpr auto kDuration = 500ms;
+
+    TimerService service;
+    mIdleTimer = std::make_unique<scheduler::OneShotTimer>(kInterval,
+                                                           mResetTimerCallback.getInvocable(),
+                                                           mExpiredTimerCallback.getInvocable(),
+                                                           service);
+    mIdleTimer->start();
+    EXPECT_TRUE(mResetTimerCallback.waitForCall().has_value());
+    // Resets are merged with the reset callback until it returns, so don't
+    // count those.
+    EXPECT_FALSE(mExpiredTimerCallback.waitForCall(waitTimeForUnexpected3msCallback).has_value());
+
+    // Each wakeup of the service is a context switch to its thread.
+    const size_t wakeups = service.getWakeupCount();
+    const auto start = Clock::now();
+    for (auto next = start; next < start + kDuration; next += kTouchPeriod) {
+        std::this_thread::sleep_until(next);
+        mIdleTimer->reset();
+    }
+    const auto elapsed = Clock::now() - start;
+    const size_t touchWakeups = service.getWakeupCount() - wakeups;
+    mIdleTimer->stop();
+
+    // The service only wakes up when the deadline it knows of passes.
+    EXPECT_LE(touchWakeups, static_cast<size_t>(elapsed / kInterval) + 1);
+    EXPECT_FALSE(mExpiredTimerCallback.waitForCall(0ms).has_value());
+}
+
 } // namespace
 } // namespace scheduler
 } // namespace android
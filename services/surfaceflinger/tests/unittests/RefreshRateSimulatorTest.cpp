@@ -0,0 +1,618 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "RefreshRateSimulatorTest"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <dirent.h>
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include <log/log.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <memory>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Scheduler/LayerHistory.h"
+#include "Scheduler/LayerInfoV2.h"
+#include "Scheduler/RefreshRateConfigs.h"
+
+using namespace std::chrono_literals;
+
+namespace android::scheduler {
+namespace {
+
+using LayerUpdateType = LayerHistory::LayerUpdateType;
+using LayerVoteType = LayerHistory::LayerVoteType;
+using RefreshRate = RefreshRateConfigs::RefreshRate;
+
+constexpr nsecs_t toNs(std::chrono::nanoseconds duration) {
+    return duration.count();
+}
+
+// The vote a layer sets through setFrameRate(), with its compatibility already
+// mapped to a vote type as LayerHistoryV2 does. A zero rate means no vote,
+// unless the type is NoVote.
+struct FrameRate {
+    float rate = 0.f;
+    LayerVoteType type = LayerVoteType::ExplicitDefault;
+};
+
+/*
+ * Timestamped layer updates and touches, replayed by the simulator below. They
+ * are either generated, or parsed from a recording.
+ */
+struct Trace {
+    struct TraceLayer {
+        std::string name;
+        FrameRate frameRate;
+        // The fraction of the display the layer covers. Nothing is composed,
+        // so this stands in for the weight derived from the layer bounds.
+        float coverage = 1.f;
+    };
+
+    struct Event {
+        nsecs_t time;
+        // Index into |layers|, or kTouch.
+        size_t layer;
+        LayerUpdateType type;
+    };
+
+    static constexpr size_t kTouch = std::numeric_limits<size_t>::max();
+
+    std::vector<TraceLayer> layers;
+    std::vector<Event> events;
+    nsecs_t end = 0;
+
+    size_t addLayer(std::string name, FrameRate frameRate = {}, float coverage = 1.f) {
+        layers.push_back({std::move(name), frameRate, coverage});
+        return layers.size() - 1;
+    }
+
+    size_t findOrAddLayer(const std::string& name) {
+        const auto it = std::find_if(layers.begin(), layers.end(),
+                                     [&](const TraceLayer& layer) { return layer.name == name; });
+        return it != layers.end() ? static_cast<size_t>(it - layers.begin()) : addLayer(name);
+    }
+
+    void addEvent(nsecs_t time, size_t layer, LayerUpdateType type) {
+        events.push_back({time, layer, type});
+        end = std::max(end, time);
+    }
+
+    // Buffers queued at |fps| in [begin, end), each moved by up to |maxJitter|.
+    void addFrames(size_t layer, float fps, nsecs_t begin, nsecs_t end, nsecs_t maxJitter = 0,
+                   uint32_t seed = 0) {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<nsecs_t> jitter(-maxJitter, maxJitter);
+        const double period = 1e9 / fps;
+        for (int64_t i = 0;; i++) {
+            const nsecs_t time = begin + static_cast<nsecs_t>(static_cast<double>(i) * period);
+            if (time >= end) break;
+            addEvent(time + jitter(generator), layer, LayerUpdateType::Buffer);
+        }
+    }
+
+    void addTouches(nsecs_t begin, nsecs_t end, nsecs_t interval) {
+        for (nsecs_t time = begin; time < end; time += interval) {
+            addEvent(time, kTouch, LayerUpdateType::Buffer);
+        }
+    }
+
+    // Parses one update per line, as "<time ns> buffer|animation|setframerate
+    // <layer name>" or "<time ns> touch". Blank lines and lines starting with
+    // '#' are skipped.
+    static std::optional<Trace> parse(const std::string& text) {
+        Trace trace;
+        std::istringstream lines(text);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (line.empty() || line[0] == '#') continue;
+
+            std::istringstream fields(line);
+            nsecs_t time;
+            std::string type;
+            if (!(fields >> time >> type)) return std::nullopt;
+
+            if (type == "touch") {
+                trace.addEvent(time, kTouch, LayerUpdateType::Buffer);
+                continue;
+            }
+
+            std::string name;
+            std::getline(fields >> std::ws, name);
+            if (name.empty()) return std::nullopt;
+            const size_t layer = trace.findOrAddLayer(name);
+            if (type == "buffer") {
+                trace.addEvent(time, layer, LayerUpdateType::Buffer);
+            } else if (type == "animation") {
+                trace.addEvent(time, layer, LayerUpdateType::AnimationTX);
+            } else if (type == "setframerate") {
+                trace.addEvent(time, layer, LayerUpdateType::SetFrameRate);
+            } else {
+                return std::nullopt;
+            }
+        }
+        return trace;
+    }
+
+    // Adds the buffers of a layer from the output of "dumpsys SurfaceFlinger
+    // --latency <layer>": the refresh period, then the desired present, actual
+    // present and frame ready times of each frame.
+    bool addLatencyDump(size_t layer, const std::string& dump) {
+        std::istringstream lines(dump);
+        std::string line;
+        if (!std::getline(lines, line)) return false;
+
+        while (std::getline(lines, line)) {
+            std::istringstream fields(line);
+            nsecs_t desiredPresent, actualPresent, frameReady;
+            if (!(fields >> desiredPresent >> actualPresent >> frameReady)) continue;
+            // Records which were never used. Frames whose present fence hasn't
+            // signaled yet were still queued, so they are kept.
+            if (desiredPresent == 0) continue;
+            addEvent(desiredPresent, layer, LayerUpdateType::Buffer);
+        }
+        return true;
+    }
+};
+
+struct SimulationOptions {
+    // As with the sysprops of the scheduler timers, zero disables them.
+    nsecs_t idleTimeout = 0;
+    nsecs_t touchTimeout = 0;
+    // Switches this soon after the previous one count as rapid.
+    nsecs_t minSwitchInterval = toNs(500ms);
+};
+
+struct SimulationReport {
+    size_t frames = 0;
+    size_t switches = 0;
+    size_t rapidSwitches = 0;
+    // Frames which don't land a whole number of vsyncs after the previous frame
+    // of their layer, so that frames are shown for uneven durations.
+    size_t cadenceMismatchFrames = 0;
+    // Frames which come less than a vsync after the previous frame of their
+    // layer, i.e. content faster than the display, so that either this frame
+    // or the previous one is never shown.
+    size_t fasterThanVsyncFrames = 0;
+
+    nsecs_t duration = 0;
+    std::map<HwcConfigIndexType, nsecs_t> timeAtConfig;
+    HwcConfigIndexType finalConfigId;
+
+    float fractionAt(HwcConfigIndexType configId) const {
+        const auto it = timeAtConfig.find(configId);
+        return it == timeAtConfig.end() || duration == 0
+                ? 0.f
+                : static_cast<float>(it->second) / static_cast<float>(duration);
+    }
+
+    std::string dump(const RefreshRateConfigs& configs) const {
+        std::string result;
+        base::StringAppendF(&result,
+                            "%zu frames, %zu switches (%zu rapid), %zu cadence mismatches, "
+                            "%zu faster than vsync, final %s\n",
+                            frames, switches, rapidSwitches, cadenceMismatchFrames,
+                            fasterThanVsyncFrames,
+                            configs.getRefreshRateFromConfigId(finalConfigId).getName().c_str());
+        for (const auto& [configId, time] : timeAtConfig) {
+            base::StringAppendF(&result, "  %s: %.3f s (%.1f%%)\n",
+                                configs.getRefreshRateFromConfigId(configId).getName().c_str(),
+                                static_cast<double>(time) / 1e9, 100.f * fractionAt(configId));
+        }
+        return result;
+    }
+};
+
+// The recording at |path|, or the recordings in the directory at |path|, in
+// order of their names.
+std::vector<std::string> findRecordings(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return {};
+    if (!S_ISDIR(st.st_mode)) return {path};
+
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
+    if (!dir) return {};
+
+    std::vector<std::string> recordings;
+    while (const dirent* entry = readdir(dir.get())) {
+        std::string file = path + '/' + entry->d_name;
+        if (stat(file.c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            recordings.push_back(std::move(file));
+        }
+    }
+    std::sort(recordings.begin(), recordings.end());
+    return recordings;
+}
+
+// Parses a comma separated list of refresh rates, such as "60,90,120".
+std::optional<std::vector<float>> parseRefreshRates(const std::string& list) {
+    std::vector<float> refreshRates;
+    for (const auto& field : base::Split(list, ",")) {
+        char* end;
+        const float refreshRate = std::strtof(field.c_str(), &end);
+        if (field.empty() || *end != '\0' || !(refreshRate > 0.f)) return std::nullopt;
+        refreshRates.push_back(refreshRate);
+    }
+    return refreshRates;
+}
+
+class RefreshRateSimulatorTest : public testing::Test {
+protected:
+    static constexpr float LO_FPS = 60.f;
+    static constexpr auto LO_FPS_PERIOD = static_cast<nsecs_t>(1e9f / LO_FPS);
+    static inline const HwcConfigIndexType HWC_CONFIG_ID_60 = HwcConfigIndexType(0);
+
+    static constexpr float HI_FPS = 90.f;
+    static constexpr auto HI_FPS_PERIOD = static_cast<nsecs_t>(1e9f / HI_FPS);
+    static inline const HwcConfigIndexType HWC_CONFIG_ID_90 = HwcConfigIndexType(1);
+
+    // Longer gaps between frames are pauses of the content rather than part of
+    // its cadence.
+    static constexpr nsecs_t MAX_FRAME_INTERVAL = toNs(100ms);
+
+    RefreshRateSimulatorTest() { setRefreshRates({LO_FPS, HI_FPS}); }
+
+    RefreshRateConfigs& configs() { return *mConfigs; }
+
+    // Replaces the display with one which has a config per rate, in order,
+    // starting at the first.
+    void setRefreshRates(const std::vector<float>& refreshRates);
+
+    // Replays |trace| one vsync at a time, at the refresh rate selected at the
+    // previous vsync, as the scheduler does when layers are updated.
+    SimulationReport simulate(const Trace& trace, const SimulationOptions& options = {});
+
+    HWC2::Display mDisplay;
+    std::unique_ptr<RefreshRateConfigs> mConfigs;
+};
+
+void RefreshRateSimulatorTest::setRefreshRates(const std::vector<float>& refreshRates) {
+    std::vector<std::shared_ptr<const HWC2::Display::Config>> displayConfigs;
+    for (size_t i = 0; i < refreshRates.size(); i++) {
+        displayConfigs.push_back(
+                HWC2::Display::Config::Builder(mDisplay, static_cast<uint32_t>(i))
+                        .setVsyncPeriod(static_cast<int32_t>(1e9f / refreshRates[i]))
+                        .setConfigGroup(0)
+                        .build());
+    }
+
+    mConfigs = std::make_unique<RefreshRateConfigs>(displayConfigs, HwcConfigIndexType(0));
+    LayerInfoV2::setRefreshRateConfigs(*mConfigs);
+}
+
+SimulationReport RefreshRateSimulatorTest::simulate(const Trace& trace,
+                                                    const SimulationOptions& options) {
+    // LayerHistoryV2 needs a Layer, and so the rest of SurfaceFlinger, for
+    // each of its layers. The simulator keeps the LayerInfoV2 of each layer
+    // itself instead, and mirrors how LayerHistoryV2 activates, votes for and
+    // summarizes them. The layers are all visible and unfocused, as are
+    // layers without a frame rate selection priority.
+    struct SimulatedLayer {
+        std::unique_ptr<LayerInfoV2> info;
+        bool active = false;
+    };
+
+    const auto highRefreshRatePeriod =
+            static_cast<nsecs_t>(1e9f / mConfigs->getMaxRefreshRate().getFps());
+    std::vector<SimulatedLayer> layers;
+    for (const auto& traceLayer : trace.layers) {
+        layers.push_back({std::make_unique<LayerInfoV2>(traceLayer.name, highRefreshRatePeriod,
+                                                        LayerVoteType::Heuristic)});
+    }
+
+    auto events = trace.events;
+    std::stable_sort(events.begin(), events.end(),
+                     [](const auto& lhs, const auto& rhs) { return lhs.time < rhs.time; });
+
+    SimulationReport report;
+    const RefreshRate* current = &mConfigs->getCurrentRefreshRate();
+    std::vector<std::optional<nsecs_t>> lastFrameTimes(layers.size());
+    std::optional<nsecs_t> lastTouch;
+    std::optional<nsecs_t> lastSwitch;
+
+    const nsecs_t begin = events.empty() ? 0 : events.front().time;
+    nsecs_t lastUpdate = begin;
+    auto next = events.begin();
+    for (nsecs_t now = begin; now <= trace.end;) {
+        const nsecs_t period = current->getVsyncPeriod();
+        for (; next != events.end() && next->time <= now; ++next) {
+            if (next->layer == Trace::kTouch) {
+                lastTouch = next->time;
+                continue;
+            }
+
+            auto& layer = layers[next->layer];
+            layer.info->setLastPresentTime(next->time, now, next->type,
+                                           /*pendingConfigChange*/ false);
+            layer.active = true;
+            lastUpdate = now;
+            if (next->type != LayerUpdateType::Buffer) continue;
+
+            report.frames++;
+            auto& lastFrameTime = lastFrameTimes[next->layer];
+            if (lastFrameTime && next->time - *lastFrameTime <= MAX_FRAME_INTERVAL) {
+                constexpr nsecs_t margin = RefreshRateConfigs::MARGIN_FOR_PERIOD_CALCULATION;
+                const nsecs_t interval = next->time - *lastFrameTime;
+                const nsecs_t remainder = interval % period;
+                if (interval < period - margin) {
+                    report.fasterThanVsyncFrames++;
+                } else if (remainder > margin && period - remainder > margin) {
+                    report.cadenceMismatchFrames++;
+                }
+            }
+            lastFrameTime = next->time;
+        }
+
+        RefreshRateConfigs::GlobalSignals signals;
+        signals.touch = options.touchTimeout > 0 && lastTouch &&
+                now - *lastTouch < options.touchTimeout;
+        signals.idle = options.idleTimeout > 0 && now - lastUpdate >= options.idleTimeout;
+
+        LayerHistory::Summary summary;
+        const nsecs_t threshold = getActiveLayerThreshold(now);
+        for (size_t i = 0; i < layers.size(); i++) {
+            auto& layer = layers[i];
+            if (!layer.active) continue;
+
+            const auto& [name, frameRate, coverage] = trace.layers[i];
+            if (frameRate.rate <= 0 && layer.info->getLastUpdatedTime() < threshold) {
+                layer.info->onLayerInactive(now);
+                layer.active = false;
+                continue;
+            }
+
+            if (frameRate.rate > 0 || frameRate.type == LayerVoteType::NoVote) {
+                layer.info->setLayerVote(frameRate.type, frameRate.rate);
+            } else {
+                layer.info->resetLayerVote();
+            }
+
+            const auto [type, refreshRate] = layer.info->getRefreshRate(now);
+            if (type == LayerVoteType::NoVote) continue;
+            summary.push_back({name, type, refreshRate, coverage, /*focused*/ false});
+        }
+
+        const RefreshRate& best = mConfigs->getBestRefreshRate(summary, signals);
+        if (best.getConfigId() != current->getConfigId()) {
+            report.switches++;
+            if (lastSwitch && now - *lastSwitch < options.minSwitchInterval) {
+                report.rapidSwitches++;
+            }
+            lastSwitch = now;
+            mConfigs->setCurrentConfigId(best.getConfigId());
+            current = &best;
+        }
+
+        const nsecs_t vsyncPeriod = current->getVsyncPeriod();
+        report.timeAtConfig[current->getConfigId()] += vsyncPeriod;
+        report.duration += vsyncPeriod;
+        now += vsyncPeriod;
+    }
+    report.finalConfigId = current->getConfigId();
+    return report;
+}
+
+TEST_F(RefreshRateSimulatorTest, videoSettlesOnMatchingRate) {
+    Trace trace;
+    const auto video = trace.addLayer("Video");
+    trace.addFrames(video, 30.f, 0, toNs(10s));
+
+    const auto report = simulate(trace);
+
+    // Max is voted for the first couple of seconds, until there is enough
+    // history, then 60 Hz fits 30 fps.
+    EXPECT_LE(report.switches, 2u);
+    EXPECT_EQ(0u, report.rapidSwitches);
+    EXPECT_EQ(HWC_CONFIG_ID_60, report.finalConfigId);
+    EXPECT_GE(report.fractionAt(HWC_CONFIG_ID_60), 0.7f);
+    EXPECT_EQ(0u, report.cadenceMismatchFrames);
+    EXPECT_EQ(0u, report.fasterThanVsyncFrames);
+}
+
+TEST_F(RefreshRateSimulatorTest, fastContentStaysOnHighRate) {
+    Trace trace;
+    const auto scroll = trace.addLayer("Scroll");
+    trace.addFrames(scroll, HI_FPS, 0, toNs(3s));
+
+    const auto report = simulate(trace);
+
+    EXPECT_EQ(1u, report.switches);
+    EXPECT_EQ(HWC_CONFIG_ID_90, report.finalConfigId);
+    EXPECT_GE(report.fractionAt(HWC_CONFIG_ID_90), 0.99f);
+    EXPECT_EQ(0u, report.fasterThanVsyncFrames);
+}
+
+TEST_F(RefreshRateSimulatorTest, explicitVoteWithoutMatchingRateJudders) {
+    Trace trace;
+    const FrameRate frameRate = {24.f, LayerVoteType::ExplicitExactOrMultiple};
+    const auto video = trace.addLayer("Video", frameRate);
+    trace.addFrames(video, 24.f, 0, toNs(3s));
+
+    const auto report = simulate(trace);
+
+    // Neither rate is a multiple of 24 fps, and 60 Hz fits best. Every frame
+    // after the first is then shown for either two or three vsyncs.
+    EXPECT_EQ(0u, report.switches);
+    EXPECT_EQ(HWC_CONFIG_ID_60, report.finalConfigId);
+    EXPECT_EQ(report.frames - 1, report.cadenceMismatchFrames);
+}
+
+TEST_F(RefreshRateSimulatorTest, idleTimerLowersRateAfterContentStops) {
+    Trace trace;
+    const auto ui = trace.addLayer("UI");
+    trace.addFrames(ui, LO_FPS, 0, toNs(1s));
+    trace.end = toNs(4s);
+
+    // Without the idle timer, no active layers means Max.
+    const auto withoutIdleTimer = simulate(trace);
+    EXPECT_EQ(HWC_CONFIG_ID_90, withoutIdleTimer.finalConfigId);
+
+    configs().setCurrentConfigId(HWC_CONFIG_ID_60);
+    const auto withIdleTimer = simulate(trace, {.idleTimeout = toNs(250ms)});
+    EXPECT_EQ(HWC_CONFIG_ID_60, withIdleTimer.finalConfigId);
+    EXPECT_GT(withIdleTimer.fractionAt(HWC_CONFIG_ID_60),
+              withoutIdleTimer.fractionAt(HWC_CONFIG_ID_60));
+}
+
+TEST_F(RefreshRateSimulatorTest, touchBoostsUntilTimeout) {
+    Trace trace;
+    const auto video = trace.addLayer("Video");
+    trace.addFrames(video, 30.f, 0, toNs(5s));
+    trace.addTouches(toNs(2s), toNs(3s), toNs(50ms));
+
+    const auto report = simulate(trace, {.touchTimeout = toNs(200ms)});
+
+    EXPECT_EQ(HWC_CONFIG_ID_60, report.finalConfigId);
+    EXPECT_GE(report.timeAtConfig.at(HWC_CONFIG_ID_90), toNs(1200ms));
+    EXPECT_EQ(0u, report.rapidSwitches);
+    EXPECT_EQ(0u, report.cadenceMismatchFrames);
+}
+
+TEST_F(RefreshRateSimulatorTest, jitteredContentDoesNotFlap) {
+    Trace trace;
+    const auto ui = trace.addLayer("UI");
+    trace.addFrames(ui, LO_FPS, 0, toNs(5s), toNs(500us), 0x5eed);
+
+    const auto report = simulate(trace);
+
+    EXPECT_LE(report.switches, 2u);
+    EXPECT_EQ(0u, report.rapidSwitches);
+    EXPECT_EQ(HWC_CONFIG_ID_60, report.finalConfigId);
+}
+
+TEST_F(RefreshRateSimulatorTest, replaysParsedTrace) {
+    std::string text = "# time type layer\n";
+    for (nsecs_t time = 0; time < toNs(3s); time += LO_FPS_PERIOD) {
+        base::StringAppendF(&text, "%" PRId64 " buffer Status bar\n", time);
+    }
+    base::StringAppendF(&text, "%" PRId64 " touch\n", toNs(2s));
+
+    const auto trace = Trace::parse(text);
+    ASSERT_TRUE(trace);
+    ASSERT_EQ(1u, trace->layers.size());
+    EXPECT_EQ("Status bar", trace->layers[0].name);
+
+    const auto report = simulate(*trace);
+    EXPECT_EQ(HWC_CONFIG_ID_60, report.finalConfigId);
+    EXPECT_EQ(0u, report.fasterThanVsyncFrames);
+
+    EXPECT_FALSE(Trace::parse("0 scroll Status bar\n"));
+    EXPECT_FALSE(Trace::parse("0 buffer\n"));
+}
+
+TEST_F(RefreshRateSimulatorTest, replaysLatencyDump) {
+    std::string dump = base::StringPrintf("%" PRId64 "\n", LO_FPS_PERIOD);
+    size_t frames = 0;
+    for (nsecs_t time = LO_FPS_PERIOD; time < toNs(3s); time += 2 * LO_FPS_PERIOD, frames++) {
+        base::StringAppendF(&dump, "%" PRId64 "\t%" PRId64 "\t%" PRId64 "\n", time,
+                            time + LO_FPS_PERIOD, time - LO_FPS_PERIOD / 2);
+    }
+    // Not presented yet, and an unused record.
+    base::StringAppendF(&dump, "%" PRId64 "\t%" PRId64 "\t%" PRId64 "\n", toNs(3s),
+                        std::numeric_limits<nsecs_t>::max(), toNs(3s));
+    dump.append("0\t0\t0\n\n");
+
+    Trace trace;
+    ASSERT_TRUE(trace.addLatencyDump(trace.addLayer("SurfaceView"), dump));
+    EXPECT_EQ(frames + 1, trace.events.size());
+    EXPECT_EQ(toNs(3s), trace.end);
+
+    const auto report = simulate(trace);
+    EXPECT_EQ(HWC_CONFIG_ID_60, report.finalConfigId);
+    EXPECT_EQ(0u, report.cadenceMismatchFrames);
+}
+
+TEST_F(RefreshRateSimulatorTest, parsesRefreshRates) {
+    EXPECT_EQ(std::vector<float>({60.f, 90.f, 120.f}), parseRefreshRates("60,90,120"));
+    EXPECT_EQ(std::vector<float>({59.94f}), parseRefreshRates("59.94"));
+    EXPECT_FALSE(parseRefreshRates(""));
+    EXPECT_FALSE(parseRefreshRates("60,,90"));
+    EXPECT_FALSE(parseRefreshRates("60,0"));
+    EXPECT_FALSE(parseRefreshRates("60Hz"));
+
+    setRefreshRates({60.f, 90.f, 120.f});
+    const auto& max = configs().getMaxRefreshRateByPolicy();
+    EXPECT_EQ(HwcConfigIndexType(2), max.getConfigId());
+}
+
+// Replays recordings when REFRESH_RATE_SIMULATOR_TRACES names one, or a
+// directory of them, e.g. on the host:
+//
+//   export REFRESH_RATE_SIMULATOR_TRACES=~/traces REFRESH_RATE_SIMULATOR_RATES=60,90,120
+//   cd $ANDROID_HOST_OUT/nativetest64/libsurfaceflinger_refreshrate_simulator
+//   ./libsurfaceflinger_refreshrate_simulator --gtest_filter='*replaysRecordedTraces'
+//
+// Files ending in ".latency" hold the output of "dumpsys SurfaceFlinger
+// --latency" for a layer named after the file, and other files are read by
+// Trace::parse. The display has the refresh rates listed in
+// REFRESH_RATE_SIMULATOR_RATES, or 60 and 90 Hz otherwise. The report for
+// each recording is saved as a test property, e.g. with --gtest_output=xml.
+TEST_F(RefreshRateSimulatorTest, replaysRecordedTraces) {
+    const char* const path = std::getenv("REFRESH_RATE_SIMULATOR_TRACES");
+    if (!path) {
+        GTEST_SKIP() << "REFRESH_RATE_SIMULATOR_TRACES is not set";
+    }
+
+    std::vector<float> refreshRates = {LO_FPS, HI_FPS};
+    if (const char* const list = std::getenv("REFRESH_RATE_SIMULATOR_RATES")) {
+        const auto parsed = parseRefreshRates(list);
+        ASSERT_TRUE(parsed) << "Invalid REFRESH_RATE_SIMULATOR_RATES: " << list;
+        refreshRates = *parsed;
+    }
+
+    const auto recordings = findRecordings(path);
+    ASSERT_FALSE(recordings.empty()) << "No recordings at " << path;
+
+    for (const auto& recording : recordings) {
+        SCOPED_TRACE(recording);
+
+        std::string text;
+        ASSERT_TRUE(base::ReadFileToString(recording, &text));
+
+        const std::string name = base::Basename(recording);
+        const std::string latencySuffix = ".latency";
+        std::optional<Trace> trace;
+        if (base::EndsWith(name, latencySuffix)) {
+            trace.emplace();
+            const size_t layer =
+                    trace->addLayer(name.substr(0, name.size() - latencySuffix.size()));
+            if (!trace->addLatencyDump(layer, text)) trace.reset();
+        } else {
+            trace = Trace::parse(text);
+        }
+        ASSERT_TRUE(trace) << "Malformed recording";
+
+        // Each recording starts from a fresh layer history.
+        setRefreshRates(refreshRates);
+        RecordProperty(name, simulate(*trace).dump(configs()));
+    }
+}
+
+} // namespace
+} // namespace android::scheduler
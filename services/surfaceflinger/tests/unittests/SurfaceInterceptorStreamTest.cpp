@@ -0,0 +1,115 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#undef LOG_TAG
+#define LOG_TAG "SurfaceInterceptorStreamTest"
+
+#include <android-base/file.h>
+#include <gtest/gtest.h>
+#include <sys/resource.h>
+
+#include "SurfaceInterceptorStream.h"
+
+namespace android {
+namespace {
+
+using surfaceflinger::Increment;
+using surfaceflinger::Trace;
+
+constexpr int kTransactionCount = 100000;
+constexpr int kWarmUpCount = 10000;
+
+// Peak resident set size in kilobytes.
+long getPeakRss() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void fillTransaction(Increment* increment, int i) {
+    increment->set_time_stamp(i);
+    auto* transaction = increment->mutable_transaction();
+    transaction->set_synchronous(false);
+    transaction->set_animation(false);
+    transaction->clear_surface_change();
+    auto* change = transaction->add_surface_change();
+    change->set_id(i % 32);
+    change->mutable_position()->set_x(i % 1080);
+    change->mutable_position()->set_y(i % 1920);
+    change = transaction->add_surface_change();
+    change->set_id(i % 32);
+    change->mutable_alpha()->set_alpha(0.5f);
+}
+
+TEST(SurfaceInterceptorStreamTest, recordsTransactionsInConstantMemory) {
+    TemporaryFile file;
+    SurfaceInterceptorStream stream;
+    ASSERT_EQ(NO_ERROR, stream.start(file.path));
+
+    // The same increment is reused, as SurfaceInterceptor does, so any growth comes from the
+    // stream itself.
+    Increment increment;
+    int written = 0;
+    for (int i = 0; i < kWarmUpCount; i++) {
+        fillTransaction(&increment, i);
+        written += stream.write(increment);
+    }
+    const long warmRss = getPeakRss();
+
+    for (int i = kWarmUpCount; i < kTransactionCount; i++) {
+        fillTransaction(&increment, i);
+        written += stream.write(increment);
+    }
+    // 90k more transactions would take several MB if they were kept around.
+    EXPECT_LT(getPeakRss() - warmRss, 1024);
+
+    ASSERT_EQ(NO_ERROR, stream.stop());
+    EXPECT_EQ(static_cast<size_t>(kTransactionCount - written), stream.getDroppedCount());
+
+    // The streamed file is a regular trace.
+    std::string contents;
+    ASSERT_TRUE(base::ReadFileToString(file.path, &contents));
+    Trace trace;
+    ASSERT_TRUE(trace.ParseFromString(contents));
+    ASSERT_EQ(written, trace.increment_size());
+    for (int i = 1; i < trace.increment_size(); i++) {
+        EXPECT_LT(trace.increment(i - 1).time_stamp(), trace.increment(i).time_stamp());
+    }
+    EXPECT_EQ(2, trace.increment(0).transaction().surface_change_size());
+}
+
+TEST(SurfaceInterceptorStreamTest, dropsIncrementsWhenBufferIsFull) {
+    TemporaryFile file;
+    // Too small for even one increment.
+    SurfaceInterceptorStream stream(8);
+    ASSERT_EQ(NO_ERROR, stream.start(file.path));
+
+    Increment increment;
+    fillTransaction(&increment, 1);
+    EXPECT_FALSE(stream.write(increment));
+    ASSERT_EQ(NO_ERROR, stream.stop());
+    EXPECT_EQ(1u, stream.getDroppedCount());
+}
+
+TEST(SurfaceInterceptorStreamTest, dropsIncrementsWhenNotStarted) {
+    SurfaceInterceptorStream stream;
+    Increment increment;
+    fillTransaction(&increment, 1);
+    EXPECT_FALSE(stream.write(increment));
+}
+
+} // namespace
+} // namespace android
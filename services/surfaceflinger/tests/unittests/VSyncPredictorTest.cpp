@@ -27,7 +27,11 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <random>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 
 using namespace testing;
@@ -464,6 +468,210 @@ TEST_F(VSyncPredictorTest, InconsistentVsyncValueIsFlushedEventually) {
     EXPECT_FALSE(tracker.needsMoreSamples());
 }
 
+// The regression as VSyncPredictor computed it before it kept running sums: over
+// all the timestamps in the history, for every new timestamp.
+class FullRegression {
+public:
+    FullRegression(nsecs_t idealPeriod, size_t historySize, size_t minimumSamplesForPrediction,
+                   uint32_t outlierTolerancePercent)
+          : kHistorySize(historySize),
+            kMinimumSamplesForPrediction(minimumSamplesForPrediction),
+            kOutlierTolerancePercent(outlierTolerancePercent),
+            mIdealPeriod(idealPeriod) {
+        mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
+    }
+
+    bool addVsyncTimestamp(nsecs_t timestamp) {
+        if (!validate(timestamp)) {
+            if (mTimestamps.size() < kMinimumSamplesForPrediction) {
+                clearTimestamps();
+            } else if (!mTimestamps.empty()) {
+                mKnownTimestamp = std::max(timestamp,
+                                           *std::max_element(mTimestamps.begin(),
+                                                             mTimestamps.end()));
+            } else {
+                mKnownTimestamp = timestamp;
+            }
+            return false;
+        }
+
+        if (mTimestamps.size() != kHistorySize) {
+            mTimestamps.push_back(timestamp);
+            mLastTimestampIndex = next(mLastTimestampIndex);
+        } else {
+            mLastTimestampIndex = next(mLastTimestampIndex);
+            mTimestamps[mLastTimestampIndex] = timestamp;
+        }
+
+        if (mTimestamps.size() < kMinimumSamplesForPrediction) {
+            mRateMap[mIdealPeriod] = {mIdealPeriod, 0};
+            return true;
+        }
+
+        std::vector<nsecs_t> vsyncTS(mTimestamps.size());
+        std::vector<nsecs_t> ordinals(mTimestamps.size());
+        auto const oldest = *std::min_element(mTimestamps.begin(), mTimestamps.end());
+        auto& model = mRateMap[mIdealPeriod];
+        auto const currentPeriod = std::get<0>(model);
+        for (auto i = 0u; i < mTimestamps.size(); i++) {
+            vsyncTS[i] = mTimestamps[i] - oldest;
+            ordinals[i] = ((vsyncTS[i] + (currentPeriod / 2)) / currentPeriod) * 1000;
+        }
+
+        auto const meanTS = calculate_mean(vsyncTS);
+        auto const meanOrdinal = calculate_mean(ordinals);
+        auto top = 0ll;
+        auto bottom = 0ll;
+        for (auto i = 0u; i < vsyncTS.size(); i++) {
+            top += (vsyncTS[i] - meanTS) * (ordinals[i] - meanOrdinal);
+            bottom += (ordinals[i] - meanOrdinal) * (ordinals[i] - meanOrdinal);
+        }
+
+        if (bottom == 0) {
+            model = {mIdealPeriod, 0};
+            clearTimestamps();
+            return false;
+        }
+
+        nsecs_t const period = top * 1000 / bottom;
+        nsecs_t const intercept = meanTS - (period * meanOrdinal / 1000);
+        if (std::abs(period - mIdealPeriod) * 100 / mIdealPeriod >= kOutlierTolerancePercent) {
+            model = {mIdealPeriod, 0};
+            clearTimestamps();
+            return false;
+        }
+
+        model = {period, intercept};
+        return true;
+    }
+
+    void setPeriod(nsecs_t period) {
+        mIdealPeriod = period;
+        if (mRateMap.find(period) == mRateMap.end()) {
+            mRateMap[mIdealPeriod] = {period, 0};
+        }
+        clearTimestamps();
+    }
+
+    std::tuple<nsecs_t, nsecs_t> getVSyncPredictionModel() const {
+        return mRateMap.at(mIdealPeriod);
+    }
+
+private:
+    size_t next(int i) const { return (i + 1) % mTimestamps.size(); }
+
+    bool validate(nsecs_t timestamp) const {
+        if (mTimestamps.empty()) {
+            return true;
+        }
+        auto const percent =
+                (timestamp - mTimestamps[mLastTimestampIndex]) % mIdealPeriod * 100 / mIdealPeriod;
+        return percent < kOutlierTolerancePercent || percent > (100 - kOutlierTolerancePercent);
+    }
+
+    void clearTimestamps() {
+        if (!mTimestamps.empty()) {
+            auto const maxRb = *std::max_element(mTimestamps.begin(), mTimestamps.end());
+            mKnownTimestamp = mKnownTimestamp ? std::max(*mKnownTimestamp, maxRb) : maxRb;
+            mTimestamps.clear();
+            mLastTimestampIndex = 0;
+        }
+    }
+
+    size_t const kHistorySize;
+    size_t const kMinimumSamplesForPrediction;
+    size_t const kOutlierTolerancePercent;
+
+    nsecs_t mIdealPeriod;
+    std::optional<nsecs_t> mKnownTimestamp;
+    std::unordered_map<nsecs_t, std::tuple<nsecs_t, nsecs_t>> mRateMap;
+    int mLastTimestampIndex = 0;
+    std::vector<nsecs_t> mTimestamps;
+};
+
+struct VSyncPredictorEquivalenceTest : VSyncPredictorTest {
+    FullRegression reference{mPeriod, kHistorySize, kMinimumSamplesForPrediction,
+                             kOutlierTolerancePercent};
+    std::mt19937 mRandom{0x5eed};
+
+    // Adds |timestamp| to both the tracker and the reference, and checks that
+    // they come up with the same model.
+    void addAndCompare(nsecs_t timestamp) {
+        SCOPED_TRACE(timestamp);
+        EXPECT_THAT(tracker.addVsyncTimestamp(timestamp),
+                    Eq(reference.addVsyncTimestamp(timestamp)));
+        EXPECT_THAT(tracker.getVSyncPredictionModel(), Eq(reference.getVSyncPredictionModel()));
+    }
+
+    nsecs_t jitter(nsecs_t amplitude) {
+        return std::uniform_int_distribution<nsecs_t>(-amplitude, amplitude)(mRandom);
+    }
+};
+
+TEST_F(VSyncPredictorEquivalenceTest, matchesFullRegressionWithJitter) {
+    for (auto i = 0; i < 500; i++) {
+        addAndCompare((mNow += mPeriod) + jitter(mPeriod / 10));
+    }
+}
+
+TEST_F(VSyncPredictorEquivalenceTest, matchesFullRegressionWithMissedVsyncs) {
+    for (auto i = 0; i < 500; i++) {
+        mNow += mPeriod * std::uniform_int_distribution<nsecs_t>(1, 4)(mRandom);
+        addAndCompare(mNow + jitter(mPeriod / 20));
+    }
+}
+
+TEST_F(VSyncPredictorEquivalenceTest, matchesFullRegressionWithOutliers) {
+    for (auto i = 0; i < 500; i++) {
+        mNow += mPeriod;
+        // Every so often, a timestamp out of phase which is to be rejected.
+        addAndCompare(i % 13 == 12 ? mNow + mPeriod / 2 : mNow + jitter(mPeriod / 20));
+    }
+}
+
+TEST_F(VSyncPredictorEquivalenceTest, matchesFullRegressionAcrossPeriodChanges) {
+    nsecs_t const periods[] = {mPeriod, mPeriod * 2, mPeriod * 3 / 2, mPeriod};
+    for (auto const period : periods) {
+        tracker.setPeriod(period);
+        reference.setPeriod(period);
+        for (auto i = 0; i < 100; i++) {
+            addAndCompare((mNow += period) + jitter(period / 20));
+        }
+    }
+}
+
+TEST_F(VSyncPredictorEquivalenceTest, matchesFullRegressionAfterALongUptime) {
+    mNow = 100_years;
+    for (auto i = 0; i < 500; i++) {
+        addAndCompare((mNow += mPeriod) + jitter(mPeriod / 10));
+    }
+}
+
+// Predictions are made concurrently with new timestamps, and must always be
+// consistent. The cost of both is measured by libsurfaceflinger_benchmarks.
+TEST_F(VSyncPredictorTest, predictsConsistentlyWhileTimestampsAreAdded) {
+    constexpr auto kIterations = 100000;
+    for (size_t i = 0; i < kHistorySize; i++) {
+        tracker.addVsyncTimestamp(mNow += mPeriod);
+    }
+
+    std::atomic<bool> done = false;
+    std::atomic<nsecs_t> now = mNow;
+    std::thread reader([&] {
+        while (!done) {
+            auto const timePoint = now.load();
+            EXPECT_THAT(tracker.nextAnticipatedVSyncTimeFrom(timePoint), Ge(timePoint));
+            auto const [slope, intercept] = tracker.getVSyncPredictionModel();
+            EXPECT_THAT(slope, IsCloseTo(mPeriod, mMaxRoundingError));
+        }
+    });
+    for (auto i = 0; i < kIterations; i++) {
+        tracker.addVsyncTimestamp(now += mPeriod);
+    }
+    done = true;
+    reader.join();
+}
+
 } // namespace android::scheduler
 
 // TODO(b/129481165): remove the #pragma below and fix conversion issues
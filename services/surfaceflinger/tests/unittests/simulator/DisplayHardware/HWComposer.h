@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+// Stands in for the real DisplayHardware/HWComposer.h in
+// libsurfaceflinger_refreshrate_simulator. RefreshRateConfigs only needs the
+// display configs from it, and the real header pulls in the composer HAL, which
+// isn't available on the host.
+
+#include <log/log.h>
+#include <utils/Timers.h>
+
+#include <cstdint>
+#include <memory>
+
+namespace android::HWC2 {
+
+class Display {
+public:
+    class Config {
+    public:
+        class Builder {
+        public:
+            Builder(Display& /*display*/, uint32_t id) : mConfig(new Config(id)) {}
+
+            std::shared_ptr<const Config> build() {
+                return std::const_pointer_cast<const Config>(std::move(mConfig));
+            }
+
+            Builder& setWidth(int32_t width) {
+                mConfig->mWidth = width;
+                return *this;
+            }
+            Builder& setHeight(int32_t height) {
+                mConfig->mHeight = height;
+                return *this;
+            }
+            Builder& setVsyncPeriod(int32_t vsyncPeriod) {
+                mConfig->mVsyncPeriod = vsyncPeriod;
+                return *this;
+            }
+            Builder& setDpiX(int32_t dpiX) {
+                mConfig->mDpiX = dpiX / 1000.0f;
+                return *this;
+            }
+            Builder& setDpiY(int32_t dpiY) {
+                mConfig->mDpiY = dpiY / 1000.0f;
+                return *this;
+            }
+            Builder& setConfigGroup(int32_t configGroup) {
+                mConfig->mConfigGroup = configGroup;
+                return *this;
+            }
+
+        private:
+            std::shared_ptr<Config> mConfig;
+        };
+
+        uint32_t getId() const { return mId; }
+
+        int32_t getWidth() const { return mWidth; }
+        int32_t getHeight() const { return mHeight; }
+        nsecs_t getVsyncPeriod() const { return mVsyncPeriod; }
+        float getDpiX() const { return mDpiX; }
+        float getDpiY() const { return mDpiY; }
+        int32_t getConfigGroup() const { return mConfigGroup; }
+
+    private:
+        explicit Config(uint32_t id) : mId(id) {}
+
+        uint32_t mId;
+
+        int32_t mWidth = -1;
+        int32_t mHeight = -1;
+        nsecs_t mVsyncPeriod = -1;
+        float mDpiX = -1.0f;
+        float mDpiY = -1.0f;
+        int32_t mConfigGroup = -1;
+    };
+};
+
+} // namespace android::HWC2